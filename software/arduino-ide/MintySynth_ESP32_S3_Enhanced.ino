@@ -9,10 +9,25 @@
  */
 
 #include <Adafruit_GFX.h>
-#include <Adafruit_ILI9341.h>
+#include <FrameDisplay.h>        // From software/lib/MintyDisplay, see README
 #include <SPI.h>
-#include <driver/i2s.h>
-#include <Preferences.h>
+#include <EnvelopeGenerator.h>   // From software/lib/MintySynth, see README
+#include <SynthTables.h>
+#include <SpscQueue.h>
+#include <AudioOutput.h>
+#include <LatencyTuner.h>
+#include <InputScanner.h>
+#include <EncoderInput.h>
+#include <UiWidgets.h>
+#include <AudioTap.h>
+#include <AudioAnalysis.h>
+#include <LatencyProbe.h>
+#include <SequencerClock.h>
+#include <EventScheduler.h>
+#include <PatternStore.h>
+#include <PresetLog.h>
+#include <ParamSnapshot.h>
+#include <atomic>
 
 // Display Configuration
 #define TFT_CS   10
@@ -21,7 +36,20 @@
 #define TFT_MOSI 11
 #define TFT_CLK  13
 
-Adafruit_ILI9341 tft = Adafruit_ILI9341(TFT_CS, TFT_DC, TFT_MOSI, TFT_CLK, TFT_RST);
+FrameDisplay tft(TFT_CS, TFT_DC, TFT_MOSI, TFT_CLK, TFT_RST);   // Hardware SPI + DMA, drawn in PSRAM
+
+// Retained-mode widgets: each one redraws only what changed since the last frame
+class NeonStepGrid : public UiStepGrid {
+protected:
+  void drawCell(UiCanvas& canvas, uint8_t cell, int16_t x, int16_t y, uint8_t flags) override;
+};
+
+UiGfxCanvas<FrameDisplay> canvas(tft);
+UiScreen screen;
+NeonStepGrid step_grid;
+UiTextField status_line;
+UiTextField encoder_lines[5];
+UiTextField tuner_line;
 
 // Hardware Pin Definitions
 const uint8_t MATRIX_ROWS[4] = {38, 37, 36, 35};
@@ -29,6 +57,7 @@ const uint8_t MATRIX_COLS[4] = {48, 47, 21, 46};
 const uint8_t ENCODER_CLK[5] = {4, 7, 17, 1, 41};
 const uint8_t ENCODER_DT[5] = {5, 15, 18, 2, 40};
 const uint8_t ENCODER_SW[5] = {6, 16, 8, 42, 39};
+const int16_t ENCODER_RANGES[5][2] = {{40, 300}, {0, 127}, {0, 127}, {0, 127}, {0, 100}};  // Tempo, Pitch, Length, Envelope, Swing
 const uint8_t DIRECT_BUTTONS[3] = {45, 3, 19};  // Button 1=GPIO45, Button 2=GPIO3, Button 3=GPIO19
 
 // Audio Configuration
@@ -36,12 +65,18 @@ const uint8_t DIRECT_BUTTONS[3] = {45, 3, 19};  // Button 1=GPIO45, Button 2=GPI
 // #define SERIAL_AUDIO_DEBUG  // Uncomment for audio debugging
 
 // I2S Audio Configuration (for PCM5102)
-#define I2S_NUM         I2S_NUM_0
 #define I2S_BCK_PIN     12
 #define I2S_WS_PIN      20  // LRCLK (Word Select) - moved from GPIO45 to GPIO20
 #define I2S_DATA_PIN    0
 #define SAMPLE_RATE     20000
-#define I2S_BUFFER_SIZE 512
+#define I2S_BUFFER_SIZE 128   // Frames per DMA buffer, rendered in place
+#define I2S_DMA_BUFFERS 8     // Latency 1-7 buffers (6.4-45 ms), tuned to the render load
+
+// Dual-core layout: audio renders on core 1, inputs and display on core 0
+#define AUDIO_TASK_CORE      1
+#define AUDIO_TASK_PRIORITY  (configMAX_PRIORITIES - 2)
+#define UI_TASK_CORE         0
+#define UI_TASK_PRIORITY     1
 
 // Enhanced Color Palette - Neon Theme (Fixed for RGB565)
 #define COLOR_BG        0x0000    // Pure black background
@@ -59,10 +94,11 @@ const uint8_t DIRECT_BUTTONS[3] = {45, 3, 19};  // Button 1=GPIO45, Button 2=GPI
 
 // Synthesis Constants
 #define NUM_VOICES      4
-#define NUM_STEPS       16
+#define NUM_STEPS       16        // Keys and grid: one page of the pattern
 #define NUM_WAVEFORMS   15
 #define NUM_SCALES      8
 #define WAVETABLE_SIZE  256
+#define WAVETABLE_MIP_LEVELS 8   // Band-limited levels, one octave apart
 
 // Waveform Types
 enum Waveforms {
@@ -98,41 +134,21 @@ const int8_t scales[NUM_SCALES][12] = {
   {0, 2, 4, 7, 9, 0, 2, 4, 7, 9, 0, 2}     // Pentatonic
 };
 
-// Enhanced Encoder Structure
+// Enhanced Encoder Structure - rotation is counted by encoder_input
 struct EncoderState {
-  bool last_clk = HIGH;
-  bool last_dt = HIGH;
   int position = 64;
   bool button = false;
   bool button_pressed = false;
-  uint32_t last_change_time = 0;
-  int8_t direction_buffer[4] = {0, 0, 0, 0};
-  uint8_t buffer_index = 0;
-  int8_t last_valid_direction = 0;
 };
 
 EncoderState encoders[5];
-
-// ADSR Envelope stages
-enum EnvelopeStage {
-  ENV_ATTACK = 0,
-  ENV_DECAY = 1,
-  ENV_SUSTAIN = 2,
-  ENV_RELEASE = 3,
-  ENV_OFF = 4
-};
+EncoderInput encoder_input;   // PCNT units for the first four, interrupts for the fifth
 
 // Enhanced Voice Structure with full ADSR
 struct Voice {
   bool active = false;
-  uint32_t phase_accumulator = 0;
-  uint32_t frequency_tuning_word = 0;
   uint8_t waveform = WAVE_SINE;
-  
-  // ADSR Envelope System
-  EnvelopeStage envelope_stage = ENV_OFF;
-  uint32_t envelope_counter = 0;
-  uint16_t current_amplitude = 0;      // Current envelope level (0-32767)
+  uint8_t mip_level = 0;               // Band-limited table level for this note
   
   // ADSR Parameters (0-127 each)
   uint8_t attack_time = 10;            // Attack time
@@ -144,23 +160,50 @@ struct Voice {
   uint8_t note = 60;
   uint16_t length = 500;               // Note duration in ms
   uint32_t note_start_time = 0;
-  uint32_t note_release_time = 0;      // When release stage started
-  bool note_released = false;          // Whether note is in release phase
   
-  // Sequence data
-  bool step_sequence[NUM_STEPS] = {false};
-  uint8_t step_notes[NUM_STEPS];
   uint8_t volume = 100;         // 0-127
   int8_t transpose = 0;         // -24 to +24 semitones
   uint8_t swing_offset = 0;     // Per-voice swing
 } voices[NUM_VOICES];
 
+// Per-sample oscillator state, kept out of Voice as parallel arrays so the
+// audio loop touches a few packed cache lines instead of whole Voice structs
+struct VoiceBank {
+  uint32_t phase_accumulator[NUM_VOICES];
+  uint32_t frequency_tuning_word[NUM_VOICES];
+  uint16_t current_amplitude[NUM_VOICES];   // Current envelope level (0-32767)
+  EnvelopeGenerator envelope[NUM_VOICES];   // ADSR state, advanced per sample
+} voice_bank;
+
+// Note, envelope and transport commands from the UI task to the audio task. Only
+// the audio task touches voice_bank; the queue is lock-free (one producer, one consumer).
+enum AudioCommandType {
+  CMD_NOTE_ON = 0,
+  CMD_NOTE_OFF,
+  CMD_UPDATE_ENVELOPE,
+  CMD_SEQ_START,
+  CMD_SEQ_STOP,
+  CMD_SEQ_TEMPO,
+  CMD_SEQ_SWING
+};
+
+struct AudioCommand {
+  uint8_t type;
+  uint8_t voice;
+  uint8_t note;
+  uint32_t key_us;     // Note-on from a key: its press and the send, for the latency probe
+  uint32_t sent_us;
+  uint16_t value;      // Tempo in BPM, swing 0-100
+};
+
+SpscQueue<AudioCommand, 32> audio_commands;
+volatile uint32_t dropped_commands = 0;
+
 // Enhanced Sequencer Structure
 struct Sequencer {
   bool playing = false;
-  uint8_t current_step = 0;
-  uint32_t last_step_time = 0;
-  uint16_t step_length = 250;
+  volatile uint8_t current_step = 0;   // Last step played, set by the audio task
+  uint16_t tempo = 120;                // BPM, steps are 16ths
   uint8_t swing = 0;
   OperatingMode mode = MODE_LIVE;
   uint8_t current_voice = 0;
@@ -182,8 +225,6 @@ struct UIState {
   // Fun animations
   float record_angle = 0.0;
   uint32_t last_record_update = 0;
-  int16_t waveform_history[80] = {0};  // For waveform display
-  uint8_t waveform_index = 0;
   uint32_t last_waveform_update = 0;
   
   // Dancing person animation
@@ -191,30 +232,60 @@ struct UIState {
   uint32_t last_dance_update = 0;
 } ui;
 
-// Input States
-bool matrix_keys[16] = {false};
-bool last_matrix_keys[16] = {false};
-bool direct_button_state[3] = {false};
-bool last_direct_button_state[3] = {false};
+// Input States - matrix keys 0-15 and direct buttons 16-18, scanned from a timer
+InputScanner key_scanner;
 
 // ADSR parameter selection
 uint8_t current_adsr_param = 0; // 0=Attack, 1=Decay, 2=Sustain, 3=Release
 const char* adsr_param_names[4] = {"ATK", "DEC", "SUS", "REL"};
 
-// Non-blocking Event Scheduler for Per-Voice Swing
-#define MAX_SCHEDULED_EVENTS 16
-struct ScheduledEvent {
-  bool active = false;
-  uint32_t trigger_time = 0;
-  uint8_t voice = 0;
-  uint8_t note = 60;
+// Swung notes and every note's note-off, on the sample clock of the audio task
+EventScheduler note_events;
+uint16_t note_ids[NUM_VOICES];   // Counts each voice's notes, so a stale note-off is ignored
+
+// Audio
+AudioOutput i2s_output;
+LatencyTuner latency_tuner;
+AudioTap audio_tap;            // Copy of the mix for the scope, filled by the audio task
+AudioAnalyzer analyzer;        // Scope, spectrum and tuner, run on the UI side
+LatencyProbe latency_probe;    // Key press to DAC, 'l' on the serial port prints it
+SequencerClock seq_clock;      // Steps on the sample clock, owned by the audio task
+uint64_t sample_clock = 0;     // Frames rendered so far
+
+// Published by the audio task every buffer and printed by the UI task,
+// since a Serial.printf can block on USB CDC and starve the DMA
+struct AudioStats {
+  std::atomic<uint32_t> buffers;          // Rendered since the last report
+  std::atomic<uint8_t> active_voices;
+  std::atomic<uint16_t> events_pending;
+  std::atomic<uint16_t> events_peak;
+  std::atomic<uint32_t> events_dropped;
+  std::atomic<int16_t> last_left;         // First frame of the last buffer
+  std::atomic<int16_t> last_right;
 };
+AudioStats audio_stats;
+PresetLog preset_log;           // Saved slots, appended to a log on LittleFS
 
-ScheduledEvent event_queue[MAX_SCHEDULED_EVENTS];
+// Patterns as a bitset word per voice with packed notes (PatternStore.h).
+// The UI edits `pattern`, its own copy, and updatePatterns() hands it to
+// the audio task through a snapshot, with the next pattern of the song
+// cued beside it. The audio task only reads the snapshot and counts the
+// patterns it starts, so a song moves on exactly at the end of each
+// pattern and an edit is never torn or overwritten.
+struct PatternPair {
+  StepPattern playing;
+  StepPattern next;                 // Takes over at the next step 0
+  bool next_cued;                   // False: `next` is `playing` again, edits go to both
+  uint32_t position;                // patterns_started when `playing` took over
+};
 
-// Audio
-int16_t audio_buffer[I2S_BUFFER_SIZE * 2];
-Preferences preferences;
+StepPattern pattern;                // UI task only
+ParamSnapshot<PatternPair> pattern_snapshot;
+std::atomic<uint32_t> patterns_started(0);
+PatternStore pattern_bank;          // Slots 0-7, saved from SONG mode
+SongChain song;                     // Chained from SONG mode with REC on
+uint32_t song_position = 0;         // Song patterns cued so far
+bool song_playing = false;
 
 // Voice Names with Neon Style
 const char* voice_names[4] = {"BASS", "LEAD", "PAD", "PERC"};
@@ -244,55 +315,66 @@ const int16_t wavetable_sine[WAVETABLE_SIZE] PROGMEM = {
   -12539, -11793, -11039, -10278, -9512, -8739, -7962, -7179, -6393, -5602, -4808, -4011, -3212, -2410, -1608, -804
 };
 
-// MIDI note to frequency conversion
-const uint32_t note_frequencies[128] PROGMEM = {
-  0x001A, 0x001C, 0x001E, 0x001F, 0x0021, 0x0023, 0x0025, 0x0028, 0x002A, 0x002D, 0x002F, 0x0032,
-  0x0035, 0x0038, 0x003C, 0x003F, 0x0043, 0x0047, 0x004B, 0x0050, 0x0055, 0x005A, 0x005F, 0x0065,
-  0x006B, 0x0071, 0x0078, 0x007F, 0x0087, 0x008F, 0x0097, 0x00A0, 0x00AA, 0x00B4, 0x00BE, 0x00CA,
-  0x00D6, 0x00E3, 0x00F0, 0x00FE, 0x010E, 0x011E, 0x012F, 0x0141, 0x0154, 0x0168, 0x017D, 0x0194,
-  0x01AC, 0x01C6, 0x01E1, 0x01FD, 0x021C, 0x023C, 0x025E, 0x0282, 0x02A8, 0x02D0, 0x02FB, 0x0329,
-  0x0359, 0x038C, 0x03C2, 0x03FB, 0x0438, 0x0478, 0x04BC, 0x0504, 0x0550, 0x05A1, 0x05F7, 0x0652,
-  0x06B2, 0x0718, 0x0784, 0x07F6, 0x0870, 0x08F0, 0x0978, 0x0A08, 0x0AA1, 0x0B43, 0x0BEF, 0x0CA4,
-  0x0D65, 0x0E31, 0x0F09, 0x0FED, 0x10E0, 0x11E1, 0x12F1, 0x1411, 0x1543, 0x1687, 0x17DE, 0x1949,
-  0x1ACA, 0x1C62, 0x1E12, 0x1FDB, 0x21C0, 0x23C2, 0x25E3, 0x2823, 0x2A86, 0x2D0E, 0x2FBC, 0x3292,
-  0x3594, 0x38C4, 0x3C24, 0x3FB7, 0x4381, 0x4785, 0x4BC6, 0x5047, 0x550D, 0x5A1C, 0x5F78, 0x6525,
-  0x6B29, 0x7188, 0x7848, 0x7F6F, 0x8703, 0x8F0A, 0x978C, 0xA08F
+// Band-limited wavetables for the discontinuous waveforms, built at boot
+// Level L holds harmonics 1..(128 >> L) so nothing folds back above Nyquist
+enum BandLimitedWave {
+  BL_SAWTOOTH = 0, BL_RAMP, BL_SQUARE, BL_PULSE_25, BL_PULSE_12, NUM_BL_WAVES
 };
 
+int16_t bandlimited_tables[NUM_BL_WAVES][WAVETABLE_MIP_LEVELS][WAVETABLE_SIZE];
+
+// MIDI note to 32-bit tuning word, computed at compile time for SAMPLE_RATE
+static constexpr SynthTuningTable note_tuning = synthMakeTuning(SAMPLE_RATE, TUNING_EQUAL);
+
 // Function Prototypes
 void setup();
 void loop();
 void initializeSystem();
 void readInputs();
-void processSequencer();
+uint64_t playSequencer(uint64_t frame);
 void generateAudio();
 uint16_t calculateADSR(uint8_t voice);
-void scheduleNoteEvent(uint8_t voice, uint8_t note, uint32_t delay_ms);
-void processNoteQueue();
+void updateEnvelopeRates(uint8_t voice);
+void playNote(uint8_t voice, uint8_t note, uint64_t frame);
 void playBootUpSound();
 void loadDemoSong();
 void startDemoSong();
 void updateDisplay();
+void initializeScreen();
 void drawNeonInterface();
 void drawEncoderValues();
 void drawVaporwaveLoadingScreen();
 void drawStatusLine();
 void drawBigStepSequencer();
 void drawWaveformDisplay();
+void updateWaveformDisplay();
 void drawBigVoiceIndicators();
 void drawParameterDisplay();
 void handleEncoderChange(int encoder, int old_value, int new_value);
-void handleMatrixKey(int key, bool pressed);
+void handleMatrixKey(int key, bool pressed, uint32_t key_us);
 void handleDirectButton(int button, bool pressed);
 void changeMode(OperatingMode new_mode);
 void savePattern(uint8_t slot);
 void loadPattern(uint8_t slot);
-void triggerNote(uint8_t voice, uint8_t note);
+void cuePattern(uint8_t slot);
+void updatePatterns();
+void triggerNote(uint8_t voice, uint8_t note, uint32_t key_us = 0);
 void stopNote(uint8_t voice);
-int16_t getWaveformSample(uint8_t waveform, uint32_t phase);
+void sendEnvelopeUpdate(uint8_t voice);
+void sendAudioCommand(uint8_t type, uint8_t voice, uint8_t note, uint32_t key_us = 0);
+void sendSequencerCommand(uint8_t type, uint16_t value = 0);
+void handleSerialCommand(int command);
+void printAudioStats();
+void processAudioCommands();
+void startVoice(uint8_t voice, uint8_t note);
+void releaseVoice(uint8_t voice);
+void audioTask(void* param);
+void uiTask(void* param);
+int16_t getWaveformSample(uint8_t waveform, uint32_t phase, uint8_t mip_level = 0);
 uint32_t midiNoteToFrequencyWord(uint8_t note);
+void buildBandLimitedTables();
+uint8_t getMipLevel(uint32_t freq_word);
 uint8_t applyScale(uint8_t note, uint8_t scale_type);
-int8_t getDirection(uint8_t last_state, uint8_t current_state);
 
 void setup() {
   Serial.begin(115200);
@@ -304,20 +386,22 @@ void setup() {
   initializeSystem();
   
   // Initialize default patterns
+  pattern.clear(NUM_STEPS, 60);
   for (int v = 0; v < NUM_VOICES; v++) {
     voices[v].waveform = v % NUM_WAVEFORMS;
     voices[v].volume = 80;
     voices[v].transpose = 0;
     
     for (int s = 0; s < NUM_STEPS; s++) {
-      voices[v].step_notes[s] = 60 + v * 12 + (s % 8);
       // Create different default patterns for each voice
+      bool on = false;
       switch (v) {
-        case 0: voices[v].step_sequence[s] = (s % 4 == 0); break;        // Kick pattern
-        case 1: voices[v].step_sequence[s] = (s % 8 == 4); break;        // Snare pattern
-        case 2: voices[v].step_sequence[s] = (s % 2 == 1); break;        // Hi-hat pattern
-        case 3: voices[v].step_sequence[s] = (s == 0 || s == 10); break; // Accent pattern
+        case 0: on = (s % 4 == 0); break;        // Kick pattern
+        case 1: on = (s % 8 == 4); break;        // Snare pattern
+        case 2: on = (s % 2 == 1); break;        // Hi-hat pattern
+        case 3: on = (s == 0 || s == 10); break; // Accent pattern
       }
+      pattern.setStep(v, s, 60 + v * 12 + (s % 8), 127, on);
     }
   }
   
@@ -341,40 +425,68 @@ void setup() {
   Serial.println("Press PLAY/STOP to start demo song!");
   
   ui.needs_full_redraw = true;
+  
+  // The audio task starts on the patterns built above
+  PatternPair patterns = { pattern, pattern, false, 0 };
+  pattern_snapshot.reset(patterns);
+  
+  // Audio gets core 1 to itself; a slow redraw can no longer starve the DMA
+  xTaskCreatePinnedToCore(audioTask, "audio", 4096, NULL, AUDIO_TASK_PRIORITY, NULL, AUDIO_TASK_CORE);
+  xTaskCreatePinnedToCore(uiTask, "ui", 8192, NULL, UI_TASK_PRIORITY, NULL, UI_TASK_CORE);
 }
 
 void loop() {
-  uint32_t current_time = millis();
-  static uint32_t last_audio_time = 0;
-  static uint32_t last_display_time = 0;
-  
-  // Read inputs
-  readInputs();
-  
-  // Process scheduled note events (for per-voice swing)
-  processNoteQueue();
-  
-  // Process sequencer
-  if (sequencer.playing) {
-    processSequencer();
-  }
-  
-  // Generate audio
-  if (current_time - last_audio_time >= 25) {
-    generateAudio();
-    last_audio_time = current_time;
-  }
-  
-  // Update display
-  if (current_time - last_display_time >= 50) {
-    updateDisplay();
-    last_display_time = current_time;
+  // Everything runs in audioTask and uiTask
+  vTaskDelete(NULL);
+}
+
+void audioTask(void* param) {
+  for (;;) {
+    pattern_snapshot.update();   // Newest patterns from the UI, once per buffer
+    processAudioCommands();
+    generateAudio();    // Waits for the DMA to finish a buffer, then fills it in place
   }
+}
+
+void uiTask(void* param) {
+  uint32_t last_display_time = 0;
+  uint32_t last_report_time = 0;
   
-  // Update blink state for UI elements
-  if (current_time - ui.last_blink >= 500) {
-    ui.blink_state = !ui.blink_state;
-    ui.last_blink = current_time;
+  for (;;) {
+    uint32_t current_time = millis();
+    
+    // Read inputs
+    readInputs();
+    
+    // Serial: 'l' prints the key-to-DAC latency breakdown, 'r' clears it
+    if (Serial.available()) {
+      handleSerialCommand(Serial.read());
+    }
+    
+    // Hand the edits to the audio task and keep the next pattern of the song cued
+    updatePatterns();
+    
+    // Update display
+    if (current_time - last_display_time >= 50) {
+      updateDisplay();
+      tft.flush();    // Pushed by the display task, returns at once
+      last_display_time = current_time;
+    }
+    
+    // Update blink state for UI elements
+    if (current_time - ui.last_blink >= 500) {
+      ui.blink_state = !ui.blink_state;
+      ui.last_blink = current_time;
+    }
+    
+    // Audio task counters every 2 seconds, printed here so a stalled USB
+    // port can only hold up the UI
+    if (current_time - last_report_time >= 2000) {
+      printAudioStats();
+      last_report_time = current_time;
+    }
+    
+    delay(1);   // Let the idle task feed the watchdog
   }
 }
 
@@ -389,122 +501,93 @@ void initializeSystem() {
   
   // VAPORWAVE PSYCHEDELIC LOADING SCREEN
   drawVaporwaveLoadingScreen();
+  tft.flush();
+  
+  // Build band-limited wavetables while the loading screen is up
+  buildBandLimitedTables();
   
   delay(2000);  // Show the screen for 2 seconds (no audio during init)
   
   // Clear again after startup
   tft.fillScreen(0x0000);
+  initializeScreen();
   
   // Initialize I2S Audio for PCM5102
-  i2s_config_t i2s_config = {
-    .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
-    .sample_rate = SAMPLE_RATE,
-    .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
-    .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
-    .communication_format = I2S_COMM_FORMAT_STAND_I2S,
-    .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-    .dma_buf_count = 8,
-    .dma_buf_len = I2S_BUFFER_SIZE,
-    .use_apll = false,
-    .tx_desc_auto_clear = true
-  };
-  
-  i2s_pin_config_t pin_config = {
-    .bck_io_num = I2S_BCK_PIN,
-    .ws_io_num = I2S_WS_PIN,
-    .data_out_num = I2S_DATA_PIN,
-    .data_in_num = I2S_PIN_NO_CHANGE
-  };
-  
-  i2s_driver_install(I2S_NUM, &i2s_config, 0, NULL);
-  i2s_set_pin(I2S_NUM, &pin_config);
-  
-  Serial.println("I2S Audio initialized:");
+  AudioOutputConfig i2s_config;
+  audioOutputDefaults(i2s_config, SAMPLE_RATE);
+  i2s_config.bufferCount = I2S_DMA_BUFFERS;
+  i2s_config.bufferFrames = I2S_BUFFER_SIZE;
+  i2s_config.bckPin = I2S_BCK_PIN;
+  i2s_config.wsPin = I2S_WS_PIN;
+  i2s_config.dataPin = I2S_DATA_PIN;
+  bool i2s_ok = i2s_output.begin(i2s_config);
+  
+  // Start at the full ring and let the tuner bring the latency down
+  uint32_t period_us = i2s_output.getBufferPeriodUs();
+  latency_tuner.begin(i2s_output.getMaxLead(), period_us, 250000UL / period_us);
+  i2s_output.setLead(latency_tuner.getLead());
+  
+  Serial.printf("I2S Audio initialized: %s\n", i2s_ok ? "OK" : "FAILED");
   Serial.println("BCK (Bit Clock) = GPIO 12");
   Serial.println("WS (Word Select/LRCLK) = GPIO 20");
   Serial.println("DATA = GPIO 0");
+  Serial.printf("DMA: %d x %d frames, %lu us latency (adaptive)\n", I2S_DMA_BUFFERS, I2S_BUFFER_SIZE,
+                (unsigned long)i2s_output.getLatencyUs());
   
-  // Test I2S with a simple sine wave burst
+  // Test I2S with a simple sine wave burst, written straight into the DMA buffers
   Serial.println("Testing I2S with sine wave burst...");
-  int16_t test_buffer[1024];
-  for (int i = 0; i < 512; i++) {
-    int16_t sample = pgm_read_word(&wavetable_sine[i % WAVETABLE_SIZE]) / 4; // Quiet test tone
-    test_buffer[i * 2] = sample;     // Left channel
-    test_buffer[i * 2 + 1] = sample; // Right channel
+  int test_buffers = 0;
+  for (int b = 0; b < 2; b++) {
+    int16_t* test_buffer = i2s_output.acquire(1000);
+    if (!test_buffer) break;
+    for (int i = 0; i < I2S_BUFFER_SIZE; i++) {
+      int16_t sample = pgm_read_word(&wavetable_sine[i % WAVETABLE_SIZE]) / 4; // Quiet test tone
+      test_buffer[i * 2] = sample;     // Left channel
+      test_buffer[i * 2 + 1] = sample; // Right channel
+    }
+    i2s_output.commit(test_buffer);
+    test_buffers++;
   }
+  Serial.printf("I2S test: %d buffers\n", test_buffers);
   
-  size_t bytes_written;
-  esp_err_t result = i2s_write(I2S_NUM, test_buffer, 1024 * 2, &bytes_written, 1000);
-  Serial.printf("I2S test write: %s, bytes: %d\n", esp_err_to_name(result), bytes_written);
-  
-  // Initialize GPIO
-  for (int i = 0; i < 4; i++) {
-    pinMode(MATRIX_ROWS[i], OUTPUT);
-    digitalWrite(MATRIX_ROWS[i], HIGH);
-    pinMode(MATRIX_COLS[i], INPUT_PULLUP);
-  }
+  // Initialize GPIO - rows are pulled low one at a time, columns read with pull-ups
+  key_scanner.setMatrix(MATRIX_ROWS, 4, MATRIX_COLS, 4, false);
+  key_scanner.setButtons(DIRECT_BUTTONS, 3);
+  key_scanner.begin();
   
   for (int i = 0; i < 5; i++) {
-    pinMode(ENCODER_CLK[i], INPUT_PULLUP);
-    pinMode(ENCODER_DT[i], INPUT_PULLUP);
+    encoder_input.attach(i, ENCODER_CLK[i], ENCODER_DT[i]);
+    encoder_input.setRange(i, ENCODER_RANGES[i][1] - ENCODER_RANGES[i][0]);  // A flick sweeps the range
     pinMode(ENCODER_SW[i], INPUT_PULLUP);
-    encoders[i].last_clk = digitalRead(ENCODER_CLK[i]);
-    encoders[i].last_dt = digitalRead(ENCODER_DT[i]);
   }
   
-  for (int i = 0; i < 3; i++) {
-    pinMode(DIRECT_BUTTONS[i], INPUT_PULLUP);
+  // Saved slots: sections are appended to a log, only the ones that changed
+  if (!preset_log.begin("/mintysynth.log")) {
+    Serial.println("Preset log failed to open, saving disabled");
+  } else if (preset_log.isRecovered()) {
+    Serial.println("Preset log: dropped a damaged tail");
   }
   
-  // Initialize preferences
-  preferences.begin("mintysynth", false);
-  
-  // Initialize sequencer
-  sequencer.step_length = 250;
+  // Initialize sequencer - the audio task plays it, on its own sample clock
+  seq_clock.begin(SAMPLE_RATE, NUM_STEPS);
+  seq_clock.setTempo(sequencer.tempo);
   sequencer.mode = MODE_LIVE;
   
   ui.needs_full_redraw = true;
 }
 
 void readInputs() {
-  // Read encoders with enhanced debouncing
+  // Read encoders - detents counted in hardware, faster turns moving further
   for (int i = 0; i < 5; i++) {
-    bool clk = digitalRead(ENCODER_CLK[i]);
-    bool dt = digitalRead(ENCODER_DT[i]);
-    
-    uint8_t current_state = (clk << 1) | dt;
-    uint8_t last_state = (encoders[i].last_clk << 1) | encoders[i].last_dt;
-    
-    if (clk != encoders[i].last_clk || dt != encoders[i].last_dt) {
-      uint32_t current_time = millis();
+    int32_t change = encoder_input.getChange(i);
+    if (change != 0) {
+      int old_position = encoders[i].position;
+      encoders[i].position = constrain(encoders[i].position + change, ENCODER_RANGES[i][0], ENCODER_RANGES[i][1]);
       
-      if (current_time - encoders[i].last_change_time >= 5) {
-        int8_t direction = getDirection(last_state, current_state);
-        
-        if (direction != 0) {
-          int old_position = encoders[i].position;
-          encoders[i].position += direction;
-          
-          // Constrain based on function
-          switch (i) {
-            case 0: encoders[i].position = constrain(encoders[i].position, 40, 300); break;  // Tempo
-            case 1: encoders[i].position = constrain(encoders[i].position, 0, 127); break;   // Pitch
-            case 2: encoders[i].position = constrain(encoders[i].position, 0, 127); break;   // Length
-            case 3: encoders[i].position = constrain(encoders[i].position, 0, 127); break;   // Envelope
-            case 4: encoders[i].position = constrain(encoders[i].position, 0, 100); break;   // Swing
-          }
-          
-          if (encoders[i].position != old_position) {
-            handleEncoderChange(i, old_position, encoders[i].position);
-            ui.last_activity = millis();
-          }
-        }
-        
-        encoders[i].last_change_time = current_time;
+      if (encoders[i].position != old_position) {
+        handleEncoderChange(i, old_position, encoders[i].position);
+        ui.last_activity = millis();
       }
-      
-      encoders[i].last_clk = clk;
-      encoders[i].last_dt = dt;
     }
     
     // Read encoder button
@@ -527,49 +610,23 @@ void readInputs() {
     encoders[i].button = button;
   }
   
-  // Read matrix keyboard
-  for (int row = 0; row < 4; row++) {
-    for (int r = 0; r < 4; r++) {
-      digitalWrite(MATRIX_ROWS[r], (r == row) ? LOW : HIGH);
-    }
-    delayMicroseconds(10);
-    
-    for (int col = 0; col < 4; col++) {
-      int key_index = row * 4 + col;
-      bool current_state = (digitalRead(MATRIX_COLS[col]) == LOW);
-      
-      if (current_state != last_matrix_keys[key_index]) {
-        handleMatrixKey(key_index, current_state);
-        ui.last_activity = millis();
-      }
-      
-      matrix_keys[key_index] = current_state;
-      last_matrix_keys[key_index] = current_state;
-    }
-  }
-  
-  for (int r = 0; r < 4; r++) {
-    digitalWrite(MATRIX_ROWS[r], HIGH);
-  }
-  
-  // Read direct buttons
-  for (int i = 0; i < 3; i++) {
-    bool current_state = (digitalRead(DIRECT_BUTTONS[i]) == LOW);
-    
-    if (current_state != last_direct_button_state[i]) {
-      handleDirectButton(i, current_state);
-      ui.last_activity = millis();
+  // Matrix keys and direct buttons: debounced events from the scanner
+  InputEvent event;
+  while (key_scanner.pop(event)) {
+    if (event.key < 16) {
+      handleMatrixKey(event.key, event.down, event.us);
+    } else {
+      handleDirectButton(event.key - 16, event.down);
     }
-    
-    direct_button_state[i] = current_state;
-    last_direct_button_state[i] = current_state;
+    ui.last_activity = millis();
   }
 }
 
 void handleEncoderChange(int encoder, int old_value, int new_value) {
   switch (encoder) {
     case 0: // Tempo
-      sequencer.step_length = map(new_value, 40, 300, 800, 100);
+      sequencer.tempo = new_value;
+      sendSequencerCommand(CMD_SEQ_TEMPO, sequencer.tempo);
       break;
       
     case 1: // Pitch
@@ -590,6 +647,11 @@ void handleEncoderChange(int encoder, int old_value, int new_value) {
       if (sequencer.mode >= MODE_PROGRAM_0 && sequencer.mode <= MODE_PROGRAM_3) {
         int voice = sequencer.mode - MODE_PROGRAM_0;
         voices[voice].length = map(new_value, 0, 127, 50, 2000);
+        sendEnvelopeUpdate(voice);
+      } else if (sequencer.mode == MODE_SONG) {
+        // In song mode, pattern length in steps
+        pattern.setLength(map(new_value, 0, 127, 1, PATTERN_MAX_STEPS));
+        ui.needs_full_redraw = true;
       }
       break;
       
@@ -612,6 +674,7 @@ void handleEncoderChange(int encoder, int old_value, int new_value) {
             voices[voice].release_time = new_value;
             break;
         }
+        sendEnvelopeUpdate(voice);
       } else {
         // In live mode, control waveform for current voice
         voices[sequencer.current_voice].waveform = map(new_value, 0, 127, 0, NUM_WAVEFORMS - 1);
@@ -620,14 +683,18 @@ void handleEncoderChange(int encoder, int old_value, int new_value) {
       
     case 4: // Swing
       sequencer.swing = new_value;
+      sendSequencerCommand(CMD_SEQ_SWING, sequencer.swing);
       break;
   }
 }
 
-void handleMatrixKey(int key, bool pressed) {
+void handleMatrixKey(int key, bool pressed, uint32_t key_us) {
   if (!pressed) return;  // Only handle key presses
   
   if (key < NUM_STEPS) {
+    // Keys cover the 16-step page the playhead is on
+    uint8_t step = sequencer.current_step / NUM_STEPS * NUM_STEPS + key;
+    
     switch (sequencer.mode) {
       case MODE_LIVE:
         if (sequencer.record_mode && sequencer.playing) {
@@ -636,20 +703,19 @@ void handleMatrixKey(int key, bool pressed) {
           note = constrain(note, 0, 127);
           
           // If current step already has a note, erase it (toggle behavior)
-          if (voices[sequencer.current_voice].step_sequence[sequencer.current_step]) {
-            voices[sequencer.current_voice].step_sequence[sequencer.current_step] = false;
+          if (pattern.isActive(sequencer.current_voice, sequencer.current_step)) {
+            pattern.setActive(sequencer.current_voice, sequencer.current_step, false);
           } else {
             // Record new note to the current step
-            voices[sequencer.current_voice].step_sequence[sequencer.current_step] = true;
-            voices[sequencer.current_voice].step_notes[sequencer.current_step] = note;
+            pattern.setStep(sequencer.current_voice, sequencer.current_step, note, 127, true);
           }
           
           // Always trigger the note for immediate feedback
-          triggerNote(sequencer.current_voice, note);
+          triggerNote(sequencer.current_voice, note, key_us);
         } else {
           // Standard live mode: just trigger preview note
           triggerNote(sequencer.current_voice, 
-                     applyScale(60 + key, sequencer.current_scale) + sequencer.song_transpose);
+                     applyScale(60 + key, sequencer.current_scale) + sequencer.song_transpose, key_us);
         }
         break;
         
@@ -659,11 +725,11 @@ void handleMatrixKey(int key, bool pressed) {
       case MODE_PROGRAM_3: {
         // In program mode, toggle step
         int voice = sequencer.mode - MODE_PROGRAM_0;
-        voices[voice].step_sequence[key] = !voices[voice].step_sequence[key];
+        pattern.setActive(voice, step, !pattern.isActive(voice, step));
         
-        if (voices[voice].step_sequence[key]) {
+        if (pattern.isActive(voice, step)) {
           // Play preview of this step
-          triggerNote(voice, voices[voice].step_notes[key] + voices[voice].transpose);
+          triggerNote(voice, pattern.notes[voice][step] + voices[voice].transpose, key_us);
         }
         break;
       }
@@ -680,10 +746,22 @@ void handleMatrixKey(int key, bool pressed) {
         break;
         
       case MODE_SONG:
-        // In song mode, save/load patterns
+        // In song mode, save/load patterns; with REC on, keys 8-15 chain
+        // the slot onto the song instead
         if (key < 8) {
           savePattern(key);
-        } else if (key < 16) {
+        } else if (sequencer.record_mode) {
+          if (!song_playing) {
+            song.clear();
+            song_position = 0;
+            song_playing = true;
+          }
+          song.append(key - 8);
+        } else if (sequencer.playing) {
+          song_playing = false;
+          cuePattern(key - 8);
+        } else {
+          song_playing = false;
           loadPattern(key - 8);
         }
         break;
@@ -701,10 +779,10 @@ void handleDirectButton(int button, bool pressed) {
       sequencer.playing = !sequencer.playing;
       Serial.printf("BUTTON 1 (PLAY/STOP) pressed - now %s\n", sequencer.playing ? "PLAYING" : "STOPPED");
       if (sequencer.playing) {
-        sequencer.current_step = 0;
-        sequencer.last_step_time = millis();
         // Start the demo song for immediate audio
         startDemoSong();
+      } else {
+        sendSequencerCommand(CMD_SEQ_STOP);
       }
       break;
       
@@ -729,9 +807,7 @@ void handleDirectButton(int button, bool pressed) {
       } else if (sequencer.mode >= MODE_PROGRAM_0 && sequencer.mode <= MODE_PROGRAM_3) {
         // Clear pattern
         int voice = sequencer.mode - MODE_PROGRAM_0;
-        for (int s = 0; s < NUM_STEPS; s++) {
-          voices[voice].step_sequence[s] = false;
-        }
+        pattern.gates[voice] = 0;
         Serial.printf("Cleared pattern for voice %s\n", voice_names[voice]);
       } else {
         changeMode(MODE_LIVE);
@@ -763,97 +839,102 @@ void changeMode(OperatingMode new_mode) {
   }
 }
 
-void processSequencer() {
-  uint32_t current_time = millis();
-  uint32_t step_duration = sequencer.step_length;
-  
-  // Apply global swing
-  if (sequencer.swing > 0 && sequencer.current_step % 2 == 1) {
-    step_duration += (sequencer.step_length * sequencer.swing) / 200;
-  }
-  
-  if (current_time - sequencer.last_step_time >= step_duration) {
-    Serial.printf("Step %d - ", sequencer.current_step);
+// Audio side: plays the step and the events due at `frame`, and returns
+// the frame of the next one so generateAudio() can stop there
+uint64_t playSequencer(uint64_t frame) {
+  if (seq_clock.framesUntilStep(frame, 1) == 0) {
+    uint8_t step = seq_clock.advance();
+    if (step == 0) patterns_started.fetch_add(1, std::memory_order_release);
     
-    // Trigger notes for all voices on this step
-    bool any_notes = false;
-    for (int v = 0; v < NUM_VOICES; v++) {
-      if (voices[v].step_sequence[sequencer.current_step]) {
-        uint8_t note = voices[v].step_notes[sequencer.current_step];
+    // Until the UI has seen step 0, the pattern that took over is still `next`
+    const PatternPair& patterns = pattern_snapshot.read();
+    bool moved_on = patterns_started.load(std::memory_order_relaxed) != patterns.position;
+    const StepPattern& playing = moved_on ? patterns.next : patterns.playing;
+    seq_clock.setLength(playing.length);   // Where it wraps, and whether this step swings
+    sequencer.current_step = step;
+    
+    // Trigger notes for all voices on this step, one bit test each
+    for (int v = 0; v < NUM_VOICES && step < playing.length; v++) {
+      if (playing.isActive(v, step)) {
+        uint8_t note = playing.notes[v][step];
         note = applyScale(note, sequencer.current_scale);
         note += voices[v].transpose + sequencer.song_transpose;
         note = constrain(note, 0, 127);
         
-        Serial.printf("V%d:Note%d ", v, note);
-        any_notes = true;
-        
-        // Apply per-voice swing offset using non-blocking scheduler
-        uint32_t voice_delay = 0;
-        if (voices[v].swing_offset > 0 && sequencer.current_step % 2 == 1) {
-          voice_delay = (sequencer.step_length * voices[v].swing_offset) / 200;
-        }
-        
-        if (voice_delay > 0) {
-          // Schedule the note to trigger later (non-blocking)
-          scheduleNoteEvent(v, note, voice_delay);
+        // Per-voice swing holds the note back on the odd steps
+        if (voices[v].swing_offset > 0 && (step & 1)) {
+          SynthEvent swung = { frame, EVENT_NOTE_ON, (uint8_t)v, note, playing.velocities[v][step], 0 };
+          swung.frame += (seq_clock.getStepLength() * voices[v].swing_offset / 200) >> SEQ_FRACTION_BITS;
+          note_events.schedule(swung);
         } else {
-          // Trigger immediately if no delay
-          triggerNote(v, note);
+          playNote(v, note, frame);
         }
       }
     }
-    
-    if (!any_notes) Serial.print("(silence)");
-    Serial.println();
-    
-    sequencer.current_step = (sequencer.current_step + 1) % NUM_STEPS;
-    sequencer.last_step_time = current_time;
   }
-}
-
-void scheduleNoteEvent(uint8_t voice, uint8_t note, uint32_t delay_ms) {
-  // Find an available slot in the event queue
-  for (int i = 0; i < MAX_SCHEDULED_EVENTS; i++) {
-    if (!event_queue[i].active) {
-      event_queue[i].active = true;
-      event_queue[i].trigger_time = millis() + delay_ms;
-      event_queue[i].voice = voice;
-      event_queue[i].note = note;
-      return;
+  
+  SynthEvent event;
+  while (note_events.pop(frame, event)) {
+    if (event.type == EVENT_NOTE_ON) {
+      playNote(event.voice, event.data, frame);
+    } else if (event.type == EVENT_NOTE_OFF && note_ids[event.voice] == event.value) {
+      releaseVoice(event.voice);
     }
   }
   
-  // If no slot available, trigger immediately (fallback)
-  triggerNote(voice, note);
+  uint32_t frames = seq_clock.framesUntilStep(frame, I2S_BUFFER_SIZE);
+  return frame + note_events.framesUntilNext(frame, frames);
 }
 
-void processNoteQueue() {
-  uint32_t current_time = millis();
+// Audio side: starts the note on `frame` and schedules its note-off one
+// note length later. With the scheduler full the note is dropped rather
+// than left without an end.
+void playNote(uint8_t voice, uint8_t note, uint64_t frame) {
+  if (voice >= NUM_VOICES) return;
   
-  // Check all scheduled events
-  for (int i = 0; i < MAX_SCHEDULED_EVENTS; i++) {
-    if (event_queue[i].active && current_time >= event_queue[i].trigger_time) {
-      // Time to trigger this note
-      triggerNote(event_queue[i].voice, event_queue[i].note);
-      
-      // Mark slot as available
-      event_queue[i].active = false;
+  uint16_t id = note_ids[voice] + 1;
+  SynthEvent off = { frame + (uint64_t)voices[voice].length * SAMPLE_RATE / 1000, EVENT_NOTE_OFF, voice, note, 0, id };
+  if (!note_events.schedule(off)) return;
+  note_ids[voice] = id;
+  startVoice(voice, note);
+}
+
+void handleSerialCommand(int command) {
+  if (command == 'l') {
+    char line[96];
+    Serial.printf("Key to DAC latency (DMA %d x %d frames, lead %u):\n", I2S_DMA_BUFFERS, I2S_BUFFER_SIZE,
+                  i2s_output.getLead());
+    for (uint8_t stage = 0; stage < LATENCY_STAGES; stage++) {
+      latency_probe.format(stage, line, sizeof(line));
+      Serial.println(line);
     }
+  } else if (command == 'r') {
+    latency_probe.reset();
+    Serial.println("Latency histograms cleared");
   }
 }
 
 void generateAudio() {
-  static uint32_t debug_counter = 0;
-  static uint32_t last_debug = 0;
+  // Next DMA buffer the I2S has finished playing, filled in place (no copy)
+  int16_t* audio_buffer = i2s_output.acquire(100);
+  if (!audio_buffer) return;
+  uint32_t render_start = micros();
+  
+  // Sequencer steps start on their own frame, wherever it falls in the buffer
+  uint64_t next_event = sample_clock;
   
   // I2S Audio Generation (for PCM5102)
   for (int i = 0; i < I2S_BUFFER_SIZE; i++) {
+    if (sample_clock + i >= next_event) {
+      next_event = playSequencer(sample_clock + i);
+    }
+    
     int32_t mix_left = 0;
     int32_t mix_right = 0;
     
     for (int v = 0; v < NUM_VOICES; v++) {
       if (voices[v].active) {
-        int16_t sample = getWaveformSample(voices[v].waveform, voices[v].phase_accumulator);
+        int16_t sample = getWaveformSample(voices[v].waveform, voice_bank.phase_accumulator[v], voices[v].mip_level);
         
         // Apply ADSR envelope
         uint16_t envelope_amplitude = calculateADSR(v);
@@ -867,7 +948,7 @@ void generateAudio() {
           mix_right += sample;
         }
         
-        voices[v].phase_accumulator += voices[v].frequency_tuning_word;
+        voice_bank.phase_accumulator[v] += voice_bank.frequency_tuning_word[v];
       }
     }
     
@@ -877,42 +958,50 @@ void generateAudio() {
     audio_buffer[i * 2] = mix_left;
     audio_buffer[i * 2 + 1] = mix_right;
   }
-  
-  // Debug output every 2 seconds
-  debug_counter++;
-  if (millis() - last_debug > 2000) {
-    int active_count = voices[0].active + voices[1].active + voices[2].active + voices[3].active;
-    Serial.printf("Audio gen: %d active voices, buffer calls: %d\n", active_count, debug_counter);
-    
-    // Show details of active voices
-    for (int v = 0; v < NUM_VOICES; v++) {
-      if (voices[v].active) {
-        Serial.printf("  Voice %d: Note=%d, Amp=%d, Env=%d, Wave=%d\n", 
-                     v, voices[v].note, voices[v].current_amplitude, voices[v].envelope_stage, voices[v].waveform);
-      }
-    }
-    
-    // Show sample values from last buffer
-    if (active_count > 0) {
-      Serial.printf("  Last audio samples: L=%d, R=%d\n", audio_buffer[0], audio_buffer[1]);
-    }
-    
-    last_debug = millis();
-    debug_counter = 0;
-  }
-  
-  size_t bytes_written;
-  esp_err_t result = i2s_write(I2S_NUM, audio_buffer, I2S_BUFFER_SIZE * 4, &bytes_written, portMAX_DELAY);
-  if (result != ESP_OK) {
-    Serial.printf("I2S write error: %s\n", esp_err_to_name(result));
+  sample_clock += I2S_BUFFER_SIZE;
+  
+  latency_probe.blockRendered();
+  audio_tap.write(audio_buffer, I2S_BUFFER_SIZE);   // One copy for the scope, never waits
+  i2s_output.commit(audio_buffer);
+  latency_probe.bufferCommitted(render_start + i2s_output.getLatencyUs(), SAMPLE_RATE);   // Plays `lead` periods after acquire()
+  
+  // Lowest latency that keeps up with the current voice load
+  static uint32_t seen_underruns = 0;
+  uint32_t underruns = i2s_output.getUnderruns();
+  i2s_output.setLead(latency_tuner.update(micros() - render_start, underruns != seen_underruns));
+  seen_underruns = underruns;
+  
+  // Counters for the UI task's report; never print from here
+  audio_stats.buffers.fetch_add(1, std::memory_order_relaxed);
+  audio_stats.active_voices.store(voices[0].active + voices[1].active + voices[2].active + voices[3].active,
+                                  std::memory_order_relaxed);
+  audio_stats.events_pending.store(note_events.getCount(), std::memory_order_relaxed);
+  audio_stats.events_peak.store(note_events.getPeak(), std::memory_order_relaxed);
+  audio_stats.events_dropped.store(note_events.getDropped(), std::memory_order_relaxed);
+  audio_stats.last_left.store(audio_buffer[0], std::memory_order_relaxed);
+  audio_stats.last_right.store(audio_buffer[1], std::memory_order_relaxed);
+}
+
+// UI side, every 2 seconds: what the audio task published
+void printAudioStats() {
+  uint8_t active_count = audio_stats.active_voices.load(std::memory_order_relaxed);
+  Serial.printf("Audio gen: %d active voices, buffer calls: %lu, underruns: %lu, latency: %lu us\n",
+                active_count, (unsigned long)audio_stats.buffers.exchange(0, std::memory_order_relaxed),
+                (unsigned long)i2s_output.getUnderruns(), (unsigned long)i2s_output.getLatencyUs());
+  Serial.printf("  Events: %u pending, peak %u of %d, %lu dropped\n",
+                audio_stats.events_pending.load(std::memory_order_relaxed),
+                audio_stats.events_peak.load(std::memory_order_relaxed), SCHED_CAPACITY,
+                (unsigned long)audio_stats.events_dropped.load(std::memory_order_relaxed));
+  
+  // Show sample values from last buffer
+  if (active_count > 0) {
+    Serial.printf("  Last audio samples: L=%d, R=%d\n", audio_stats.last_left.load(std::memory_order_relaxed),
+                  audio_stats.last_right.load(std::memory_order_relaxed));
   }
 }
 
 void updateDisplay() {
   static bool first_draw = true;
-  static uint8_t last_step = 255;
-  static uint8_t last_voice = 255;
-  static bool last_playing = false;
   static OperatingMode last_mode = MODE_LIVE;
   static int last_tempo = -1;
   static int last_pitch = -1;
@@ -927,9 +1016,6 @@ void updateDisplay() {
     first_draw = false;
     
     // Update all cached values
-    last_step = sequencer.current_step;
-    last_voice = sequencer.current_voice;
-    last_playing = sequencer.playing;
     last_mode = sequencer.mode;
     last_tempo = encoders[0].position;
     last_pitch = encoders[1].position;
@@ -957,34 +1043,16 @@ void updateDisplay() {
     last_mode = sequencer.mode;
   }
 
-  // Always update status line - NO FLASHING
-  if (sequencer.current_step != last_step || 
-      sequencer.current_voice != last_voice ||
-      sequencer.playing != last_playing) {
-    
-    // Clear and update status line
-    tft.fillRect(5, 40, 310, 15, 0x0000);  // Black background
-    tft.setTextColor(COLOR_TEXT);
-    tft.setCursor(5, 40);
-    tft.printf("Voice:%s %s Step:%02d BPM:%d", 
-               voice_names[sequencer.current_voice],
-               sequencer.playing ? "PLAY" : "STOP",
-               sequencer.current_step + 1,
-               map(sequencer.step_length, 100, 800, 300, 40));
-    
-    last_step = sequencer.current_step;
-    last_voice = sequencer.current_voice;
-    last_playing = sequencer.playing;
-  }
-  
-  // Update step grid when voice changes or step advances
-  if (sequencer.current_voice != last_voice || sequencer.current_step != last_step) {
-    drawBigStepSequencer();
-    last_voice = sequencer.current_voice;
-    last_step = sequencer.current_step;
-  }
-  
-  // This section moved to drawEncoderValues() function
+  // Status line - the text field redraws only the characters that changed
+  status_line.printf("Voice:%s %s Step:%02d BPM:%ld",
+                     voice_names[sequencer.current_voice],
+                     sequencer.playing ? "PLAY" : "STOP",
+                     sequencer.current_step + 1,
+                     (long)sequencer.tempo);
+  status_line.render(canvas);
+  
+  // Step grid - only the cells whose state changed
+  drawBigStepSequencer();
   
   // Update record indicator
   if (sequencer.record_mode != last_record) {
@@ -1000,13 +1068,17 @@ void updateDisplay() {
     last_record = sequencer.record_mode;
   }
   
-  // Always update encoder values to fix real-time display issue
+  // Encoder values - only the characters that changed
   drawEncoderValues();
+  
+  // Scope, spectrum and tuner from the real output
+  updateWaveformDisplay();
 }
 
 void drawNeonInterface() {
   // Clear screen with pure black background
   tft.fillScreen(0x0000);  // Force pure black
+  screen.invalidate();     // Widgets redraw in full on their next render
   
   // Layout plan (320x240):
   // Row 1: Title bar (0-30)
@@ -1118,7 +1190,7 @@ void drawStatusLine() {
   // Clear the status area
   tft.fillRect(0, 35, 320, 20, 0x0000);
   
-  int bpm = map(sequencer.step_length, 100, 800, 300, 40);
+  int bpm = sequencer.tempo;
   
   tft.setTextColor(COLOR_TEXT);
   tft.setTextSize(1);
@@ -1127,7 +1199,7 @@ void drawStatusLine() {
   
   tft.setCursor(10, 48);
   tft.setTextColor(sequencer.playing ? COLOR_SUCCESS : COLOR_WARNING);
-  tft.printf("Step: %02d/%d", sequencer.current_step + 1, NUM_STEPS);
+  tft.printf("Step: %02d/%d", sequencer.current_step + 1, pattern.length);
   
   tft.setTextColor(COLOR_ACCENT3);
   tft.setCursor(200, 40);
@@ -1135,7 +1207,7 @@ void drawStatusLine() {
   
   // Dancing person (when playing)
   if (sequencer.playing) {
-    uint32_t dance_speed = sequencer.step_length / 4;
+    uint32_t dance_speed = 15000 / sequencer.tempo / 4;   // A quarter of a 16th
     if (millis() - ui.last_dance_update >= dance_speed) {
       ui.dance_frame = (ui.dance_frame + 1) % 4;
       ui.last_dance_update = millis();
@@ -1153,102 +1225,121 @@ void drawStatusLine() {
   }
 }
 
+void initializeScreen() {
+  // STEP SEQUENCER (60-115): 2 rows of 8 at a 25 pixel pitch
+  step_grid.begin(13, 63, NUM_STEPS, 8, 25);
+  screen.add(step_grid);
+  
+  // STATUS ROW (35-55), clear of the REC indicator
+  status_line.begin(5, 40, 36, 1, COLOR_TEXT, COLOR_BG);
+  screen.add(status_line);
+  
+  // ENCODER VALUES (right side), one 15 character line each
+  for (int i = 0; i < 5; i++) {
+    encoder_lines[i].begin(225, 70 + i * 12, 15, 1, COLOR_ACCENT3, COLOR_BG);
+    screen.add(encoder_lines[i]);
+  }
+  
+  // SCOPE label row, with the tuner reading
+  tuner_line.begin(10, 115, 33, 1, COLOR_ACCENT1, COLOR_BG);
+  screen.add(tuner_line);
+  analyzer.begin(SAMPLE_RATE);
+}
+
+// Each cell keeps inside its 25x25 box (x - 3 to x + 21), so redrawing one
+// never touches a neighbour: step, grid line, glow, current-step ring
+void NeonStepGrid::drawCell(UiCanvas& canvas, uint8_t cell, int16_t x, int16_t y, uint8_t flags) {
+  bool on = flags & UI_STEP_ON;
+  bool is_current = flags & UI_STEP_CURRENT;
+  int side = pitch - 6;
+  
+  uint16_t color;
+  if (on) {
+    color = is_current ? COLOR_CURRENT : COLOR_STEP_ON;
+  } else {
+    color = is_current ? COLOR_WARNING : COLOR_STEP_OFF;
+  }
+  
+  canvas.fillRect(x, y, side, side, color);
+  canvas.drawRect(x - 1, y - 1, side + 2, side + 2, COLOR_GRID);
+  canvas.drawRect(x - 2, y - 2, side + 4, side + 4, on ? COLOR_DIM : COLOR_BG);
+  canvas.drawRect(x - 3, y - 3, side + 6, side + 6, (on && is_current) ? COLOR_TEXT : COLOR_BG);
+  
+  // Step numbers (only for first row to save space)
+  if (cell < 8) {
+    char label[2] = { (char)('1' + cell), 0 };
+    canvas.drawText(x + 7, y + 6, label, 1, 1, COLOR_TEXT, color);
+  }
+}
+
 void drawBigStepSequencer() {
-  // STEP SEQUENCER (60-115) - 55 pixels high
-  int grid_x = 10;
-  int grid_y = 60;
-  int step_size = 25;  // Fits perfectly: 8*25 = 200, leaves room for margins
+  // Program mode shows the voice being programmed, live mode the current voice
+  int voice = sequencer.current_voice;
+  if (sequencer.mode >= MODE_PROGRAM_0 && sequencer.mode <= MODE_PROGRAM_3) {
+    voice = sequencer.mode - MODE_PROGRAM_0;
+  }
   
+  // The 16-step page the playhead is on; steps past the end stay dark
+  uint8_t page = sequencer.current_step / NUM_STEPS * NUM_STEPS;
   for (int step = 0; step < NUM_STEPS; step++) {
-    int x = grid_x + (step % 8) * step_size;
-    int y = grid_y + (step / 8) * step_size;
-    
-    uint16_t color = COLOR_STEP_OFF;
-    bool is_current = (step == sequencer.current_step && sequencer.playing);
-    
-    if (sequencer.mode >= MODE_PROGRAM_0 && sequencer.mode <= MODE_PROGRAM_3) {
-      int voice = sequencer.mode - MODE_PROGRAM_0;
-      if (voices[voice].step_sequence[step]) {
-        color = is_current ? COLOR_CURRENT : COLOR_STEP_ON;
-      } else {
-        color = is_current ? COLOR_WARNING : COLOR_STEP_OFF;
-      }
-    } else {
-      // Show current voice pattern in live mode
-      if (voices[sequencer.current_voice].step_sequence[step]) {
-        color = is_current ? COLOR_CURRENT : COLOR_STEP_ON;
-      } else {
-        color = is_current ? COLOR_WARNING : COLOR_STEP_OFF;
-      }
-    }
-    
-    // Draw step with enhanced neon glow effect
-    tft.fillRect(x, y, step_size - 3, step_size - 3, color);
-    tft.drawRect(x - 1, y - 1, step_size - 1, step_size - 1, COLOR_GRID);
-    
-    // Add glow for active steps
-    if (color == COLOR_STEP_ON || color == COLOR_CURRENT) {
-      tft.drawRect(x - 2, y - 2, step_size + 1, step_size + 1, COLOR_DIM);
-      if (is_current) {
-        tft.drawRect(x - 3, y - 3, step_size + 3, step_size + 3, COLOR_TEXT);
-      }
-    }
-    
-    // Step numbers (only for first row to save space)
-    if (step < 8) {
-      tft.setTextColor(COLOR_TEXT);
-      tft.setTextSize(1);
-      tft.setCursor(x + 7, y + 7);
-      tft.printf("%d", step + 1);
-    }
+    step_grid.setStep(step, page + step < pattern.length && pattern.isActive(voice, page + step));
   }
+  step_grid.setCurrent(sequencer.playing ? sequencer.current_step - page : -1);
+  step_grid.render(canvas);
 }
 
+#define SCOPE_X         10
+#define SCOPE_Y         125
+#define SCOPE_WIDTH     130
+#define SCOPE_HEIGHT    35
+#define SPECTRUM_X      146   // 32 bands, 2 pixels each, to x = 209
+#define SPECTRUM_BAR    2
+
 void drawWaveformDisplay() {
-  // WAVEFORM ROW (120-165) - Full width now!
-  if (millis() - ui.last_waveform_update >= 50) {  // Update 20 times per second
-    // Generate waveform data based on active voices
-    int16_t current_sample = 0;
-    for (int v = 0; v < NUM_VOICES; v++) {
-      if (voices[v].active) {
-        current_sample += getWaveformSample(voices[v].waveform, voices[v].phase_accumulator) / 4;
-      }
-    }
-    
-    ui.waveform_history[ui.waveform_index] = current_sample / 1000;  // Scale down
-    ui.waveform_index = (ui.waveform_index + 1) % 80;
-    ui.last_waveform_update = millis();
+  // WAVEFORM ROW (120-165): frame around scope and spectrum, contents on the next update
+  tft.drawRect(SCOPE_X - 1, SCOPE_Y - 1, 202, SCOPE_HEIGHT + 2, COLOR_GRID);
+  tft.drawFastVLine(SPECTRUM_X - 3, SCOPE_Y, SCOPE_HEIGHT, COLOR_GRID);
+  ui.last_waveform_update = 0;
+}
+
+void updateWaveformDisplay() {
+  if (millis() - ui.last_waveform_update < 50) return;  // Update 20 times per second
+  if (!analyzer.update(audio_tap)) return;              // Lapped by the audio task, try next frame
+  ui.last_waveform_update = millis();
+  
+  // Scope: min/max of the real output per column, so nothing between pixels is lost
+  int16_t low[SCOPE_WIDTH];
+  int16_t high[SCOPE_WIDTH];
+  analyzer.getScope(low, high, SCOPE_WIDTH);
+  
+  int mid = SCOPE_Y + SCOPE_HEIGHT / 2;
+  int half = SCOPE_HEIGHT / 2;
+  tft.fillRect(SCOPE_X, SCOPE_Y, SCOPE_WIDTH, SCOPE_HEIGHT, COLOR_BG);
+  tft.drawFastHLine(SCOPE_X, mid, SCOPE_WIDTH, COLOR_DIM);
+  for (int x = 0; x < SCOPE_WIDTH; x++) {
+    int top = mid - (high[x] * half) / 32768;
+    int bottom = mid - (low[x] * half) / 32768;
+    tft.drawFastVLine(SCOPE_X + x, top, bottom - top + 1, COLOR_ACCENT3);
   }
   
-  // Draw waveform (full width)
-  int waveform_x = 10;
-  int waveform_y = 125;
-  int waveform_width = 200;  // Narrower to avoid encoder overlap
-  int waveform_height = 35;
-  
-  // Background
-  tft.fillRect(waveform_x, waveform_y, waveform_width, waveform_height, 0x0000);
-  tft.drawRect(waveform_x - 1, waveform_y - 1, waveform_width + 2, waveform_height + 2, COLOR_GRID);
-  
-  // Draw waveform line (scale to full width)
-  for (int i = 1; i < 80; i++) {
-    int x1 = waveform_x + ((i - 1) * waveform_width) / 80;
-    int y1 = waveform_y + waveform_height/2 + ui.waveform_history[(ui.waveform_index + i - 1) % 80];
-    int x2 = waveform_x + (i * waveform_width) / 80;
-    int y2 = waveform_y + waveform_height/2 + ui.waveform_history[(ui.waveform_index + i) % 80];
-    
-    tft.drawLine(x1, y1, x2, y2, COLOR_ACCENT3);
+  // Spectrum: log-spaced bands, 72 dB tall
+  const uint8_t* bands = analyzer.getBands();
+  for (int b = 0; b < AUDIO_SPECTRUM_BANDS; b++) {
+    int x = SPECTRUM_X + b * SPECTRUM_BAR;
+    int bar = (bands[b] * SCOPE_HEIGHT) / 255;
+    tft.fillRect(x, SCOPE_Y, SPECTRUM_BAR, SCOPE_HEIGHT - bar, COLOR_BG);
+    tft.fillRect(x, SCOPE_Y + SCOPE_HEIGHT - bar, SPECTRUM_BAR, bar, COLOR_ACCENT2);
   }
   
-  // Center line
-  tft.drawLine(waveform_x, waveform_y + waveform_height/2, 
-               waveform_x + waveform_width, waveform_y + waveform_height/2, COLOR_DIM);
-  
-  // Label
-  tft.setTextColor(COLOR_ACCENT1);
-  tft.setTextSize(1);
-  tft.setCursor(waveform_x, waveform_y - 10);
-  tft.print("WAVEFORM VISUALIZATION");
+  // Tuner: nearest note and how far off it is
+  const TunerReading& tuning = analyzer.getTuner();
+  if (tuning.valid) {
+    tuner_line.printf("SCOPE  %-2s%d %+3dc %4dHz", audioNoteName(tuning.note), tuning.note / 12 - 1,
+                      tuning.cents, (int)(tuning.hz + 0.5f));
+  } else {
+    tuner_line.printf("SCOPE  --");
+  }
+  tuner_line.render(canvas);
 }
 
 // Spinning record function removed - using full width waveform instead
@@ -1289,67 +1380,17 @@ void drawBigVoiceIndicators() {
 }
 
 void drawEncoderValues() {
-  // ENCODER VALUES - Place them on the right side to avoid overlap
-  // Cache last drawn values to prevent unnecessary redraws
-  static int last_tempo = -1;
-  static int last_pitch = -1;
-  static int last_length = -1;
-  static int last_env = -1;
-  static int last_swing = -1;
-  static uint8_t last_scale = 255;
-  static OperatingMode last_mode = MODE_LIVE;
-  static uint8_t last_adsr_param = 255;
-  static uint8_t last_adsr_value = 255;
-  static bool first_draw = true;
-  
-  tft.setTextColor(COLOR_ACCENT3);
-  tft.setTextSize(1);
+  // ENCODER VALUES - fixed-width lines, so a shorter value blanks the old one
+  encoder_lines[0].printf("TEMPO: %3d", encoders[0].position);
   
-  // Clear and redraw everything on first draw or mode change
-  if (first_draw || sequencer.mode != last_mode) {
-    tft.fillRect(220, 65, 100, 80, 0x0000);
-    first_draw = false;
-    last_mode = sequencer.mode;
-    // Reset all cache values to force redraw
-    last_tempo = last_pitch = last_length = last_env = last_swing = -1;
-    last_scale = 255;
-    last_adsr_param = last_adsr_value = 255;
-  }
-  
-  // TEMPO - Only redraw if changed
-  if (encoders[0].position != last_tempo) {
-    tft.fillRect(225, 70, 95, 10, 0x0000);  // Clear this line
-    tft.setCursor(225, 70);
-    tft.printf("TEMPO: %3d", encoders[0].position);
-    last_tempo = encoders[0].position;
-  }
-  
-  // PITCH/SCALE - Only redraw if changed
   if (sequencer.mode == MODE_SCALE) {
-    if (sequencer.current_scale != last_scale) {
-      tft.fillRect(225, 82, 95, 10, 0x0000);
-      tft.setCursor(225, 82);
-      tft.printf("SCALE: %s", scale_names[sequencer.current_scale]);
-      last_scale = sequencer.current_scale;
-    }
+    encoder_lines[1].printf("SCALE: %s", scale_names[sequencer.current_scale]);
   } else {
-    if (encoders[1].position != last_pitch) {
-      tft.fillRect(225, 82, 95, 10, 0x0000);
-      tft.setCursor(225, 82);
-      tft.printf("PITCH: %3d", encoders[1].position);
-      last_pitch = encoders[1].position;
-    }
+    encoder_lines[1].printf("PITCH: %3d", encoders[1].position);
   }
   
-  // LENGTH - Only redraw if changed
-  if (encoders[2].position != last_length) {
-    tft.fillRect(225, 94, 95, 10, 0x0000);
-    tft.setCursor(225, 94);
-    tft.printf("LENGTH:%3d", encoders[2].position);
-    last_length = encoders[2].position;
-  }
+  encoder_lines[2].printf("LENGTH:%3d", encoders[2].position);
   
-  // ENVELOPE/ADSR - Only redraw if changed
   if (sequencer.mode >= MODE_PROGRAM_0 && sequencer.mode <= MODE_PROGRAM_3) {
     int voice = sequencer.mode - MODE_PROGRAM_0;
     uint8_t adsr_value = 0;
@@ -1359,29 +1400,15 @@ void drawEncoderValues() {
       case 2: adsr_value = voices[voice].sustain_level; break;
       case 3: adsr_value = voices[voice].release_time; break;
     }
-    
-    if (current_adsr_param != last_adsr_param || adsr_value != last_adsr_value) {
-      tft.fillRect(225, 106, 95, 10, 0x0000);
-      tft.setCursor(225, 106);
-      tft.printf("%s:%3d", adsr_param_names[current_adsr_param], adsr_value);
-      last_adsr_param = current_adsr_param;
-      last_adsr_value = adsr_value;
-    }
+    encoder_lines[3].printf("%s:%3d", adsr_param_names[current_adsr_param], adsr_value);
   } else {
-    if (encoders[3].position != last_env) {
-      tft.fillRect(225, 106, 95, 10, 0x0000);
-      tft.setCursor(225, 106);
-      tft.printf("ENV: %3d", encoders[3].position);
-      last_env = encoders[3].position;
-    }
+    encoder_lines[3].printf("ENV: %3d", encoders[3].position);
   }
   
-  // SWING - Only redraw if changed
-  if (sequencer.swing != last_swing) {
-    tft.fillRect(225, 118, 95, 10, 0x0000);
-    tft.setCursor(225, 118);
-    tft.printf("SWING:%3d%%", sequencer.swing);
-    last_swing = sequencer.swing;
+  encoder_lines[4].printf("SWING:%3d%%", sequencer.swing);
+  
+  for (int i = 0; i < 5; i++) {
+    encoder_lines[i].render(canvas);
   }
 }
 
@@ -1428,129 +1455,143 @@ uint8_t applyScale(uint8_t note, uint8_t scale_type) {
   return octave * 12 + scales[scale_type][scale_note];
 }
 
-void triggerNote(uint8_t voice, uint8_t note) {
+// UI side: queue a note-on for the audio task; key_us is the press that
+// played it (InputEvent::us), 0 for notes not from a key
+void triggerNote(uint8_t voice, uint8_t note, uint32_t key_us) {
+  if (voice >= NUM_VOICES) return;
+  
+  Serial.printf("TRIGGER Voice %d Note %d\n", voice, note);
+  sendAudioCommand(CMD_NOTE_ON, voice, note, key_us);
+}
+
+// UI side: queue a note-off for the audio task
+void stopNote(uint8_t voice) {
+  if (voice >= NUM_VOICES) return;
+  sendAudioCommand(CMD_NOTE_OFF, voice, 0);
+}
+
+// UI side: ADSR or length changed, recompute the envelope rates
+void sendEnvelopeUpdate(uint8_t voice) {
+  sendAudioCommand(CMD_UPDATE_ENVELOPE, voice, 0);
+}
+
+void sendAudioCommand(uint8_t type, uint8_t voice, uint8_t note, uint32_t key_us) {
+  AudioCommand command = { type, voice, note, key_us, 0, 0 };
+  if (key_us) command.sent_us = latency_probe.noteSent(key_us);
+  if (!audio_commands.push(command)) {
+    dropped_commands++;
+  }
+}
+
+// UI side: transport, tempo and swing go to the audio task, which owns the clock
+void sendSequencerCommand(uint8_t type, uint16_t value) {
+  AudioCommand command = { type, 0, 0, 0, 0, value };
+  if (!audio_commands.push(command)) {
+    dropped_commands++;
+  }
+}
+
+// Audio side: apply everything queued since the last buffer
+void processAudioCommands() {
+  AudioCommand command;
+  while (audio_commands.pop(command)) {
+    switch (command.type) {
+      case CMD_NOTE_ON:
+        playNote(command.voice, command.note, sample_clock);
+        if (command.key_us) latency_probe.noteApplied(command.key_us, command.sent_us, 0);
+        break;
+      case CMD_NOTE_OFF:
+        releaseVoice(command.voice);
+        break;
+      case CMD_UPDATE_ENVELOPE:
+        updateEnvelopeRates(command.voice);
+        break;
+      case CMD_SEQ_START:
+        seq_clock.start(sample_clock);   // Step 0 on the first frame of the next buffer
+        break;
+      case CMD_SEQ_STOP:
+        seq_clock.stop();
+        note_events.clear(sample_clock);   // Note-offs too, so release everything now
+        for (int v = 0; v < NUM_VOICES; v++) releaseVoice(v);
+        break;
+      case CMD_SEQ_TEMPO:
+        seq_clock.setTempo(command.value);
+        break;
+      case CMD_SEQ_SWING:
+        seq_clock.setSwing(command.value, 100);   // Odd steps up to half a step late
+        break;
+    }
+  }
+}
+
+void startVoice(uint8_t voice, uint8_t note) {
   if (voice >= NUM_VOICES) return;
   
-  uint32_t freq_word = pgm_read_dword(&note_frequencies[note]);
-  Serial.printf("TRIGGER Voice %d Note %d (freq_word=0x%X)\n", voice, note, freq_word);
+  uint32_t freq_word = midiNoteToFrequencyWord(note);
   
   voices[voice].active = true;
   voices[voice].note = note;
-  voices[voice].frequency_tuning_word = freq_word;
-  voices[voice].phase_accumulator = 0;
+  voice_bank.frequency_tuning_word[voice] = freq_word;
+  voices[voice].mip_level = getMipLevel(freq_word);
+  voice_bank.phase_accumulator[voice] = 0;
   voices[voice].note_start_time = millis();
-  voices[voice].note_released = false;
-  voices[voice].note_release_time = 0;
   
   // Initialize ADSR envelope
-  voices[voice].envelope_stage = ENV_ATTACK;
-  voices[voice].envelope_counter = 0;
-  voices[voice].current_amplitude = 0;
-  
-  Serial.printf("Voice %d activated: freq=0x%X, wave=%d\n", voice, freq_word, voices[voice].waveform);
+  updateEnvelopeRates(voice);
+  voice_bank.envelope[voice].start();
+  voice_bank.current_amplitude[voice] = 0;
 }
 
-void stopNote(uint8_t voice) {
+void releaseVoice(uint8_t voice) {
   if (voice >= NUM_VOICES) return;
   
   // Don't immediately stop - start release phase instead
-  if (voices[voice].active && !voices[voice].note_released) {
-    voices[voice].note_released = true;
-    voices[voice].note_release_time = millis();
-    voices[voice].envelope_stage = ENV_RELEASE;
-    voices[voice].envelope_counter = 0;
+  if (voices[voice].active) {
+    voice_bank.envelope[voice].release();
   }
 }
 
-uint16_t calculateADSR(uint8_t voice) {
-  if (voice >= NUM_VOICES || !voices[voice].active) return 0;
+// Works out the envelope segment rates from the ADSR parameters. Called at
+// note-on and whenever a parameter changes, never per sample.
+void updateEnvelopeRates(uint8_t voice) {
+  if (voice >= NUM_VOICES) return;
   
   Voice* v = &voices[voice];
-  uint32_t elapsed = millis() - v->note_start_time;
   
   // Convert ADSR parameters to time values (in ms)
   uint32_t attack_time_ms = map(v->attack_time, 0, 127, 1, 2000);
-  uint32_t decay_time_ms = map(v->decay_time, 0, 127, 10, 2000); 
-  uint32_t sustain_amplitude = map(v->sustain_level, 0, 127, 0, 32767);
+  uint32_t decay_time_ms = map(v->decay_time, 0, 127, 10, 2000);
+  int32_t sustain_level = map(v->sustain_level, 0, 127, 0, ENVELOPE_FULL_SCALE);
   uint32_t release_time_ms = map(v->release_time, 0, 127, 10, 4000);
   
-  switch (v->envelope_stage) {
-    case ENV_ATTACK:
-      if (elapsed < attack_time_ms) {
-        // Linear attack from 0 to max amplitude
-        v->current_amplitude = (elapsed * 32767) / attack_time_ms;
-      } else {
-        // Attack complete, move to decay
-        v->current_amplitude = 32767;
-        v->envelope_stage = ENV_DECAY;
-        v->envelope_counter = elapsed;
-      }
-      break;
-      
-    case ENV_DECAY:
-      {
-        uint32_t decay_elapsed = elapsed - v->envelope_counter;
-        if (decay_elapsed < decay_time_ms) {
-          // Linear decay from max amplitude to sustain level
-          uint32_t decay_amount = ((32767 - sustain_amplitude) * decay_elapsed) / decay_time_ms;
-          v->current_amplitude = 32767 - decay_amount;
-        } else {
-          // Decay complete, move to sustain
-          v->current_amplitude = sustain_amplitude;
-          v->envelope_stage = ENV_SUSTAIN;
-        }
-      }
-      break;
-      
-    case ENV_SUSTAIN:
-      // Hold sustain level until note is released
-      v->current_amplitude = sustain_amplitude;
-      
-      // Check if note should be released due to length
-      if (elapsed >= v->length && !v->note_released) {
-        v->note_released = true;
-        v->note_release_time = millis();
-        v->envelope_stage = ENV_RELEASE;
-        v->envelope_counter = 0;
-      }
-      break;
-      
-    case ENV_RELEASE:
-      {
-        uint32_t release_elapsed = millis() - v->note_release_time;
-        if (release_elapsed < release_time_ms) {
-          // Linear release from current level to 0
-          uint32_t release_start_amplitude = sustain_amplitude;
-          if (v->envelope_counter == 0) {
-            // Store the amplitude when release started
-            release_start_amplitude = v->current_amplitude;
-            v->envelope_counter = release_start_amplitude;
-          } else {
-            release_start_amplitude = v->envelope_counter;
-          }
-          
-          uint32_t release_amount = (release_start_amplitude * release_elapsed) / release_time_ms;
-          v->current_amplitude = release_start_amplitude - release_amount;
-        } else {
-          // Release complete, turn off voice
-          v->current_amplitude = 0;
-          v->active = false;
-          v->envelope_stage = ENV_OFF;
-        }
-      }
-      break;
-      
-    case ENV_OFF:
-    default:
-      v->current_amplitude = 0;
-      v->active = false;
-      break;
+  EnvelopeRates rates;
+  rates.attackStep = envelopeStep(ENVELOPE_FULL_SCALE, attack_time_ms * SAMPLE_RATE / 1000);
+  rates.holdTicks = 0;
+  rates.decayExponential = false;   // Linear decay to sustain
+  rates.decayStep = envelopeStep(ENVELOPE_FULL_SCALE - sustain_level, decay_time_ms * SAMPLE_RATE / 1000);
+  rates.decayCoef = 0;
+  rates.sustainLevel = sustain_level;
+  rates.releaseTicks = envelopeTicks(release_time_ms * SAMPLE_RATE / 1000);
+  rates.gateTicks = 0;   // Released by the note-off playNote() schedules
+  
+  voice_bank.envelope[voice].setRates(rates);
+}
+
+uint16_t calculateADSR(uint8_t voice) {
+  if (voice >= NUM_VOICES || !voices[voice].active) return 0;
+  
+  EnvelopeGenerator* env = &voice_bank.envelope[voice];
+  voice_bank.current_amplitude[voice] = env->nextSample();
+  
+  // Release complete, turn off voice
+  if (!env->isActive()) {
+    voices[voice].active = false;
   }
   
-  return v->current_amplitude;
+  return voice_bank.current_amplitude[voice];
 }
 
-int16_t getWaveformSample(uint8_t waveform, uint32_t phase) {
+int16_t getWaveformSample(uint8_t waveform, uint32_t phase, uint8_t mip_level) {
   uint8_t table_index = (phase >> 24);
   
   switch (waveform) {
@@ -1559,17 +1600,17 @@ int16_t getWaveformSample(uint8_t waveform, uint32_t phase) {
     case WAVE_TRIANGLE:
       return (table_index < 128) ? (table_index * 512) - 32767 : 32767 - ((table_index - 128) * 512);
     case WAVE_SAWTOOTH:
-      return (table_index * 256) - 32767;
+      return bandlimited_tables[BL_SAWTOOTH][mip_level][table_index];
     case WAVE_SQUARE:
-      return (table_index < 128) ? 16383 : -16383;
+      return bandlimited_tables[BL_SQUARE][mip_level][table_index];
     case WAVE_NOISE:
       return random(-16383, 16383);
     case WAVE_RAMP:  // Inverted sawtooth
-      return 32767 - (table_index * 256);
+      return bandlimited_tables[BL_RAMP][mip_level][table_index];
     case WAVE_A:  // 25% pulse wave
-      return (table_index < 64) ? 16383 : -16383;
+      return bandlimited_tables[BL_PULSE_25][mip_level][table_index];
     case WAVE_B:  // 12.5% pulse wave
-      return (table_index < 32) ? 16383 : -16383;
+      return bandlimited_tables[BL_PULSE_12][mip_level][table_index];
     case WAVE_C:  // Two-step square
       if (table_index < 64) return 16383;
       else if (table_index < 128) return 0;
@@ -1605,37 +1646,206 @@ int16_t getWaveformSample(uint8_t waveform, uint32_t phase) {
   }
 }
 
+uint32_t midiNoteToFrequencyWord(uint8_t note) {
+  return note_tuning.ftw[note & 0x7F];
+}
+
+uint8_t getMipLevel(uint32_t freq_word) {
+  // Harmonic h aliases once h * freq_word >= 2^31, level L keeps 128 >> L
+  // harmonics, so level L is safe while freq_word <= 2^(24 + L)
+  if (freq_word <= (1UL << 24)) return 0;
+  uint8_t level = (32 - __builtin_clz(freq_word - 1)) - 24;
+  return min(level, (uint8_t)(WAVETABLE_MIP_LEVELS - 1));
+}
+
+void buildBandLimitedTables() {
+  // Additive synthesis of the Fourier series of each naive shape. Integer
+  // harmonics of a 256-point cycle are exact reads of wavetable_sine, so
+  // this needs no sin() calls.
+  static float accum[WAVETABLE_SIZE];
+  const int16_t peaks[NUM_BL_WAVES] = {32767, 32767, 16383, 16383, 16383};  // Match the naive levels
+  
+  for (int wave = 0; wave < NUM_BL_WAVES; wave++) {
+    int duty = WAVETABLE_SIZE / 2;   // High for index < duty
+    if (wave == BL_PULSE_25) duty = WAVETABLE_SIZE / 4;
+    if (wave == BL_PULSE_12) duty = WAVETABLE_SIZE / 8;
+    
+    // Pass 0 finds the peak over every level, pass 1 writes with one shared scale
+    float peak = 0;
+    for (int pass = 0; pass < 2; pass++) {
+      for (int level = 0; level < WAVETABLE_MIP_LEVELS; level++) {
+        int harmonics = min(128 >> level, WAVETABLE_SIZE / 2 - 1);
+        float dc = (wave >= BL_SQUARE) ? (2.0f * duty / WAVETABLE_SIZE - 1.0f) : 0.0f;
+        for (int i = 0; i < WAVETABLE_SIZE; i++) accum[i] = dc;
+        
+        for (int k = 1; k <= harmonics; k++) {
+          float sin_coeff = 0, cos_coeff = 0;
+          if (wave == BL_SAWTOOTH) {
+            sin_coeff = -2.0f / (PI * k);
+          } else if (wave == BL_RAMP) {
+            sin_coeff = 2.0f / (PI * k);
+          } else {
+            float s = (int16_t)pgm_read_word(&wavetable_sine[(k * duty) & 0xFF]) / 32767.0f;
+            float c = (int16_t)pgm_read_word(&wavetable_sine[(k * duty + 64) & 0xFF]) / 32767.0f;
+            cos_coeff = 2.0f * s / (PI * k);
+            sin_coeff = 2.0f * (1.0f - c) / (PI * k);
+          }
+          
+          for (int i = 0; i < WAVETABLE_SIZE; i++) {
+            uint8_t index = (k * i) & 0xFF;
+            accum[i] += sin_coeff * (int16_t)pgm_read_word(&wavetable_sine[index]) / 32767.0f
+                      + cos_coeff * (int16_t)pgm_read_word(&wavetable_sine[(uint8_t)(index + 64)]) / 32767.0f;
+          }
+        }
+        
+        for (int i = 0; i < WAVETABLE_SIZE; i++) {
+          if (pass == 0) {
+            peak = max(peak, fabsf(accum[i]));
+          } else {
+            bandlimited_tables[wave][level][i] = (int16_t)lrintf(accum[i] * peaks[wave] / peak);
+          }
+        }
+      }
+    }
+  }
+  
+  Serial.printf("Band-limited wavetables ready (%d bytes)\n", (int)sizeof(bandlimited_tables));
+}
+
+// Patterns go into the bank in SRAM and to the preset log; the sounds
+// only to the log. Each part is its own section, so the log appends only
+// what changed since the slot was last saved.
 void savePattern(uint8_t slot) {
-  char key[32];
-  sprintf(key, "pattern_%d", slot);
+  uint8_t buffer[PRESET_SECTION_MAX];
+  pattern_bank.save(slot, pattern);
   
-  // Save current voice patterns
-  preferences.putBytes(key, voices, sizeof(voices));
-  preferences.putUChar("current_scale", sequencer.current_scale);
-  preferences.putInt("song_transpose", sequencer.song_transpose);
+  PresetWriter sounds(buffer, sizeof(buffer));
+  for (int v = 0; v < NUM_VOICES; v++) {
+    sounds.put8(voices[v].waveform);
+    sounds.put8(voices[v].attack_time);
+    sounds.put8(voices[v].decay_time);
+    sounds.put8(voices[v].sustain_level);
+    sounds.put8(voices[v].release_time);
+    sounds.put16(voices[v].length);
+    sounds.put8(voices[v].volume);
+    sounds.put8((uint8_t)voices[v].transpose);
+    sounds.put8(voices[v].swing_offset);
+  }
+  preset_log.write(slot, PRESET_VOICES, buffer, sounds.getLength());
+  
+  PresetWriter globals(buffer, sizeof(buffer));
+  globals.put8(sequencer.current_scale);
+  globals.put8((uint8_t)sequencer.song_transpose);
+  preset_log.write(slot, PRESET_GLOBALS, buffer, globals.getLength());
+  
+  PresetWriter steps(buffer, sizeof(buffer));
+  presetPutPattern(steps, pattern);
+  preset_log.write(slot, PRESET_PATTERN, buffer, steps.getLength());
+}
+
+// A slot saved before a reboot is read back from the log into the bank
+bool fetchPattern(uint8_t slot, StepPattern& target) {
+  if (pattern_bank.load(slot, target)) return true;
+  
+  uint8_t buffer[PRESET_SECTION_MAX];
+  int16_t length = preset_log.read(slot, PRESET_PATTERN, buffer, sizeof(buffer));
+  if (length < 0) return false;
+  PresetReader steps(buffer, length);
+  if (!presetGetPattern(steps, target, 60)) return false;
+  pattern_bank.save(slot, target);
+  return true;
 }
 
 void loadPattern(uint8_t slot) {
-  char key[32];
-  sprintf(key, "pattern_%d", slot);
-  
-  // Load voice patterns
-  size_t len = preferences.getBytesLength(key);
-  if (len == sizeof(voices)) {
-    preferences.getBytes(key, voices, len);
-    sequencer.current_scale = preferences.getUChar("current_scale", 0);
-    sequencer.song_transpose = preferences.getInt("song_transpose", 0);
-    ui.needs_full_redraw = true;
+  uint8_t buffer[PRESET_SECTION_MAX];
+  
+  // Load voice sounds (values read first: constrain() is a macro)
+  int16_t length = preset_log.read(slot, PRESET_VOICES, buffer, sizeof(buffer));
+  if (length == NUM_VOICES * 10) {
+    PresetReader sounds(buffer, length);
+    for (int v = 0; v < NUM_VOICES; v++) {
+      uint8_t waveform = sounds.get8();
+      voices[v].waveform = constrain(waveform, 0, NUM_WAVEFORMS - 1);
+      voices[v].attack_time = sounds.get8() & 0x7F;
+      voices[v].decay_time = sounds.get8() & 0x7F;
+      voices[v].sustain_level = sounds.get8() & 0x7F;
+      voices[v].release_time = sounds.get8() & 0x7F;
+      voices[v].length = sounds.get16();
+      voices[v].volume = sounds.get8() & 0x7F;
+      int8_t transpose = (int8_t)sounds.get8();
+      voices[v].transpose = constrain(transpose, -24, 24);
+      voices[v].swing_offset = sounds.get8();
+      sendEnvelopeUpdate(v);
+    }
   }
+  
+  length = preset_log.read(slot, PRESET_GLOBALS, buffer, sizeof(buffer));
+  if (length == 2) {
+    PresetReader globals(buffer, length);
+    uint8_t scale = globals.get8();
+    int8_t transpose = (int8_t)globals.get8();
+    sequencer.current_scale = constrain(scale, 0, NUM_SCALES - 1);
+    sequencer.song_transpose = constrain(transpose, -24, 24);
+  }
+  fetchPattern(slot, pattern);
+  ui.needs_full_redraw = true;
+}
+
+// Steps only: plays from the end of the current pattern, in place of
+// anything cued before
+void cuePattern(uint8_t slot) {
+  StepPattern cued;                 // A failed read leaves `next` as it was
+  if (!fetchPattern(slot, cued)) return;
+  PatternPair& edit = pattern_snapshot.edit();
+  edit.next = cued;
+  edit.next_cued = true;
+  pattern_snapshot.publish();
 }
 
-int8_t getDirection(uint8_t last_state, uint8_t current_state) {
-  uint8_t transition = (last_state << 2) | current_state;
-  switch(transition) {
-    case 0b0010: case 0b1011: case 0b1101: case 0b0100: return 1;   // CW
-    case 0b0001: case 0b0111: case 0b1110: case 0b1000: return -1;  // CCW
-    default: return 0;
+// UI side, every pass of the UI loop: publishes the edits made to
+// `pattern`, follows the audio task onto the next pattern after its step
+// 0, and cues the next one of the song from the bank. The chain loops
+// until a pattern is cued or loaded by hand.
+void updatePatterns() {
+  PatternPair& edit = pattern_snapshot.edit();
+  bool changed = false;
+  
+  // Edits first, so an edit made just before step 0 still reaches the
+  // pattern that loops on
+  if (!pattern.sameAs(edit.playing)) {
+    edit.playing = pattern;
+    if (!edit.next_cued) edit.next = pattern;
+    changed = true;
   }
+  
+  uint32_t position = patterns_started.load(std::memory_order_acquire);
+  if (position != edit.position) {
+    edit.playing = edit.next;
+    edit.next_cued = false;
+    edit.position = position;
+    changed = true;
+    if (!pattern.sameAs(edit.playing)) {
+      pattern = edit.playing;
+      ui.needs_full_redraw = true;
+    }
+  }
+  
+  if (song_playing && !edit.next_cued) {
+    uint8_t slot = song.slotAt(song_position);
+    if (slot == PATTERN_NONE) {
+      song_playing = false;
+    } else {
+      StepPattern cued;
+      if (fetchPattern(slot, cued)) {
+        edit.next = cued;
+        edit.next_cued = true;
+      }
+      song_position++;
+      changed = true;
+    }
+  }
+  
+  if (changed) pattern_snapshot.publish();
 }
 
 void playBootUpSound() {
@@ -1665,9 +1875,9 @@ void loadDemoSong() {
   voices[0].volume = 100;
   voices[0].transpose = -24; // Low bass
   
+  pattern.clear(NUM_STEPS, 60);
   for (int s = 0; s < NUM_STEPS; s++) {
-    voices[0].step_sequence[s] = (s % 4 == 0); // Steps 1, 5, 9, 13
-    voices[0].step_notes[s] = 36; // Low C
+    pattern.setStep(0, s, 36, 127, s % 4 == 0); // Low C on steps 1, 5, 9, 13
   }
   Serial.printf("BASS: Steps 0,4,8,12 active\n");
   
@@ -1683,8 +1893,7 @@ void loadDemoSong() {
   // Melodic pattern: C-E-G-E C-F-A-F
   uint8_t melody[16] = {60, 0, 64, 0, 67, 0, 64, 0, 60, 0, 65, 0, 69, 0, 65, 0};
   for (int s = 0; s < NUM_STEPS; s++) {
-    voices[1].step_sequence[s] = (melody[s] > 0);
-    voices[1].step_notes[s] = (melody[s] > 0) ? melody[s] : 60; // Default to C if 0
+    pattern.setStep(1, s, (melody[s] > 0) ? melody[s] : 60, 127, melody[s] > 0); // Default to C if 0
   }
   Serial.printf("LEAD: Melodic pattern loaded\n");
   
@@ -1698,8 +1907,7 @@ void loadDemoSong() {
   voices[2].transpose = 0;
   
   for (int s = 0; s < NUM_STEPS; s++) {
-    voices[2].step_sequence[s] = (s % 8 == 0); // Steps 1, 9
-    voices[2].step_notes[s] = 48; // Mid C
+    pattern.setStep(2, s, 48, 127, s % 8 == 0); // Mid C on steps 1, 9
   }
   Serial.printf("PAD: Steps 0,8 active\n");
   
@@ -1713,13 +1921,12 @@ void loadDemoSong() {
   voices[3].transpose = 0;
   
   for (int s = 0; s < NUM_STEPS; s++) {
-    voices[3].step_sequence[s] = (s % 2 == 1); // Off-beats
-    voices[3].step_notes[s] = 72; // High pitched
+    pattern.setStep(3, s, 72, 127, s % 2 == 1); // High pitched off-beats
   }
   Serial.printf("PERC: Off-beat pattern (1,3,5,7,9,11,13,15)\n");
   
   // Set demo song parameters
-  sequencer.step_length = 200; // 150 BPM
+  sequencer.tempo = 150;
   sequencer.swing = 15; // Add some groove
   sequencer.current_scale = 1; // Major scale
   
@@ -1730,7 +1937,9 @@ void startDemoSong() {
   // Start the demo song playing
   sequencer.playing = true;
   sequencer.current_step = 0;
-  sequencer.last_step_time = millis();
   sequencer.mode = MODE_LIVE;
   sequencer.current_voice = 0;
+  sendSequencerCommand(CMD_SEQ_TEMPO, sequencer.tempo);
+  sendSequencerCommand(CMD_SEQ_SWING, sequencer.swing);
+  sendSequencerCommand(CMD_SEQ_START);
 }
\ No newline at end of file
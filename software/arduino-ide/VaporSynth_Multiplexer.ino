@@ -27,10 +27,19 @@
  */
 
 #include <Adafruit_GFX.h>
-#include <Adafruit_ILI9341.h>
+#include <FrameDisplay.h>        // From software/lib/MintyDisplay, see README
 #include <SPI.h>
 #include <driver/i2s.h>
-#include <Preferences.h>
+#include <EnvelopeGenerator.h>   // From software/lib/MintySynth, see README
+#include <SynthTables.h>
+#include <SpscQueue.h>
+#include <EncoderInput.h>
+#include <SequencerClock.h>
+#include <EventScheduler.h>
+#include <PatternStore.h>
+#include <PresetLog.h>
+#include <ParamSnapshot.h>
+#include <atomic>
 
 // ═══════════════════════════════════════════════════════════════════════════════
 // HARDWARE PIN DEFINITIONS
@@ -51,6 +60,12 @@
 #define SAMPLE_RATE     20000
 #define I2S_BUFFER_SIZE 512
 
+// Dual-core layout: audio renders on core 1, inputs and display on core 0
+#define AUDIO_TASK_CORE      1
+#define AUDIO_TASK_PRIORITY  (configMAX_PRIORITIES - 2)
+#define UI_TASK_CORE         0
+#define UI_TASK_PRIORITY     1
+
 // Multiplexer Control System (8 pins total)
 #define MUX_A0          4     // Address bit 0 (shared)
 #define MUX_A1          5     // Address bit 1 (shared)
@@ -120,7 +135,7 @@ enum FunctionKeys {
 // ═══════════════════════════════════════════════════════════════════════════════
 
 #define NUM_VOICES      4
-#define NUM_STEPS       16
+#define NUM_STEPS       16        // Keys and grid: one page of the pattern
 #define NUM_WAVEFORMS   15
 #define NUM_SCALES      8
 #define WAVETABLE_SIZE  256
@@ -157,15 +172,6 @@ enum OperatingMode {
   MODE_SONG           // Song management mode
 };
 
-// ADSR Envelope stages
-enum EnvelopeStage {
-  ENV_ATTACK = 0,
-  ENV_DECAY = 1,
-  ENV_SUSTAIN = 2,
-  ENV_RELEASE = 3,
-  ENV_OFF = 4
-};
-
 // ═══════════════════════════════════════════════════════════════════════════════
 // DATA STRUCTURES
 // ═══════════════════════════════════════════════════════════════════════════════
@@ -173,15 +179,8 @@ enum EnvelopeStage {
 // Enhanced Voice Structure with full ADSR
 struct Voice {
   bool active = false;
-  uint32_t phase_accumulator = 0;
-  uint32_t frequency_tuning_word = 0;
   uint8_t waveform = WAVE_SINE;
   
-  // ADSR Envelope System
-  EnvelopeStage envelope_stage = ENV_OFF;
-  uint32_t envelope_counter = 0;
-  uint16_t current_amplitude = 0;      // Current envelope level (0-32767)
-  
   // ADSR Parameters (0-127 each)
   uint8_t attack_time = 10;            // Attack time
   uint8_t decay_time = 30;             // Decay time  
@@ -192,23 +191,48 @@ struct Voice {
   uint8_t note = 60;
   uint16_t length = 500;               // Note duration in ms
   uint32_t note_start_time = 0;
-  uint32_t note_release_time = 0;      // When release stage started
-  bool note_released = false;          // Whether note is in release phase
   
-  // Sequence data
-  bool step_sequence[NUM_STEPS] = {false};
-  uint8_t step_notes[NUM_STEPS];
   uint8_t volume = 100;         // 0-127
   int8_t transpose = 0;         // -24 to +24 semitones
   uint8_t swing_offset = 0;     // Per-voice swing
 } voices[NUM_VOICES];
 
+// Per-sample oscillator state, kept out of Voice as parallel arrays so the
+// audio loop touches a few packed cache lines instead of whole Voice structs
+struct VoiceBank {
+  uint32_t phase_accumulator[NUM_VOICES];
+  uint32_t frequency_tuning_word[NUM_VOICES];
+  uint16_t current_amplitude[NUM_VOICES];   // Current envelope level (0-32767)
+  EnvelopeGenerator envelope[NUM_VOICES];   // ADSR state, advanced per sample
+} voice_bank;
+
+// Note, envelope and transport commands from the UI task to the audio task. Only
+// the audio task touches voice_bank; the queue is lock-free (one producer, one consumer).
+enum AudioCommandType {
+  CMD_NOTE_ON = 0,
+  CMD_NOTE_OFF,
+  CMD_UPDATE_ENVELOPE,
+  CMD_SEQ_START,
+  CMD_SEQ_STOP,
+  CMD_SEQ_TEMPO,
+  CMD_SEQ_SWING
+};
+
+struct AudioCommand {
+  uint8_t type;
+  uint8_t voice;
+  uint8_t note;
+  uint16_t value;      // Tempo in BPM, swing 0-100
+};
+
+SpscQueue<AudioCommand, 32> audio_commands;
+volatile uint32_t dropped_commands = 0;
+
 // Enhanced Sequencer Structure
 struct Sequencer {
   bool playing = false;
-  uint8_t current_step = 0;
-  uint32_t last_step_time = 0;
-  uint16_t step_length = 250;
+  volatile uint8_t current_step = 0;   // Last step played, set by the audio task
+  uint16_t tempo = 120;                // BPM, steps are 16ths
   uint8_t swing = 0;
   OperatingMode mode = MODE_LIVE;
   uint8_t current_voice = 0;
@@ -229,45 +253,38 @@ struct DualMatrixInputs {
   bool last_matrix2_keys[16] = {false};
   
   // Pattern clipboard for copy/paste
-  bool pattern_clipboard[NUM_VOICES][NUM_STEPS];
+  uint64_t pattern_clipboard[NUM_VOICES];   // Step gates, one word per voice
   bool clipboard_has_data = false;
 } inputs;
 
-// Enhanced Encoder Structure
+// Enhanced Encoder Structure - rotation is counted by encoder_input
 struct EncoderState {
   uint8_t clk_pin;
   uint8_t dt_pin;
   uint8_t sw_pin;
-  bool last_clk = HIGH;
-  bool last_dt = HIGH;
+  int16_t min_position;
+  int16_t max_position;
   int position = 64;
   bool button = false;
   bool button_pressed = false;
-  uint32_t last_change_time = 0;
-  int8_t direction_buffer[4] = {0, 0, 0, 0};
-  uint8_t buffer_index = 0;
-  int8_t last_valid_direction = 0;
 };
 
 // Initialize encoder pin mappings
 EncoderState encoders[5] = {
-  {ENC1_CLK, ENC1_DT, ENC1_SW},  // Tempo
-  {ENC2_CLK, ENC2_DT, ENC2_SW},  // Pitch
-  {ENC3_CLK, ENC3_DT, ENC3_SW},  // Length
-  {ENC4_CLK, ENC4_DT, ENC4_SW},  // Envelope
-  {ENC5_CLK, ENC5_DT, ENC5_SW}   // Swing
+  {ENC1_CLK, ENC1_DT, ENC1_SW, 40, 300},  // Tempo
+  {ENC2_CLK, ENC2_DT, ENC2_SW, 0, 127},   // Pitch
+  {ENC3_CLK, ENC3_DT, ENC3_SW, 0, 127},   // Length
+  {ENC4_CLK, ENC4_DT, ENC4_SW, 0, 127},   // Envelope
+  {ENC5_CLK, ENC5_DT, ENC5_SW, 0, 100}    // Swing
 };
 
-// Non-blocking Event Scheduler for Per-Voice Swing
-#define MAX_SCHEDULED_EVENTS 16
-struct ScheduledEvent {
-  bool active = false;
-  uint32_t trigger_time = 0;
-  uint8_t voice = 0;
-  uint8_t note = 60;
-};
+EncoderInput encoder_input;   // PCNT units for the first four, interrupts for the fifth
 
-ScheduledEvent event_queue[MAX_SCHEDULED_EVENTS];
+// Swung notes and every note's note-off, on the sample clock of the audio task
+EventScheduler note_events;
+uint16_t note_ids[NUM_VOICES];   // Counts each voice's notes, so a stale note-off is ignored
+SequencerClock seq_clock;      // Steps on the sample clock, owned by the audio task
+uint64_t sample_clock = 0;     // Frames rendered so far
 
 // UI State
 struct UIState {
@@ -291,8 +308,25 @@ struct UIState {
 } ui;
 
 // Global objects
-Adafruit_ILI9341 tft = Adafruit_ILI9341(TFT_CS, TFT_DC, TFT_MOSI, TFT_CLK, TFT_RST);
-Preferences preferences;
+FrameDisplay tft(TFT_CS, TFT_DC, TFT_MOSI, TFT_CLK, TFT_RST);   // Hardware SPI + DMA, drawn in PSRAM
+PresetLog preset_log;           // Saved slots, appended to a log on LittleFS
+
+// Patterns as a bitset word per voice with packed notes (PatternStore.h).
+// The UI edits `pattern`, its own copy, and hands it to the audio task
+// through a snapshot, cued and chained as in the Enhanced sketch.
+struct PatternPair {
+  StepPattern playing;
+  StepPattern next;                 // Takes over at the next step 0
+  bool next_cued;                   // False: `next` is `playing` again, edits go to both
+  uint32_t position;                // patterns_started when `playing` took over
+};
+StepPattern pattern;                // UI task only
+ParamSnapshot<PatternPair> pattern_snapshot;
+std::atomic<uint32_t> patterns_started(0);
+PatternStore pattern_bank;
+SongChain song;
+uint32_t song_position = 0;         // Song patterns cued so far
+bool song_playing = false;
 
 // Audio buffer and synthesis variables
 int16_t audio_buffer[I2S_BUFFER_SIZE * 2];
@@ -348,20 +382,8 @@ const int16_t wavetable_sine[WAVETABLE_SIZE] PROGMEM = {
   -12539, -11793, -11039, -10278, -9512, -8739, -7962, -7179, -6393, -5602, -4808, -4011, -3212, -2410, -1608, -804
 };
 
-// MIDI note to frequency conversion
-const uint32_t note_frequencies[128] PROGMEM = {
-  0x001A, 0x001C, 0x001E, 0x001F, 0x0021, 0x0023, 0x0025, 0x0028, 0x002A, 0x002D, 0x002F, 0x0032,
-  0x0035, 0x0038, 0x003C, 0x003F, 0x0043, 0x0047, 0x004B, 0x0050, 0x0055, 0x005A, 0x005F, 0x0065,
-  0x006B, 0x0071, 0x0078, 0x007F, 0x0087, 0x008F, 0x0097, 0x00A0, 0x00AA, 0x00B4, 0x00BE, 0x00CA,
-  0x00D6, 0x00E3, 0x00F0, 0x00FE, 0x010E, 0x011E, 0x012F, 0x0141, 0x0154, 0x0168, 0x017D, 0x0194,
-  0x01AC, 0x01C6, 0x01E1, 0x01FD, 0x021C, 0x023C, 0x025E, 0x0282, 0x02A8, 0x02D0, 0x02FB, 0x0329,
-  0x0359, 0x038C, 0x03C2, 0x03FB, 0x0438, 0x0478, 0x04BC, 0x0504, 0x0550, 0x05A1, 0x05F7, 0x0652,
-  0x06B2, 0x0718, 0x0784, 0x07F6, 0x0870, 0x08F0, 0x0978, 0x0A08, 0x0AA1, 0x0B43, 0x0BEF, 0x0CA4,
-  0x0D65, 0x0E31, 0x0F09, 0x0FED, 0x10E0, 0x11E1, 0x12F1, 0x1411, 0x1543, 0x1687, 0x17DE, 0x1949,
-  0x1ACA, 0x1C62, 0x1E12, 0x1FDB, 0x21C0, 0x23C2, 0x25E3, 0x2823, 0x2A86, 0x2D0E, 0x2FBC, 0x3292,
-  0x3594, 0x38C4, 0x3C24, 0x3FB7, 0x4381, 0x4785, 0x4BC6, 0x5047, 0x550D, 0x5A1C, 0x5F78, 0x6525,
-  0x6B29, 0x7188, 0x7848, 0x7F6F, 0x8703, 0x8F0A, 0x978C, 0xA08F
-};
+// MIDI note to 32-bit tuning word, computed at compile time for SAMPLE_RATE
+static constexpr SynthTuningTable note_tuning = synthMakeTuning(SAMPLE_RATE, TUNING_EQUAL);
 
 // ═══════════════════════════════════════════════════════════════════════════════
 // FUNCTION PROTOTYPES
@@ -377,11 +399,11 @@ void scanMatrix1();
 void scanMatrix2();
 void readEncoders();
 void processEncoders();
-void processSequencer();
-void processNoteQueue();
-void scheduleNoteEvent(uint8_t voice, uint8_t note, uint32_t delay_ms);
+uint64_t playSequencer(uint64_t frame);
+void playNote(uint8_t voice, uint8_t note, uint64_t frame);
 void generateAudio();
 uint16_t calculateADSR(uint8_t voice);
+void updateEnvelopeRates(uint8_t voice);
 void updateDisplay();
 void drawVaporwaveLoadingScreen();
 void drawNeonInterface();
@@ -397,12 +419,21 @@ void handleFunctionKey(FunctionKeys func);
 void changeMode(OperatingMode new_mode);
 void triggerNote(uint8_t voice, uint8_t note);
 void stopNote(uint8_t voice);
+void sendEnvelopeUpdate(uint8_t voice);
+void sendAudioCommand(uint8_t type, uint8_t voice, uint8_t note);
+void sendSequencerCommand(uint8_t type, uint16_t value = 0);
+void processAudioCommands();
+void startVoice(uint8_t voice, uint8_t note);
+void releaseVoice(uint8_t voice);
+void audioTask(void* param);
+void uiTask(void* param);
 int16_t getWaveformSample(uint8_t waveform, uint32_t phase);
 uint32_t midiNoteToFrequencyWord(uint8_t note);
 uint8_t applyScale(uint8_t note, uint8_t scale_type);
-int8_t getDirection(uint8_t last_state, uint8_t current_state);
 void savePattern(uint8_t slot);
 void loadPattern(uint8_t slot);
+void cuePattern(uint8_t slot);
+void updatePatterns();
 void loadDemoSong();
 void startDemoSong();
 void setMultiplexerChannel(uint8_t channel);
@@ -422,44 +453,59 @@ void setup() {
   
   Serial.println("VaporSynth ready! Hardware: 2x multiplexers, dedicated I2S audio");
   Serial.println("Press PLAY button to start demo song!");
+  
+  // The audio task starts on the patterns built by initializeSystem()
+  PatternPair patterns = { pattern, pattern, false, 0 };
+  pattern_snapshot.reset(patterns);
+  
+  // Audio gets core 1 to itself; a slow redraw can no longer starve i2s_write
+  xTaskCreatePinnedToCore(audioTask, "audio", 4096, NULL, AUDIO_TASK_PRIORITY, NULL, AUDIO_TASK_CORE);
+  xTaskCreatePinnedToCore(uiTask, "ui", 8192, NULL, UI_TASK_PRIORITY, NULL, UI_TASK_CORE);
 }
 
 void loop() {
-  uint32_t current_time = millis();
-  static uint32_t last_audio_time = 0;
-  static uint32_t last_display_time = 0;
-  static uint32_t last_input_time = 0;
-  
-  // Read inputs at high frequency for responsive controls
-  if (current_time - last_input_time >= 5) {  // 200Hz input scanning
-    readInputs();
-    last_input_time = current_time;
-  }
-  
-  // Process scheduled note events (for per-voice swing)
-  processNoteQueue();
-  
-  // Process sequencer
-  if (sequencer.playing) {
-    processSequencer();
-  }
-  
-  // Generate audio at regular intervals
-  if (current_time - last_audio_time >= 25) {  // ~40Hz audio generation
-    generateAudio();
-    last_audio_time = current_time;
-  }
-  
-  // Update display at lower rate
-  if (current_time - last_display_time >= 50) {  // 20Hz display updates
-    updateDisplay();
-    last_display_time = current_time;
+  // Everything runs in audioTask and uiTask
+  vTaskDelete(NULL);
+}
+
+void audioTask(void* param) {
+  for (;;) {
+    pattern_snapshot.update();   // Newest patterns from the UI, once per buffer
+    processAudioCommands();
+    generateAudio();    // Blocks in i2s_write until the DMA has room
   }
+}
+
+void uiTask(void* param) {
+  uint32_t last_display_time = 0;
+  uint32_t last_input_time = 0;
   
-  // Update blink state for UI elements
-  if (current_time - ui.last_blink >= 500) {
-    ui.blink_state = !ui.blink_state;
-    ui.last_blink = current_time;
+  for (;;) {
+    uint32_t current_time = millis();
+    
+    // Read inputs at high frequency for responsive controls
+    if (current_time - last_input_time >= 5) {  // 200Hz input scanning
+      readInputs();
+      last_input_time = current_time;
+    }
+    
+    // Hand the edits to the audio task and keep the next pattern of the song cued
+    updatePatterns();
+    
+    // Update display at lower rate
+    if (current_time - last_display_time >= 50) {  // 20Hz display updates
+      updateDisplay();
+      tft.flush();    // Pushed by the display task, returns at once
+      last_display_time = current_time;
+    }
+    
+    // Update blink state for UI elements
+    if (current_time - ui.last_blink >= 500) {
+      ui.blink_state = !ui.blink_state;
+      ui.last_blink = current_time;
+    }
+    
+    delay(1);   // Let the idle task feed the watchdog
   }
 }
 
@@ -474,6 +520,7 @@ void initializeSystem() {
   
   // Show loading screen
   drawVaporwaveLoadingScreen();
+  tft.flush();
   delay(2000);
   tft.fillScreen(COLOR_BG);
   
@@ -483,8 +530,10 @@ void initializeSystem() {
   // Initialize multiplexer control system
   initializeMultiplexers();
   
-  // Initialize preferences for save/load
-  preferences.begin("vaporsynth", false);
+  // Save/load: sections are appended to a log, only the ones that changed
+  if (!preset_log.begin("/vaporsynth.log")) {
+    Serial.println("Preset log failed to open, saving disabled");
+  }
   
   // Set initial encoder positions
   encoders[0].position = 120;  // Tempo (120 BPM)
@@ -494,28 +543,31 @@ void initializeSystem() {
   encoders[4].position = 0;    // Swing
   
   // Initialize default patterns
+  pattern.clear(NUM_STEPS, 60);
   for (int v = 0; v < NUM_VOICES; v++) {
     voices[v].waveform = v % NUM_WAVEFORMS;
     voices[v].volume = 80;
     voices[v].transpose = 0;
     
     for (int s = 0; s < NUM_STEPS; s++) {
-      voices[v].step_notes[s] = 60 + v * 12 + (s % 8);
       // Create different default patterns for each voice
+      bool on = false;
       switch (v) {
-        case 0: voices[v].step_sequence[s] = (s % 4 == 0); break;        // Kick pattern
-        case 1: voices[v].step_sequence[s] = (s % 8 == 4); break;        // Snare pattern
-        case 2: voices[v].step_sequence[s] = (s % 2 == 1); break;        // Hi-hat pattern
-        case 3: voices[v].step_sequence[s] = (s == 0 || s == 10); break; // Accent pattern
+        case 0: on = (s % 4 == 0); break;        // Kick pattern
+        case 1: on = (s % 8 == 4); break;        // Snare pattern
+        case 2: on = (s % 2 == 1); break;        // Hi-hat pattern
+        case 3: on = (s == 0 || s == 10); break; // Accent pattern
       }
+      pattern.setStep(v, s, 60 + v * 12 + (s % 8), 127, on);
     }
   }
   
   // Load demo song but don't start playing
   loadDemoSong();
   
-  // Initialize sequencer
-  sequencer.step_length = 250;
+  // Initialize sequencer - the audio task plays it, on its own sample clock
+  seq_clock.begin(SAMPLE_RATE, NUM_STEPS);
+  seq_clock.setTempo(sequencer.tempo);
   sequencer.mode = MODE_LIVE;
   
   ui.needs_full_redraw = true;
@@ -595,20 +647,18 @@ void initializeMultiplexers() {
   digitalWrite(MUX_EN_A, HIGH);  // Start disabled
   digitalWrite(MUX_EN_B, HIGH);  // Start disabled
   
-  // Initialize encoder pins (now on direct GPIO)
+  // Initialize encoders (now on direct GPIO, counted in hardware)
   for (int i = 0; i < 5; i++) {
-    pinMode(encoders[i].clk_pin, INPUT_PULLUP);
-    pinMode(encoders[i].dt_pin, INPUT_PULLUP);
+    encoder_input.attach(i, encoders[i].clk_pin, encoders[i].dt_pin);
+    encoder_input.setRange(i, encoders[i].max_position - encoders[i].min_position);  // A flick sweeps the range
     pinMode(encoders[i].sw_pin, INPUT_PULLUP);
-    encoders[i].last_clk = digitalRead(encoders[i].clk_pin);
-    encoders[i].last_dt = digitalRead(encoders[i].dt_pin);
   }
   
   Serial.println("Dual matrix system initialized:");
   Serial.printf("  Address bus: GPIO %d-%d (4 bits)\\n", MUX_A0, MUX_A3);
   Serial.printf("  Matrix 1 (Steps): GPIO %d (Multiplexer A)\\n", MUX_SIG_A);
   Serial.printf("  Matrix 2 (Functions): GPIO %d (Multiplexer B)\\n", MUX_SIG_B);
-  Serial.printf("  Encoders: Direct GPIO connections\\n");
+  Serial.printf("  Encoders: Direct GPIO, PCNT counted\\n");
 }
 
 // ═══════════════════════════════════════════════════════════════════════════════
@@ -678,55 +728,27 @@ void scanMatrix2() {
 }
 
 void readEncoders() {
-  // Read encoders directly from GPIO
+  // Encoder buttons; rotation is counted by encoder_input without polling
   for (int i = 0; i < 5; i++) {
-    encoders[i].last_clk = digitalRead(encoders[i].clk_pin);
-    encoders[i].last_dt = digitalRead(encoders[i].dt_pin);
     encoders[i].button = (digitalRead(encoders[i].sw_pin) == LOW);
   }
 }
 
 void processEncoders() {
-  // Process 5 encoders from direct GPIO
+  // Process 5 encoders: detents since the last pass, faster turns moving further
   for (int enc = 0; enc < 5; enc++) {
-    bool clk = digitalRead(encoders[enc].clk_pin);
-    bool dt = digitalRead(encoders[enc].dt_pin);
     bool sw = encoders[enc].button;
+    int32_t change = encoder_input.getChange(enc);
     
-    // Check for rotation
-    uint8_t current_state = (clk << 1) | dt;
-    uint8_t last_state = (encoders[enc].last_clk << 1) | encoders[enc].last_dt;
-    
-    if (clk != encoders[enc].last_clk || dt != encoders[enc].last_dt) {
-      uint32_t current_time = millis();
+    if (change != 0) {
+      int old_position = encoders[enc].position;
+      encoders[enc].position = constrain(encoders[enc].position + change,
+                                         encoders[enc].min_position, encoders[enc].max_position);
       
-      if (current_time - encoders[enc].last_change_time >= 5) {  // Debounce
-        int8_t direction = getDirection(last_state, current_state);
-        
-        if (direction != 0) {
-          int old_position = encoders[enc].position;
-          encoders[enc].position += direction;
-          
-          // Constrain based on encoder function
-          switch (enc) {
-            case 0: encoders[enc].position = constrain(encoders[enc].position, 40, 300); break;  // Tempo
-            case 1: encoders[enc].position = constrain(encoders[enc].position, 0, 127); break;   // Pitch
-            case 2: encoders[enc].position = constrain(encoders[enc].position, 0, 127); break;   // Length
-            case 3: encoders[enc].position = constrain(encoders[enc].position, 0, 127); break;   // Envelope
-            case 4: encoders[enc].position = constrain(encoders[enc].position, 0, 100); break;   // Swing
-          }
-          
-          if (encoders[enc].position != old_position) {
-            handleEncoderChange(enc, old_position, encoders[enc].position);
-            ui.last_activity = millis();
-          }
-        }
-        
-        encoders[enc].last_change_time = current_time;
+      if (encoders[enc].position != old_position) {
+        handleEncoderChange(enc, old_position, encoders[enc].position);
+        ui.last_activity = millis();
       }
-      
-      encoders[enc].last_clk = clk;
-      encoders[enc].last_dt = dt;
     }
     
     // Check for button press
@@ -756,7 +778,8 @@ void processEncoders() {
 void handleEncoderChange(int encoder, int old_value, int new_value) {
   switch (encoder) {
     case 0: // Tempo
-      sequencer.step_length = map(new_value, 40, 300, 800, 100);
+      sequencer.tempo = new_value;
+      sendSequencerCommand(CMD_SEQ_TEMPO, sequencer.tempo);
       break;
       
     case 1: // Pitch
@@ -777,6 +800,7 @@ void handleEncoderChange(int encoder, int old_value, int new_value) {
       if (sequencer.mode >= MODE_PROGRAM_0 && sequencer.mode <= MODE_PROGRAM_3) {
         int voice = sequencer.mode - MODE_PROGRAM_0;
         voices[voice].length = map(new_value, 0, 127, 50, 2000);
+        sendEnvelopeUpdate(voice);
       }
       break;
       
@@ -799,6 +823,7 @@ void handleEncoderChange(int encoder, int old_value, int new_value) {
             voices[voice].release_time = new_value;
             break;
         }
+        sendEnvelopeUpdate(voice);
       } else {
         // In live mode, control waveform for current voice
         voices[sequencer.current_voice].waveform = map(new_value, 0, 127, 0, NUM_WAVEFORMS - 1);
@@ -807,6 +832,7 @@ void handleEncoderChange(int encoder, int old_value, int new_value) {
       
     case 4: // Swing
       sequencer.swing = new_value;
+      sendSequencerCommand(CMD_SEQ_SWING, sequencer.swing);
       break;
   }
 }
@@ -817,6 +843,9 @@ void handleMatrix1Key(int key, bool pressed) {
   Serial.printf("Step key %d pressed\\n", key + 1);
   
   if (key < NUM_STEPS) {
+    // Keys cover the 16-step page the playhead is on
+    uint8_t step = sequencer.current_step / NUM_STEPS * NUM_STEPS + key;
+    
     switch (sequencer.mode) {
       case MODE_LIVE:
         if (sequencer.record_mode && sequencer.playing) {
@@ -825,12 +854,11 @@ void handleMatrix1Key(int key, bool pressed) {
           note = constrain(note, 0, 127);
           
           // If current step already has a note, erase it (toggle behavior)
-          if (voices[sequencer.current_voice].step_sequence[sequencer.current_step]) {
-            voices[sequencer.current_voice].step_sequence[sequencer.current_step] = false;
+          if (pattern.isActive(sequencer.current_voice, sequencer.current_step)) {
+            pattern.setActive(sequencer.current_voice, sequencer.current_step, false);
           } else {
             // Record new note to the current step
-            voices[sequencer.current_voice].step_sequence[sequencer.current_step] = true;
-            voices[sequencer.current_voice].step_notes[sequencer.current_step] = note;
+            pattern.setStep(sequencer.current_voice, sequencer.current_step, note, 127, true);
           }
           
           // Always trigger the note for immediate feedback
@@ -848,11 +876,11 @@ void handleMatrix1Key(int key, bool pressed) {
       case MODE_PROGRAM_3: {
         // In program mode, toggle step
         int voice = sequencer.mode - MODE_PROGRAM_0;
-        voices[voice].step_sequence[key] = !voices[voice].step_sequence[key];
+        pattern.setActive(voice, step, !pattern.isActive(voice, step));
         
-        if (voices[voice].step_sequence[key]) {
+        if (pattern.isActive(voice, step)) {
           // Play preview of this step
-          triggerNote(voice, voices[voice].step_notes[key] + voices[voice].transpose);
+          triggerNote(voice, pattern.notes[voice][step] + voices[voice].transpose);
         }
         break;
       }
@@ -921,9 +949,7 @@ void handleFunctionKey(FunctionKeys func) {
     case FUNC_PATTERN_COPY:
       // Copy current pattern to clipboard
       for (int v = 0; v < NUM_VOICES; v++) {
-        for (int s = 0; s < NUM_STEPS; s++) {
-          inputs.pattern_clipboard[v][s] = voices[v].step_sequence[s];
-        }
+        inputs.pattern_clipboard[v] = pattern.gates[v];
       }
       inputs.clipboard_has_data = true;
       Serial.println("Pattern copied to clipboard");
@@ -932,9 +958,7 @@ void handleFunctionKey(FunctionKeys func) {
       // Paste clipboard to current pattern
       if (inputs.clipboard_has_data) {
         for (int v = 0; v < NUM_VOICES; v++) {
-          for (int s = 0; s < NUM_STEPS; s++) {
-            voices[v].step_sequence[s] = inputs.pattern_clipboard[v][s];
-          }
+          pattern.gates[v] = inputs.pattern_clipboard[v];
         }
         Serial.println("Pattern pasted from clipboard");
       }
@@ -946,7 +970,11 @@ void handleFunctionKey(FunctionKeys func) {
       Serial.printf("PLAY/STOP: %s\\n", sequencer.playing ? "PLAYING" : "STOPPED");
       if (sequencer.playing) {
         sequencer.current_step = 0;
-        sequencer.last_step_time = millis();
+        sendSequencerCommand(CMD_SEQ_TEMPO, sequencer.tempo);
+        sendSequencerCommand(CMD_SEQ_SWING, sequencer.swing);
+        sendSequencerCommand(CMD_SEQ_START);
+      } else {
+        sendSequencerCommand(CMD_SEQ_STOP);
       }
       break;
     case FUNC_MUTE_ALL:
@@ -962,17 +990,17 @@ void handleFunctionKey(FunctionKeys func) {
       break;
     case FUNC_FILL:
       // Create a fill pattern on current voice
-      for (int s = 0; s < NUM_STEPS; s++) {
-        voices[sequencer.current_voice].step_sequence[s] = true;
+      for (int s = 0; s < pattern.length; s++) {
+        pattern.setActive(sequencer.current_voice, s, true);
       }
       Serial.printf("Fill pattern on voice %s\\n", voice_names[sequencer.current_voice]);
       break;
     case FUNC_RANDOM:
       // Randomize current voice pattern
-      for (int s = 0; s < NUM_STEPS; s++) {
-        voices[sequencer.current_voice].step_sequence[s] = (random(100) > 50);
-        if (voices[sequencer.current_voice].step_sequence[s]) {
-          voices[sequencer.current_voice].step_notes[s] = 48 + random(24); // Random notes C3-C5
+      for (int s = 0; s < pattern.length; s++) {
+        pattern.setActive(sequencer.current_voice, s, random(100) > 50);
+        if (pattern.isActive(sequencer.current_voice, s)) {
+          pattern.notes[sequencer.current_voice][s] = 48 + random(24); // Random notes C3-C5
         }
       }
       Serial.printf("Randomized voice %s\\n", voice_names[sequencer.current_voice]);
@@ -1021,9 +1049,9 @@ void loadDemoSong() {
   voices[0].volume = 100;
   voices[0].transpose = -24; // Low bass
   
+  pattern.clear(NUM_STEPS, 60);
   for (int s = 0; s < NUM_STEPS; s++) {
-    voices[0].step_sequence[s] = (s % 4 == 0); // Steps 1, 5, 9, 13
-    voices[0].step_notes[s] = 36; // Low C
+    pattern.setStep(0, s, 36, 127, s % 4 == 0); // Low C on steps 1, 5, 9, 13
   }
   
   // LEAD voice (voice 1) - Melodic sequence
@@ -1038,8 +1066,7 @@ void loadDemoSong() {
   // Melodic pattern: C-E-G-E C-F-A-F
   uint8_t melody[16] = {60, 0, 64, 0, 67, 0, 64, 0, 60, 0, 65, 0, 69, 0, 65, 0};
   for (int s = 0; s < NUM_STEPS; s++) {
-    voices[1].step_sequence[s] = (melody[s] > 0);
-    voices[1].step_notes[s] = (melody[s] > 0) ? melody[s] : 60; // Default to C if 0
+    pattern.setStep(1, s, (melody[s] > 0) ? melody[s] : 60, 127, melody[s] > 0); // Default to C if 0
   }
   
   // PAD voice (voice 2) - Sustained chords
@@ -1052,8 +1079,7 @@ void loadDemoSong() {
   voices[2].transpose = 0;
   
   for (int s = 0; s < NUM_STEPS; s++) {
-    voices[2].step_sequence[s] = (s % 8 == 0); // Steps 1, 9
-    voices[2].step_notes[s] = 48; // Mid C
+    pattern.setStep(2, s, 48, 127, s % 8 == 0); // Mid C on steps 1, 9
   }
   
   // PERC voice (voice 3) - Hi-hat pattern
@@ -1066,12 +1092,11 @@ void loadDemoSong() {
   voices[3].transpose = 0;
   
   for (int s = 0; s < NUM_STEPS; s++) {
-    voices[3].step_sequence[s] = (s % 2 == 1); // Off-beats
-    voices[3].step_notes[s] = 72; // High pitched
+    pattern.setStep(3, s, 72, 127, s % 2 == 1); // High pitched off-beats
   }
   
   // Set demo song parameters
-  sequencer.step_length = 200; // 150 BPM
+  sequencer.tempo = 150;
   sequencer.swing = 15; // Add some groove
   sequencer.current_scale = 1; // Major scale
   
@@ -1082,9 +1107,11 @@ void startDemoSong() {
   // Start the demo song playing
   sequencer.playing = true;
   sequencer.current_step = 0;
-  sequencer.last_step_time = millis();
   sequencer.mode = MODE_LIVE;
   sequencer.current_voice = 0;
+  sendSequencerCommand(CMD_SEQ_TEMPO, sequencer.tempo);
+  sendSequencerCommand(CMD_SEQ_SWING, sequencer.swing);
+  sendSequencerCommand(CMD_SEQ_START);
 }
 
 // Include all remaining functions from Enhanced version...
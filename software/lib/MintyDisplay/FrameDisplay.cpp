@@ -0,0 +1,422 @@
+/*
+ * MintySynth Frame Display Implementation
+ */
+
+#include "FrameDisplay.h"
+#include <esp_heap_caps.h>
+
+// ILI9341 commands
+#define ILI_SWRESET   0x01
+#define ILI_SLPOUT    0x11
+#define ILI_INVOFF    0x20
+#define ILI_INVON     0x21
+#define ILI_DISPON    0x29
+#define ILI_CASET     0x2A
+#define ILI_PASET     0x2B
+#define ILI_RAMWR     0x2C
+#define ILI_MADCTL    0x36
+
+#define MADCTL_MY     0x80
+#define MADCTL_MX     0x40
+#define MADCTL_MV     0x20
+#define MADCTL_BGR    0x08
+
+#define CLEAN_FIRST   0x7FFF
+#define CLEAN_LAST    -1
+
+// Command, data length (0x80: wait 150 ms after), data. Same sequence
+// as Adafruit_ILI9341::begin().
+static const uint8_t initCommands[] = {
+    0xEF, 3, 0x03, 0x80, 0x02,
+    0xCF, 3, 0x00, 0xC1, 0x30,
+    0xED, 4, 0x64, 0x03, 0x12, 0x81,
+    0xE8, 3, 0x85, 0x00, 0x78,
+    0xCB, 5, 0x39, 0x2C, 0x00, 0x34, 0x02,
+    0xF7, 1, 0x20,
+    0xEA, 2, 0x00, 0x00,
+    0xC0, 1, 0x23,                          // Power control 1
+    0xC1, 1, 0x10,                          // Power control 2
+    0xC5, 2, 0x3E, 0x28,                    // VCOM control 1
+    0xC7, 1, 0x86,                          // VCOM control 2
+    0x37, 1, 0x00,                          // Vertical scroll start
+    0x3A, 1, 0x55,                          // 16 bits per pixel
+    0xB1, 2, 0x00, 0x18,                    // Frame rate 79 Hz
+    0xB6, 3, 0x08, 0x82, 0x27,              // Display function control
+    0xF2, 1, 0x00,                          // 3 gamma off
+    0x26, 1, 0x01,                          // Gamma curve 1
+    0xE0, 15, 0x0F, 0x31, 0x2B, 0x0C, 0x0E, 0x08, 0x4E, 0xF1,
+              0x37, 0x07, 0x10, 0x03, 0x0E, 0x09, 0x00,
+    0xE1, 15, 0x00, 0x0E, 0x14, 0x03, 0x11, 0x07, 0x31, 0xC1,
+              0x48, 0x08, 0x0F, 0x0C, 0x31, 0x36, 0x0F,
+    ILI_SLPOUT, 0x80,
+    ILI_DISPON, 0x80,
+    0x00
+};
+
+static const uint8_t rotationMadctl[4] = {
+    MADCTL_MX | MADCTL_BGR,
+    MADCTL_MV | MADCTL_BGR,
+    MADCTL_MY | MADCTL_BGR,
+    MADCTL_MX | MADCTL_MY | MADCTL_MV | MADCTL_BGR,
+};
+
+// The panel takes RGB565 most significant byte first
+static inline uint16_t panelColor(uint16_t color) {
+    return (color >> 8) | (color << 8);
+}
+
+FrameDisplay::FrameDisplay(int8_t cs, int8_t dc, int8_t mosi, int8_t sclk, int8_t rst, int8_t miso)
+    : Adafruit_GFX(FRAME_WIDTH, FRAME_HEIGHT),
+      csPin(cs), dcPin(dc), mosiPin(mosi), sclkPin(sclk), rstPin(rst), misoPin(miso) {
+    device = NULL;
+    task = NULL;
+    mux = portMUX_INITIALIZER_UNLOCKED;
+    frame = NULL;
+    bounce[0] = NULL;
+    bounce[1] = NULL;
+    pendingAny = false;
+    pendingMadctl = 0;
+    pendingInvert = 0;
+    busy = false;
+    flushTime = 0;
+    pushUs = 0;
+    pushedPixels = 0;
+    flushes = 0;
+    clearDirty(dirtyFirst, dirtyLast);
+    clearDirty(pendingFirst, pendingLast);
+}
+
+FrameDisplay::~FrameDisplay() {
+    if (task) {
+        waitIdle();
+        vTaskDelete(task);
+    }
+    if (device) {
+        spi_bus_remove_device(device);
+        spi_bus_free(SPI2_HOST);
+    }
+    heap_caps_free(frame);
+    heap_caps_free(bounce[0]);
+    heap_caps_free(bounce[1]);
+}
+
+bool FrameDisplay::begin(uint32_t frequency) {
+    if (task) return true;
+
+    // PSRAM when there is some, a 150 KB block of internal RAM otherwise
+    size_t frameBytes = FRAME_WIDTH * FRAME_HEIGHT * sizeof(uint16_t);
+    frame = (uint16_t*)heap_caps_malloc(frameBytes, MALLOC_CAP_SPIRAM);
+    if (!frame) frame = (uint16_t*)heap_caps_malloc(frameBytes, MALLOC_CAP_8BIT);
+    bounce[0] = (uint8_t*)heap_caps_malloc(FRAME_BOUNCE_BYTES, MALLOC_CAP_DMA);
+    bounce[1] = (uint8_t*)heap_caps_malloc(FRAME_BOUNCE_BYTES, MALLOC_CAP_DMA);
+    if (!frame || !bounce[0] || !bounce[1]) return false;
+    memset(frame, 0, frameBytes);
+
+    spi_bus_config_t bus = {};
+    bus.mosi_io_num = mosiPin;
+    bus.miso_io_num = misoPin;
+    bus.sclk_io_num = sclkPin;
+    bus.quadwp_io_num = -1;
+    bus.quadhd_io_num = -1;
+    bus.max_transfer_sz = FRAME_BOUNCE_BYTES;
+    if (spi_bus_initialize(SPI2_HOST, &bus, SPI_DMA_CH_AUTO) != ESP_OK) return false;
+
+    spi_device_interface_config_t config = {};
+    config.clock_speed_hz = frequency;
+    config.mode = 0;
+    config.spics_io_num = csPin;
+    config.queue_size = 2;
+    config.pre_cb = preTransfer;
+    if (spi_bus_add_device(SPI2_HOST, &config, &device) != ESP_OK) {
+        spi_bus_free(SPI2_HOST);
+        return false;
+    }
+
+    pinMode(dcPin, OUTPUT);
+    if (rstPin >= 0) {
+        pinMode(rstPin, OUTPUT);
+        digitalWrite(rstPin, HIGH);
+        delay(5);
+        digitalWrite(rstPin, LOW);
+        delay(20);
+        digitalWrite(rstPin, HIGH);
+        delay(150);
+    } else {
+        command(ILI_SWRESET);
+        delay(150);
+    }
+    sendInit();
+    command(ILI_MADCTL, &rotationMadctl[rotation], 1);
+
+    // The whole (black) frame goes out with the first flush
+    markDirty(0, width() - 1, 0, height() - 1);
+    xTaskCreatePinnedToCore(taskEntry, "display", 4096, this, FRAME_TASK_PRIORITY, &task, FRAME_TASK_CORE);
+    return task != NULL;
+}
+
+void FrameDisplay::flush() {
+    if (!task) return;
+
+    bool send = false;
+    portENTER_CRITICAL(&mux);
+    for (int y = 0; y < FRAME_HEIGHT; y++) {
+        if (dirtyFirst[y] > dirtyLast[y]) continue;
+        if (dirtyFirst[y] < pendingFirst[y]) pendingFirst[y] = dirtyFirst[y];
+        if (dirtyLast[y] > pendingLast[y]) pendingLast[y] = dirtyLast[y];
+        send = true;
+    }
+    send = send || pendingMadctl || pendingInvert;
+    if (send) {
+        if (!busy) flushTime = micros();
+        pendingAny = true;
+        busy = true;
+    }
+    portEXIT_CRITICAL(&mux);
+
+    if (!send) return;
+    clearDirty(dirtyFirst, dirtyLast);
+    flushes++;
+    xTaskNotifyGive(task);
+}
+
+bool FrameDisplay::isBusy() {
+    return busy;
+}
+
+void FrameDisplay::waitIdle() {
+    while (busy) vTaskDelay(1);
+}
+
+uint32_t FrameDisplay::getPushUs() {
+    return pushUs;
+}
+
+uint32_t FrameDisplay::getPushedPixels() {
+    return pushedPixels;
+}
+
+uint32_t FrameDisplay::getFlushes() {
+    return flushes;
+}
+
+// -------------------------------------------------------------------------
+// Drawing: memory only
+// -------------------------------------------------------------------------
+
+void FrameDisplay::clearDirty(int16_t* first, int16_t* last) {
+    for (int y = 0; y < FRAME_HEIGHT; y++) {
+        first[y] = CLEAN_FIRST;
+        last[y] = CLEAN_LAST;
+    }
+}
+
+void FrameDisplay::markDirty(int16_t x0, int16_t x1, int16_t y0, int16_t y1) {
+    for (int y = y0; y <= y1; y++) {
+        if (x0 < dirtyFirst[y]) dirtyFirst[y] = x0;
+        if (x1 > dirtyLast[y]) dirtyLast[y] = x1;
+    }
+}
+
+void FrameDisplay::drawPixel(int16_t x, int16_t y, uint16_t color) {
+    if (!frame || x < 0 || y < 0 || x >= _width || y >= _height) return;
+    frame[y * _width + x] = panelColor(color);
+    markDirty(x, x, y, y);
+}
+
+void FrameDisplay::writePixel(int16_t x, int16_t y, uint16_t color) {
+    drawPixel(x, y, color);
+}
+
+void FrameDisplay::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    if (!frame) return;
+    if (w < 0) { x += w + 1; w = -w; }
+    if (h < 0) { y += h + 1; h = -h; }
+    int16_t x0 = x < 0 ? 0 : x;
+    int16_t y0 = y < 0 ? 0 : y;
+    int16_t x1 = x + w > _width ? _width - 1 : x + w - 1;
+    int16_t y1 = y + h > _height ? _height - 1 : y + h - 1;
+    if (x0 > x1 || y0 > y1) return;
+
+    uint16_t value = panelColor(color);
+    for (int row = y0; row <= y1; row++) {
+        uint16_t* pixel = frame + row * _width + x0;
+        for (int n = x1 - x0 + 1; n > 0; n--) *pixel++ = value;
+    }
+    markDirty(x0, x1, y0, y1);
+}
+
+void FrameDisplay::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    fillRect(x, y, w, h, color);
+}
+
+void FrameDisplay::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    fillRect(x, y, w, 1, color);
+}
+
+void FrameDisplay::writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    fillRect(x, y, w, 1, color);
+}
+
+void FrameDisplay::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    fillRect(x, y, 1, h, color);
+}
+
+void FrameDisplay::writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    fillRect(x, y, 1, h, color);
+}
+
+void FrameDisplay::fillScreen(uint16_t color) {
+    fillRect(0, 0, _width, _height, color);
+}
+
+// The framebuffer is kept in drawing orientation, so a new rotation
+// reinterprets its contents; sketches set it once and redraw
+void FrameDisplay::setRotation(uint8_t r) {
+    Adafruit_GFX::setRotation(r);
+    portENTER_CRITICAL(&mux);
+    pendingMadctl = rotationMadctl[rotation];
+    portEXIT_CRITICAL(&mux);
+    markDirty(0, _width - 1, 0, _height - 1);
+}
+
+void FrameDisplay::invertDisplay(bool i) {
+    portENTER_CRITICAL(&mux);
+    pendingInvert = i ? ILI_INVON : ILI_INVOFF;
+    portEXIT_CRITICAL(&mux);
+}
+
+// -------------------------------------------------------------------------
+// Push task: framebuffer to panel
+// -------------------------------------------------------------------------
+
+// DC low for commands, high for data, set just before each transfer
+void IRAM_ATTR FrameDisplay::preTransfer(spi_transaction_t* transaction) {
+    intptr_t user = (intptr_t)transaction->user;
+    gpio_set_level((gpio_num_t)(user >> 1), user & 1);
+}
+
+// Blocking, only used while no pixel transfer is queued
+void FrameDisplay::command(uint8_t cmd, const uint8_t* data, size_t length) {
+    spi_transaction_t transaction = {};
+    transaction.flags = SPI_TRANS_USE_TXDATA;
+    transaction.length = 8;
+    transaction.tx_data[0] = cmd;
+    transaction.user = (void*)(intptr_t)(dcPin << 1);
+    spi_device_polling_transmit(device, &transaction);
+    if (!length) return;
+
+    transaction = {};
+    transaction.length = length * 8;
+    transaction.user = (void*)(intptr_t)((dcPin << 1) | 1);
+    if (length <= 4) {
+        transaction.flags = SPI_TRANS_USE_TXDATA;
+        memcpy(transaction.tx_data, data, length);
+    } else {
+        transaction.tx_buffer = data;
+    }
+    spi_device_polling_transmit(device, &transaction);
+}
+
+void FrameDisplay::sendInit() {
+    const uint8_t* p = initCommands;
+    while (*p) {
+        uint8_t cmd = *p++;
+        uint8_t count = *p++;
+        command(cmd, p, count & 0x7F);
+        p += count & 0x7F;
+        if (count & 0x80) delay(150);
+    }
+}
+
+// One window, streamed through the two bounce buffers: one is copied
+// from the framebuffer while the DMA sends the other
+void FrameDisplay::pushWindow(int16_t x0, int16_t x1, int16_t y0, int16_t y1) {
+    uint8_t window[4];
+    window[0] = x0 >> 8; window[1] = x0; window[2] = x1 >> 8; window[3] = x1;
+    command(ILI_CASET, window, 4);
+    window[0] = y0 >> 8; window[1] = y0; window[2] = y1 >> 8; window[3] = y1;
+    command(ILI_PASET, window, 4);
+    command(ILI_RAMWR);
+
+    size_t rowBytes = (x1 - x0 + 1) * sizeof(uint16_t);
+    int chunkRows = FRAME_BOUNCE_BYTES / rowBytes;
+    spi_transaction_t transactions[2];
+    spi_transaction_t* done;
+    int queued = 0;
+    int slot = 0;
+
+    for (int y = y0; y <= y1; y += chunkRows) {
+        int rows = y1 - y + 1 < chunkRows ? y1 - y + 1 : chunkRows;
+        if (queued == 2) {
+            spi_device_get_trans_result(device, &done, portMAX_DELAY);
+            queued--;
+        }
+
+        uint8_t* out = bounce[slot];
+        for (int row = y; row < y + rows; row++) {
+            memcpy(out, frame + row * _width + x0, rowBytes);
+            out += rowBytes;
+        }
+
+        spi_transaction_t& transaction = transactions[slot];
+        transaction = {};
+        transaction.length = rows * rowBytes * 8;
+        transaction.tx_buffer = bounce[slot];
+        transaction.user = (void*)(intptr_t)((dcPin << 1) | 1);
+        spi_device_queue_trans(device, &transaction, portMAX_DELAY);
+        queued++;
+        slot ^= 1;
+    }
+    while (queued--) spi_device_get_trans_result(device, &done, portMAX_DELAY);
+}
+
+void FrameDisplay::pushLoop() {
+    int16_t first[FRAME_HEIGHT], last[FRAME_HEIGHT];
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        portENTER_CRITICAL(&mux);
+        memcpy(first, pendingFirst, sizeof(first));
+        memcpy(last, pendingLast, sizeof(last));
+        uint8_t madctl = pendingMadctl;
+        uint8_t invert = pendingInvert;
+        pendingMadctl = 0;
+        pendingInvert = 0;
+        pendingAny = false;
+        clearDirty(pendingFirst, pendingLast);
+        portEXIT_CRITICAL(&mux);
+
+        if (madctl) command(ILI_MADCTL, &madctl, 1);
+        if (invert) command(invert);
+
+        // Runs of dirty rows, each sent as one window
+        uint32_t pixels = 0;
+        int16_t rows = _height;
+        for (int y = 0; y < rows; y++) {
+            if (first[y] > last[y]) continue;
+            int16_t x0 = first[y], x1 = last[y], y0 = y;
+            while (y + 1 < rows && first[y + 1] <= last[y + 1]) {
+                y++;
+                if (first[y] < x0) x0 = first[y];
+                if (last[y] > x1) x1 = last[y];
+            }
+            pushWindow(x0, x1, y0, y);
+            pixels += (uint32_t)(x1 - x0 + 1) * (y - y0 + 1);
+        }
+
+        portENTER_CRITICAL(&mux);
+        pushUs = micros() - flushTime;
+        pushedPixels = pixels;
+        if (!pendingAny) {
+            busy = false;
+        } else {
+            flushTime = micros();
+        }
+        portEXIT_CRITICAL(&mux);
+    }
+}
+
+void FrameDisplay::taskEntry(void* param) {
+    static_cast<FrameDisplay*>(param)->pushLoop();
+}
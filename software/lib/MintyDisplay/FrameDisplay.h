@@ -0,0 +1,106 @@
+/*
+ * MintySynth Frame Display
+ *
+ * ILI9341 driver for the Arduino sketches that draws into a framebuffer
+ * in PSRAM and sends the changed parts to the panel over hardware SPI
+ * with DMA, from a background task. Drawing calls (everything
+ * Adafruit_GFX offers: text, rects, lines, circles) only write memory
+ * and mark the rows they touched; flush() hands the dirty rows to the
+ * push task and returns at once, so the UI never waits for the wire.
+ *
+ * The push task sends each run of dirty rows as one window (the union of
+ * the rows' dirty columns), copying the pixels into small internal-RAM
+ * bounce buffers while the previous one is on the bus. Rows drawn again
+ * while a push is in progress are simply sent again with the next flush.
+ *
+ * Takes the same pins as the software SPI Adafruit_ILI9341 constructor,
+ * so it is a drop-in replacement; the pins are routed to SPI2 through
+ * the GPIO matrix.
+ */
+
+#ifndef MINTYSYNTH_FRAMEDISPLAY_H
+#define MINTYSYNTH_FRAMEDISPLAY_H
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <driver/spi_master.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define FRAME_WIDTH           240     // Panel, portrait
+#define FRAME_HEIGHT          320
+#define FRAME_SPI_HZ          40000000
+#define FRAME_BOUNCE_BYTES    8192    // Per bounce buffer, two of them
+#define FRAME_TASK_CORE       0
+#define FRAME_TASK_PRIORITY   2       // Above the UI task, it mostly waits on the DMA
+
+class FrameDisplay : public Adafruit_GFX {
+public:
+    FrameDisplay(int8_t cs, int8_t dc, int8_t mosi, int8_t sclk, int8_t rst = -1, int8_t miso = -1);
+    ~FrameDisplay();
+
+    // Allocates the framebuffer, initialises the panel and starts the
+    // push task. False if the SPI bus or the memory could not be had.
+    bool begin(uint32_t frequency = FRAME_SPI_HZ);
+
+    // Hand everything drawn since the last flush to the push task
+    void flush();
+    bool isBusy();
+    void waitIdle();
+
+    // Adafruit_GFX
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    void writePixel(int16_t x, int16_t y, uint16_t color) override;
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void fillScreen(uint16_t color) override;
+    void setRotation(uint8_t r) override;
+    void invertDisplay(bool i) override;
+
+    uint16_t* getBuffer() { return frame; }     // Big-endian RGB565, width() per row
+
+    // Statistics
+    uint32_t getPushUs();           // Last push, flush() to last pixel on the wire
+    uint32_t getPushedPixels();     // Pixels in the last push
+    uint32_t getFlushes();
+
+private:
+    int8_t csPin, dcPin, mosiPin, sclkPin, rstPin, misoPin;
+    spi_device_handle_t device;
+    TaskHandle_t task;
+    portMUX_TYPE mux;
+
+    uint16_t* frame;
+    uint8_t* bounce[2];
+
+    // Dirty columns per row, first > last when clean. `dirty` is drawn
+    // into by the UI, `pending` waits for the push task (under mux).
+    int16_t dirtyFirst[FRAME_HEIGHT], dirtyLast[FRAME_HEIGHT];
+    int16_t pendingFirst[FRAME_HEIGHT], pendingLast[FRAME_HEIGHT];
+    bool pendingAny;
+    uint8_t pendingMadctl;          // Commands for the push task, 0 = none
+    uint8_t pendingInvert;
+    volatile bool busy;
+    uint32_t flushTime;
+
+    uint32_t pushUs;
+    uint32_t pushedPixels;
+    uint32_t flushes;
+
+    void markDirty(int16_t x0, int16_t x1, int16_t y0, int16_t y1);
+    void clearDirty(int16_t* first, int16_t* last);
+
+    void command(uint8_t cmd, const uint8_t* data = NULL, size_t length = 0);
+    void sendInit();
+    void pushWindow(int16_t x0, int16_t x1, int16_t y0, int16_t y1);
+    void pushLoop();
+
+    static void taskEntry(void* param);
+    static void IRAM_ATTR preTransfer(spi_transaction_t* transaction);
+};
+
+#endif // MINTYSYNTH_FRAMEDISPLAY_H
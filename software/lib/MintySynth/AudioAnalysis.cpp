@@ -0,0 +1,261 @@
+/*
+ * MintySynth Audio Analysis Implementation
+ */
+
+#include "AudioAnalysis.h"
+#include "MintySynth.h"
+#include "SynthTables.h"
+
+#define FFT_FULL_SCALE   8192.0f     // Bin magnitude of a full-scale sine after window and scaling
+
+// Twiddles and Hann window in Q15, computed by the compiler
+struct AudioFftTables {
+    int16_t cosine[AUDIO_FFT_SIZE / 2];
+    int16_t sine[AUDIO_FFT_SIZE / 2];
+    int16_t window[AUDIO_FFT_SIZE];
+};
+
+static constexpr int16_t fftQ15(double x) {
+    return (int16_t)(x >= 32767.0 / 32768.0 ? 32767 : synthRound(x * 32768.0));
+}
+
+static constexpr AudioFftTables makeFftTables() {
+    AudioFftTables tables = {};
+    for (int k = 0; k < AUDIO_FFT_SIZE / 2; k++) {
+        double angle = 2.0 * SYNTH_PI * k / AUDIO_FFT_SIZE;
+        tables.cosine[k] = fftQ15(synthSin(angle + SYNTH_PI / 2));
+        tables.sine[k] = fftQ15(synthSin(angle));
+    }
+    for (int n = 0; n < AUDIO_FFT_SIZE; n++) {
+        tables.window[n] = fftQ15(0.5 - 0.5 * synthSin(2.0 * SYNTH_PI * n / AUDIO_FFT_SIZE + SYNTH_PI / 2));
+    }
+    return tables;
+}
+
+static constexpr AudioFftTables fftTables = makeFftTables();
+
+static const char* const noteNames[12] = {
+    "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"
+};
+
+const char* audioNoteName(uint8_t note) {
+    return noteNames[note % 12];
+}
+
+void audioFft(int16_t* re, int16_t* im) {
+    // Bit-reversed order
+    for (uint16_t i = 1, j = 0; i < AUDIO_FFT_SIZE; i++) {
+        uint16_t bit = AUDIO_FFT_SIZE >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j |= bit;
+        if (i < j) {
+            int16_t t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (uint16_t size = 2; size <= AUDIO_FFT_SIZE; size <<= 1) {
+        uint16_t half = size >> 1;
+        uint16_t step = AUDIO_FFT_SIZE / size;
+        for (uint16_t start = 0; start < AUDIO_FFT_SIZE; start += size) {
+            for (uint16_t k = 0; k < half; k++) {
+                int32_t wr = fftTables.cosine[k * step];
+                int32_t wi = -fftTables.sine[k * step];
+                uint16_t i = start + k;
+                uint16_t j = i + half;
+                int32_t tr = (re[j] * wr - im[j] * wi) >> 15;
+                int32_t ti = (re[j] * wi + im[j] * wr) >> 15;
+                re[j] = (int16_t)((re[i] - tr) >> 1);
+                im[j] = (int16_t)((im[i] - ti) >> 1);
+                re[i] = (int16_t)((re[i] + tr) >> 1);
+                im[i] = (int16_t)((im[i] + ti) >> 1);
+            }
+        }
+    }
+}
+
+static uint16_t squareRoot(uint32_t value) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value) bit >>= 2;
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint16_t)root;
+}
+
+AudioAnalyzer::AudioAnalyzer() : sampleRate(SAMPLE_RATE), peakHz(0), peakLevel(-AUDIO_SPECTRUM_RANGE_DB) {
+    memset(samples, 0, sizeof(samples));
+    memset(bands, 0, sizeof(bands));
+    tuner.valid = false;
+    tuner.hz = 0;
+    tuner.note = 0;
+    tuner.cents = 0;
+    begin(SAMPLE_RATE);
+}
+
+// Band edges spaced evenly in log frequency from bin 1 to Nyquist, at
+// least one bin wide
+void AudioAnalyzer::begin(uint32_t rate) {
+    sampleRate = rate ? rate : SAMPLE_RATE;
+
+    const float top = AUDIO_FFT_SIZE / 2;
+    bandEdges[0] = 1;
+    for (int b = 1; b <= AUDIO_SPECTRUM_BANDS; b++) {
+        uint16_t edge = (uint16_t)(powf(top, (float)b / AUDIO_SPECTRUM_BANDS) + 0.5f);
+        uint16_t least = bandEdges[b - 1] + 1;
+        uint16_t most = AUDIO_FFT_SIZE / 2 - (AUDIO_SPECTRUM_BANDS - b);
+        bandEdges[b] = constrain(edge, least, most);
+    }
+}
+
+uint16_t AudioAnalyzer::getBandHz(uint8_t band) {
+    if (band > AUDIO_SPECTRUM_BANDS) band = AUDIO_SPECTRUM_BANDS;
+    return (uint16_t)((uint32_t)bandEdges[band] * sampleRate / AUDIO_FFT_SIZE);
+}
+
+bool AudioAnalyzer::update(AudioTap& tap) {
+    if (!tap.read(decimated, AUDIO_ANALYSIS_FRAMES)) return false;
+    analyse(decimated);
+    return true;
+}
+
+void AudioAnalyzer::analyse(const int16_t* mono) {
+    if (mono != samples) memcpy(samples, mono, sizeof(samples));
+    computeSpectrum();
+    computeTuner();
+}
+
+void AudioAnalyzer::getScope(int16_t* low, int16_t* high, uint16_t columns) {
+    const uint16_t span = AUDIO_ANALYSIS_FRAMES / 4;
+    uint16_t start = AUDIO_ANALYSIS_FRAMES - span;
+
+    // Trigger: the latest rising zero crossing that still leaves a full span
+    for (uint16_t i = AUDIO_ANALYSIS_FRAMES - span; i > AUDIO_ANALYSIS_FRAMES / 2; i--) {
+        if (samples[i - 1] < 0 && samples[i] >= 0) {
+            start = i;
+            break;
+        }
+    }
+
+    for (uint16_t c = 0; c < columns; c++) {
+        uint16_t from = start + (uint32_t)c * span / columns;
+        uint16_t to = start + (uint32_t)(c + 1) * span / columns;
+        if (to <= from) to = from + 1;
+        int16_t lowest = samples[from];
+        int16_t highest = samples[from];
+        for (uint16_t i = from + 1; i < to; i++) {
+            if (samples[i] < lowest) lowest = samples[i];
+            if (samples[i] > highest) highest = samples[i];
+        }
+        low[c] = lowest;
+        high[c] = highest;
+    }
+}
+
+// FFT of the newest AUDIO_FFT_SIZE frames, banded by the loudest bin in
+// each band
+void AudioAnalyzer::computeSpectrum() {
+    const int16_t* newest = samples + AUDIO_ANALYSIS_FRAMES - AUDIO_FFT_SIZE;
+    for (int n = 0; n < AUDIO_FFT_SIZE; n++) {
+        re[n] = (int16_t)(((int32_t)newest[n] * fftTables.window[n]) >> 15);
+        im[n] = 0;
+    }
+    audioFft(re, im);
+
+    // Magnitudes into re[] (bins up to Nyquist)
+    uint16_t loudestBin = 1;
+    for (int k = 1; k <= AUDIO_FFT_SIZE / 2; k++) {
+        re[k] = (int16_t)squareRoot((uint32_t)(re[k] * re[k]) + (uint32_t)(im[k] * im[k]));
+        if (re[k] > re[loudestBin]) loudestBin = k;
+    }
+
+    for (int b = 0; b < AUDIO_SPECTRUM_BANDS; b++) {
+        int16_t loudest = 0;
+        for (int k = bandEdges[b]; k < bandEdges[b + 1]; k++) {
+            if (re[k] > loudest) loudest = re[k];
+        }
+        float db = loudest ? 20.0f * log10f(loudest / FFT_FULL_SCALE) : -AUDIO_SPECTRUM_RANGE_DB;
+        int level = (int)((db + AUDIO_SPECTRUM_RANGE_DB) * 255.0f / AUDIO_SPECTRUM_RANGE_DB);
+        bands[b] = (uint8_t)constrain(level, 0, 255);
+    }
+
+    peakHz = (uint16_t)((uint32_t)loudestBin * sampleRate / AUDIO_FFT_SIZE);
+    peakLevel = re[loudestBin] ? (int16_t)(20.0f * log10f(re[loudestBin] / FFT_FULL_SCALE)) : -AUDIO_SPECTRUM_RANGE_DB;
+}
+
+// Cumulative mean normalised difference (YIN): the first lag whose
+// difference dips under the threshold, walked down to its minimum
+void AudioAnalyzer::computeTuner() {
+    uint8_t step = sampleRate > 32000 ? 2 : 1;
+    uint32_t rate = sampleRate / step;
+    uint16_t count = AUDIO_ANALYSIS_FRAMES / step;
+
+    for (uint16_t i = 0; i < count; i++) {
+        decimated[i] = (step == 1) ? samples[i]
+                                   : (int16_t)(((int32_t)samples[2 * i] + samples[2 * i + 1]) >> 1);
+    }
+
+    uint16_t minLag = rate / AUDIO_TUNER_MAX_HZ;
+    uint16_t maxLag = rate / AUDIO_TUNER_MIN_HZ;
+    if (minLag < 2) minLag = 2;
+    if (maxLag > AUDIO_TUNER_MAX_LAG) maxLag = AUDIO_TUNER_MAX_LAG;
+    if (maxLag + AUDIO_TUNER_WINDOW > count) maxLag = count - AUDIO_TUNER_WINDOW;
+
+    // Newest window, compared with the frames lag before it
+    const int16_t* x = decimated + count - AUDIO_TUNER_WINDOW - maxLag;
+    int16_t level = 0;
+    for (uint16_t j = 0; j < AUDIO_TUNER_WINDOW + maxLag; j++) {
+        int16_t magnitude = x[j] < 0 ? -x[j] : x[j];
+        if (magnitude > level) level = magnitude;
+    }
+    tuner.valid = false;
+    if (level < AUDIO_TUNER_MIN_LEVEL) return;
+
+    uint64_t total = 0;
+    difference[0] = 1024;
+    uint16_t found = 0;
+    for (uint16_t lag = 1; lag <= maxLag; lag++) {
+        uint32_t sum = 0;
+        const int16_t* a = x + maxLag;
+        const int16_t* b = a - lag;
+        for (uint16_t j = 0; j < AUDIO_TUNER_WINDOW; j++) {
+            int32_t d = a[j] - b[j];
+            sum += d < 0 ? -d : d;
+        }
+        total += sum;
+        uint64_t normalised = total ? (uint64_t)sum * lag * 1024 / total : 1024;
+        difference[lag] = normalised > 65535 ? 65535 : (uint16_t)normalised;
+
+        if (found) {
+            if (difference[lag] >= difference[found]) break;
+            found = lag;
+        } else if (lag >= minLag && difference[lag] < AUDIO_TUNER_THRESHOLD) {
+            found = lag;
+        }
+    }
+    if (!found || found >= maxLag) return;
+
+    // Parabola through the minimum and its neighbours
+    float left = difference[found - 1];
+    float centre = difference[found];
+    float right = difference[found + 1];
+    float curve = left - 2.0f * centre + right;
+    float offset = curve > 0 ? 0.5f * (left - right) / curve : 0.0f;
+
+    float hz = (float)rate / (found + offset);
+    float note = 69.0f + 12.0f * log2f(hz / 440.0f);
+    int nearest = (int)lroundf(note);
+    if (nearest < 0 || nearest > 127) return;
+
+    tuner.valid = true;
+    tuner.hz = hz;
+    tuner.note = (uint8_t)nearest;
+    tuner.cents = (int8_t)lroundf((note - nearest) * 100.0f);
+}
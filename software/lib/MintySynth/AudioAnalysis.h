@@ -0,0 +1,93 @@
+/*
+ * MintySynth Audio Analysis
+ *
+ * Scope, spectrum and tuner for the display, computed on the UI core
+ * from the frames an AudioTap holds:
+ *
+ * - Scope: min/max peaks per display column from a rising zero crossing,
+ *   so a steady tone stands still and nothing between columns is lost.
+ * - Spectrum: 512-point fixed-point FFT (Q15, Hann window, scaled per
+ *   stage) of the newest frames, folded into log-spaced bands with a
+ *   level in dB.
+ * - Tuner: YIN-style difference function (decimated to about 22 kHz),
+ *   with parabolic interpolation of the best lag; reports the nearest
+ *   note and how many cents off it is.
+ *
+ * update() takes one snapshot; the getters all describe that snapshot.
+ */
+
+#ifndef MINTYSYNTH_AUDIOANALYSIS_H
+#define MINTYSYNTH_AUDIOANALYSIS_H
+
+#include <Arduino.h>
+#include "AudioTap.h"
+
+#define AUDIO_ANALYSIS_FRAMES   2048    // Frames per snapshot, half the tap
+#define AUDIO_FFT_BITS          9
+#define AUDIO_FFT_SIZE          (1 << AUDIO_FFT_BITS)
+#define AUDIO_SPECTRUM_BANDS    32
+#define AUDIO_SPECTRUM_RANGE_DB 72      // Band level 0 is this far below full scale
+#define AUDIO_TUNER_MIN_HZ      50
+#define AUDIO_TUNER_MAX_HZ      1000
+#define AUDIO_TUNER_MAX_LAG     1024    // Difference function entries
+#define AUDIO_TUNER_WINDOW      512     // Samples compared per lag
+#define AUDIO_TUNER_THRESHOLD   200     // Difference dip that counts as periodic, of 1024
+#define AUDIO_TUNER_MIN_LEVEL   256     // Peak below this is silence
+
+struct TunerReading {
+    bool valid;
+    float hz;
+    uint8_t note;           // MIDI note nearest to hz
+    int8_t cents;           // -50 to +50 from that note
+};
+
+// In-place radix-2 FFT of AUDIO_FFT_SIZE Q15 points. Each stage halves,
+// so the result is the DFT divided by AUDIO_FFT_SIZE and cannot overflow.
+void audioFft(int16_t* re, int16_t* im);
+
+// "C", "C#", ... for a MIDI note
+const char* audioNoteName(uint8_t note);
+
+class AudioAnalyzer {
+public:
+    AudioAnalyzer();
+
+    void begin(uint32_t sampleRate);
+
+    // Takes the latest AUDIO_ANALYSIS_FRAMES from the tap and analyses
+    // them. False (results unchanged) if the tap had no clean snapshot.
+    bool update(AudioTap& tap);
+
+    // Same, from samples the caller already has (AUDIO_ANALYSIS_FRAMES, mono)
+    void analyse(const int16_t* mono);
+
+    // Min/max per column over the newest quarter snapshot, starting at a
+    // rising zero crossing where one can be found
+    void getScope(int16_t* low, int16_t* high, uint16_t columns);
+
+    // AUDIO_SPECTRUM_BANDS levels, 0 (-AUDIO_SPECTRUM_RANGE_DB) to 255 (0 dB)
+    const uint8_t* getBands() { return bands; }
+    uint16_t getBandHz(uint8_t band);   // Lower edge
+    uint16_t getPeakHz() { return peakHz; }
+    int16_t getPeakLevel() { return peakLevel; }
+
+    const TunerReading& getTuner() { return tuner; }
+
+private:
+    uint32_t sampleRate;
+    int16_t samples[AUDIO_ANALYSIS_FRAMES];
+    int16_t re[AUDIO_FFT_SIZE];
+    int16_t im[AUDIO_FFT_SIZE];
+    uint16_t bandEdges[AUDIO_SPECTRUM_BANDS + 1];   // FFT bins
+    uint8_t bands[AUDIO_SPECTRUM_BANDS];
+    uint16_t peakHz;
+    int16_t peakLevel;
+    TunerReading tuner;
+    int16_t decimated[AUDIO_ANALYSIS_FRAMES];
+    uint16_t difference[AUDIO_TUNER_MAX_LAG + 1];   // Normalised, 1024 = no correlation
+
+    void computeSpectrum();
+    void computeTuner();
+};
+
+#endif // MINTYSYNTH_AUDIOANALYSIS_H
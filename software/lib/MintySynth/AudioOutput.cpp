@@ -0,0 +1,295 @@
+/*
+ * MintySynth Audio Output Implementation
+ */
+
+#include "AudioOutput.h"
+
+// TX done handling runs in the I2S interrupt on the ESP32
+#if defined(ARDUINO_ARCH_ESP32)
+#define AUDIO_OUTPUT_ISR IRAM_ATTR
+#else
+#define AUDIO_OUTPUT_ISR
+#endif
+
+void audioOutputDefaults(AudioOutputConfig& config, uint32_t sampleRate) {
+    config.sampleRate = sampleRate;
+    config.bufferCount = AUDIO_OUTPUT_BUFFERS;
+    config.bufferFrames = AUDIO_OUTPUT_FRAMES;
+    config.bckPin = -1;
+    config.wsPin = -1;
+    config.dataPin = -1;
+    config.sink = NULL;
+    config.realtime = true;
+}
+
+AudioOutput::AudioOutput()
+    : knownBuffers(0), lead(AUDIO_OUTPUT_BUFFERS - 1), running(false), buffersPlayed(0), underruns(0) {
+    audioOutputDefaults(config, 44100);
+    for (int i = 0; i < AUDIO_OUTPUT_MAX_BUFFERS; i++) {
+        buffers[i] = NULL;
+        filled[i].store(0);
+    }
+#if defined(ARDUINO_ARCH_ESP32)
+    channel = NULL;
+    waiter.store(NULL);
+#else
+    memory = NULL;
+    dma = NULL;
+#endif
+}
+
+AudioOutput::~AudioOutput() {
+    end();
+}
+
+bool AudioOutput::isRunning() {
+    return running.load();
+}
+
+uint8_t AudioOutput::getBufferCount() {
+    return config.bufferCount;
+}
+
+uint16_t AudioOutput::getBufferFrames() {
+    return config.bufferFrames;
+}
+
+uint32_t AudioOutput::getBufferPeriodUs() {
+    return (uint32_t)((uint64_t)config.bufferFrames * 1000000ULL / config.sampleRate);
+}
+
+uint32_t AudioOutput::getLatencyUs() {
+    return (uint32_t)((uint64_t)lead.load() * config.bufferFrames * 1000000ULL / config.sampleRate);
+}
+
+void AudioOutput::setLead(uint8_t buffers) {
+    lead.store(constrain(buffers, 1, config.bufferCount - 1));
+}
+
+uint8_t AudioOutput::getLead() {
+    return lead.load();
+}
+
+uint8_t AudioOutput::getMaxLead() {
+    return config.bufferCount - 1;
+}
+
+uint32_t AudioOutput::getBuffersPlayed() {
+    return buffersPlayed.load(std::memory_order_relaxed);
+}
+
+uint32_t AudioOutput::getUnderruns() {
+    return underruns.load(std::memory_order_relaxed);
+}
+
+int AUDIO_OUTPUT_ISR AudioOutput::findBuffer(const int16_t* buffer) {
+    uint8_t known = knownBuffers.load(std::memory_order_acquire);
+    for (int i = 0; i < known; i++) {
+        if (buffers[i] == buffer) return i;
+    }
+    return -1;
+}
+
+// TX done: `buffer` has just been played. The first lap of the ring is the
+// DMA's initial silence and only teaches us the buffer addresses.
+bool AUDIO_OUTPUT_ISR AudioOutput::bufferDone(int16_t* buffer) {
+    int index = findBuffer(buffer);
+    if (index < 0) {
+        index = knownBuffers.load(std::memory_order_relaxed);
+        if (index >= AUDIO_OUTPUT_MAX_BUFFERS) return false;
+        buffers[index] = buffer;
+        knownBuffers.store(index + 1, std::memory_order_release);
+    } else if (!filled[index].load(std::memory_order_acquire)) {
+        underruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    buffersPlayed.fetch_add(1, std::memory_order_relaxed);
+
+    // Silence, in case the renderer misses this buffer's next turn
+    memset(buffer, 0, config.bufferFrames * 2 * sizeof(int16_t));
+    filled[index].store(0, std::memory_order_relaxed);
+    return freed.push(buffer);
+}
+
+void AudioOutput::commit(int16_t* buffer) {
+    int index = findBuffer(buffer);
+    if (index < 0) return;
+    filled[index].store(1, std::memory_order_release);
+#if !defined(ARDUINO_ARCH_ESP32)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+    }
+    wake.notify_all();
+#endif
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+bool AudioOutput::begin(const AudioOutputConfig& outputConfig) {
+    if (running.load()) return false;
+
+    config = outputConfig;
+    config.bufferCount = constrain(config.bufferCount, 2, AUDIO_OUTPUT_MAX_BUFFERS);
+    config.bufferFrames = constrain(config.bufferFrames, 1, AUDIO_OUTPUT_MAX_FRAMES);
+    knownBuffers.store(0);
+    lead.store(config.bufferCount - 1);
+    int16_t* stale;
+    while (freed.pop(stale)) {}
+
+    i2s_chan_config_t channelConfig = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
+    channelConfig.dma_desc_num = config.bufferCount;
+    channelConfig.dma_frame_num = config.bufferFrames;
+    channelConfig.auto_clear = false;       // bufferDone() clears once the callback is done with it
+    if (i2s_new_channel(&channelConfig, &channel, NULL) != ESP_OK) return false;
+
+    i2s_std_config_t stdConfig = {
+        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(config.sampleRate),
+        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_STEREO),
+        .gpio_cfg = {
+            .mclk = I2S_GPIO_UNUSED,
+            .bclk = (gpio_num_t)config.bckPin,
+            .ws = (gpio_num_t)config.wsPin,
+            .dout = (gpio_num_t)config.dataPin,
+            .din = I2S_GPIO_UNUSED,
+            .invert_flags = { .mclk_inv = false, .bclk_inv = false, .ws_inv = false },
+        },
+    };
+
+    i2s_event_callbacks_t callbacks = {};
+    callbacks.on_sent = onSent;
+
+    if (i2s_channel_init_std_mode(channel, &stdConfig) != ESP_OK ||
+        i2s_channel_register_event_callback(channel, &callbacks, this) != ESP_OK ||
+        i2s_channel_enable(channel) != ESP_OK) {
+        i2s_del_channel(channel);
+        channel = NULL;
+        return false;
+    }
+
+    running.store(true);
+    return true;
+}
+
+void AudioOutput::end() {
+    if (!running.load()) return;
+
+    running.store(false);
+    i2s_channel_disable(channel);
+    i2s_del_channel(channel);
+    channel = NULL;
+
+    TaskHandle_t task = waiter.load();
+    if (task) xTaskNotifyGive(task);
+}
+
+int16_t* AudioOutput::acquire(uint32_t timeoutMs) {
+    int16_t* buffer;
+
+    // A full ring behind: the oldest buffers are already overdue
+    while (freed.size() >= config.bufferCount) freed.pop(buffer);
+
+    // The oldest freed buffer plays in bufferCount - freed periods
+    waiter.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+    while (freed.size() < (size_t)(config.bufferCount - lead.load())) {
+        if (!ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs))) return NULL;
+        if (!running.load()) return NULL;
+    }
+    return freed.pop(buffer) ? buffer : NULL;
+}
+
+bool IRAM_ATTR AudioOutput::onSent(i2s_chan_handle_t handle, i2s_event_data_t* event, void* arg) {
+    AudioOutput* output = static_cast<AudioOutput*>(arg);
+    (void)handle;
+
+    // event->data points at the finished descriptor's buffer pointer
+    output->bufferDone(*(int16_t**)event->data);
+
+    BaseType_t woken = pdFALSE;
+    TaskHandle_t task = output->waiter.load(std::memory_order_acquire);
+    if (task) vTaskNotifyGiveFromISR(task, &woken);
+    return woken == pdTRUE;
+}
+
+#else
+
+bool AudioOutput::begin(const AudioOutputConfig& outputConfig) {
+    if (running.load()) return false;
+
+    config = outputConfig;
+    config.bufferCount = constrain(config.bufferCount, 2, AUDIO_OUTPUT_MAX_BUFFERS);
+    config.bufferFrames = constrain(config.bufferFrames, 1, AUDIO_OUTPUT_MAX_FRAMES);
+    knownBuffers.store(0);
+    lead.store(config.bufferCount - 1);
+    int16_t* stale;
+    while (freed.pop(stale)) {}
+
+    // Zeroed, like the DMA buffers the I2S driver allocates
+    memory = new int16_t[config.bufferCount * config.bufferFrames * 2]();
+    running.store(true);
+    dma = new std::thread(&AudioOutput::playLoop, this);
+    return true;
+}
+
+void AudioOutput::end() {
+    if (!running.load()) return;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running.store(false);
+    }
+    wake.notify_all();
+    dma->join();
+    delete dma;
+    dma = NULL;
+    delete[] memory;
+    memory = NULL;
+}
+
+int16_t* AudioOutput::acquire(uint32_t timeoutMs) {
+    int16_t* buffer;
+
+    // A full ring behind: the oldest buffers are already overdue
+    while (freed.size() >= config.bufferCount) freed.pop(buffer);
+
+    // The oldest freed buffer plays in bufferCount - freed periods. Without
+    // realtime the DMA waits for the renderer, so there is nothing to lead.
+    size_t due = config.realtime ? config.bufferCount - lead.load() : 1;
+    std::unique_lock<std::mutex> guard(lock);
+    if (!wake.wait_for(guard, std::chrono::milliseconds(timeoutMs),
+                       [this, due] { return freed.size() >= due || !running.load(); })) {
+        return NULL;
+    }
+    return freed.pop(buffer) ? buffer : NULL;
+}
+
+// Stand-in for the I2S DMA: plays the ring in order, one buffer period per
+// buffer (or as soon as the renderer commits when not realtime), then
+// raises TX done exactly like the interrupt does
+void AudioOutput::playLoop() {
+    const size_t samples = config.bufferFrames * 2;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t frames = 0;
+    uint8_t next = 0;
+
+    while (running.load()) {
+        int16_t* buffer = memory + next * samples;
+
+        if (config.realtime) {
+            frames += config.bufferFrames;
+            std::this_thread::sleep_until(start + std::chrono::microseconds(frames * 1000000ULL / config.sampleRate));
+        } else if (knownBuffers.load() == config.bufferCount) {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this, next] { return filled[next].load() || !running.load(); });
+        }
+        if (!running.load()) break;
+
+        if (config.sink) config.sink(buffer, samples);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            bufferDone(buffer);
+        }
+        wake.notify_all();
+        next = (next + 1) % config.bufferCount;
+    }
+}
+
+#endif
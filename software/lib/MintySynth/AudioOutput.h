@@ -0,0 +1,120 @@
+/*
+ * MintySynth Audio Output
+ *
+ * Zero-copy streaming to the I2S DAC (PCM5102). The I2S DMA plays a ring
+ * of bufferCount buffers of bufferFrames stereo frames. When the DMA has
+ * finished a buffer (TX done) it is handed to the renderer, which fills
+ * it in place with acquire()/commit() while the other buffers play; no
+ * intermediate buffer and no copy. A buffer that is not committed before
+ * its next turn plays as silence and counts as an underrun.
+ *
+ * The renderer works `lead` buffers ahead of the DAC: a buffer is handed
+ * out once it is lead buffer periods away from playing, so lead periods
+ * are both the render deadline and the output latency. The default and
+ * maximum lead is bufferCount - 1 (every buffer handed out at its TX
+ * done); a smaller lead trades headroom for latency (see LatencyTuner).
+ *
+ * On a host build the DMA is a thread that "plays" the same ring at the
+ * sample rate and passes every played buffer to an AudioSink (a file
+ * writer, or NULL for a null sink), so the pipeline runs natively under
+ * the same timing contract.
+ */
+
+#ifndef MINTYSYNTH_AUDIOOUTPUT_H
+#define MINTYSYNTH_AUDIOOUTPUT_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "SpscQueue.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <driver/i2s_std.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+
+#define AUDIO_OUTPUT_BUFFERS      4       // Default DMA buffer count
+#define AUDIO_OUTPUT_FRAMES       256     // Default stereo frames per DMA buffer
+#define AUDIO_OUTPUT_MAX_BUFFERS  16
+#define AUDIO_OUTPUT_MAX_FRAMES   1023    // 16-bit stereo in one 4092-byte DMA buffer
+
+// Output sink: receives interleaved stereo samples, may block
+typedef void (*AudioSink)(const int16_t* buffer, size_t samples);
+
+struct AudioOutputConfig {
+    uint32_t sampleRate;
+    uint8_t bufferCount;        // 2 - AUDIO_OUTPUT_MAX_BUFFERS
+    uint16_t bufferFrames;      // 1 - AUDIO_OUTPUT_MAX_FRAMES
+    int bckPin;                 // I2S pins (ESP32)
+    int wsPin;
+    int dataPin;
+    AudioSink sink;             // Host: gets each buffer as it plays, NULL = null sink
+    bool realtime;              // Host: play at the sample rate, or as soon as committed
+};
+
+void audioOutputDefaults(AudioOutputConfig& config, uint32_t sampleRate);
+
+class AudioOutput {
+public:
+    AudioOutput();
+    ~AudioOutput();
+
+    bool begin(const AudioOutputConfig& config);
+    void end();
+    bool isRunning();
+
+    // Render side (one task). The next buffer due to play in `lead`
+    // periods, to be filled in place with bufferFrames interleaved stereo
+    // frames and handed back with commit(). NULL if no TX done came
+    // within timeoutMs.
+    int16_t* acquire(uint32_t timeoutMs);
+    void commit(int16_t* buffer);
+
+    // Render side. 1 - bufferCount - 1 buffers, takes effect with the next acquire()
+    void setLead(uint8_t buffers);
+    uint8_t getLead();
+    uint8_t getMaxLead();
+
+    uint8_t getBufferCount();
+    uint16_t getBufferFrames();
+    uint32_t getBufferPeriodUs();
+    uint32_t getLatencyUs();        // Render to DAC at the current lead
+
+    // Statistics
+    uint32_t getBuffersPlayed();
+    uint32_t getUnderruns();        // Buffers played before they were committed
+
+private:
+    AudioOutputConfig config;
+    SpscQueue<int16_t*, AUDIO_OUTPUT_MAX_BUFFERS> freed;    // TX done, oldest first
+    int16_t* buffers[AUDIO_OUTPUT_MAX_BUFFERS];             // Ring, learnt from TX done events
+    std::atomic<uint8_t> filled[AUDIO_OUTPUT_MAX_BUFFERS];
+    std::atomic<uint8_t> knownBuffers;
+    std::atomic<uint8_t> lead;
+    std::atomic<bool> running;
+    std::atomic<uint32_t> buffersPlayed;
+    std::atomic<uint32_t> underruns;
+
+    int findBuffer(const int16_t* buffer);
+    bool bufferDone(int16_t* buffer);
+
+#if defined(ARDUINO_ARCH_ESP32)
+    i2s_chan_handle_t channel;
+    std::atomic<TaskHandle_t> waiter;       // Render task blocked in acquire()
+
+    static bool IRAM_ATTR onSent(i2s_chan_handle_t handle, i2s_event_data_t* event, void* arg);
+#else
+    int16_t* memory;
+    std::thread* dma;
+    std::mutex lock;
+    std::condition_variable wake;
+
+    void playLoop();
+#endif
+};
+
+#endif // MINTYSYNTH_AUDIOOUTPUT_H
@@ -0,0 +1,289 @@
+/*
+ * MintySynth Audio Pipeline Implementation
+ */
+
+#include "AudioPipeline.h"
+
+AudioPipeline::AudioPipeline(MintySynth& engine)
+    : synth(engine), output(NULL), sink(NULL), task(NULL), adaptive(false), renderUs(0), tap(NULL), probe(NULL),
+      midi(NULL), midiLate(0), seenUnderruns(0),
+      running(false), finished(true), blocksRendered(0), commandsApplied(0), commandsDropped(0) {
+}
+
+bool AudioPipeline::begin(AudioOutput& dmaOutput, int core, uint8_t priority) {
+    if (running.load() || !dmaOutput.isRunning()) return false;
+    
+    output = &dmaOutput;
+    sink = NULL;
+    
+    // Shrink decisions four times a second
+    uint32_t periodUs = output->getBufferPeriodUs();
+    tuner.begin(output->getMaxLead(), periodUs, 250000UL / (periodUs ? periodUs : 1));
+    output->setLead(adaptive.load() ? tuner.getLead() : output->getMaxLead());
+    seenUnderruns = output->getUnderruns();
+    return startTask(core, priority);
+}
+
+bool AudioPipeline::begin(AudioSink outputSink, int core, uint8_t priority) {
+    if (running.load()) return false;
+    
+    output = NULL;
+    sink = outputSink;
+    return startTask(core, priority);
+}
+
+bool AudioPipeline::startTask(int core, uint8_t priority) {
+    timeline.begin(SAMPLE_RATE, micros());
+    events.clear(synth.getSampleClock());
+    running.store(true);
+    finished.store(false);
+    
+    if (!synthTaskStart(&task, taskEntry, this, "audio", AUDIO_TASK_STACK, priority, core)) {
+        running.store(false);
+        finished.store(true);
+        return false;
+    }
+    return true;
+}
+
+void AudioPipeline::end() {
+    if (!running.load()) return;
+    
+    running.store(false);
+    while (!finished.load()) synthSleepMs(1);
+    synthTaskJoin(&task);
+}
+
+bool AudioPipeline::isRunning() {
+    return running.load();
+}
+
+bool AudioPipeline::send(const AudioCommand& command) {
+    if (commands.push(command)) return true;
+    commandsDropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool AudioPipeline::noteOn(uint8_t voice, uint8_t note, uint8_t velocity, uint32_t keyUs) {
+    AudioCommand command = { AUDIO_CMD_NOTE_ON, voice, note, velocity, keyUs, 0 };
+    if (keyUs && probe) command.sentUs = probe->noteSent(keyUs);
+    return send(command);
+}
+
+bool AudioPipeline::noteOff(uint8_t voice, uint8_t note) {
+    AudioCommand command = { AUDIO_CMD_NOTE_OFF, voice, note, 0, 0, 0 };
+    return send(command);
+}
+
+bool AudioPipeline::releaseVoice(uint8_t voice) {
+    AudioCommand command = { AUDIO_CMD_RELEASE_VOICE, voice, 0, 0, 0, 0 };
+    return send(command);
+}
+
+bool AudioPipeline::start() {
+    AudioCommand command = { AUDIO_CMD_START, 0, 0, 0, 0, 0 };
+    return send(command);
+}
+
+bool AudioPipeline::stop() {
+    AudioCommand command = { AUDIO_CMD_STOP, 0, 0, 0, 0, 0 };
+    return send(command);
+}
+
+void AudioPipeline::setVoiceParam(uint8_t voice, uint8_t param, uint8_t value) {
+    synth.setVoiceParam(voice, param, value);
+}
+
+void AudioPipeline::setGlobalParam(uint8_t param, uint16_t value) {
+    synth.setGlobalParam(param, value);
+}
+
+void AudioPipeline::setStep(uint8_t voice, uint8_t step, uint8_t note, bool active) {
+    synth.setStep(voice, step, note, active);
+}
+
+void AudioPipeline::updatePatterns() {
+    synth.updatePatterns();
+}
+
+bool AudioPipeline::savePreset(uint8_t slot) {
+    return synth.savePreset(slot);
+}
+
+bool AudioPipeline::loadPreset(uint8_t slot) {
+    return synth.loadPreset(slot);
+}
+
+void AudioPipeline::setAdaptiveLatency(bool enabled) {
+    adaptive.store(enabled);
+}
+
+bool AudioPipeline::isAdaptiveLatency() {
+    return adaptive.load();
+}
+
+uint32_t AudioPipeline::getLatencyUs() {
+    return output ? output->getLatencyUs() : 0;
+}
+
+uint32_t AudioPipeline::getRenderUs() {
+    return renderUs.load(std::memory_order_relaxed);
+}
+
+void AudioPipeline::setTap(AudioTap* audioTap) {
+    tap.store(audioTap, std::memory_order_release);
+}
+
+void AudioPipeline::setProbe(LatencyProbe* latencyProbe) {
+    if (!running.load()) probe = latencyProbe;
+}
+
+void AudioPipeline::setMidi(MidiInput* midiInput) {
+    if (!running.load()) midi = midiInput;
+}
+
+uint32_t AudioPipeline::getBlocksRendered() {
+    return blocksRendered.load(std::memory_order_relaxed);
+}
+
+uint32_t AudioPipeline::getCommandsApplied() {
+    return commandsApplied.load(std::memory_order_relaxed);
+}
+
+uint32_t AudioPipeline::getCommandsDropped() {
+    return commandsDropped.load(std::memory_order_relaxed);
+}
+
+uint32_t AudioPipeline::getMidiLate() {
+    return midiLate.load(std::memory_order_relaxed);
+}
+
+void AudioPipeline::taskEntry(void* arg) {
+    static_cast<AudioPipeline*>(arg)->run();
+    synthTaskExit();
+}
+
+void AudioPipeline::run() {
+    while (running.load(std::memory_order_relaxed)) {
+        if (output) {
+            int16_t* dma = output->acquire(AUDIO_OUTPUT_WAIT_MS);
+            if (dma) renderBuffer(dma);
+        } else {
+            scheduleMidi(micros());
+            render(buffer, AUDIO_BUFFER_SIZE, 0);
+            if (sink) sink(buffer, AUDIO_BUFFER_SIZE * 2);
+            if (probe) probe->bufferCommitted(micros(), SAMPLE_RATE);
+        }
+    }
+    finished.store(true);
+}
+
+// Renders in place into a DMA buffer, then lets the tuner move the lead
+void AudioPipeline::renderBuffer(int16_t* dma) {
+    uint32_t started = micros();
+    scheduleMidi(started);
+    
+    size_t frames = output->getBufferFrames();
+    for (size_t done = 0; done < frames; done += AUDIO_BUFFER_SIZE) {
+        size_t count = (frames - done < AUDIO_BUFFER_SIZE) ? frames - done : AUDIO_BUFFER_SIZE;
+        render(dma + done * 2, count, done);
+    }
+    output->commit(dma);
+    
+    // Handed out `lead` periods before it plays
+    if (probe) probe->bufferCommitted(started + output->getLatencyUs(), SAMPLE_RATE);
+    
+    uint32_t elapsed = micros() - started;
+    uint32_t underruns = output->getUnderruns();
+    uint8_t lead = tuner.update(elapsed, underruns != seenUnderruns);
+    seenUnderruns = underruns;
+    renderUs.store(tuner.getWorstUs(), std::memory_order_relaxed);
+    output->setLead(adaptive.load(std::memory_order_relaxed) ? lead : output->getMaxLead());
+}
+
+// One block of at most AUDIO_BUFFER_SIZE frames, offset frames into the output buffer
+void AudioPipeline::render(int16_t* out, size_t frames, size_t offset) {
+    // Parameters first, so queued notes start with the settings the UI
+    // had when it sent them
+    synth.refreshParams();
+    
+    // Apply everything the UI queued since the last block
+    AudioCommand command;
+    while (commands.pop(command)) {
+        applyCommand(command);
+        if (command.type == AUDIO_CMD_NOTE_ON && command.sentUs && probe) {
+            probe->noteApplied(command.keyUs, command.sentUs, (uint32_t)offset);
+        }
+    }
+    
+    // Scheduled events split the block at their frames
+    for (size_t done = 0; done < frames;) {
+        uint64_t now = synth.getSampleClock();
+        SynthEvent event;
+        while (events.pop(now, event)) applyEvent(event);
+        uint32_t count = events.framesUntilNext(now, (uint32_t)(frames - done));
+        synth.processAudio(out + done * 2, count * 2);
+        done += count;
+    }
+    if (probe) probe->blockRendered();
+    
+    AudioTap* audioTap = tap.load(std::memory_order_acquire);
+    if (audioTap) audioTap->write(out, frames);
+    blocksRendered.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AudioPipeline::applyCommand(const AudioCommand& command) {
+    switch (command.type) {
+        case AUDIO_CMD_NOTE_ON:
+            synth.triggerVoice(command.voice, command.note, command.velocity);
+            break;
+        case AUDIO_CMD_NOTE_OFF:
+            synth.releaseNote(command.voice, command.note);
+            break;
+        case AUDIO_CMD_RELEASE_VOICE:
+            synth.releaseVoice(command.voice);
+            break;
+        case AUDIO_CMD_START:
+            synth.start();
+            break;
+        case AUDIO_CMD_STOP:
+            synth.stop();
+            break;
+    }
+    commandsApplied.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Everything that arrived since the last buffer, onto its frame
+void AudioPipeline::scheduleMidi(uint32_t nowUs) {
+    if (!midi) return;
+    timeline.startBuffer(synth.getSampleClock(), nowUs);
+    
+    MidiMessage message;
+    while (midi->pop(message)) {
+        SynthEvent event;
+        if (!midiToEvent(message, timeline.frameOf(message.us), NUM_VOICES, event)) continue;
+        if (timeline.isLate(message.us)) midiLate.fetch_add(1, std::memory_order_relaxed);
+        events.schedule(event);
+    }
+}
+
+void AudioPipeline::applyEvent(const SynthEvent& event) {
+    switch (event.type) {
+        case EVENT_NOTE_ON:
+            synth.triggerVoice(event.voice, event.data, event.velocity);
+            break;
+        case EVENT_NOTE_OFF:
+            synth.releaseNote(event.voice, event.data);
+            break;
+        case EVENT_PARAM:
+            // A controller number, or a transport status
+            if (event.data == MIDI_START || event.data == MIDI_CONTINUE) {
+                synth.start();
+            } else if (event.data == MIDI_STOP) {
+                synth.stop();
+            } else {
+                synth.releaseVoice(event.voice);
+            }
+            break;
+    }
+}
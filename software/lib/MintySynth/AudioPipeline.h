@@ -0,0 +1,151 @@
+/*
+ * MintySynth Audio Pipeline
+ *
+ * Runs MintySynth in a dedicated render task pinned to AUDIO_TASK_CORE.
+ * Notes and transport go through a lock-free SPSC command queue that the
+ * render task drains before every block. Parameter and step changes are
+ * published straight into the engine's ParamSnapshot from the UI side and
+ * never queue, so they cannot be dropped.
+ *
+ * Output goes either straight into the DMA buffers of an AudioOutput,
+ * rendered in place as each one comes free (zero copy), or to a sink
+ * function that blocks until the DMA has room. Either way the output
+ * paces the task. With an AudioOutput the latency can adapt to the load:
+ * every buffer's render time goes to a LatencyTuner, which sets how far
+ * ahead of the DAC the task renders.
+ *
+ * An AudioTap set with setTap() gets a copy of every block as it is
+ * rendered, for the scope and spectrum on the UI side. A LatencyProbe set
+ * with setProbe() times every note-on sent with a key stamp, from the key
+ * to the DAC.
+ *
+ * MIDI from a MidiInput set with setMidi() skips the UI entirely: before
+ * each output buffer the render task takes the messages that arrived,
+ * places each on its frame with a MidiTimeline and plays it from an
+ * EventScheduler, splitting the block there. Every message is then one
+ * buffer late, and its jitter is that of its timestamp, not a block.
+ * Channels 1-4 play lanes 1-4; note on and off, all notes/sound off and
+ * start, continue and stop are taken, the rest ignored.
+ */
+
+#ifndef MINTYSYNTH_AUDIOPIPELINE_H
+#define MINTYSYNTH_AUDIOPIPELINE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "MintySynth.h"
+#include "AudioOutput.h"
+#include "AudioTap.h"
+#include "LatencyTuner.h"
+#include "LatencyProbe.h"
+#include "MidiInput.h"
+#include "EventScheduler.h"
+#include "SpscQueue.h"
+#include "SynthPlatform.h"
+
+#define AUDIO_COMMAND_QUEUE_SIZE 64
+#define AUDIO_OUTPUT_WAIT_MS     100    // Longest wait for a DMA buffer before checking for end()
+
+enum AudioCommandType {
+    AUDIO_CMD_NOTE_ON = 0,
+    AUDIO_CMD_NOTE_OFF,
+    AUDIO_CMD_RELEASE_VOICE,
+    AUDIO_CMD_START,
+    AUDIO_CMD_STOP
+};
+
+struct AudioCommand {
+    uint8_t type;           // AudioCommandType
+    uint8_t voice;          // Lane
+    uint8_t note;
+    uint8_t velocity;
+    uint32_t keyUs;         // Note-on: key press behind it, micros(); 0 if none
+    uint32_t sentUs;        // Set by noteOn() for the LatencyProbe
+};
+
+class AudioPipeline {
+public:
+    AudioPipeline(MintySynth& engine);
+    
+    // Starts the render task, rendering in place into output's DMA buffers.
+    // The output must already be running.
+    bool begin(AudioOutput& output, int core = AUDIO_TASK_CORE, uint8_t priority = AUDIO_TASK_PRIORITY);
+    
+    // Starts the render task; sink receives AUDIO_BUFFER_SIZE frames at a time
+    bool begin(AudioSink sink, int core = AUDIO_TASK_CORE, uint8_t priority = AUDIO_TASK_PRIORITY);
+    void end();
+    bool isRunning();
+    
+    // UI side (single producer). Return false if the queue was full.
+    // keyUs: when the key that played the note went down (InputEvent::us),
+    // for the LatencyProbe; 0 for notes not from a key.
+    bool noteOn(uint8_t voice, uint8_t note, uint8_t velocity = 127, uint32_t keyUs = 0);
+    bool noteOff(uint8_t voice, uint8_t note);
+    bool releaseVoice(uint8_t voice);
+    bool start();
+    bool stop();
+    bool send(const AudioCommand& command);
+    
+    // UI side (single writer). Published to the render task, never dropped.
+    void setVoiceParam(uint8_t voice, uint8_t param, uint8_t value);
+    void setGlobalParam(uint8_t param, uint16_t value);
+    void setStep(uint8_t voice, uint8_t step, uint8_t note, bool active = true);
+    void updatePatterns();          // From the UI loop: follows the song, see MintySynth
+    bool savePreset(uint8_t slot);  // Through the engine's PresetLog
+    bool loadPreset(uint8_t slot);
+    
+    // Adaptive latency (AudioOutput only): off renders the full ring ahead
+    void setAdaptiveLatency(bool enabled);
+    bool isAdaptiveLatency();
+    uint32_t getLatencyUs();        // Render to DAC, 0 without an AudioOutput
+    uint32_t getRenderUs();         // Worst render time per DMA buffer, last tuner window
+    
+    // Copy of the output for analysis; NULL to stop. Any time, from any task.
+    void setTap(AudioTap* audioTap);
+    
+    // Key-to-DAC timing of stamped note-ons; NULL to stop. Before begin().
+    void setProbe(LatencyProbe* latencyProbe);
+    
+    // MIDI played on the render task, see above; NULL for none. Before begin().
+    void setMidi(MidiInput* midiInput);
+    
+    // Statistics
+    uint32_t getBlocksRendered();
+    uint32_t getCommandsApplied();
+    uint32_t getCommandsDropped();
+    uint32_t getMidiLate();         // MIDI events that arrived too late for their frame
+    
+private:
+    MintySynth& synth;
+    AudioOutput* output;
+    AudioSink sink;
+    SynthTask task;
+    SpscQueue<AudioCommand, AUDIO_COMMAND_QUEUE_SIZE> commands;
+    LatencyTuner tuner;
+    std::atomic<bool> adaptive;
+    std::atomic<uint32_t> renderUs;
+    std::atomic<AudioTap*> tap;
+    LatencyProbe* probe;
+    MidiInput* midi;
+    MidiTimeline timeline;
+    EventScheduler events;          // Render task only
+    std::atomic<uint32_t> midiLate;
+    uint32_t seenUnderruns;
+    std::atomic<bool> running;
+    std::atomic<bool> finished;
+    std::atomic<uint32_t> blocksRendered;
+    std::atomic<uint32_t> commandsApplied;
+    std::atomic<uint32_t> commandsDropped;
+    int16_t buffer[AUDIO_BUFFER_SIZE * 2];
+    
+    bool startTask(int core, uint8_t priority);
+    static void taskEntry(void* arg);
+    void run();
+    void render(int16_t* out, size_t frames, size_t offset);
+    void renderBuffer(int16_t* dma);
+    void applyCommand(const AudioCommand& command);
+    void scheduleMidi(uint32_t nowUs);
+    void applyEvent(const SynthEvent& event);
+};
+
+#endif // MINTYSYNTH_AUDIOPIPELINE_H
@@ -0,0 +1,75 @@
+/*
+ * MintySynth Audio Tap
+ *
+ * Lock-free window on the mixed output for the scope, spectrum and tuner.
+ * The render task copies each finished block into a ring of the last
+ * AUDIO_TAP_FRAMES stereo frames (one memcpy, two at the wrap) and
+ * publishes the running frame count; it never waits and never learns
+ * whether anyone is looking. The UI copies out the latest frames at its
+ * own rate and checks the count again afterwards: if the renderer lapped
+ * the copy in the meantime, read() says so and the frame is skipped.
+ *
+ * One writer, any number of readers. Header only, so the sketches can
+ * use it with their own audio loop.
+ */
+
+#ifndef MINTYSYNTH_AUDIOTAP_H
+#define MINTYSYNTH_AUDIOTAP_H
+
+#include <Arduino.h>
+#include <atomic>
+
+#define AUDIO_TAP_FRAMES  4096    // Stereo frames kept, a power of two
+
+class AudioTap {
+    static_assert((AUDIO_TAP_FRAMES & (AUDIO_TAP_FRAMES - 1)) == 0, "AUDIO_TAP_FRAMES must be a power of two");
+
+public:
+    AudioTap() : written(0) {
+        memset(ring, 0, sizeof(ring));
+    }
+
+    // Render side: one block of interleaved stereo
+    void write(const int16_t* stereo, size_t frames) {
+        if (frames > AUDIO_TAP_FRAMES) {
+            stereo += (frames - AUDIO_TAP_FRAMES) * 2;
+            frames = AUDIO_TAP_FRAMES;
+        }
+        uint32_t count = written.load(std::memory_order_relaxed);
+        size_t index = count & (AUDIO_TAP_FRAMES - 1);
+        size_t first = AUDIO_TAP_FRAMES - index;
+        if (first > frames) first = frames;
+
+        memcpy(&ring[index * 2], stereo, first * 2 * sizeof(int16_t));
+        memcpy(&ring[0], stereo + first * 2, (frames - first) * 2 * sizeof(int16_t));
+        written.store(count + (uint32_t)frames, std::memory_order_release);
+    }
+
+    // UI side: the latest `frames` frames mixed to mono, oldest first.
+    // False if fewer have been written, or the copy was overwritten.
+    bool read(int16_t* mono, size_t frames) {
+        if (frames > AUDIO_TAP_FRAMES) return false;
+        uint32_t end = written.load(std::memory_order_acquire);
+        if (end < frames) return false;
+
+        uint32_t start = end - (uint32_t)frames;
+        for (size_t i = 0; i < frames; i++) {
+            size_t index = ((start + i) & (AUDIO_TAP_FRAMES - 1)) * 2;
+            mono[i] = (int16_t)(((int32_t)ring[index] + ring[index + 1]) >> 1);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return written.load(std::memory_order_relaxed) - start <= AUDIO_TAP_FRAMES;
+    }
+
+    // Frames written so far; wraps
+    uint32_t getWritten() {
+        return written.load(std::memory_order_acquire);
+    }
+
+private:
+    int16_t ring[AUDIO_TAP_FRAMES * 2];
+    std::atomic<uint32_t> written;
+};
+
+#endif // MINTYSYNTH_AUDIOTAP_H
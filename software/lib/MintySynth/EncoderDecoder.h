@@ -0,0 +1,129 @@
+/*
+ * MintySynth Encoder Decoder
+ *
+ * The logic half of the rotary encoders, kept apart from the pins so it
+ * runs the same on the host:
+ *
+ * - QuadratureDecoder turns CLK/DT levels into quarter steps for the
+ *   pin-change interrupt path. No table: the Gray code state becomes a
+ *   position 0-3 and the step is the difference. A skipped state (two
+ *   edges behind one interrupt) counts two steps the way it was turning.
+ * - EncoderAccel turns a running quarter-step count (from the decoder or
+ *   a PCNT unit) into detents, multiplied by how fast they come: slow
+ *   turns move by one, a quick flick sweeps the whole range.
+ *
+ * Header only; EncoderInput owns the hardware.
+ */
+
+#ifndef MINTYSYNTH_ENCODERDECODER_H
+#define MINTYSYNTH_ENCODERDECODER_H
+
+#include <Arduino.h>
+
+#define ENCODER_STEPS_PER_DETENT  4
+#define ENCODER_SLOW_US           40000   // Detents this far apart move by one
+#define ENCODER_FAST_US           5000    // Detents this close get the full gain
+#define ENCODER_FLICK_DETENTS     8       // Detents at full gain that cross the range
+
+class QuadratureDecoder {
+public:
+    QuadratureDecoder() : position(0), direction(0), count(0), skipped(0) {}
+
+    // Levels as clk << 1 | dt
+    void begin(uint8_t levels) {
+        position = toPosition(levels);
+        direction = 0;
+    }
+
+    // Feeds the levels after a pin change; returns the quarter steps taken
+    inline int8_t update(uint8_t levels) {
+        uint8_t next = toPosition(levels);
+        uint8_t diff = (next - position) & 3;
+        position = next;
+
+        int8_t step = 0;
+        if (diff == 1) {
+            step = 1;
+        } else if (diff == 3) {
+            step = -1;
+        } else if (diff == 2) {
+            step = direction * 2;
+            skipped++;
+        }
+        if (step) {
+            direction = step > 0 ? 1 : -1;
+            count += step;
+        }
+        return step;
+    }
+
+    int32_t getCount() const { return count; }
+    uint32_t getSkipped() const { return skipped; }
+
+private:
+    uint8_t position;
+    int8_t direction;
+    volatile int32_t count;
+    uint32_t skipped;
+
+    // Clockwise runs 00, 10, 11, 01 as 0, 1, 2, 3
+    static inline uint8_t toPosition(uint8_t levels) {
+        uint8_t clk = (levels >> 1) & 1;
+        uint8_t dt = levels & 1;
+        return (uint8_t)((dt << 1) | (clk ^ dt));
+    }
+};
+
+class EncoderAccel {
+public:
+    EncoderAccel() : base(0), maxGain(1), lastUs(0), intervalUs(ENCODER_SLOW_US), direction(0) {}
+
+    // Starts from count; range is the span of the value the encoder sets
+    // (0 or 1 for no acceleration)
+    void begin(int32_t count, int32_t range) {
+        base = count;
+        maxGain = range / ENCODER_FLICK_DETENTS;
+        if (maxGain < 1) maxGain = 1;
+        intervalUs = ENCODER_SLOW_US;
+        direction = 0;
+    }
+
+    // Detents since the last call, times the gain for the current speed.
+    // Part detents stay in the count for next time.
+    int32_t update(int32_t count, uint32_t nowUs) {
+        int32_t detents = (count - base) / ENCODER_STEPS_PER_DETENT;
+        if (!detents) return 0;
+        base += detents * ENCODER_STEPS_PER_DETENT;
+
+        int8_t turning = detents > 0 ? 1 : -1;
+        uint32_t magnitude = detents > 0 ? detents : -detents;
+        uint32_t interval = (nowUs - lastUs) / magnitude;
+        lastUs = nowUs;
+
+        // Smoothed time per detent; a reversal or a pause starts slow
+        if (turning != direction || interval >= ENCODER_SLOW_US) {
+            intervalUs = ENCODER_SLOW_US;
+        } else {
+            intervalUs = (intervalUs + interval) / 2;
+        }
+        direction = turning;
+
+        return detents * getGain();
+    }
+
+    int32_t getGain() const {
+        if (intervalUs >= ENCODER_SLOW_US) return 1;
+        if (intervalUs <= ENCODER_FAST_US) return maxGain;
+        return 1 + (int32_t)((int64_t)(maxGain - 1) * (ENCODER_SLOW_US - intervalUs) /
+                             (ENCODER_SLOW_US - ENCODER_FAST_US));
+    }
+
+private:
+    int32_t base;
+    int32_t maxGain;
+    uint32_t lastUs;
+    uint32_t intervalUs;
+    int8_t direction;
+};
+
+#endif // MINTYSYNTH_ENCODERDECODER_H
@@ -0,0 +1,196 @@
+/*
+ * MintySynth Encoder Input Implementation
+ */
+
+#include "EncoderInput.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <driver/gpio.h>
+#include <soc/gpio_reg.h>
+#else
+#define IRAM_ATTR
+#endif
+
+EncoderInput::EncoderInput() : unitsUsed(0) {
+    for (uint8_t i = 0; i < ENCODER_MAX; i++) {
+        encoders[i].attached = false;
+        encoders[i].hardware = false;
+        encoders[i].clkPin = 0;
+        encoders[i].dtPin = 0;
+        encoders[i].unit = NULL;
+        encoders[i].channels[0] = NULL;
+        encoders[i].channels[1] = NULL;
+    }
+}
+
+EncoderInput::~EncoderInput() {
+    end();
+}
+
+bool EncoderInput::attach(uint8_t encoder, uint8_t clkPin, uint8_t dtPin) {
+    if (encoder >= ENCODER_MAX || encoders[encoder].attached) return false;
+
+    Channel& channel = encoders[encoder];
+    channel.clkPin = clkPin;
+    channel.dtPin = dtPin;
+    channel.hardware = unitsUsed < ENCODER_PCNT_UNITS && attachCounter(channel);
+    if (channel.hardware) {
+        unitsUsed++;
+    } else if (!attachInterrupts(channel)) {
+        return false;
+    }
+
+    channel.attached = true;
+    channel.accel.begin(getCount(encoder), 0);
+    return true;
+}
+
+void EncoderInput::setRange(uint8_t encoder, int32_t range) {
+    if (encoder >= ENCODER_MAX) return;
+    encoders[encoder].accel.begin(getCount(encoder), range);
+}
+
+int32_t EncoderInput::getChange(uint8_t encoder) {
+    if (encoder >= ENCODER_MAX || !encoders[encoder].attached) return 0;
+    return encoders[encoder].accel.update(getCount(encoder), micros());
+}
+
+bool EncoderInput::isHardware(uint8_t encoder) {
+    return encoder < ENCODER_MAX && encoders[encoder].hardware;
+}
+
+// -------------------------------------------------------------------------
+// Interrupt fallback: both pins on CHANGE, levels read from the register
+// -------------------------------------------------------------------------
+
+void IRAM_ATTR EncoderInput::onPinChange(void* arg) {
+    Channel* channel = static_cast<Channel*>(arg);
+#if defined(ARDUINO_ARCH_ESP32)
+    uint64_t pins = ((uint64_t)REG_READ(GPIO_IN1_REG) << 32) | REG_READ(GPIO_IN_REG);
+    channel->decoder.update((uint8_t)((((pins >> channel->clkPin) & 1) << 1) | ((pins >> channel->dtPin) & 1)));
+#else
+    (void)channel;
+#endif
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+bool EncoderInput::attachInterrupts(Channel& channel) {
+    pinMode(channel.clkPin, INPUT_PULLUP);
+    pinMode(channel.dtPin, INPUT_PULLUP);
+    channel.decoder.begin((uint8_t)((digitalRead(channel.clkPin) << 1) | digitalRead(channel.dtPin)));
+    attachInterruptArg(channel.clkPin, onPinChange, &channel, CHANGE);
+    attachInterruptArg(channel.dtPin, onPinChange, &channel, CHANGE);
+    return true;
+}
+
+// Full quadrature: each pin is the edge input of one channel and the
+// direction level of the other, so every edge of either counts one step
+bool EncoderInput::attachCounter(Channel& channel) {
+    pcnt_unit_config_t unitConfig = {};
+    unitConfig.low_limit = -ENCODER_PCNT_LIMIT;
+    unitConfig.high_limit = ENCODER_PCNT_LIMIT;
+    unitConfig.flags.accum_count = 1;
+    if (pcnt_new_unit(&unitConfig, &channel.unit) != ESP_OK) return false;
+
+    pcnt_glitch_filter_config_t filter = {};
+    filter.max_glitch_ns = ENCODER_GLITCH_NS;
+    pcnt_unit_set_glitch_filter(channel.unit, &filter);
+
+    pcnt_chan_config_t clkConfig = {};
+    clkConfig.edge_gpio_num = channel.clkPin;
+    clkConfig.level_gpio_num = channel.dtPin;
+    pcnt_chan_config_t dtConfig = {};
+    dtConfig.edge_gpio_num = channel.dtPin;
+    dtConfig.level_gpio_num = channel.clkPin;
+    if (pcnt_new_channel(channel.unit, &clkConfig, &channel.channels[0]) != ESP_OK ||
+        pcnt_new_channel(channel.unit, &dtConfig, &channel.channels[1]) != ESP_OK) {
+        if (channel.channels[0]) pcnt_del_channel(channel.channels[0]);
+        pcnt_del_unit(channel.unit);
+        channel.channels[0] = NULL;
+        channel.unit = NULL;
+        return false;
+    }
+
+    // Same sense as QuadratureDecoder: clockwise is 00, 10, 11, 01
+    pcnt_channel_set_edge_action(channel.channels[0], PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+                                 PCNT_CHANNEL_EDGE_ACTION_DECREASE);
+    pcnt_channel_set_level_action(channel.channels[0], PCNT_CHANNEL_LEVEL_ACTION_INVERSE,
+                                  PCNT_CHANNEL_LEVEL_ACTION_KEEP);
+    pcnt_channel_set_edge_action(channel.channels[1], PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+                                 PCNT_CHANNEL_EDGE_ACTION_DECREASE);
+    pcnt_channel_set_level_action(channel.channels[1], PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+                                  PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+
+    // The limits must be watch points for the unit to keep a running total
+    pcnt_unit_add_watch_point(channel.unit, -ENCODER_PCNT_LIMIT);
+    pcnt_unit_add_watch_point(channel.unit, ENCODER_PCNT_LIMIT);
+
+    gpio_pullup_en((gpio_num_t)channel.clkPin);
+    gpio_pullup_en((gpio_num_t)channel.dtPin);
+
+    pcnt_unit_enable(channel.unit);
+    pcnt_unit_clear_count(channel.unit);
+    pcnt_unit_start(channel.unit);
+    return true;
+}
+
+int32_t EncoderInput::getCount(uint8_t encoder) {
+    if (encoder >= ENCODER_MAX) return 0;
+    Channel& channel = encoders[encoder];
+    if (!channel.hardware) return channel.decoder.getCount();
+
+    int count = 0;
+    pcnt_unit_get_count(channel.unit, &count);
+    return count;
+}
+
+void EncoderInput::end() {
+    for (uint8_t i = 0; i < ENCODER_MAX; i++) {
+        Channel& channel = encoders[i];
+        if (!channel.attached) continue;
+        if (channel.hardware) {
+            pcnt_unit_stop(channel.unit);
+            pcnt_unit_disable(channel.unit);
+            pcnt_del_channel(channel.channels[0]);
+            pcnt_del_channel(channel.channels[1]);
+            pcnt_del_unit(channel.unit);
+            channel.unit = NULL;
+            channel.channels[0] = NULL;
+            channel.channels[1] = NULL;
+        } else {
+            detachInterrupt(channel.clkPin);
+            detachInterrupt(channel.dtPin);
+        }
+        channel.attached = false;
+        channel.hardware = false;
+    }
+    unitsUsed = 0;
+}
+
+#else
+
+// No pins on the host: encoders attach but never turn
+bool EncoderInput::attachInterrupts(Channel& channel) {
+    channel.decoder.begin(3);
+    return true;
+}
+
+bool EncoderInput::attachCounter(Channel& channel) {
+    (void)channel;
+    return false;
+}
+
+int32_t EncoderInput::getCount(uint8_t encoder) {
+    if (encoder >= ENCODER_MAX) return 0;
+    return encoders[encoder].decoder.getCount();
+}
+
+void EncoderInput::end() {
+    for (uint8_t i = 0; i < ENCODER_MAX; i++) {
+        encoders[i].attached = false;
+    }
+    unitsUsed = 0;
+}
+
+#endif
@@ -0,0 +1,76 @@
+/*
+ * MintySynth Encoder Input
+ *
+ * Rotary encoders counted in hardware so no detent is lost however busy
+ * the loop is. Each encoder takes one of the S3's four PCNT units: both
+ * pins are edge inputs (with the other as the direction level), so the
+ * unit counts every quarter step by itself, behind a 1 us glitch filter.
+ * Encoders beyond the fourth fall back to pin-change interrupts and a
+ * QuadratureDecoder, which is enough at hand-turning speeds.
+ *
+ * The UI asks for the change since it last looked; the counts themselves
+ * only ever run forward, so nothing is lost between a read and a clear.
+ * The change is in detents, accelerated by an EncoderAccel sized to the
+ * range the encoder sets.
+ */
+
+#ifndef MINTYSYNTH_ENCODERINPUT_H
+#define MINTYSYNTH_ENCODERINPUT_H
+
+#include <Arduino.h>
+#include "EncoderDecoder.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <driver/pulse_cnt.h>
+typedef pcnt_unit_handle_t EncoderUnit;
+typedef pcnt_channel_handle_t EncoderUnitChannel;
+#else
+typedef void* EncoderUnit;
+typedef void* EncoderUnitChannel;
+#endif
+
+#define ENCODER_MAX           8
+#define ENCODER_PCNT_UNITS    4       // On the ESP32-S3
+#define ENCODER_PCNT_LIMIT    16384   // Unit counter wraps into the running total here
+#define ENCODER_GLITCH_NS     1000
+
+class EncoderInput {
+public:
+    EncoderInput();
+    ~EncoderInput();
+
+    // Starts counting: a PCNT unit while one is free, else interrupts
+    bool attach(uint8_t encoder, uint8_t clkPin, uint8_t dtPin);
+    void end();
+
+    // Span of the value the encoder sets, for acceleration (0 for none)
+    void setRange(uint8_t encoder, int32_t range);
+
+    // UI side: detents since the last call, accelerated
+    int32_t getChange(uint8_t encoder);
+
+    // Quarter steps since attach()
+    int32_t getCount(uint8_t encoder);
+    bool isHardware(uint8_t encoder);
+
+private:
+    struct Channel {
+        bool attached;
+        bool hardware;
+        uint8_t clkPin;
+        uint8_t dtPin;
+        EncoderUnit unit;
+        EncoderUnitChannel channels[2];
+        QuadratureDecoder decoder;  // Interrupt path
+        EncoderAccel accel;
+    };
+
+    Channel encoders[ENCODER_MAX];
+    uint8_t unitsUsed;
+
+    bool attachCounter(Channel& channel);
+    bool attachInterrupts(Channel& channel);
+    static void onPinChange(void* arg);
+};
+
+#endif // MINTYSYNTH_ENCODERINPUT_H
@@ -0,0 +1,210 @@
+/*
+ * MintySynth Envelope Generator
+ *
+ * Incremental attack/hold/decay/sustain/release envelope shared by the
+ * library and the Arduino IDE sketches. Segment rates are worked out once
+ * (EnvelopeRates) when a note starts or a parameter changes, or at
+ * compile time, as the helpers are constexpr. The generator
+ * then only adds or multiplies at a control rate of one tick per
+ * ENVELOPE_CONTROL_PERIOD samples, like the divider in the original AVR
+ * synth ISR, and interpolates linearly between ticks for every sample.
+ *
+ * Header only, and every name is prefixed, so sketches can include it
+ * next to their own ENV_* and NUM_VOICES definitions.
+ */
+
+#ifndef MINTYSYNTH_ENVELOPEGENERATOR_H
+#define MINTYSYNTH_ENVELOPEGENERATOR_H
+
+#include <Arduino.h>
+#include "SynthTables.h"
+
+// Control rate = sample rate / ENVELOPE_CONTROL_PERIOD
+#define ENVELOPE_CONTROL_SHIFT   4
+#define ENVELOPE_CONTROL_PERIOD  (1 << ENVELOPE_CONTROL_SHIFT)
+
+// Internal level format: 32767 << 9 is full scale, so getLevel() and
+// nextSample() return 0-32767 with a plain shift
+#define ENVELOPE_LEVEL_SHIFT     9
+#define ENVELOPE_FULL_SCALE      (32767L << ENVELOPE_LEVEL_SHIFT)
+#define ENVELOPE_COEF_ONE        (1L << 30)     // Exponential coefficients are Q30
+
+enum EnvelopeGeneratorStage {
+    EG_IDLE = 0,
+    EG_ATTACK,
+    EG_HOLD,
+    EG_DECAY,
+    EG_SUSTAIN,
+    EG_RELEASE
+};
+
+// Per-segment rates in control ticks. Build with the helpers below.
+struct EnvelopeRates {
+    int32_t attackStep;         // Level added per tick, ENVELOPE_FULL_SCALE = instant
+    uint32_t holdTicks;         // Ticks at full level before the decay
+    bool decayExponential;      // false: linear decayStep, true: decayCoef
+    int32_t decayStep;          // Level removed per tick
+    int32_t decayCoef;          // Fraction of the distance to sustain kept per tick (Q30)
+    int32_t sustainLevel;       // 0 - ENVELOPE_FULL_SCALE
+    uint32_t releaseTicks;      // Linear release from the current level, 0 = immediate
+    uint32_t gateTicks;         // Release once in sustain after this many ticks, 0 = wait for release()
+};
+
+// Ticks for a duration in samples (at least one)
+constexpr uint32_t envelopeTicks(uint32_t samples) {
+    uint32_t ticks = (samples + ENVELOPE_CONTROL_PERIOD / 2) >> ENVELOPE_CONTROL_SHIFT;
+    return ticks ? ticks : 1;
+}
+
+// Per-tick step covering `distance` in `samples`
+constexpr int32_t envelopeStep(int32_t distance, uint32_t samples) {
+    int32_t step = distance / (int32_t)envelopeTicks(samples);
+    return step ? step : 1;
+}
+
+// Per-tick coefficient for an exponential segment with time constant `samples`
+constexpr int32_t envelopeCoef(float samples) {
+    if (samples <= 0.0f) return 0;
+    return (int32_t)(synthExp(-(double)ENVELOPE_CONTROL_PERIOD / samples) * ENVELOPE_COEF_ONE);
+}
+
+class EnvelopeGenerator {
+public:
+    EnvelopeGenerator() {
+        rates.attackStep = ENVELOPE_FULL_SCALE;
+        rates.holdTicks = 0;
+        rates.decayExponential = false;
+        rates.decayStep = ENVELOPE_FULL_SCALE;
+        rates.decayCoef = 0;
+        rates.sustainLevel = ENVELOPE_FULL_SCALE;
+        rates.releaseTicks = 0;
+        rates.gateTicks = 0;
+        stage = EG_IDLE;
+        level = 0;
+        value = 0;
+        sampleStep = 0;
+        releaseStep = 0;
+        countdown = 0;
+        stageTicks = 0;
+        elapsedTicks = 0;
+    }
+
+    // New rates apply from the next control tick
+    void setRates(const EnvelopeRates& newRates) {
+        rates = newRates;
+    }
+
+    // Note-on: attack from silence
+    void start() {
+        stage = EG_ATTACK;
+        level = 0;
+        value = 0;
+        sampleStep = 0;
+        countdown = 0;
+        stageTicks = 0;
+        elapsedTicks = 0;
+    }
+
+    // Note-off: linear release from wherever the envelope is
+    void release() {
+        if (stage == EG_IDLE || stage == EG_RELEASE) return;
+        stage = EG_RELEASE;
+        releaseStep = rates.releaseTicks ? (level / (int32_t)rates.releaseTicks) : level;
+        if (releaseStep <= 0) releaseStep = 1;
+    }
+
+    // Hard stop, no release
+    void stop() {
+        stage = EG_IDLE;
+        level = 0;
+        value = 0;
+        sampleStep = 0;
+    }
+
+    bool isActive() const { return stage != EG_IDLE || value > 0; }
+    EnvelopeGeneratorStage getStage() const { return (EnvelopeGeneratorStage)stage; }
+
+    // Current level, 0-32767
+    uint16_t getLevel() const { return value >> ENVELOPE_LEVEL_SHIFT; }
+
+    // Level for the next audio sample, 0-32767
+    inline uint16_t nextSample() {
+        if (countdown == 0) controlTick();
+        countdown--;
+        int32_t out = value;
+        value += sampleStep;
+        return out >> ENVELOPE_LEVEL_SHIFT;
+    }
+
+private:
+    EnvelopeRates rates;
+    uint8_t stage;
+    int32_t level;          // Control point the interpolation is heading for
+    int32_t value;          // Interpolated per-sample level
+    int32_t sampleStep;     // Per-sample interpolation step
+    int32_t releaseStep;
+    uint8_t countdown;      // Samples left until the next tick
+    uint32_t stageTicks;
+    uint32_t elapsedTicks;
+
+    // Advances one control tick and sets up interpolation towards it
+    void controlTick() {
+        // Interpolation lands exactly on the previous control point
+        value = level;
+
+        switch (stage) {
+            case EG_ATTACK:
+                level += rates.attackStep;
+                if (level >= ENVELOPE_FULL_SCALE) {
+                    level = ENVELOPE_FULL_SCALE;
+                    stage = rates.holdTicks ? EG_HOLD : EG_DECAY;
+                    stageTicks = 0;
+                }
+                break;
+
+            case EG_HOLD:
+                if (++stageTicks >= rates.holdTicks) stage = EG_DECAY;
+                break;
+
+            case EG_DECAY:
+                if (rates.decayExponential) {
+                    level = rates.sustainLevel
+                          + (int32_t)(((int64_t)(level - rates.sustainLevel) * rates.decayCoef) >> 30);
+                    // Within one output step of the target counts as there
+                    if (level - rates.sustainLevel < (1 << ENVELOPE_LEVEL_SHIFT)) level = rates.sustainLevel;
+                } else {
+                    level -= rates.decayStep;
+                }
+                if (level <= rates.sustainLevel) {
+                    level = rates.sustainLevel;
+                    stage = EG_SUSTAIN;
+                }
+                break;
+
+            case EG_SUSTAIN:
+                level = rates.sustainLevel;
+                if (rates.gateTicks && elapsedTicks >= rates.gateTicks) release();
+                break;
+
+            case EG_RELEASE:
+                level -= releaseStep;
+                if (level <= 0) {
+                    level = 0;
+                    stage = EG_IDLE;
+                }
+                break;
+
+            case EG_IDLE:
+            default:
+                level = 0;
+                break;
+        }
+
+        elapsedTicks++;
+        // Division rounds towards zero, so the ramp never overshoots below 0
+        sampleStep = (level - value) / ENVELOPE_CONTROL_PERIOD;
+        countdown = ENVELOPE_CONTROL_PERIOD;
+    }
+};
+
+#endif // MINTYSYNTH_ENVELOPEGENERATOR_H
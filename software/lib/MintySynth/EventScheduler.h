@@ -0,0 +1,213 @@
+/*
+ * MintySynth Event Scheduler
+ *
+ * Note-on, note-off and parameter events stamped with the frame they
+ * play on, for the render task. A timing wheel: SCHED_WHEEL_SLOTS slots
+ * of SCHED_SLOT_FRAMES frames each, every slot a list of events from a
+ * preallocated pool, so schedule() is O(1), taking the next due event
+ * only looks at the few events sharing its slot, and nothing is ever
+ * allocated. Events further ahead than the wheel reaches (a long note's
+ * note-off) wait in an overflow list that is sorted into the wheel every
+ * half turn.
+ *
+ * Events on the same frame come out in the order they were scheduled,
+ * so a note-off queued before a retrigger still plays first.
+ *
+ * The render loop pops everything due at the frame it is on, renders
+ * up to framesUntilNext() and repeats. Only the render task touches the
+ * scheduler; the UI sends its events through the command queue.
+ *
+ * Header only, so the sketches can use it with their own audio loop.
+ */
+
+#ifndef MINTYSYNTH_EVENTSCHEDULER_H
+#define MINTYSYNTH_EVENTSCHEDULER_H
+
+#include <Arduino.h>
+
+#define SCHED_CAPACITY        512                               // Events pending at once
+#define SCHED_SLOT_BITS       5
+#define SCHED_SLOT_FRAMES     (1 << SCHED_SLOT_BITS)
+#define SCHED_WHEEL_BITS      9
+#define SCHED_WHEEL_SLOTS     (1 << SCHED_WHEEL_BITS)            // 16384 frames ahead
+#define SCHED_NONE            0xFFFF
+
+enum SynthEventType {
+    EVENT_NOTE_ON = 0,
+    EVENT_NOTE_OFF,
+    EVENT_PARAM
+};
+
+struct SynthEvent {
+    uint64_t frame;         // Sample frame it plays on
+    uint8_t type;
+    uint8_t voice;
+    uint8_t data;           // Note, or parameter
+    uint8_t velocity;
+    uint16_t value;         // Parameter value, or the note a note-off ends
+};
+
+class EventScheduler {
+public:
+    EventScheduler() : peak(0), dropped(0) {
+        clear(0);
+    }
+
+    // Drops everything pending; the wheel starts at `frame`
+    void clear(uint64_t frame) {
+        for (uint16_t i = 0; i < SCHED_CAPACITY; i++) {
+            pool[i].next = (i + 1 < SCHED_CAPACITY) ? i + 1 : SCHED_NONE;
+        }
+        freeList = 0;
+        for (uint16_t s = 0; s < SCHED_WHEEL_SLOTS; s++) {
+            heads[s] = SCHED_NONE;
+            tails[s] = SCHED_NONE;
+        }
+        overflowHead = SCHED_NONE;
+        overflowTail = SCHED_NONE;
+        tick = frame >> SCHED_SLOT_BITS;
+        horizon = tick + SCHED_WHEEL_SLOTS;
+        count = 0;
+        wheelCount = 0;
+    }
+
+    // False (and counted) when all SCHED_CAPACITY events are pending.
+    // An event in the past plays at once.
+    bool schedule(const SynthEvent& event) {
+        if (freeList == SCHED_NONE) {
+            dropped++;
+            return false;
+        }
+        uint16_t node = freeList;
+        freeList = pool[node].next;
+        pool[node].event = event;
+        insert(node);
+        count++;
+        if (count > peak) peak = count;
+        return true;
+    }
+
+    // Takes the earliest event due at or before `frame`
+    bool pop(uint64_t frame, SynthEvent& event) {
+        uint64_t target = frame >> SCHED_SLOT_BITS;
+        for (;;) {
+            uint16_t slot = tick & (SCHED_WHEEL_SLOTS - 1);
+            uint16_t best = SCHED_NONE;
+            uint16_t bestPrev = SCHED_NONE;
+            for (uint16_t prev = SCHED_NONE, n = heads[slot]; n != SCHED_NONE; prev = n, n = pool[n].next) {
+                uint64_t at = pool[n].event.frame;
+                if (at <= frame && (best == SCHED_NONE || at < pool[best].event.frame)) {
+                    best = n;
+                    bestPrev = prev;
+                }
+            }
+            if (best != SCHED_NONE) {
+                unlink(slot, best, bestPrev);
+                event = pool[best].event;
+                pool[best].next = freeList;
+                freeList = best;
+                count--;
+                wheelCount--;
+                return true;
+            }
+
+            // Nothing left in this slot that is due; move on towards frame
+            if (tick >= target) return false;
+            if (!wheelCount) {
+                tick = target;
+                cascade();
+            } else {
+                tick++;
+                if ((tick & (SCHED_WHEEL_SLOTS / 2 - 1)) == 0) cascade();
+            }
+        }
+    }
+
+    // Frames from `frame` to the next event, at most limit. 0 only while
+    // pop() still has one due.
+    uint32_t framesUntilNext(uint64_t frame, uint32_t limit) const {
+        uint64_t next = frame + limit;
+        uint64_t reach = horizon << SCHED_SLOT_BITS;    // Overflow events are no earlier
+        if (next > reach) next = reach;
+        if (wheelCount && next > 0) {
+            uint64_t last = (next - 1) >> SCHED_SLOT_BITS;
+            for (uint64_t t = tick; t <= last; t++) {
+                for (uint16_t n = heads[t & (SCHED_WHEEL_SLOTS - 1)]; n != SCHED_NONE; n = pool[n].next) {
+                    if (pool[n].event.frame < next) next = pool[n].event.frame;
+                }
+            }
+        }
+        return next > frame ? (uint32_t)(next - frame) : 0;
+    }
+
+    uint16_t getCount() const { return count; }
+    uint16_t getPeak() const { return peak; }
+    uint32_t getDropped() const { return dropped; }
+
+private:
+    struct Node {
+        SynthEvent event;
+        uint16_t next;
+    };
+
+    Node pool[SCHED_CAPACITY];
+    uint16_t freeList;
+    uint16_t heads[SCHED_WHEEL_SLOTS];
+    uint16_t tails[SCHED_WHEEL_SLOTS];      // Appended at the tail, so ties stay in order
+    uint16_t overflowHead;
+    uint16_t overflowTail;
+    uint64_t tick;                          // Slot being played, in SCHED_SLOT_FRAMES
+    uint64_t horizon;                       // Slots from here on wait in the overflow
+    uint16_t count;
+    uint16_t wheelCount;
+    uint16_t peak;                          // Most pending at once
+    uint32_t dropped;
+
+    void insert(uint16_t node) {
+        uint64_t at = pool[node].event.frame >> SCHED_SLOT_BITS;
+        if (at < tick) at = tick;
+        pool[node].next = SCHED_NONE;
+        if (at < horizon) {
+            uint16_t slot = at & (SCHED_WHEEL_SLOTS - 1);
+            if (tails[slot] == SCHED_NONE) {
+                heads[slot] = node;
+            } else {
+                pool[tails[slot]].next = node;
+            }
+            tails[slot] = node;
+            wheelCount++;
+        } else {
+            if (overflowTail == SCHED_NONE) {
+                overflowHead = node;
+            } else {
+                pool[overflowTail].next = node;
+            }
+            overflowTail = node;
+        }
+    }
+
+    void unlink(uint16_t slot, uint16_t node, uint16_t prev) {
+        if (prev == SCHED_NONE) {
+            heads[slot] = pool[node].next;
+        } else {
+            pool[prev].next = pool[node].next;
+        }
+        if (tails[slot] == node) tails[slot] = prev;
+    }
+
+    // Every half turn the wheel reaches further; overflow events that are
+    // now in reach move in, in the order they were scheduled
+    void cascade() {
+        horizon = tick + SCHED_WHEEL_SLOTS;
+        uint16_t n = overflowHead;
+        overflowHead = SCHED_NONE;
+        overflowTail = SCHED_NONE;
+        while (n != SCHED_NONE) {
+            uint16_t next = pool[n].next;
+            insert(n);
+            n = next;
+        }
+    }
+};
+
+#endif // MINTYSYNTH_EVENTSCHEDULER_H
@@ -0,0 +1,118 @@
+/*
+ * MintySynth Input Decoder
+ *
+ * Turns raw key scans into press and release events. A scan is one bit
+ * per key (1 = down), so the whole 4x4 matrix and the direct buttons
+ * fit in one word and every key is decoded with a few bit operations
+ * instead of a loop over per-key flags.
+ *
+ * KeyDebouncer sits in front of it for raw switch readings: a key only
+ * changes state once its contact has stopped bouncing, and the change is
+ * stamped with the time of its first edge.
+ *
+ * Header only; the scan itself (GPIO) stays with the caller, or with
+ * InputScanner.
+ */
+
+#ifndef MINTYSYNTH_INPUTDECODER_H
+#define MINTYSYNTH_INPUTDECODER_H
+
+#include <Arduino.h>
+
+#define INPUT_MAX_KEYS      32
+#define INPUT_DEBOUNCE_US   5000    // Contact must hold a level this long to count
+
+// Key bit for row/column of a matrix with `cols` columns
+constexpr uint32_t inputMatrixBit(uint8_t row, uint8_t col, uint8_t cols) {
+    return 1UL << (row * cols + col);
+}
+
+class KeyDecoder {
+public:
+    KeyDecoder() : down(0), pressed(0), released(0) {}
+
+    // Feeds one scan; returns the keys that went down since the last one
+    uint32_t update(uint32_t scan) {
+        uint32_t changed = scan ^ down;
+        pressed = changed & scan;
+        released = changed & down;
+        down = scan;
+        return pressed;
+    }
+
+    uint32_t getDown() const { return down; }
+    uint32_t getPressed() const { return pressed; }
+    uint32_t getReleased() const { return released; }
+    bool isDown(uint8_t key) const { return (down >> key) & 1; }
+
+    // Lowest key in mask, removing it; INPUT_MAX_KEYS once mask is empty.
+    // Walks only the keys that changed: while (mask) handle(nextKey(mask));
+    static uint8_t nextKey(uint32_t& mask) {
+        if (!mask) return INPUT_MAX_KEYS;
+        uint8_t key = (uint8_t)__builtin_ctz(mask);
+        mask &= mask - 1;
+        return key;
+    }
+
+private:
+    uint32_t down;
+    uint32_t pressed;
+    uint32_t released;
+};
+
+// Per-key debounce state machine. A key is either stable or settling:
+// any edge starts (or restarts) settling, and once the raw level has held
+// for debounceUs the key either takes the new level (a press or release,
+// dated from the first edge) or goes back to stable unchanged (a glitch).
+// Time based, so it does not depend on how often the keys are scanned.
+class KeyDebouncer {
+public:
+    KeyDebouncer(uint32_t holdUs = INPUT_DEBOUNCE_US)
+        : debounceUs(holdUs), raw(0), down(0), settling(0) {
+        memset(edgeUs, 0, sizeof(edgeUs));
+        memset(changeUs, 0, sizeof(changeUs));
+    }
+
+    // Feeds one raw scan taken at nowUs; returns the keys whose debounced
+    // state changed. Only keys that are settling cost anything.
+    uint32_t update(uint32_t scan, uint32_t nowUs) {
+        uint32_t toggled = scan ^ raw;
+        uint32_t starting = toggled & ~settling;
+        raw = scan;
+        settling |= toggled;
+
+        while (toggled) {
+            uint8_t key = KeyDecoder::nextKey(toggled);
+            changeUs[key] = nowUs;
+            if ((starting >> key) & 1) edgeUs[key] = nowUs;
+        }
+
+        uint32_t changed = 0;
+        uint32_t waiting = settling;
+        while (waiting) {
+            uint8_t key = KeyDecoder::nextKey(waiting);
+            if (nowUs - changeUs[key] < debounceUs) continue;
+            uint32_t bit = 1UL << key;
+            settling &= ~bit;
+            changed |= bit & (raw ^ down);
+        }
+        down ^= changed;
+        return changed;
+    }
+
+    uint32_t getDown() const { return down; }
+    uint32_t getSettling() const { return settling; }
+
+    // First edge of the key's last change
+    uint32_t getEdgeUs(uint8_t key) const { return edgeUs[key]; }
+
+private:
+    uint32_t debounceUs;
+    uint32_t raw;
+    uint32_t down;
+    uint32_t settling;
+    uint32_t edgeUs[INPUT_MAX_KEYS];
+    uint32_t changeUs[INPUT_MAX_KEYS];
+};
+
+#endif // MINTYSYNTH_INPUTDECODER_H
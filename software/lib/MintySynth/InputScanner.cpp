@@ -0,0 +1,166 @@
+/*
+ * MintySynth Input Scanner Implementation
+ */
+
+#include "InputScanner.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <soc/gpio_reg.h>
+#endif
+
+InputScanner::InputScanner()
+    : driveCount(0), driveMask(0), senseCount(0), buttonCount(0), linesAreColumns(true), matrixKeys(0),
+      timer(NULL), line(0), scan(0), down(0), ticks(0), dropped(0) {
+}
+
+InputScanner::~InputScanner() {
+    end();
+}
+
+void InputScanner::setMatrix(const uint8_t* rowPins, uint8_t rowCount, const uint8_t* colPins, uint8_t colCount,
+                             bool driveColumns) {
+    const uint8_t* drive = driveColumns ? colPins : rowPins;
+    const uint8_t* sense = driveColumns ? rowPins : colPins;
+    driveCount = driveColumns ? colCount : rowCount;
+    senseCount = driveColumns ? rowCount : colCount;
+    if (driveCount > INPUT_MAX_LINES) driveCount = INPUT_MAX_LINES;
+    if (senseCount > INPUT_MAX_LINES) senseCount = INPUT_MAX_LINES;
+    if (driveCount * senseCount > INPUT_MAX_KEYS) senseCount = INPUT_MAX_KEYS / driveCount;
+
+    driveMask = 0;
+    for (uint8_t i = 0; i < driveCount; i++) {
+        drivePins[i] = drive[i];
+        driveMask |= 1ULL << drive[i];
+    }
+    for (uint8_t i = 0; i < senseCount; i++) {
+        sensePins[i] = sense[i];
+    }
+    linesAreColumns = driveColumns;
+    matrixKeys = driveCount * senseCount;
+    if (matrixKeys + buttonCount > INPUT_MAX_KEYS) buttonCount = INPUT_MAX_KEYS - matrixKeys;
+}
+
+void InputScanner::setButtons(const uint8_t* pins, uint8_t count) {
+    buttonCount = (matrixKeys + count > INPUT_MAX_KEYS) ? INPUT_MAX_KEYS - matrixKeys : count;
+    for (uint8_t i = 0; i < buttonCount; i++) {
+        buttonPins[i] = pins[i];
+    }
+}
+
+bool InputScanner::begin(uint32_t periodUs) {
+    if (timer) return false;
+
+#if defined(ARDUINO_ARCH_ESP32)
+    for (uint8_t i = 0; i < driveCount; i++) {
+        pinMode(drivePins[i], OUTPUT);
+        digitalWrite(drivePins[i], HIGH);
+    }
+    for (uint8_t i = 0; i < senseCount; i++) {
+        pinMode(sensePins[i], INPUT_PULLUP);
+    }
+    for (uint8_t i = 0; i < buttonCount; i++) {
+        pinMode(buttonPins[i], INPUT_PULLUP);
+    }
+#endif
+
+    line = 0;
+    scan = 0;
+    if (driveCount) driveLine(0);
+    return synthTimerStart(&timer, timerEntry, this, "input", periodUs);
+}
+
+void InputScanner::end() {
+    synthTimerStop(&timer);
+}
+
+void InputScanner::timerEntry(void* arg) {
+    static_cast<InputScanner*>(arg)->tick(micros());
+}
+
+uint8_t InputScanner::keyFor(uint8_t driveLine, uint8_t senseLine) {
+    return linesAreColumns ? senseLine * driveCount + driveLine : driveLine * senseCount + senseLine;
+}
+
+void InputScanner::tick(uint32_t nowUs) {
+    uint64_t pins = readPins();
+
+    // The line driven last tick has settled: read it, then drive the next
+    if (driveCount) {
+        for (uint8_t s = 0; s < senseCount; s++) {
+            uint32_t bit = 1UL << keyFor(line, s);
+            if ((pins >> sensePins[s]) & 1) {
+                scan &= ~bit;
+            } else {
+                scan |= bit;
+            }
+        }
+        line = (line + 1 < driveCount) ? line + 1 : 0;
+        driveLine(line);
+    }
+
+    // Debounced every tick, so each key is dated to the tick that read it
+    uint32_t keys = scan;
+    for (uint8_t b = 0; b < buttonCount; b++) {
+        if (!((pins >> buttonPins[b]) & 1)) keys |= 1UL << (matrixKeys + b);
+    }
+
+    uint32_t changed = debouncer.update(keys, nowUs);
+    uint32_t state = debouncer.getDown();
+    while (changed) {
+        InputEvent event;
+        event.key = KeyDecoder::nextKey(changed);
+        event.down = (state >> event.key) & 1;
+        event.us = debouncer.getEdgeUs(event.key);
+        if (!events.push(event)) dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    down.store(state, std::memory_order_release);
+    ticks.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool InputScanner::pop(InputEvent& event) {
+    return events.pop(event);
+}
+
+uint32_t InputScanner::getDown() {
+    return down.load(std::memory_order_acquire);
+}
+
+uint32_t InputScanner::getTicks() {
+    return ticks.load(std::memory_order_relaxed);
+}
+
+uint32_t InputScanner::getDropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+// -------------------------------------------------------------------------
+// GPIO: one register read per tick, set/clear registers for the lines
+// -------------------------------------------------------------------------
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+uint64_t InputScanner::readPins() {
+    return ((uint64_t)REG_READ(GPIO_IN1_REG) << 32) | REG_READ(GPIO_IN_REG);
+}
+
+void InputScanner::driveLine(uint8_t driven) {
+    uint64_t low = 1ULL << drivePins[driven];
+    uint64_t high = driveMask & ~low;
+    REG_WRITE(GPIO_OUT_W1TS_REG, (uint32_t)high);
+    REG_WRITE(GPIO_OUT1_W1TS_REG, (uint32_t)(high >> 32));
+    REG_WRITE(GPIO_OUT_W1TC_REG, (uint32_t)low);
+    REG_WRITE(GPIO_OUT1_W1TC_REG, (uint32_t)(low >> 32));
+}
+
+#else
+
+// No pins on the host: nothing pressed
+uint64_t InputScanner::readPins() {
+    return ~0ULL;
+}
+
+void InputScanner::driveLine(uint8_t driven) {
+    (void)driven;
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * MintySynth Input Scanner
+ *
+ * Scans the key matrix and the direct buttons from a periodic timer
+ * instead of the UI loop, so key latency and debounce no longer depend
+ * on how long the last display update took.
+ *
+ * Every tick reads the GPIO input registers once and drives the next
+ * matrix line: the line driven on one tick is read on the next, so the
+ * tick period is the settling time and nothing busy-waits. The keys go
+ * through a KeyDebouncer on every tick, and every press or release lands
+ * in a lock-free queue as an InputEvent stamped with the time of its
+ * first edge, to within one full scan (one tick per line).
+ *
+ * Pin access is virtual: a host tool overrides readPins() and driveLine()
+ * with a simulated trace and calls tick() on its own clock.
+ */
+
+#ifndef MINTYSYNTH_INPUTSCANNER_H
+#define MINTYSYNTH_INPUTSCANNER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "InputDecoder.h"
+#include "SpscQueue.h"
+#include "SynthPlatform.h"
+
+#define INPUT_SCAN_PERIOD_US    250     // One matrix line per tick, a 4-line matrix every 1 ms
+#define INPUT_EVENT_QUEUE_SIZE  32
+#define INPUT_MAX_LINES         8
+
+struct InputEvent {
+    uint32_t us;            // First edge, micros()
+    uint8_t key;            // Matrix keys first, then the buttons
+    bool down;
+};
+
+class InputScanner {
+public:
+    InputScanner();
+    virtual ~InputScanner();
+
+    // Matrix keys are numbered row * colCount + col, as inputMatrixBit().
+    // With driveColumns the columns are pulled low one at a time and the
+    // rows read with pull-ups; otherwise the other way round.
+    void setMatrix(const uint8_t* rowPins, uint8_t rowCount, const uint8_t* colPins, uint8_t colCount,
+                   bool driveColumns = true);
+
+    // Active-low buttons with pull-ups, numbered after the matrix keys
+    void setButtons(const uint8_t* pins, uint8_t count);
+
+    // Sets up the pins and starts the timer
+    bool begin(uint32_t periodUs = INPUT_SCAN_PERIOD_US);
+    void end();
+
+    // One timer tick. Public so host tools can run the scanner on a
+    // simulated clock without begin().
+    void tick(uint32_t nowUs);
+
+    // Consumer side (one task)
+    bool pop(InputEvent& event);
+
+    uint32_t getDown();         // Debounced, one bit per key
+    uint32_t getTicks();        // Timer ticks so far
+    uint32_t getDropped();      // Events lost to a full queue
+
+protected:
+    // Input levels, bit n = GPIO n
+    virtual uint64_t readPins();
+    // Pulls one drive line low and the others high
+    virtual void driveLine(uint8_t line);
+
+private:
+    uint8_t drivePins[INPUT_MAX_LINES];
+    uint8_t driveCount;
+    uint64_t driveMask;
+    uint8_t sensePins[INPUT_MAX_LINES];
+    uint8_t senseCount;
+    uint8_t buttonPins[INPUT_MAX_KEYS];
+    uint8_t buttonCount;
+    bool linesAreColumns;
+    uint8_t matrixKeys;
+
+    SynthTimer timer;
+    uint8_t line;               // Driven since the last tick
+    uint32_t scan;              // Built up line by line
+    KeyDebouncer debouncer;
+    SpscQueue<InputEvent, INPUT_EVENT_QUEUE_SIZE> events;
+    std::atomic<uint32_t> down;
+    std::atomic<uint32_t> ticks;
+    std::atomic<uint32_t> dropped;
+
+    uint8_t keyFor(uint8_t driveLine, uint8_t senseLine);
+    static void timerEntry(void* arg);
+};
+
+#endif // MINTYSYNTH_INPUTSCANNER_H
@@ -0,0 +1,222 @@
+/*
+ * MintySynth Latency Probe
+ *
+ * Where the time goes between pressing a key and hearing it. A note-on
+ * that comes from a key carries two stamps, the key's first edge (from
+ * the scanner) and the moment the UI sent it; the render side adds the
+ * end of the block that first rendered the note and the hand-off of its
+ * DMA buffer, and works out when that buffer reaches the DAC from the
+ * output lead. Each stage goes into a histogram:
+ *
+ *   key>note      debounce and UI loop, up to the note-on being queued
+ *   note>render   command queue, up to the first block with the note
+ *   render>dma    rest of the DMA buffer, up to commit()
+ *   dma>dac       output lead, up to the note's first frame playing
+ *   key>dac       all of it
+ *
+ * The histograms are log-linear: exact below 16 us, then eight buckets
+ * per power of two (12.5% wide), up to LATENCY_MAX_US. Min and max are
+ * exact; percentiles are bucket midpoints. Each histogram has one writer
+ * (the UI task for key>note, the render task for the rest) and is read
+ * from anywhere without locks; reset() while notes are being stamped may
+ * leave one of them half counted.
+ *
+ * Header only, so the sketches can use it with their own audio loop.
+ */
+
+#ifndef MINTYSYNTH_LATENCYPROBE_H
+#define MINTYSYNTH_LATENCYPROBE_H
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <atomic>
+
+#define LATENCY_SUB_BITS      3                                   // 8 buckets per power of two
+#define LATENCY_MAX_US        ((1UL << 24) - 1)                   // 16.7 s, longer counts as this
+#define LATENCY_BUCKETS       ((24 - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+#define LATENCY_PENDING       8                                   // Stamped notes per DMA buffer
+
+enum LatencyStage {
+    LATENCY_KEY_TO_NOTE = 0,
+    LATENCY_NOTE_TO_RENDER,
+    LATENCY_RENDER_TO_DMA,
+    LATENCY_DMA_TO_DAC,
+    LATENCY_KEY_TO_DAC,
+    LATENCY_STAGES
+};
+
+struct LatencyStats {
+    uint32_t count;
+    uint32_t minUs;
+    uint32_t p50Us;
+    uint32_t p99Us;
+    uint32_t maxUs;
+};
+
+class LatencyHistogram {
+public:
+    LatencyHistogram() {
+        reset();
+    }
+
+    void reset() {
+        for (int b = 0; b < LATENCY_BUCKETS; b++) buckets[b].store(0, std::memory_order_relaxed);
+        minUs.store(UINT32_MAX, std::memory_order_relaxed);
+        maxUs.store(0, std::memory_order_relaxed);
+        count.store(0, std::memory_order_release);
+    }
+
+    // Writer side
+    void record(uint32_t us) {
+        if (us > LATENCY_MAX_US) us = LATENCY_MAX_US;
+        uint16_t b = bucketOf(us);
+        buckets[b].store(buckets[b].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (us < minUs.load(std::memory_order_relaxed)) minUs.store(us, std::memory_order_relaxed);
+        if (us > maxUs.load(std::memory_order_relaxed)) maxUs.store(us, std::memory_order_relaxed);
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void getStats(LatencyStats& stats) const {
+        stats.count = count.load(std::memory_order_acquire);
+        stats.minUs = stats.count ? minUs.load(std::memory_order_relaxed) : 0;
+        stats.maxUs = maxUs.load(std::memory_order_relaxed);
+        stats.p50Us = percentile(stats, 50);
+        stats.p99Us = percentile(stats, 99);
+    }
+
+    // Log-linear bucket: exact below 2 << LATENCY_SUB_BITS, then the top
+    // LATENCY_SUB_BITS + 1 bits of the value
+    static uint16_t bucketOf(uint32_t us) {
+        if (us < (2UL << LATENCY_SUB_BITS)) return (uint16_t)us;
+        uint8_t shift = (uint8_t)(31 - __builtin_clz(us) - LATENCY_SUB_BITS);
+        return (uint16_t)(((shift + 1) << LATENCY_SUB_BITS) + ((us >> shift) & ((1UL << LATENCY_SUB_BITS) - 1)));
+    }
+
+    static uint32_t bucketFloor(uint16_t bucket) {
+        if (bucket < (2UL << LATENCY_SUB_BITS)) return bucket;
+        uint8_t shift = (uint8_t)((bucket >> LATENCY_SUB_BITS) - 1);
+        return ((1UL << LATENCY_SUB_BITS) + (bucket & ((1UL << LATENCY_SUB_BITS) - 1))) << shift;
+    }
+
+    static uint32_t bucketWidth(uint16_t bucket) {
+        if (bucket < (2UL << LATENCY_SUB_BITS)) return 1;
+        return 1UL << ((bucket >> LATENCY_SUB_BITS) - 1);
+    }
+
+private:
+    std::atomic<uint32_t> buckets[LATENCY_BUCKETS];
+    std::atomic<uint32_t> minUs;
+    std::atomic<uint32_t> maxUs;
+    std::atomic<uint32_t> count;
+
+    // Midpoint of the bucket holding the percent'th value, within min..max
+    uint32_t percentile(const LatencyStats& stats, uint32_t percent) const {
+        if (!stats.count) return 0;
+        uint32_t rank = (uint32_t)(((uint64_t)stats.count * percent + 99) / 100);
+        uint32_t seen = 0;
+        for (uint16_t b = 0; b < LATENCY_BUCKETS; b++) {
+            seen += buckets[b].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                uint32_t us = bucketFloor(b) + bucketWidth(b) / 2;
+                return constrain(us, stats.minUs, stats.maxUs);
+            }
+        }
+        return stats.maxUs;
+    }
+};
+
+class LatencyProbe {
+public:
+    LatencyProbe() : pendingCount(0), renderedCount(0) {}
+
+    void reset() {
+        for (int s = 0; s < LATENCY_STAGES; s++) stages[s].reset();
+    }
+
+    // UI side: a note-on for the key pressed at keyUs is being queued.
+    // Returns the send stamp to go with it.
+    uint32_t noteSent(uint32_t keyUs) {
+        uint32_t nowUs = micros();
+        stages[LATENCY_KEY_TO_NOTE].record(nowUs - keyUs);
+        return nowUs;
+    }
+
+    // Render side: the note-on was applied before rendering the block
+    // that starts `frame` frames into the current DMA buffer
+    void noteApplied(uint32_t keyUs, uint32_t sentUs, uint32_t frame) {
+        if (pendingCount >= LATENCY_PENDING) return;
+        Pending& note = pending[pendingCount++];
+        note.keyUs = keyUs;
+        note.sentUs = sentUs;
+        note.renderedUs = 0;
+        note.frame = frame;
+    }
+
+    // Render side: the block is rendered, so are the notes applied before it
+    void blockRendered() {
+        if (renderedCount == pendingCount) return;
+        uint32_t nowUs = micros();
+        for (; renderedCount < pendingCount; renderedCount++) {
+            pending[renderedCount].renderedUs = nowUs;
+            stages[LATENCY_NOTE_TO_RENDER].record(nowUs - pending[renderedCount].sentUs);
+        }
+    }
+
+    // Render side: the DMA buffer is committed and will start playing at
+    // dacUs (with a sink and no DMA ring, pass the hand-off time)
+    void bufferCommitted(uint32_t dacUs, uint32_t sampleRate) {
+        if (!pendingCount) return;
+        uint32_t nowUs = micros();
+        for (uint8_t i = 0; i < renderedCount; i++) {
+            const Pending& note = pending[i];
+            uint32_t playUs = dacUs + (uint32_t)((uint64_t)note.frame * 1000000ULL / sampleRate);
+            stages[LATENCY_RENDER_TO_DMA].record(nowUs - note.renderedUs);
+            stages[LATENCY_DMA_TO_DAC].record((int32_t)(playUs - nowUs) > 0 ? playUs - nowUs : 0);
+            stages[LATENCY_KEY_TO_DAC].record(playUs - note.keyUs);
+        }
+        pendingCount = 0;
+        renderedCount = 0;
+    }
+
+    void getStats(uint8_t stage, LatencyStats& stats) const {
+        if (stage < LATENCY_STAGES) {
+            stages[stage].getStats(stats);
+        } else {
+            memset(&stats, 0, sizeof(stats));
+        }
+    }
+
+    static const char* getStageName(uint8_t stage) {
+        static const char* const names[LATENCY_STAGES] = {
+            "key>note", "note>render", "render>dma", "dma>dac", "key>dac"
+        };
+        return stage < LATENCY_STAGES ? names[stage] : "";
+    }
+
+    // One report line for the stage, times in ms
+    int format(uint8_t stage, char* text, size_t size) const {
+        LatencyStats stats;
+        getStats(stage, stats);
+        return snprintf(text, size, "%-12s n %-6lu min %3lu.%02lu  p50 %3lu.%02lu  p99 %3lu.%02lu  max %3lu.%02lu ms",
+                        getStageName(stage), (unsigned long)stats.count,
+                        (unsigned long)(stats.minUs / 1000), (unsigned long)(stats.minUs / 10 % 100),
+                        (unsigned long)(stats.p50Us / 1000), (unsigned long)(stats.p50Us / 10 % 100),
+                        (unsigned long)(stats.p99Us / 1000), (unsigned long)(stats.p99Us / 10 % 100),
+                        (unsigned long)(stats.maxUs / 1000), (unsigned long)(stats.maxUs / 10 % 100));
+    }
+
+private:
+    struct Pending {
+        uint32_t keyUs;
+        uint32_t sentUs;
+        uint32_t renderedUs;
+        uint32_t frame;
+    };
+
+    LatencyHistogram stages[LATENCY_STAGES];
+    Pending pending[LATENCY_PENDING];       // Render side, this DMA buffer
+    uint8_t pendingCount;
+    uint8_t renderedCount;                   // Of those, rendered
+};
+
+#endif // MINTYSYNTH_LATENCYPROBE_H
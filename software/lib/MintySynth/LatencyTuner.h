@@ -0,0 +1,94 @@
+/*
+ * MintySynth Latency Tuner
+ *
+ * Picks the output lead: how many DMA buffers ahead of the DAC the
+ * renderer works (see AudioOutput::setLead), which is the audio latency.
+ * Fed the render time of every buffer, it grows the lead at once when a
+ * buffer came close to its deadline or the output underran, and shrinks
+ * it one buffer at a time after a quiet window in which the worst render
+ * time (with margin) would still have fit, so it settles on the lowest
+ * latency that stays underrun-free for the current load.
+ *
+ * Header only, so the sketches can use it with their own audio loop.
+ */
+
+#ifndef MINTYSYNTH_LATENCYTUNER_H
+#define MINTYSYNTH_LATENCYTUNER_H
+
+#include <Arduino.h>
+
+#define LATENCY_MARGIN_PERCENT  150     // Worst render time is budgeted at 1.5x
+#ifndef LATENCY_SLACK_US
+#define LATENCY_SLACK_US        300     // Wake-up jitter: TX done interrupt to render task
+#endif
+#define LATENCY_HOLD_WINDOWS    8       // Windows without shrinking after the lead grew
+
+class LatencyTuner {
+public:
+    LatencyTuner() {
+        begin(1, 1000, 1);
+    }
+
+    // maxLead: buffers in the DMA ring - 1. Starts there, the safe end.
+    // windowBuffers: buffers between shrink decisions (a fraction of a second).
+    void begin(uint8_t maxLead, uint32_t bufferPeriodUs, uint16_t windowBuffers) {
+        limit = maxLead ? maxLead : 1;
+        lead = limit;
+        periodUs = bufferPeriodUs;
+        window = windowBuffers ? windowBuffers : 1;
+        count = 0;
+        worstUs = 0;
+        lastWorstUs = 0;
+        hold = LATENCY_HOLD_WINDOWS;
+    }
+
+    // One buffer rendered in renderUs; underrun if the output played a
+    // buffer late since the last call. Returns the lead to use from now on.
+    uint8_t update(uint32_t renderUs, bool underrun) {
+        if (renderUs > worstUs) worstUs = renderUs;
+
+        if (underrun || neededUs(renderUs) > (uint32_t)lead * periodUs) {
+            if (lead < limit) lead++;
+            hold = LATENCY_HOLD_WINDOWS;
+            endWindow();
+            return lead;
+        }
+
+        if (++count >= window) {
+            if (hold) {
+                hold--;
+            } else if (lead > 1 && neededUs(worstUs) <= (uint32_t)(lead - 1) * periodUs) {
+                lead--;
+            }
+            endWindow();
+        }
+        return lead;
+    }
+
+    uint8_t getLead() const { return lead; }
+    uint8_t getMaxLead() const { return limit; }
+    uint32_t getLatencyUs() const { return (uint32_t)lead * periodUs; }
+    uint32_t getWorstUs() const { return lastWorstUs; }     // Worst render time of the last window
+
+private:
+    uint8_t lead;
+    uint8_t limit;
+    uint32_t periodUs;
+    uint16_t window;
+    uint16_t count;
+    uint32_t worstUs;
+    uint32_t lastWorstUs;
+    uint8_t hold;
+
+    static uint32_t neededUs(uint32_t renderUs) {
+        return renderUs * LATENCY_MARGIN_PERCENT / 100 + LATENCY_SLACK_US;
+    }
+
+    void endWindow() {
+        lastWorstUs = worstUs;
+        worstUs = 0;
+        count = 0;
+    }
+};
+
+#endif // MINTYSYNTH_LATENCYTUNER_H
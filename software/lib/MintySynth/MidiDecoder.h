@@ -0,0 +1,236 @@
+/*
+ * MintySynth MIDI Decoder
+ *
+ * Byte-at-a-time MIDI parsing and the timing that turns a message's
+ * arrival into the sample frame it plays on, kept apart from the ports
+ * (MidiInput) so host tools can run a recorded byte stream through them.
+ *
+ *   MidiDecoder   one per port: running status, real-time bytes in the
+ *                 middle of a message, system exclusive skipped. Each
+ *                 message is stamped with the arrival of its last byte,
+ *                 when it can first be played.
+ *   MidiTimeline  render side: a message that arrived some time into the
+ *                 last buffer plays the same time into the next one, so
+ *                 every message is one buffer late and the jitter is
+ *                 only that of the stamps, not of the block it lands in
+ *   midiToEvent   what the synth plays for a message, as a SynthEvent
+ *
+ * Header only, so the sketches can use it with their own audio loop.
+ */
+
+#ifndef MINTYSYNTH_MIDIDECODER_H
+#define MINTYSYNTH_MIDIDECODER_H
+
+#include <Arduino.h>
+#include "EventScheduler.h"
+
+#define MIDI_NOTE_OFF         0x80
+#define MIDI_NOTE_ON          0x90
+#define MIDI_POLY_PRESSURE    0xA0
+#define MIDI_CONTROL_CHANGE   0xB0
+#define MIDI_PROGRAM_CHANGE   0xC0
+#define MIDI_CHANNEL_PRESSURE 0xD0
+#define MIDI_PITCH_BEND       0xE0
+#define MIDI_SYSEX            0xF0
+#define MIDI_SYSEX_END        0xF7
+#define MIDI_CLOCK            0xF8
+#define MIDI_START            0xFA
+#define MIDI_CONTINUE         0xFB
+#define MIDI_STOP             0xFC
+
+#define MIDI_CC_ALL_SOUND_OFF 120
+#define MIDI_CC_ALL_NOTES_OFF 123
+
+struct MidiMessage {
+    uint32_t us;            // Arrival of the last byte, micros()
+    uint8_t status;         // Type and channel, or a system message
+    uint8_t data1;
+    uint8_t data2;
+    uint8_t port;
+};
+
+// Type without the channel; system messages come back whole
+inline uint8_t midiType(const MidiMessage& message) {
+    return message.status < 0xF0 ? message.status & 0xF0 : message.status;
+}
+
+inline uint8_t midiChannel(const MidiMessage& message) {
+    return message.status & 0x0F;
+}
+
+// Note-on with velocity 0 is a note-off
+inline bool midiIsNoteOff(const MidiMessage& message) {
+    uint8_t type = midiType(message);
+    return type == MIDI_NOTE_OFF || (type == MIDI_NOTE_ON && message.data2 == 0);
+}
+
+// What a message plays as on `frame`; false for what the synth does not
+// take. Channels below `lanes` play their lane. Note on and off come as
+// notes, all notes/sound off as a parameter event carrying the controller
+// number, and start, continue and stop as one on lane 0 carrying the
+// status.
+inline bool midiToEvent(const MidiMessage& message, uint64_t frame, uint8_t lanes, SynthEvent& event) {
+    uint8_t type = midiType(message);
+    event.frame = frame;
+    event.type = EVENT_PARAM;
+    event.voice = midiChannel(message);
+    event.data = message.data1;
+    event.velocity = message.data2;
+    event.value = 0;
+
+    if (type == MIDI_NOTE_ON || type == MIDI_NOTE_OFF) {
+        event.type = midiIsNoteOff(message) ? EVENT_NOTE_OFF : EVENT_NOTE_ON;
+        event.value = message.data1;
+        return event.voice < lanes;
+    }
+    if (type == MIDI_CONTROL_CHANGE) {
+        return event.voice < lanes &&
+               (message.data1 == MIDI_CC_ALL_SOUND_OFF || message.data1 == MIDI_CC_ALL_NOTES_OFF);
+    }
+    if (type == MIDI_START || type == MIDI_CONTINUE || type == MIDI_STOP) {
+        event.voice = 0;
+        event.data = type;
+        return true;
+    }
+    return false;
+}
+
+class MidiDecoder {
+public:
+    MidiDecoder() {
+        reset();
+    }
+
+    void reset() {
+        running = 0;
+        expected = 0;
+        count = 0;
+        sysex = false;
+        errors = 0;
+    }
+
+    // One byte received at `us`. True when it completes a message, which
+    // goes into `message`. Real-time bytes (clock, start, stop) complete at
+    // once, even in the middle of another message.
+    bool decode(uint8_t byte, uint32_t us, MidiMessage& message) {
+        if (byte >= 0xF8) {
+            if (byte == 0xF9 || byte == 0xFD) return false;     // Undefined
+            message.us = us;
+            message.status = byte;
+            message.data1 = 0;
+            message.data2 = 0;
+            return true;
+        }
+
+        if (byte & 0x80) {
+            if (count) errors++;            // Cut short by the next status
+            count = 0;
+            sysex = (byte == MIDI_SYSEX);
+            if (byte < 0xF0) {
+                running = byte;
+                expected = (byte & 0xE0) == 0xC0 ? 1 : 2;   // Program change, channel pressure
+                return false;
+            }
+
+            // System common: cancels running status
+            running = 0;
+            switch (byte) {
+                case 0xF1:
+                case 0xF3:
+                    running = byte;
+                    expected = 1;
+                    return false;
+                case 0xF2:
+                    running = byte;
+                    expected = 2;
+                    return false;
+                case 0xF6:
+                    message.us = us;
+                    message.status = byte;
+                    message.data1 = 0;
+                    message.data2 = 0;
+                    return true;
+                default:
+                    return false;           // Sysex start and end, undefined
+            }
+        }
+
+        // Data byte
+        if (sysex) return false;
+        if (!running) {
+            errors++;
+            return false;
+        }
+        data[count++] = byte;
+        if (count < expected) return false;
+
+        message.us = us;
+        message.status = running;
+        message.data1 = data[0];
+        message.data2 = (expected > 1) ? data[1] : 0;
+        count = 0;
+        if (running >= 0xF0) running = 0;   // System common does not run
+        return true;
+    }
+
+    // Data bytes with no status to go with them, and messages cut short
+    uint32_t getErrors() const { return errors; }
+
+private:
+    uint8_t running;            // Status the data bytes belong to, 0 if none
+    uint8_t expected;           // Data bytes per message
+    uint8_t count;              // Data bytes so far
+    uint8_t data[2];
+    bool sysex;
+    uint32_t errors;
+};
+
+class MidiTimeline {
+public:
+    MidiTimeline() {
+        begin(44100, 0);
+    }
+
+    void begin(uint32_t rate, uint32_t nowUs) {
+        sampleRate = rate;
+        windowUs = nowUs;
+        lastUs = nowUs;
+        windowFrame = 0;
+        lastFrame = 0;
+    }
+
+    // Render side, before each buffer: the frame it starts on and micros()
+    void startBuffer(uint64_t frame, uint32_t nowUs) {
+        windowUs = lastUs;
+        windowFrame = frame;
+        lastUs = nowUs;
+    }
+
+    // Frame a message stamped `us` plays on: as far into this buffer as it
+    // arrived after the last one started. Stamps from before that play at
+    // the start of the buffer; later ones fall into the buffers after it.
+    // Call in stamp order: a message never plays before one that arrived
+    // ahead of it, even when a late buffer stretched the last window.
+    uint64_t frameOf(uint32_t us) {
+        int32_t since = (int32_t)(us - windowUs);
+        uint64_t frame = windowFrame;
+        if (since > 0) frame += (uint64_t)since * sampleRate / 1000000UL;
+        if (frame < lastFrame) frame = lastFrame;
+        lastFrame = frame;
+        return frame;
+    }
+
+    // Stamped before the last buffer started: it plays late
+    bool isLate(uint32_t us) const {
+        return (int32_t)(us - windowUs) < 0;
+    }
+
+private:
+    uint32_t sampleRate;
+    uint32_t windowUs;          // Start of the last buffer
+    uint32_t lastUs;            // Start of this one
+    uint64_t windowFrame;
+    uint64_t lastFrame;         // Of the last message placed
+};
+
+#endif // MINTYSYNTH_MIDIDECODER_H
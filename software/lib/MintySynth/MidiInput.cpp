@@ -0,0 +1,104 @@
+/*
+ * MintySynth MIDI Input Implementation
+ */
+
+#include "MidiInput.h"
+
+MidiInput::MidiInput() : portCount(0), timer(NULL), messages(0), errors(0), dropped(0) {
+#if defined(ARDUINO_ARCH_ESP32)
+    for (uint8_t i = 0; i < MIDI_MAX_PORTS; i++) streams[i] = NULL;
+#endif
+}
+
+MidiInput::~MidiInput() {
+    end();
+}
+
+bool MidiInput::begin(uint32_t periodUs) {
+    return synthTimerStart(&timer, timerEntry, this, "midi", periodUs);
+}
+
+void MidiInput::end() {
+    synthTimerStop(&timer);
+}
+
+void MidiInput::timerEntry(void* arg) {
+    static_cast<MidiInput*>(arg)->tick(micros());
+}
+
+void MidiInput::tick(uint32_t nowUs) {
+    uint8_t ports = portCount.load(std::memory_order_acquire);
+    uint32_t errorCount = 0;
+
+    for (uint8_t port = 0; port < ports; port++) {
+        MidiDecoder& decoder = decoders[port];
+        for (uint8_t n = 0; n < MIDI_BYTES_PER_TICK; n++) {
+            int byte = readPort(port);
+            if (byte < 0) break;
+
+            MidiMessage message;
+            if (!decoder.decode((uint8_t)byte, nowUs, message)) continue;
+            message.port = port;
+            if (queue.push(message)) {
+                messages.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        errorCount += decoder.getErrors();
+    }
+    errors.store(errorCount, std::memory_order_relaxed);
+}
+
+bool MidiInput::pop(MidiMessage& message) {
+    return queue.pop(message);
+}
+
+uint32_t MidiInput::getMessages() {
+    return messages.load(std::memory_order_relaxed);
+}
+
+uint32_t MidiInput::getErrors() {
+    return errors.load(std::memory_order_relaxed);
+}
+
+uint32_t MidiInput::getDropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+// -------------------------------------------------------------------------
+// Ports: Arduino streams on the ESP32, a recording on the host
+// -------------------------------------------------------------------------
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+int8_t MidiInput::attachUart(HardwareSerial& uart, int8_t rxPin) {
+    uart.begin(MIDI_BAUD, SERIAL_8N1, rxPin, -1);
+    uart.setRxFIFOFull(1);
+    return attach(uart);
+}
+
+int8_t MidiInput::attach(Stream& stream) {
+    uint8_t port = portCount.load(std::memory_order_relaxed);
+    if (port >= MIDI_MAX_PORTS) return -1;
+    streams[port] = &stream;
+    portCount.store(port + 1, std::memory_order_release);
+    return (int8_t)port;
+}
+
+// Only what is already waiting: the timer callback must not block
+int MidiInput::readPort(uint8_t port) {
+    Stream* stream = streams[port];
+    if (!stream || stream->available() <= 0) return -1;
+    return stream->read();
+}
+
+#else
+
+// No ports on the host: a tool overrides this with its recording
+int MidiInput::readPort(uint8_t port) {
+    (void)port;
+    return -1;
+}
+
+#endif
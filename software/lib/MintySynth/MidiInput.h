@@ -0,0 +1,81 @@
+/*
+ * MintySynth MIDI Input
+ *
+ * MIDI in from a UART (DIN, 31250 baud) and USB CDC, read from a
+ * periodic timer like the key scanner so no message waits for the UI
+ * loop. Every port has its own MidiDecoder (running status is per
+ * cable); each byte is stamped with the tick that read it, so a message
+ * is dated to within one period, and complete messages land in a
+ * lock-free queue for the render task (AudioPipeline::setMidi), which
+ * places them on their frame with a MidiTimeline.
+ *
+ * Port access is virtual: a host tool overrides readPort() with a
+ * recorded byte stream and calls tick() on its own clock.
+ */
+
+#ifndef MINTYSYNTH_MIDIINPUT_H
+#define MINTYSYNTH_MIDIINPUT_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "MidiDecoder.h"
+#include "SpscQueue.h"
+#include "SynthPlatform.h"
+
+#define MIDI_POLL_PERIOD_US   500     // 16 bytes of DIN MIDI
+#define MIDI_QUEUE_SIZE       64
+#define MIDI_MAX_PORTS        2
+#define MIDI_BAUD             31250
+#define MIDI_BYTES_PER_TICK   64      // Read at most this many per port per tick
+
+class MidiInput {
+public:
+    MidiInput();
+    virtual ~MidiInput();
+
+#if defined(ARDUINO_ARCH_ESP32)
+    // DIN MIDI: receive only, on rxPin, interrupting on every byte so it
+    // does not wait in the UART FIFO. Returns the port number, -1 if full.
+    int8_t attachUart(HardwareSerial& uart, int8_t rxPin);
+
+    // USB CDC or any other stream already running. Any time, also after
+    // begin(); nothing else may read the stream from then on.
+    int8_t attach(Stream& stream);
+#endif
+
+    bool begin(uint32_t periodUs = MIDI_POLL_PERIOD_US);
+    void end();
+
+    // One timer tick: everything waiting on the ports. Public so host
+    // tools can run the input on a simulated clock without begin().
+    void tick(uint32_t nowUs);
+
+    // Consumer side (one task, the render task through AudioPipeline)
+    bool pop(MidiMessage& message);
+
+    uint32_t getMessages();     // Decoded so far
+    uint32_t getErrors();       // Stray data bytes and cut-short messages
+    uint32_t getDropped();      // Lost to a full queue
+
+protected:
+    // Next byte waiting on the port, -1 if none
+    virtual int readPort(uint8_t port);
+
+    // Ports ready to read; a host tool sets it for its own readPort()
+    std::atomic<uint8_t> portCount;
+
+private:
+#if defined(ARDUINO_ARCH_ESP32)
+    Stream* streams[MIDI_MAX_PORTS];
+#endif
+    MidiDecoder decoders[MIDI_MAX_PORTS];
+    SynthTimer timer;
+    SpscQueue<MidiMessage, MIDI_QUEUE_SIZE> queue;
+    std::atomic<uint32_t> messages;
+    std::atomic<uint32_t> errors;
+    std::atomic<uint32_t> dropped;
+
+    static void timerEntry(void* arg);
+};
+
+#endif // MINTYSYNTH_MIDIINPUT_H
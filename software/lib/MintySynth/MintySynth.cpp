@@ -5,97 +5,191 @@
  */
 
 #include "MintySynth.h"
-#include <math.h>
+#include "Wavetables.h"
+#include <string.h>
 
-// Waveform tables (simplified versions - full tables would be in PROGMEM)
-const float SINE_TABLE[256] = {
-    // Sine wave lookup table would go here
-    // For now, we'll calculate on the fly
+// CPU cycle counter used for render profiling
+static inline uint32_t readCycleCount() {
+#if defined(ARDUINO_ARCH_ESP32)
+    return ESP.getCycleCount();
+#else
+    return 0;   // No cycle counter on this target, profiling reads 0
+#endif
+}
+
+// Segment rates for each EnvelopeType, shaped after the original curves
+// (linear ramps, exp(-3t) pluck, 2-unit hold). The time unit is 1000
+// samples at 44.1 kHz and follows SAMPLE_RATE.
+static constexpr uint32_t ENVELOPE_UNIT = (SAMPLE_RATE * 10UL) / 441;
+
+struct EnvelopeRateTable {
+    EnvelopeRates type[NUM_ENVELOPES];
 };
 
+constexpr EnvelopeRateTable buildEnvelopeRates() {
+    EnvelopeRateTable table = {};
+    for (int i = 0; i < NUM_ENVELOPES; i++) {
+        EnvelopeRates& rates = table.type[i];
+        rates.attackStep = ENVELOPE_FULL_SCALE;
+        rates.holdTicks = 0;
+        rates.decayExponential = false;
+        rates.decayStep = envelopeStep(ENVELOPE_FULL_SCALE, ENVELOPE_UNIT);
+        rates.decayCoef = 0;
+        rates.sustainLevel = 0;
+        rates.releaseTicks = 0;
+        rates.gateTicks = 0;     // Voices end at their note length
+    }
+    
+    table.type[ENV_ATTACK].attackStep = envelopeStep(ENVELOPE_FULL_SCALE, ENVELOPE_UNIT);
+    table.type[ENV_ATTACK].sustainLevel = ENVELOPE_FULL_SCALE;
+    
+    table.type[ENV_PLUCK].decayExponential = true;
+    table.type[ENV_PLUCK].decayCoef = envelopeCoef(ENVELOPE_UNIT / 3.0f);
+    
+    table.type[ENV_LONG].holdTicks = envelopeTicks(2 * ENVELOPE_UNIT);
+    table.type[ENV_LONG].decayExponential = true;
+    table.type[ENV_LONG].decayCoef = envelopeCoef((float)ENVELOPE_UNIT);
+    
+    return table;
+}
+
+static constexpr EnvelopeRateTable envelopeRates = buildEnvelopeRates();
+
+// Note -> tuning word for every SynthTuning at SAMPLE_RATE
+static constexpr SynthTuningBank tuningBank SYNTH_TABLE_ATTR = synthMakeTuningBank(SAMPLE_RATE);
+
+// Renders `frames` samples of one voice into its block. Everything that
+// depends on the voice parameters is resolved by the caller once per
+// block; the envelope only adds an increment per sample.
+static void renderVoice(const int16_t* table, uint32_t& phase, uint32_t ftw,
+                        EnvelopeGenerator& envelope, float gain, float gainStep,
+                        int16_t* out, size_t frames) {
+    uint32_t p = phase;
+    float g = gain;
+    
+    for (size_t n = 0; n < frames; n++) {
+        int32_t sample = table[p >> WAVETABLE_SHIFT] * (int32_t)envelope.nextSample();
+        out[n] = (int16_t)(sample * g);
+        p += ftw;
+        g += gainStep;
+    }
+    
+    phase = p;
+}
+
 MintySynth::MintySynth() {
     playing = false;
-    currentStep = 0;
-    lastStepTime = 0;
+    sampleClock = 0;
+    clock.begin(SAMPLE_RATE, NUM_STEPS);
+    patternPosition.store(0);
+    songActive = false;
+    songStart = 0;
+    presets = NULL;
+    cyclesPerSample.store(0);
+    
+    SynthParamSet defaults;
     
     // Initialize voices
     for (int i = 0; i < NUM_VOICES; i++) {
-        voices[i].waveform = WAVE_SINE;
-        voices[i].pitch = 60;
-        voices[i].envelope = ENV_PLUCK;
-        voices[i].length = 50;
-        voices[i].modulation = 64;
-        voices[i].volume = 100;
-        voices[i].active = false;
+        defaults.voices[i].waveform = WAVE_SINE;
+        defaults.voices[i].pitch = 60;
+        defaults.voices[i].envelope = ENV_PLUCK;
+        defaults.voices[i].length = 50;
+        defaults.voices[i].modulation = 64;
+        defaults.voices[i].volume = 100;
+        defaults.voices[i].lfoRate = 64;
+        defaults.voices[i].lfoShape = LFO_SINE;
+        defaults.voices[i].active = false;
         
-        voicePhase[i] = 0;
-        voiceFreq[i] = 440.0;
-        voiceEnvPhase[i] = 0;
-        voiceActive[i] = false;
+        for (int slot = 0; slot < MOD_ROUTES; slot++) {
+            defaults.routes[i][slot] = modulation.getRoute(i, slot);
+        }
     }
     
-    // Initialize sequencer
-    for (int v = 0; v < NUM_VOICES; v++) {
-        for (int s = 0; s < NUM_STEPS; s++) {
-            sequence[v][s].note = 60;
-            sequence[v][s].active = false;
-            sequence[v][s].velocity = 127;
-            sequence[v][s].length = 50;
-        }
+    for (int i = 0; i < NUM_RENDER_VOICES; i++) {
+        bank.phase[i] = 0;
+        bank.ftw[i] = 0;
+        bank.envPhase[i] = 0;
+        bank.gain[i] = 0;
+        bank.level[i] = 0;
+        bank.lane[i] = 0;
+        bank.velocity[i] = 127;
+        bank.active[i] = false;
     }
     
+    // Initialize sequencer: one empty pattern, cued to repeat
+    defaults.patterns[0].clear(NUM_STEPS, 60);
+    defaults.patterns[1] = defaults.patterns[0];
+    defaults.patternSlots[0] = PATTERN_NONE;
+    defaults.patternSlots[1] = PATTERN_NONE;
+    defaults.chainPosition = 0;
+    
     // Initialize global parameters
-    globals.tempo = 120;
-    globals.swing = 0;
-    globals.scale = 0;
-    globals.transpose = 0;
-    globals.masterVolume = 100;
+    defaults.globals.tempo = 120;
+    defaults.globals.swing = 0;
+    defaults.globals.scale = 0;
+    defaults.globals.transpose = 0;
+    defaults.globals.masterVolume = 100;
+    defaults.globals.tuning = TUNING_EQUAL;
     
-    calculateStepDuration();
+    params.reset(defaults);
+    params.publish();
+    live = &params.read();
+    refreshParams();
 }
 
 void MintySynth::begin() {
-    // Initialize synthesis engine
-    updateVoiceFrequencies();
+    // Wave, pitch and envelope tables are built at compile time
 }
 
 void MintySynth::setVoiceParam(uint8_t voice, uint8_t param, uint8_t value) {
     if (voice >= NUM_VOICES) return;
     
+    VoiceParams& edit = params.edit().voices[voice];
     switch (param) {
         case PARAM_WAVEFORM:
-            voices[voice].waveform = constrain(value, 0, NUM_WAVEFORMS - 1);
+            edit.waveform = constrain(value, 0, NUM_WAVEFORMS - 1);
             break;
         case PARAM_PITCH:
-            voices[voice].pitch = constrain(value, 0, 127);
+            edit.pitch = constrain(value, 0, 127);
             break;
         case PARAM_ENVELOPE:
-            voices[voice].envelope = constrain(value, 0, 4);
+            edit.envelope = constrain(value, 0, 4);
             break;
         case PARAM_LENGTH:
-            voices[voice].length = constrain(value, 0, 127);
+            edit.length = constrain(value, 0, 127);
             break;
         case PARAM_MODULATION:
-            voices[voice].modulation = constrain(value, 0, 127);
+            edit.modulation = constrain(value, 0, 127);
             break;
         case PARAM_VOLUME:
-            voices[voice].volume = constrain(value, 0, 127);
+            edit.volume = constrain(value, 0, 127);
+            break;
+        case PARAM_LFO_RATE:
+            edit.lfoRate = constrain(value, 0, 127);
             break;
+        case PARAM_LFO_SHAPE:
+            edit.lfoShape = constrain(value, 0, NUM_LFO_SHAPES - 1);
+            break;
+        default:
+            return;
     }
-    
-    updateVoiceFrequencies();
+    params.publish();
 }
 
 uint8_t MintySynth::getVoiceParam(uint8_t voice, uint8_t param) {
     if (voice >= NUM_VOICES) return 0;
     
+    const VoiceParams& staged = params.staged().voices[voice];
     switch (param) {
-        case PARAM_WAVEFORM: return voices[voice].waveform;
-        case PARAM_PITCH: return voices[voice].pitch;
-        case PARAM_ENVELOPE: return voices[voice].envelope;
-        case PARAM_LENGTH: return voices[voice].length;
-        case PARAM_MODULATION: return voices[voice].modulation;
-        case PARAM_VOLUME: return voices[voice].volume;
+        case PARAM_WAVEFORM: return staged.waveform;
+        case PARAM_PITCH: return staged.pitch;
+        case PARAM_ENVELOPE: return staged.envelope;
+        case PARAM_LENGTH: return staged.length;
+        case PARAM_MODULATION: return staged.modulation;
+        case PARAM_VOLUME: return staged.volume;
+        case PARAM_LFO_RATE: return staged.lfoRate;
+        case PARAM_LFO_SHAPE: return staged.lfoShape;
         default: return 0;
     }
 }
@@ -103,53 +197,361 @@ uint8_t MintySynth::getVoiceParam(uint8_t voice, uint8_t param) {
 void MintySynth::triggerVoice(uint8_t voice, uint8_t note, uint8_t velocity) {
     if (voice >= NUM_VOICES) return;
     
-    voices[voice].pitch = note;
-    voiceActive[voice] = true;
-    voiceEnvPhase[voice] = 0;
-    voicePhase[voice] = 0;
+    // No refreshParams() here: playStep() holds a pattern from the live
+    // snapshot while it triggers, and parameters change once per block
+    const VoiceParams& lane = live->voices[voice];
+    
+    // Earlier notes on this lane keep sounding on their own render voices
+    uint8_t renderVoice = allocator.allocate(voice, note, bank.active, bank.level);
+    bank.lane[renderVoice] = voice;
+    bank.velocity[renderVoice] = (velocity < 127) ? velocity : 127;
+    bank.active[renderVoice] = true;
+    bank.envPhase[renderVoice] = 0;
+    bank.phase[renderVoice] = 0;
+    
+    uint8_t envelope = (lane.envelope < NUM_ENVELOPES) ? lane.envelope : ENV_PLUCK;
+    bank.envelope[renderVoice].setRates(envelopeRates.type[envelope]);
+    bank.envelope[renderVoice].start();
+    bank.gain[renderVoice] = -1.0f;
+    bank.level[renderVoice] = (lane.volume * bank.velocity[renderVoice] / 127) << 8;
+    modulation.noteOn(renderVoice);
     
-    // Calculate frequency for this note
-    voiceFreq[voice] = 440.0 * pow(2.0, (note - 69) / 12.0);
+    // Calculate tuning word for this note
+    bank.ftw[renderVoice] = noteToTuningWord(note);
 }
 
 void MintySynth::releaseVoice(uint8_t voice) {
     if (voice >= NUM_VOICES) return;
-    voiceActive[voice] = false;
+    
+    // Silence every note of this lane
+    for (int i = 0; i < NUM_RENDER_VOICES; i++) {
+        if (bank.lane[i] == voice) bank.active[i] = false;
+    }
+}
+
+void MintySynth::releaseNote(uint8_t voice, uint8_t note) {
+    if (voice >= NUM_VOICES) return;
+    
+    uint8_t renderVoice = allocator.findVoice(voice, note, bank.active);
+    if (renderVoice != NO_VOICE) bank.active[renderVoice] = false;
+}
+
+void MintySynth::setPolyphony(uint8_t voices) {
+    allocator.setPolyphony(voices);
+}
+
+void MintySynth::setStealPolicy(StealPolicy policy) {
+    allocator.setPolicy(policy);
+}
+
+void MintySynth::setSameNoteSteal(bool enabled) {
+    allocator.setSameNoteSteal(enabled);
 }
 
+void MintySynth::setModRoute(uint8_t voice, uint8_t slot, uint8_t source, uint8_t destination, int8_t amount) {
+    if (voice >= NUM_VOICES || slot >= MOD_ROUTES) return;
+    
+    ModRoute& route = params.edit().routes[voice][slot];
+    route.source = (source < NUM_MOD_SOURCES) ? source : MOD_SRC_NONE;
+    route.destination = (destination < NUM_MOD_DESTINATIONS) ? destination : MOD_DST_PITCH;
+    route.amount = (amount < -127) ? -127 : amount;
+    params.publish();
+}
+
+ModRoute MintySynth::getModRoute(uint8_t voice, uint8_t slot) {
+    if (voice >= NUM_VOICES || slot >= MOD_ROUTES) return params.staged().routes[0][0];
+    return params.staged().routes[voice][slot];
+}
+
+uint8_t MintySynth::getActiveVoiceCount() {
+    uint8_t count = 0;
+    for (int i = 0; i < NUM_RENDER_VOICES; i++) {
+        if (bank.active[i]) count++;
+    }
+    return count;
+}
+
+// Edits go to the playing pattern, and to the cued one when that is the
+// same pattern coming round again
 void MintySynth::setStep(uint8_t voice, uint8_t step, uint8_t note, bool active) {
-    if (voice >= NUM_VOICES || step >= NUM_STEPS) return;
+    if (voice >= NUM_VOICES || step >= PATTERN_MAX_STEPS) return;
+    updatePatterns();
     
-    sequence[voice][step].note = note;
-    sequence[voice][step].active = active;
+    SynthParamSet& edit = params.edit();
+    uint8_t velocity = edit.patterns[0].velocities[voice][step];
+    edit.patterns[0].setStep(voice, step, note, velocity, active);
+    if (edit.patternSlots[1] == edit.patternSlots[0]) {
+        edit.patterns[1].setStep(voice, step, note, velocity, active);
+    }
+    params.publish();
 }
 
 void MintySynth::clearStep(uint8_t voice, uint8_t step) {
-    if (voice >= NUM_VOICES || step >= NUM_STEPS) return;
-    sequence[voice][step].active = false;
+    if (voice >= NUM_VOICES || step >= PATTERN_MAX_STEPS) return;
+    updatePatterns();
+    
+    SynthParamSet& edit = params.edit();
+    edit.patterns[0].setActive(voice, step, false);
+    if (edit.patternSlots[1] == edit.patternSlots[0]) {
+        edit.patterns[1].setActive(voice, step, false);
+    }
+    params.publish();
 }
 
 bool MintySynth::isStepActive(uint8_t voice, uint8_t step) {
-    if (voice >= NUM_VOICES || step >= NUM_STEPS) return false;
-    return sequence[voice][step].active;
+    if (voice >= NUM_VOICES || step >= PATTERN_MAX_STEPS) return false;
+    return params.staged().patterns[0].isActive(voice, step);
+}
+
+void MintySynth::setPatternLength(uint8_t steps) {
+    updatePatterns();
+    
+    SynthParamSet& edit = params.edit();
+    edit.patterns[0].setLength(steps);
+    if (edit.patternSlots[1] == edit.patternSlots[0]) {
+        edit.patterns[1].setLength(steps);
+    }
+    params.publish();
+}
+
+uint8_t MintySynth::getPatternLength() {
+    return params.staged().patterns[0].length;
+}
+
+bool MintySynth::savePattern(uint8_t slot) {
+    updatePatterns();
+    
+    SynthParamSet& edit = params.edit();
+    if (!store.save(slot, edit.patterns[0])) return false;
+    edit.patternSlots[0] = slot;
+    cueNext(edit);
+    params.publish();
+    return true;
+}
+
+bool MintySynth::loadPattern(uint8_t slot) {
+    updatePatterns();
+    
+    SynthParamSet& edit = params.edit();
+    if (!store.load(slot, edit.patterns[0])) return false;
+    edit.patternSlots[0] = slot;
+    songActive = false;
+    cueNext(edit);
+    params.publish();
+    return true;
+}
+
+bool MintySynth::cuePattern(uint8_t slot) {
+    updatePatterns();
+    
+    SynthParamSet& edit = params.edit();
+    if (!store.load(slot, edit.patterns[1])) return false;
+    edit.patternSlots[1] = slot;
+    songActive = false;
+    params.publish();
+    return true;
+}
+
+void MintySynth::setSong(const SongChain& chain) {
+    updatePatterns();
+    
+    SynthParamSet& edit = params.edit();
+    song = chain;
+    songActive = true;
+    songStart = edit.chainPosition + 1;
+    cueNext(edit);
+    params.publish();
+}
+
+void MintySynth::clearSong() {
+    updatePatterns();
+    
+    SynthParamSet& edit = params.edit();
+    songActive = false;
+    cueNext(edit);
+    params.publish();
+}
+
+// The renderer has moved on to the cued pattern: it becomes the one edited
+// and the pattern after it is fetched. A UI that falls a whole pattern
+// behind hears the cued one again.
+void MintySynth::updatePatterns() {
+    uint32_t position = patternPosition.load(std::memory_order_acquire);
+    SynthParamSet& edit = params.edit();
+    if (position == edit.chainPosition) return;
+    
+    edit.patterns[0] = edit.patterns[1];
+    edit.patternSlots[0] = edit.patternSlots[1];
+    edit.chainPosition = position;
+    cueNext(edit);
+    params.publish();
+}
+
+void MintySynth::cueNext(SynthParamSet& edit) {
+    uint8_t slot = songActive ? song.slotAt(edit.chainPosition + 1 - songStart) : PATTERN_NONE;
+    if (slot != PATTERN_NONE && store.load(slot, edit.patterns[1])) {
+        edit.patternSlots[1] = slot;
+    } else {
+        edit.patterns[1] = edit.patterns[0];
+        edit.patternSlots[1] = edit.patternSlots[0];
+    }
+}
+
+PatternStore& MintySynth::getPatternStore() {
+    return store;
+}
+
+uint32_t MintySynth::getPatternPosition() {
+    return patternPosition.load(std::memory_order_acquire);
+}
+
+void MintySynth::setPresetLog(PresetLog* log) {
+    presets = log;
+}
+
+// Each section in its compact encoding; the log skips the ones whose
+// bytes have not changed since the last save
+bool MintySynth::savePreset(uint8_t slot) {
+    if (!presets) return false;
+    updatePatterns();
+    
+    const SynthParamSet& staged = params.staged();
+    uint8_t buffer[PRESET_SECTION_MAX];
+    bool ok = true;
+    
+    PresetWriter voices(buffer, sizeof(buffer));
+    for (uint8_t v = 0; v < NUM_VOICES; v++) {
+        const VoiceParams& lane = staged.voices[v];
+        voices.put8(lane.waveform);
+        voices.put8(lane.pitch);
+        voices.put8(lane.envelope);
+        voices.put8(lane.length);
+        voices.put8(lane.modulation);
+        voices.put8(lane.volume);
+        voices.put8(lane.lfoRate);
+        voices.put8(lane.lfoShape);
+    }
+    ok &= presets->write(slot, PRESET_VOICES, buffer, voices.getLength());
+    
+    PresetWriter routes(buffer, sizeof(buffer));
+    for (uint8_t v = 0; v < NUM_VOICES; v++) {
+        for (uint8_t r = 0; r < MOD_ROUTES; r++) {
+            routes.put8(staged.routes[v][r].source);
+            routes.put8(staged.routes[v][r].destination);
+            routes.put8((uint8_t)staged.routes[v][r].amount);
+        }
+    }
+    ok &= presets->write(slot, PRESET_ROUTES, buffer, routes.getLength());
+    
+    PresetWriter globals(buffer, sizeof(buffer));
+    globals.put16(staged.globals.tempo);
+    globals.put8(staged.globals.swing);
+    globals.put8(staged.globals.scale);
+    globals.put8((uint8_t)staged.globals.transpose);
+    globals.put8(staged.globals.masterVolume);
+    globals.put8(staged.globals.tuning);
+    ok &= presets->write(slot, PRESET_GLOBALS, buffer, globals.getLength());
+    
+    PresetWriter pattern(buffer, sizeof(buffer));
+    presetPutPattern(pattern, staged.patterns[0]);
+    ok &= !pattern.isOverflow() && presets->write(slot, PRESET_PATTERN, buffer, pattern.getLength());
+    return ok;
+}
+
+// Values are held to the same ranges as the setters. Only the sounds are
+// required; a missing or damaged section leaves that part as it is.
+bool MintySynth::loadPreset(uint8_t slot) {
+    if (!presets || !presets->has(slot, PRESET_VOICES)) return false;
+    updatePatterns();
+    
+    SynthParamSet& edit = params.edit();
+    uint8_t buffer[PRESET_SECTION_MAX];
+    int16_t length = presets->read(slot, PRESET_VOICES, buffer, sizeof(buffer));
+    if (length != NUM_VOICES * 8) return false;
+    
+    // Read into locals first: constrain() evaluates its argument more than once
+    PresetReader voices(buffer, length);
+    for (uint8_t v = 0; v < NUM_VOICES; v++) {
+        uint8_t value[8];
+        for (uint8_t i = 0; i < 8; i++) value[i] = voices.get8();
+        VoiceParams& lane = edit.voices[v];
+        lane.waveform = constrain(value[0], 0, NUM_WAVEFORMS - 1);
+        lane.pitch = constrain(value[1], 0, 127);
+        lane.envelope = constrain(value[2], 0, 4);
+        lane.length = constrain(value[3], 0, 127);
+        lane.modulation = constrain(value[4], 0, 127);
+        lane.volume = constrain(value[5], 0, 127);
+        lane.lfoRate = constrain(value[6], 0, 127);
+        lane.lfoShape = constrain(value[7], 0, NUM_LFO_SHAPES - 1);
+    }
+    
+    length = presets->read(slot, PRESET_ROUTES, buffer, sizeof(buffer));
+    if (length == NUM_VOICES * MOD_ROUTES * 3) {
+        PresetReader routes(buffer, length);
+        for (uint8_t v = 0; v < NUM_VOICES; v++) {
+            for (uint8_t r = 0; r < MOD_ROUTES; r++) {
+                ModRoute& route = edit.routes[v][r];
+                uint8_t source = routes.get8();
+                uint8_t destination = routes.get8();
+                int8_t amount = (int8_t)routes.get8();
+                route.source = (source < NUM_MOD_SOURCES) ? source : MOD_SRC_NONE;
+                route.destination = (destination < NUM_MOD_DESTINATIONS) ? destination : MOD_DST_PITCH;
+                route.amount = (amount < -127) ? -127 : amount;
+            }
+        }
+    }
+    
+    length = presets->read(slot, PRESET_GLOBALS, buffer, sizeof(buffer));
+    if (length == 7) {
+        PresetReader globals(buffer, length);
+        uint16_t tempo = globals.get16();
+        uint8_t swing = globals.get8();
+        uint8_t scale = globals.get8();
+        int8_t transpose = (int8_t)globals.get8();
+        uint8_t masterVolume = globals.get8();
+        uint8_t tuning = globals.get8();
+        edit.globals.tempo = constrain(tempo, 60, 200);
+        edit.globals.swing = constrain(swing, 0, 127);
+        edit.globals.scale = constrain(scale, 0, 8);
+        edit.globals.transpose = constrain(transpose, -12, 12);
+        edit.globals.masterVolume = constrain(masterVolume, 0, 127);
+        edit.globals.tuning = constrain(tuning, 0, NUM_TUNINGS - 1);
+    }
+    
+    length = presets->read(slot, PRESET_PATTERN, buffer, sizeof(buffer));
+    if (length > 0) {
+        PresetReader reader(buffer, length);
+        StepPattern loaded;
+        if (presetGetPattern(reader, loaded, 60)) {
+            edit.patterns[0] = loaded;
+            edit.patternSlots[0] = PATTERN_NONE;
+            songActive = false;
+        }
+    }
+    
+    cueNext(edit);
+    params.publish();
+    return true;
 }
 
 void MintySynth::setTempo(uint16_t bpm) {
-    globals.tempo = constrain(bpm, 60, 200);
-    calculateStepDuration();
+    params.edit().globals.tempo = constrain(bpm, 60, 200);
+    params.publish();
 }
 
 void MintySynth::start() {
     playing = true;
-    currentStep = 0;
-    lastStepTime = millis();
+    
+    // Step 0 plays on the next frame rendered
+    clock.start(sampleClock);
 }
 
 void MintySynth::stop() {
     playing = false;
+    clock.stop();
     // Release all voices
-    for (int i = 0; i < NUM_VOICES; i++) {
-        voiceActive[i] = false;
+    for (int i = 0; i < NUM_RENDER_VOICES; i++) {
+        bank.active[i] = false;
     }
 }
 
@@ -158,159 +560,214 @@ bool MintySynth::isPlaying() {
 }
 
 void MintySynth::setGlobalParam(uint8_t param, uint16_t value) {
+    SynthParams& edit = params.edit().globals;
     switch (param) {
         case GLOBAL_TEMPO:
-            setTempo(value);
+            edit.tempo = constrain(value, 60, 200);
             break;
         case GLOBAL_SWING:
-            globals.swing = constrain(value, 0, 127);
-            calculateStepDuration();
+            edit.swing = constrain(value, 0, 127);
             break;
         case GLOBAL_SCALE:
-            globals.scale = constrain(value, 0, 8);
+            edit.scale = constrain(value, 0, 8);
             break;
         case GLOBAL_TRANSPOSE:
-            globals.transpose = constrain((int16_t)value, -12, 12);
-            updateVoiceFrequencies();
+            edit.transpose = constrain((int16_t)value, -12, 12);
             break;
         case GLOBAL_VOLUME:
-            globals.masterVolume = constrain(value, 0, 127);
+            edit.masterVolume = constrain(value, 0, 127);
+            break;
+        case GLOBAL_TUNING:
+            edit.tuning = constrain(value, 0, NUM_TUNINGS - 1);
             break;
+        default:
+            return;
     }
+    params.publish();
 }
 
 uint16_t MintySynth::getGlobalParam(uint8_t param) {
+    const SynthParams& staged = params.staged().globals;
     switch (param) {
-        case GLOBAL_TEMPO: return globals.tempo;
-        case GLOBAL_SWING: return globals.swing;
-        case GLOBAL_SCALE: return globals.scale;
-        case GLOBAL_TRANSPOSE: return (uint16_t)(globals.transpose + 12);
-        case GLOBAL_VOLUME: return globals.masterVolume;
+        case GLOBAL_TEMPO: return staged.tempo;
+        case GLOBAL_SWING: return staged.swing;
+        case GLOBAL_SCALE: return staged.scale;
+        case GLOBAL_TRANSPOSE: return (uint16_t)(staged.transpose + 12);
+        case GLOBAL_VOLUME: return staged.masterVolume;
+        case GLOBAL_TUNING: return staged.tuning;
         default: return 0;
     }
 }
 
-void MintySynth::updateSequencer() {
-    if (!playing) return;
+// Patterns since patterns[0] started: 0 plays it, more plays the cued one
+const StepPattern& MintySynth::playingPattern() {
+    uint32_t position = patternPosition.load(std::memory_order_relaxed);
+    return live->patterns[position != live->chainPosition ? 1 : 0];
+}
+
+// Plays the step that is due on this frame. Step 0 starts the next
+// pattern, the first one after start() included.
+void MintySynth::playStep() {
+    uint8_t current = clock.advance();
+    if (current == 0) {
+        patternPosition.store(patternPosition.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
     
-    if (millis() - lastStepTime >= stepDuration) {
-        // Advance to next step
-        currentStep = (currentStep + 1) % NUM_STEPS;
-        lastStepTime = millis();
-        
-        // Trigger notes for active steps
-        for (int voice = 0; voice < NUM_VOICES; voice++) {
-            if (sequence[voice][currentStep].active) {
-                triggerVoice(voice, 
-                           sequence[voice][currentStep].note + globals.transpose,
-                           sequence[voice][currentStep].velocity);
-            }
+    // The pattern's length decides where it wraps and whether this step swings
+    const StepPattern& pattern = playingPattern();
+    clock.setLength(pattern.length);
+    if (current >= pattern.length) return;     // Shortened under the playhead
+    
+    for (int voice = 0; voice < NUM_VOICES; voice++) {
+        if (pattern.isActive(voice, current)) {
+            triggerVoice(voice, constrain(pattern.notes[voice][current] + live->globals.transpose, 0, 127),
+                         pattern.velocities[voice][current]);
         }
     }
 }
 
+uint64_t MintySynth::getSampleClock() {
+    return sampleClock;
+}
+
 void MintySynth::processAudio(int16_t* buffer, size_t length) {
-    for (size_t i = 0; i < length; i += 2) {
-        float mixL = 0, mixR = 0;
+    uint32_t startCycles = readCycleCount();
+    size_t frames = length / 2;
+    
+    refreshParams();
+    
+    while (frames > 0) {
+        size_t blockFrames = (frames < AUDIO_BUFFER_SIZE) ? frames : AUDIO_BUFFER_SIZE;
         
-        // Process each voice
-        for (int voice = 0; voice < NUM_VOICES; voice++) {
-            if (!voiceActive[voice]) continue;
-            
-            // Generate waveform sample
-            float sample = getWaveformSample(voices[voice].waveform, voicePhase[voice]);
-            
-            // Apply envelope
-            float envSample = getEnvelopeSample(voices[voice].envelope, voiceEnvPhase[voice]);
-            sample *= envSample;
-            
-            // Apply voice volume
-            sample *= (voices[voice].volume / 127.0);
-            
-            // Mix to stereo (simple center for now)
-            mixL += sample;
-            mixR += sample;
-            
-            // Update phase
-            voicePhase[voice] += (voiceFreq[voice] * 2.0 * PI) / SAMPLE_RATE;
-            if (voicePhase[voice] > 2.0 * PI) {
-                voicePhase[voice] -= 2.0 * PI;
-            }
-            
-            // Update envelope
-            voiceEnvPhase[voice]++;
-            
-            // Check if envelope finished
-            uint16_t envLength = (voices[voice].length * SAMPLE_RATE) / 1000;
-            if (voiceEnvPhase[voice] > envLength) {
-                voiceActive[voice] = false;
-            }
+        // Look ahead: a step due inside this block splits it at its frame
+        uint32_t untilStep = clock.framesUntilStep(sampleClock, blockFrames);
+        if (untilStep == 0) {
+            playStep();
+            continue;
         }
+        blockFrames = untilStep;
         
-        // Apply master volume
-        mixL *= (globals.masterVolume / 127.0);
-        mixR *= (globals.masterVolume / 127.0);
-        
-        // Convert to 16-bit integer
-        buffer[i] = (int16_t)(constrain(mixL * 16000, -32767, 32767));     // Left
-        buffer[i + 1] = (int16_t)(constrain(mixR * 16000, -32767, 32767)); // Right
+        renderBlock(buffer, blockFrames);
+        sampleClock += blockFrames;
+        buffer += blockFrames * 2;
+        frames -= blockFrames;
+    }
+    
+    if (length >= 2) {
+        cyclesPerSample.store((readCycleCount() - startCycles) / (length / 2), std::memory_order_relaxed);
     }
 }
 
-void MintySynth::calculateStepDuration() {
-    // Calculate step duration in milliseconds (16th notes)
-    stepDuration = (60000 / globals.tempo) / 4;
-    
-    // Apply swing (affects even/odd steps differently)
-    // This is a simplified implementation
-}
-
-float MintySynth::getWaveformSample(uint8_t waveform, float phase) {
-    switch (waveform) {
-        case WAVE_SINE:
-            return sin(phase);
-        case WAVE_SQUARE:
-            return (phase < PI) ? 1.0 : -1.0;
-        case WAVE_SAW:
-            return (2.0 * phase / (2.0 * PI)) - 1.0;
-        case WAVE_TRIANGLE:
-            if (phase < PI) {
-                return (2.0 * phase / PI) - 1.0;
-            } else {
-                return 3.0 - (2.0 * phase / PI);
-            }
-        case WAVE_NOISE:
-            return ((float)random(-32767, 32767)) / 32767.0;
-        default:
-            return sin(phase); // Default to sine
+void MintySynth::renderBlock(int16_t* buffer, size_t frames) {
+    const int16_t* blocks[NUM_RENDER_VOICES];
+    uint8_t blockCount = 0;
+    
+    // Output scale: a full-scale voice at full volume lands at +-16000
+    float masterGain = live->globals.masterVolume * (1.0f / 127.0f) * (16000.0f / 32768.0f);
+    
+    // Render each voice as a whole block
+    for (int voice = 0; voice < NUM_RENDER_VOICES; voice++) {
+        if (!bank.active[voice]) continue;
+        
+        const VoiceParams& params = live->voices[bank.lane[voice]];
+        uint8_t volume = params.volume * bank.velocity[voice] / 127;   // Full velocity leaves it as is
+        
+        // The voice stops after the sample whose envelope phase reaches envLength
+        uint16_t envLength = (params.length * SAMPLE_RATE) / 1000;
+        size_t remaining = (bank.envPhase[voice] <= envLength) ? (envLength - bank.envPhase[voice] + 1) : 1;
+        size_t voiceFrames = (remaining < frames) ? remaining : frames;
+        
+        // Modulation runs once per block
+        ModOutputs mod;
+        uint16_t progress = envLength ? (uint16_t)(((uint32_t)bank.envPhase[voice] * 32767) / envLength) : 32767;
+        modulation.evaluate(voice, bank.lane[voice], bank.ftw[voice], params.waveform,
+                            progress, bank.envelope[voice].getLevel(), voiceFrames, mod);
+        
+        // Gain ramps from the previous block to avoid zipper noise
+        float gain = volume * (1.0f / (127.0f * 32767.0f)) * masterGain * mod.gain;
+        float startGain = (bank.gain[voice] < 0) ? gain : bank.gain[voice];
+        bank.gain[voice] = gain;
+        
+        int16_t* out = bank.block[voice];
+        renderVoice(getWavetable(mod.waveform, mod.ftw),
+                    bank.phase[voice], mod.ftw, bank.envelope[voice],
+                    startGain, (gain - startGain) / voiceFrames,
+                    out, voiceFrames);
+        bank.envPhase[voice] += voiceFrames;
+        
+        if (voiceFrames == remaining) {
+            bank.active[voice] = false;
+            bank.level[voice] = 0;
+            memset(out + voiceFrames, 0, (frames - voiceFrames) * sizeof(int16_t));
+        } else {
+            bank.level[voice] = (volume * bank.envelope[voice].getLevel()) >> 7;
+        }
+        blocks[blockCount++] = out;
     }
+    
+    mixVoiceBlocks(mixBlock, blocks, blockCount, frames);
+    
+    // Interleave to 16-bit stereo
+    for (size_t n = 0; n < frames; n++) {
+        buffer[n * 2] = mixBlock[n];        // Left
+        buffer[n * 2 + 1] = mixBlock[n];    // Right (simple center for now)
+    }
+}
+
+uint32_t MintySynth::getCyclesPerSample() {
+    return cyclesPerSample.load(std::memory_order_relaxed);
 }
 
-float MintySynth::getEnvelopeSample(uint8_t envelope, uint16_t phase) {
-    // Simplified envelope implementation
-    // Real implementation would use lookup tables from original MintySynth
+void MintySynth::measureVoiceCost(uint32_t* cyclesPerFrame, uint8_t maxVoices) {
+    static int16_t scratch[AUDIO_BUFFER_SIZE * 2];
     
-    float normalizedPhase = phase / 1000.0; // Rough normalization
+    if (maxVoices > NUM_RENDER_VOICES) maxVoices = NUM_RENDER_VOICES;
+    uint8_t polyphony = allocator.getPolyphony();
+    allocator.setPolyphony(NUM_RENDER_VOICES);
     
-    switch (envelope) {
-        case ENV_ATTACK:
-            return (normalizedPhase < 1.0) ? normalizedPhase : 1.0;
-        case ENV_DECAY:
-            return (normalizedPhase < 1.0) ? (1.0 - normalizedPhase) : 0.0;
-        case ENV_PLUCK:
-            return exp(-normalizedPhase * 3.0);
-        case ENV_LONG:
-            return (normalizedPhase < 2.0) ? 1.0 : exp(-(normalizedPhase - 2.0));
-        case ENV_REVERSE:
-            return (normalizedPhase < 1.0) ? (1.0 - normalizedPhase) : 0.0;
-        default:
-            return exp(-normalizedPhase * 2.0);
+    for (uint8_t count = 0; count <= maxVoices; count++) {
+        for (int i = 0; i < NUM_RENDER_VOICES; i++) bank.active[i] = false;
+        for (uint8_t n = 0; n < count; n++) triggerVoice(n % NUM_VOICES, 36 + n);
+        
+        // One warm-up block, then the best of four so cache misses and
+        // interrupts do not skew the curve
+        processAudio(scratch, AUDIO_BUFFER_SIZE * 2);
+        uint32_t best = 0xFFFFFFFF;
+        for (int run = 0; run < 4; run++) {
+            processAudio(scratch, AUDIO_BUFFER_SIZE * 2);
+            uint32_t cycles = cyclesPerSample.load(std::memory_order_relaxed);
+            if (cycles < best) best = cycles;
+        }
+        cyclesPerFrame[count] = best;
     }
+    
+    for (int i = 0; i < NUM_RENDER_VOICES; i++) bank.active[i] = false;
+    allocator.setPolyphony(polyphony);
 }
 
-void MintySynth::updateVoiceFrequencies() {
-    for (int i = 0; i < NUM_VOICES; i++) {
-        float note = voices[i].pitch + globals.transpose;
-        voiceFreq[i] = 440.0 * pow(2.0, (note - 69) / 12.0);
+void MintySynth::refreshParams() {
+    if (!params.update()) return;
+    live = &params.read();
+    
+    // Derived render state is rebuilt here, on the render side only
+    for (int lane = 0; lane < NUM_VOICES; lane++) {
+        const VoiceParams& voice = live->voices[lane];
+        modulation.setLfo(lane, voice.lfoRate, voice.lfoShape);
+        modulation.setPitchEnvDepth(lane, voice.modulation);
+        for (int slot = 0; slot < MOD_ROUTES; slot++) {
+            const ModRoute& route = live->routes[lane][slot];
+            modulation.setRoute(lane, slot, route.source, route.destination, route.amount);
+        }
     }
-}
\ No newline at end of file
+    calculateStepDuration();
+}
+
+void MintySynth::calculateStepDuration() {
+    // 16th notes, the odd ones late by up to half a step at full swing
+    clock.setTempo(live->globals.tempo);
+    clock.setSwing(live->globals.swing, 127);
+}
+
+uint32_t MintySynth::noteToTuningWord(uint8_t note) {
+    return tuningBank.tuning[live->globals.tuning].ftw[note & 0x7F];
+}
@@ -9,13 +9,24 @@
 #define MINTYSYNTH_H
 
 #include <Arduino.h>
+#include <atomic>
+#include "VoiceMixer.h"
+#include "VoiceAllocator.h"
+#include "EnvelopeGenerator.h"
+#include "Modulation.h"
+#include "ParamSnapshot.h"
+#include "SequencerClock.h"
+#include "PatternStore.h"
+#include "PresetLog.h"
+#include "SynthTables.h"
 
 // Audio configuration
 #define SAMPLE_RATE 44100
 #define AUDIO_BUFFER_SIZE 128
-#define NUM_VOICES 4
-#define NUM_STEPS 16
+#define NUM_VOICES 4            // Instrument lanes (render voices: NUM_RENDER_VOICES)
+#define NUM_STEPS 16            // Default pattern length, up to PATTERN_MAX_STEPS
 #define NUM_WAVEFORMS 15
+#define NUM_ENVELOPES 5
 
 // Waveform types (from original MintySynth)
 enum WaveformType {
@@ -51,28 +62,67 @@ struct VoiceParams {
     uint8_t pitch;          // 0-127 MIDI note
     uint8_t envelope;       // 0-4 envelope type
     uint8_t length;         // 0-127 note duration
-    uint8_t modulation;     // 0-127 pitch modulation
+    uint8_t modulation;     // 0-127 pitch envelope sweep, 64 = none
     uint8_t volume;         // 0-127 volume level
+    uint8_t lfoRate;        // 0-127 LFO rate (0.05-20 Hz)
+    uint8_t lfoShape;       // 0-4 LfoShape
     bool active;            // Voice active flag
 };
 
-// Step sequencer data
-struct SequencerStep {
-    uint8_t note;           // MIDI note number
-    bool active;            // Step active/inactive
-    uint8_t velocity;       // Note velocity
-    uint8_t length;         // Note length override
+static_assert(PATTERN_LANES == NUM_VOICES, "a pattern has one lane per instrument");
+
+// Hot per-voice DSP state as a structure of arrays, one entry per render
+// voice. Kept apart from the parameters and sequence data, 16-byte aligned
+// for the vector mixer.
+struct VoiceBank {
+    alignas(MIXER_ALIGN) int16_t block[NUM_RENDER_VOICES][AUDIO_BUFFER_SIZE];  // Rendered voice samples
+    alignas(MIXER_ALIGN) uint32_t phase[NUM_RENDER_VOICES];     // Phase accumulators
+    alignas(MIXER_ALIGN) uint32_t ftw[NUM_RENDER_VOICES];       // Frequency tuning words
+    alignas(MIXER_ALIGN) uint16_t envPhase[NUM_RENDER_VOICES];  // Samples since note-on
+    EnvelopeGenerator envelope[NUM_RENDER_VOICES];
+    float gain[NUM_RENDER_VOICES];          // Output gain at the end of the last block, < 0 after note-on
+    uint16_t level[NUM_RENDER_VOICES];      // Loudness at the end of the last block
+    uint8_t lane[NUM_RENDER_VOICES];        // Instrument lane providing the sound
+    uint8_t velocity[NUM_RENDER_VOICES];    // Note-on velocity 0-127, scales the lane volume
+    bool active[NUM_RENDER_VOICES];
 };
 
 // Global synthesis parameters
 struct SynthParams {
     uint16_t tempo;         // BPM
-    uint8_t swing;          // Swing amount 0-127
+    uint8_t swing;          // 0-127: odd steps late by up to half a step
     uint8_t scale;          // Scale type 0-8
     int8_t transpose;       // Global transpose -12 to +12
     uint8_t masterVolume;   // Master volume 0-127
+    uint8_t tuning;         // SynthTuning 0-3
 };
 
+// Everything the UI can change, handed to the renderer as one snapshot
+struct SynthParamSet {
+    VoiceParams voices[NUM_VOICES];
+    StepPattern patterns[2];        // Playing since chainPosition, and the one cued after it
+    uint8_t patternSlots[2];        // Store slots they came from, PATTERN_NONE if none
+    uint32_t chainPosition;         // Patterns started when patterns[0] did
+    ModRoute routes[NUM_VOICES][MOD_ROUTES];
+    SynthParams globals;
+};
+
+// Threading: parameter and step setters belong to one UI task and are
+// published through a ParamSnapshot. The renderer picks the newest set up
+// at the start of every block, so a change is audible within one
+// AUDIO_BUFFER_SIZE block plus the output queue. Notes, start() and
+// stop() must come from the render task (see AudioPipeline).
+//
+// The sequencer runs on the sample clock (SequencerClock) inside
+// processAudio(): a step due inside a block splits it at the step's
+// frame, so timing does not depend on when or how often the caller
+// renders.
+//
+// Patterns: the snapshot carries the pattern playing and the one cued to
+// follow it, so the renderer switches on the exact step without waiting
+// for the UI. updatePatterns() then catches the UI up and prefetches the
+// next pattern of the song from the store. Without a song, or at the end
+// of one that does not loop, the playing pattern is cued again.
 class MintySynth {
 public:
     MintySynth();
@@ -81,55 +131,101 @@ public:
     void begin();
     void setAudioCallback(void (*callback)(int16_t*, size_t));
     
-    // Voice control
+    // Voice control (voice = instrument lane 0-3). Notes play with the
+    // parameters taken at the last block boundary (refreshParams()), at
+    // the lane volume scaled by velocity / 127.
     void setVoiceParam(uint8_t voice, uint8_t param, uint8_t value);
     uint8_t getVoiceParam(uint8_t voice, uint8_t param);
     void triggerVoice(uint8_t voice, uint8_t note, uint8_t velocity = 127);
     void releaseVoice(uint8_t voice);
+    void releaseNote(uint8_t voice, uint8_t note);
+    
+    // Polyphony: notes are played on a pool of NUM_RENDER_VOICES render voices
+    void setPolyphony(uint8_t voices);
+    void setStealPolicy(StealPolicy policy);
+    void setSameNoteSteal(bool enabled);
+    uint8_t getActiveVoiceCount();
+    
+    // Modulation matrix: slot 0 to MOD_ROUTES-1 of a lane, see Modulation.h
+    void setModRoute(uint8_t voice, uint8_t slot, uint8_t source, uint8_t destination, int8_t amount);
+    ModRoute getModRoute(uint8_t voice, uint8_t slot);
     
-    // Sequencer control
+    // Sequencer control (steps 0 to PATTERN_MAX_STEPS-1 of the playing pattern)
     void setStep(uint8_t voice, uint8_t step, uint8_t note, bool active = true);
     void clearStep(uint8_t voice, uint8_t step);
     bool isStepActive(uint8_t voice, uint8_t step);
+    void setPatternLength(uint8_t steps);
+    uint8_t getPatternLength();
     void setTempo(uint16_t bpm);
     void start();
     void stop();
     bool isPlaying();
     
+    // Pattern bank and song chain (UI side)
+    bool savePattern(uint8_t slot);         // Playing pattern into the store
+    bool loadPattern(uint8_t slot);         // Plays and edits it from now on
+    bool cuePattern(uint8_t slot);          // Plays it once the current pattern ends
+    void setSong(const SongChain& chain);   // Starts once the current pattern ends
+    void clearSong();
+    void updatePatterns();                  // Call from the UI loop
+    PatternStore& getPatternStore();
+    uint32_t getPatternPosition();          // Patterns started so far
+    
     // Global parameters
     void setGlobalParam(uint8_t param, uint16_t value);
     uint16_t getGlobalParam(uint8_t param);
     
-    // Audio processing
+    // Audio processing, sequencer included
     void processAudio(int16_t* buffer, size_t length);
-    void updateSequencer();
+    void refreshParams();       // Render side: switch to the newest published parameters
+    uint64_t getSampleClock();  // Frames rendered so far
+    
+    // Preset management (UI side): sounds, modulation, globals and the
+    // playing pattern, in the log's compact sections. Saving writes only
+    // the sections that changed.
+    void setPresetLog(PresetLog* log);
+    bool savePreset(uint8_t slot);
+    bool loadPreset(uint8_t slot);
+    
+    // Render profiling: CPU cycles per stereo frame of the last processAudio
+    // call, 0 on targets without a cycle counter. Any task may read it.
+    uint32_t getCyclesPerSample();
     
-    // Preset management
-    void savePreset(uint8_t slot);
-    void loadPreset(uint8_t slot);
+    // Cycles per frame with 0..maxVoices voices sounding, into cyclesPerFrame[0..maxVoices].
+    // Takes over the voice pool; call it while the sequencer is stopped and
+    // no other task renders (main.cpp stops the AudioPipeline for 'v').
+    void measureVoiceCost(uint32_t* cyclesPerFrame, uint8_t maxVoices);
     
 private:
-    VoiceParams voices[NUM_VOICES];
-    SequencerStep sequence[NUM_VOICES][NUM_STEPS];
-    SynthParams globals;
+    ParamSnapshot<SynthParamSet> params;
+    const SynthParamSet* live;              // Renderer's current snapshot
     
     bool playing;
-    uint8_t currentStep;
-    unsigned long lastStepTime;
-    unsigned long stepDuration;
+    SequencerClock clock;
+    uint64_t sampleClock;       // Frames rendered
+    std::atomic<uint32_t> patternPosition;  // Render side, read by updatePatterns()
+    
+    // Pattern bank (UI side)
+    PatternStore store;
+    SongChain song;
+    bool songActive;
+    uint32_t songStart;         // Pattern position the song began at
+    PresetLog* presets;
     
-    // Audio synthesis
-    float voicePhase[NUM_VOICES];
-    float voiceFreq[NUM_VOICES];
-    uint16_t voiceEnvPhase[NUM_VOICES];
-    bool voiceActive[NUM_VOICES];
+    // Audio synthesis (32-bit DDS oscillator bank)
+    VoiceBank bank;
+    VoiceAllocator allocator;
+    ModulationEngine modulation;
+    alignas(MIXER_ALIGN) int16_t mixBlock[AUDIO_BUFFER_SIZE];   // Mono mix bus
+    std::atomic<uint32_t> cyclesPerSample;  // Render side, read by the UI
     
     // Internal methods
     void calculateStepDuration();
-    float getWaveformSample(uint8_t waveform, float phase);
-    float getEnvelopeSample(uint8_t envelope, uint16_t phase);
-    uint16_t noteToFrequency(uint8_t note);
-    void updateVoiceFrequencies();
+    void playStep();
+    const StepPattern& playingPattern();
+    void cueNext(SynthParamSet& edit);
+    void renderBlock(int16_t* buffer, size_t frames);
+    uint32_t noteToTuningWord(uint8_t note);
 };
 
 // Parameter indices for setVoiceParam/getVoiceParam
@@ -139,6 +235,8 @@ private:
 #define PARAM_LENGTH      3
 #define PARAM_MODULATION  4
 #define PARAM_VOLUME      5
+#define PARAM_LFO_RATE    6
+#define PARAM_LFO_SHAPE   7
 
 // Parameter indices for setGlobalParam/getGlobalParam
 #define GLOBAL_TEMPO      0
@@ -146,5 +244,6 @@ private:
 #define GLOBAL_SCALE      2
 #define GLOBAL_TRANSPOSE  3
 #define GLOBAL_VOLUME     4
+#define GLOBAL_TUNING     5
 
 #endif // MINTYSYNTH_H
\ No newline at end of file
@@ -0,0 +1,143 @@
+/*
+ * MintySynth Modulation Engine Implementation
+ */
+
+#include "Modulation.h"
+#include "MintySynth.h"
+#include "Wavetables.h"
+#include "SynthTables.h"
+#include <math.h>
+
+// LFO phase increment per rate setting: 0.05 Hz * 400^(rate/127), up to 20 Hz
+static constexpr double LFO_LOG2_RANGE = 8.643856189774724;    // log2(400)
+
+struct LfoRateTable {
+    uint32_t increment[128];
+};
+
+constexpr LfoRateTable buildLfoRates() {
+    LfoRateTable table = {};
+    for (int rate = 0; rate < 128; rate++) {
+        table.increment[rate] = synthTuningWord(0.05 * synthExp2(rate * LFO_LOG2_RANGE / 127.0), SAMPLE_RATE);
+    }
+    return table;
+}
+
+static constexpr LfoRateTable lfoRates = buildLfoRates();
+
+ModulationEngine::ModulationEngine() {
+    noiseState = 0xACE1;
+
+    for (int lane = 0; lane < MOD_LANES; lane++) {
+        lfoIncrement[lane] = 0;
+        lfoShape[lane] = LFO_SINE;
+        pitchEnvDepth[lane] = 0;
+        for (int slot = 0; slot < MOD_ROUTES; slot++) {
+            routes[lane][slot].source = MOD_SRC_NONE;
+            routes[lane][slot].destination = MOD_DST_PITCH;
+            routes[lane][slot].amount = 0;
+        }
+        setLfo(lane, 64, LFO_SINE);
+    }
+
+    for (int i = 0; i < NUM_RENDER_VOICES; i++) {
+        lfoPhase[i] = 0;
+        lfoHold[i] = 0;
+    }
+}
+
+void ModulationEngine::setLfo(uint8_t lane, uint8_t rate, uint8_t shape) {
+    if (lane >= MOD_LANES) return;
+
+    lfoIncrement[lane] = lfoRates.increment[constrain(rate, 0, 127)];
+    lfoShape[lane] = (shape < NUM_LFO_SHAPES) ? shape : LFO_SINE;
+}
+
+void ModulationEngine::setPitchEnvDepth(uint8_t lane, uint8_t modulation) {
+    if (lane >= MOD_LANES) return;
+    pitchEnvDepth[lane] = (int8_t)(constrain(modulation, 0, 127) - 64);
+}
+
+void ModulationEngine::setRoute(uint8_t lane, uint8_t slot, uint8_t source, uint8_t destination, int8_t amount) {
+    if (lane >= MOD_LANES || slot >= MOD_ROUTES) return;
+
+    routes[lane][slot].source = (source < NUM_MOD_SOURCES) ? source : MOD_SRC_NONE;
+    routes[lane][slot].destination = (destination < NUM_MOD_DESTINATIONS) ? destination : MOD_DST_PITCH;
+    routes[lane][slot].amount = (amount < -127) ? -127 : amount;
+}
+
+ModRoute ModulationEngine::getRoute(uint8_t lane, uint8_t slot) {
+    if (lane >= MOD_LANES || slot >= MOD_ROUTES) return routes[0][0];
+    return routes[lane][slot];
+}
+
+void ModulationEngine::noteOn(uint8_t voice) {
+    if (voice >= NUM_RENDER_VOICES) return;
+    lfoPhase[voice] = 0;
+    lfoHold[voice] = 0;
+}
+
+int16_t ModulationEngine::lfoValue(uint8_t voice, uint8_t shape) {
+    uint32_t phase = lfoPhase[voice];
+    int32_t ramp = (int32_t)(phase >> 16) - 32768;    // -32768 .. 32767
+
+    switch (shape) {
+        case LFO_TRIANGLE:
+            return (int16_t)constrain(((ramp < 0) ? -ramp : ramp) * 2 - 32767, -32767, 32767);
+        case LFO_SAW:
+            return (int16_t)constrain(ramp, -32767, 32767);
+        case LFO_SQUARE:
+            return (phase & 0x80000000UL) ? -32767 : 32767;
+        case LFO_RANDOM:
+            return lfoHold[voice];
+        case LFO_SINE:
+        default:
+            return getWavetable(WAVE_SINE)[phase >> WAVETABLE_SHIFT];
+    }
+}
+
+void ModulationEngine::evaluate(uint8_t voice, uint8_t lane, uint32_t ftw, uint8_t waveform,
+                                uint16_t progress, uint16_t envLevel, size_t frames, ModOutputs& out) {
+    if (lane >= MOD_LANES) lane = 0;
+
+    int32_t sources[NUM_MOD_SOURCES];
+    sources[MOD_SRC_NONE] = 0;
+    sources[MOD_SRC_LFO] = lfoValue(voice, lfoShape[lane]);
+    sources[MOD_SRC_PITCH_ENV] = progress;
+    sources[MOD_SRC_ENVELOPE] = envLevel;
+
+    // Advance the LFO over this block; sample and hold picks a new value on wrap
+    uint32_t previous = lfoPhase[voice];
+    lfoPhase[voice] += lfoIncrement[lane] * (uint32_t)frames;
+    if (lfoPhase[voice] < previous) {
+        noiseState = (noiseState >> 1) ^ (-(noiseState & 1u) & 0xB400u);
+        lfoHold[voice] = (int16_t)constrain((int16_t)noiseState, -32767, 32767);
+    }
+
+    // Routing matrix
+    int32_t sums[NUM_MOD_DESTINATIONS] = { 0, 0, 0 };
+    for (int slot = 0; slot < MOD_ROUTES; slot++) {
+        const ModRoute& route = routes[lane][slot];
+        if (route.source == MOD_SRC_NONE || route.amount == 0) continue;
+        sums[route.destination] += (sources[route.source] * route.amount) / 127;
+    }
+
+    // Pitch envelope from the original synth: FTW = PITCH + PITCH * EPCW * MOD / 2^19,
+    // which sweeps linearly to PITCH * (1 + MOD/16) at the end of the note
+    int64_t sweep = ((int64_t)ftw * progress * pitchEnvDepth[lane]) >> 19;
+    int64_t modulated = (int64_t)ftw + sweep;
+
+    int32_t pitch = constrain(sums[MOD_DST_PITCH], -MOD_FULL_SCALE, MOD_FULL_SCALE);
+    if (pitch != 0) {
+        modulated = (int64_t)(modulated * exp2f(pitch * (1.0f / 32768.0f)));
+    }
+    if (modulated < 0) modulated = 0;
+    if (modulated > 0x7FFFFFFF) modulated = 0x7FFFFFFF;
+    out.ftw = (uint32_t)modulated;
+
+    int32_t volume = constrain(sums[MOD_DST_VOLUME], -MOD_FULL_SCALE, MOD_FULL_SCALE);
+    out.gain = 1.0f + volume * (1.0f / 32767.0f);
+
+    int32_t wave = waveform + (constrain(sums[MOD_DST_WAVEFORM], -MOD_FULL_SCALE, MOD_FULL_SCALE) * (NUM_WAVEFORMS - 1)) / 32767;
+    out.waveform = (uint8_t)constrain(wave, 0, NUM_WAVEFORMS - 1);
+}
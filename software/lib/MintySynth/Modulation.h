@@ -0,0 +1,94 @@
+/*
+ * MintySynth Modulation Engine
+ *
+ * Per-voice LFOs, the original pitch-envelope sweep and a small routing
+ * matrix onto pitch, volume and waveform. Everything is evaluated once
+ * per render block, so the cost per voice is fixed and independent of
+ * the block length.
+ */
+
+#ifndef MINTYSYNTH_MODULATION_H
+#define MINTYSYNTH_MODULATION_H
+
+#include <Arduino.h>
+#include "VoiceAllocator.h"
+
+#define MOD_LANES       4       // One configuration per instrument lane
+#define MOD_ROUTES      4       // Routing matrix slots per lane
+#define MOD_FULL_SCALE  32767   // Sources and destination sums are signed Q15
+
+// Modulation sources
+enum ModSource {
+    MOD_SRC_NONE = 0,
+    MOD_SRC_LFO = 1,            // Bipolar, per-voice LFO
+    MOD_SRC_PITCH_ENV = 2,      // 0 at note-on rising to full scale at note end
+    MOD_SRC_ENVELOPE = 3,       // Amplitude envelope level
+    NUM_MOD_SOURCES
+};
+
+// Modulation destinations
+enum ModDestination {
+    MOD_DST_PITCH = 0,          // Full scale = +-1 octave
+    MOD_DST_VOLUME = 1,         // Full scale = +-100% gain
+    MOD_DST_WAVEFORM = 2,       // Full scale = +-14 waveforms
+    NUM_MOD_DESTINATIONS
+};
+
+// LFO shapes
+enum LfoShape {
+    LFO_SINE = 0,
+    LFO_TRIANGLE = 1,
+    LFO_SAW = 2,
+    LFO_SQUARE = 3,
+    LFO_RANDOM = 4,             // Sample and hold, new value every cycle
+    NUM_LFO_SHAPES
+};
+
+// One routing matrix slot: destination += source * amount / 127
+struct ModRoute {
+    uint8_t source;
+    uint8_t destination;
+    int8_t amount;              // -127 to 127
+};
+
+// Block-rate results for one render voice
+struct ModOutputs {
+    uint32_t ftw;               // Modulated tuning word
+    float gain;                 // Volume multiplier, 0 - 2
+    uint8_t waveform;           // Modulated waveform, 0-14
+};
+
+class ModulationEngine {
+public:
+    ModulationEngine();
+
+    // Lane configuration
+    void setLfo(uint8_t lane, uint8_t rate, uint8_t shape);   // rate 0-127 = 0.05-20 Hz
+    void setPitchEnvDepth(uint8_t lane, uint8_t modulation);  // 0-127, 64 = no sweep
+    void setRoute(uint8_t lane, uint8_t slot, uint8_t source, uint8_t destination, int8_t amount);
+    ModRoute getRoute(uint8_t lane, uint8_t slot);
+
+    // Restarts the voice's LFO
+    void noteOn(uint8_t voice);
+
+    // Evaluates all sources and routes for one voice and advances its LFO
+    // by `frames` samples. progress and envLevel are Q15 (0-32767).
+    void evaluate(uint8_t voice, uint8_t lane, uint32_t ftw, uint8_t waveform,
+                  uint16_t progress, uint16_t envLevel, size_t frames, ModOutputs& out);
+
+private:
+    // Lane configuration
+    uint32_t lfoIncrement[MOD_LANES];       // Phase increment per sample
+    uint8_t lfoShape[MOD_LANES];
+    int8_t pitchEnvDepth[MOD_LANES];        // -64 to 63, like MOD in the original synth.h
+    ModRoute routes[MOD_LANES][MOD_ROUTES];
+
+    // Per render voice LFO state
+    uint32_t lfoPhase[NUM_RENDER_VOICES];
+    int16_t lfoHold[NUM_RENDER_VOICES];     // Sample-and-hold value
+    uint16_t noiseState;
+
+    int16_t lfoValue(uint8_t voice, uint8_t shape);
+};
+
+#endif // MINTYSYNTH_MODULATION_H
@@ -0,0 +1,183 @@
+/*
+ * MintySynth Original Waves
+ *
+ * Single-cycle waves A-I from tables.h of the original MintySynth 4.2,
+ * 8-bit signed, 256 points. Tables A-I are from Adventure Kid's
+ * single-cycle waveform collection, resampled and reduced to 8-bit by
+ * Andrew Mowry. Wavetables.cpp scales them to Q15 at compile time.
+ */
+
+#ifndef MINTYSYNTH_ORIGINALWAVES_H
+#define MINTYSYNTH_ORIGINALWAVES_H
+
+#include <stdint.h>
+
+#define ORIGINAL_WAVES      9       // WAVE_A to WAVE_I
+#define ORIGINAL_WAVE_SIZE  256
+
+static constexpr int8_t originalWaves[ORIGINAL_WAVES][ORIGINAL_WAVE_SIZE] = {
+    {   // A (0094)
+        0, -4, -8, -11, -15, -18, -22, -25, -28, -31, -34, -37, -40, -43, -45, -48,
+        -50, -52, -55, -57, -59, -61, -63, -65, -67, -68, -70, -72, -73, -75, -76, -77,
+        -79, -80, -81, -82, -83, -84, -85, -86, -87, -87, -88, -89, -89, -90, -90, -91,
+        -91, -91, -92, -92, -92, -92, -92, -92, -92, -92, -92, -92, -92, -91, -91, -91,
+        -90, -90, -89, -89, -88, -88, -87, -86, -86, -85, -84, -83, -82, -82, -81, -80,
+        -79, -78, -76, -75, -74, -73, -72, -71, -69, -68, -67, -65, -64, -63, -61, -60,
+        -58, -58, -60, -61, -62, -63, -62, -62, -61, -61, -60, -60, -59, -59, -58, -58,
+        -58, -57, -57, -57, -56, -56, -55, -55, -54, -53, -52, -51, -51, -49, -49, -47,
+        -45, -44, -42, -40, -38, -36, -34, -31, -29, -27, -24, -21, -19, -16, -13, -10,
+        -7, -3, 0, 3, 7, 10, 14, 17, 21, 25, 30, 35, 39, 43, 48, 52,
+        56, 60, 61, 62, 63, 65, 67, 69, 72, 74, 77, 79, 81, 84, 86, 88,
+        89, 91, 93, 94, 95, 97, 98, 99, 100, 101, 102, 103, 104, 105, 106, 107,
+        108, 109, 111, 113, 114, 115, 117, 118, 119, 119, 120, 121, 122, 123, 124, 125,
+        125, 126, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 126,
+        126, 125, 123, 120, 115, 110, 106, 103, 99, 96, 93, 89, 86, 82, 78, 74,
+        70, 65, 61, 56, 52, 47, 43, 38, 33, 29, 25, 21, 18, 14, 10, 6
+    },
+    {   // B (blended0076)
+        0, 10, 20, 30, 39, 48, 57, 66, 74, 82, 89, 96, 102, 107, 112, 117,
+        120, 123, 126, 127, 127, 127, 127, 127, 126, 124, 121, 119, 115, 111, 107, 103,
+        99, 94, 89, 84, 79, 75, 70, 65, 61, 57, 53, 49, 46, 43, 41, 38,
+        37, 36, 35, 34, 34, 35, 35, 37, 38, 40, 42, 44, 47, 49, 52, 55,
+        58, 60, 63, 66, 68, 70, 72, 74, 75, 76, 77, 77, 77, 76, 75, 73,
+        71, 68, 65, 61, 57, 52, 47, 42, 37, 31, 24, 18, 12, 5, -2, -9,
+        -15, -22, -28, -34, -40, -46, -51, -56, -60, -64, -68, -71, -73, -74, -75, -76,
+        -76, -75, -73, -71, -68, -65, -61, -57, -52, -46, -41, -35, -28, -22, -22, -8,
+        -1, 6, 13, 20, 27, 33, 39, 45, 51, 56, 60, 64, 68, 71, 73, 75,
+        76, 77, 77, 76, 75, 73, 70, 67, 63, 59, 54, 49, 44, 38, 32, 25,
+        19, 12, 6, -1, -8, -14, -21, -27, -33, -39, -44, -49, -54, -58, -62, -66,
+        -69, -71, -73, -74, -75, -76, -76, -75, -75, -73, -72, -70, -68, -66, -63, -60,
+        -58, -55, -52, -49, -47, -44, -42, -40, -38, -36, -35, -34, -33, -33, -33, -34,
+        -35, -37, -39, -41, -44, -47, -50, -54, -58, -62, -67, -72, -76, -81, -86, -91,
+        -96, -100, -105, -109, -113, -116, -119, -122, -124, -126, -127, -127, -127, -127, -125, -123,
+        -121, -117, -113, -108, -103, -97, -91, -84, -76, -68, -60, -51, -42, -33, -23, -14
+    },
+    {   // C (0006)
+        3, 9, 14, 18, 22, 26, 30, 34, 38, 41, 45, 48, 51, 54, 57, 60,
+        63, 66, 69, 71, 74, 76, 79, 81, 83, 85, 87, 89, 90, 92, 94, 95,
+        97, 99, 102, 104, 105, 107, 108, 109, 111, 110, 107, 105, 103, 102, 101, 100,
+        100, 99, 98, 97, 96, 94, 93, 92, 91, 89, 88, 86, 85, 83, 82, 81,
+        80, 79, 81, 82, 82, 82, 82, 83, 83, 83, 83, 83, 83, 83, 83, 84,
+        84, 84, 85, 85, 85, 85, 85, 85, 85, 85, 85, 85, 84, 84, 84, 83,
+        82, 81, 81, 79, 78, 77, 76, 74, 73, 71, 69, 68, 65, 63, 61, 59,
+        56, 54, 51, 49, 46, 43, 40, 37, 34, 31, 28, 24, 21, 17, 13, 8,
+        2, -4, -8, -13, -16, -20, -24, -27, -30, -34, -37, -40, -43, -46, -49, -52,
+        -54, -57, -60, -62, -65, -67, -69, -71, -74, -76, -78, -79, -81, -83, -85, -86,
+        -88, -89, -91, -92, -92, -91, -90, -89, -88, -87, -87, -86, -86, -85, -85, -84,
+        -84, -83, -83, -82, -81, -81, -80, -80, -79, -79, -78, -78, -78, -79, -80, -83,
+        -84, -85, -86, -87, -88, -89, -90, -91, -92, -92, -93, -94, -95, -96, -96, -97,
+        -97, -98, -98, -99, -99, -99, -99, -99, -99, -99, -99, -98, -98, -97, -97, -96,
+        -95, -94, -93, -92, -90, -89, -87, -85, -83, -81, -79, -77, -74, -72, -69, -66,
+        -63, -60, -57, -54, -51, -47, -44, -40, -37, -33, -29, -25, -21, -16, -11, -6
+    },
+    {   // D (altosax0008)
+        2, 9, 15, 22, 29, 36, 44, 51, 59, 67, 74, 82, 88, 93, 96, 99,
+        103, 105, 107, 110, 113, 116, 119, 121, 123, 125, 125, 125, 126, 127, 127, 127,
+        127, 126, 124, 121, 117, 114, 109, 104, 98, 93, 87, 82, 77, 71, 67, 61,
+        56, 52, 48, 43, 37, 31, 24, 19, 16, 15, 12, 10, 7, 4, 3, 0,
+        -3, -7, -11, -17, -20, -23, -25, -29, -33, -37, -40, -42, -45, -47, -51, -53,
+        -56, -58, -60, -63, -65, -66, -67, -68, -68, -68, -68, -68, -67, -66, -64, -63,
+        -61, -59, -57, -55, -53, -50, -46, -43, -39, -35, -31, -26, -21, -17, -13, -9,
+        -5, -1, 3, 6, 10, 13, 16, 20, 23, 26, 28, 30, 32, 33, 33, 34,
+        34, 33, 33, 32, 30, 28, 26, 24, 22, 19, 17, 13, 9, 5, 2, -2,
+        -5, -8, -12, -15, -18, -20, -22, -25, -28, -30, -33, -34, -36, -36, -37, -38,
+        -40, -40, -39, -39, -39, -38, -38, -37, -36, -35, -34, -33, -31, -30, -29, -27,
+        -25, -23, -22, -21, -20, -19, -18, -17, -16, -16, -15, -15, -14, -14, -13, -12,
+        -12, -12, -12, -12, -12, -13, -14, -14, -15, -16, -17, -18, -19, -20, -21, -21,
+        -22, -23, -24, -25, -26, -27, -28, -29, -30, -30, -30, -30, -30, -31, -31, -31,
+        -30, -30, -30, -30, -30, -31, -31, -32, -32, -33, -34, -36, -37, -39, -40, -42,
+        -44, -46, -47, -48, -49, -49, -48, -47, -45, -42, -38, -33, -28, -22, -16, -9
+    },
+    {   // E (98)
+        2, 6, 10, 14, 17, 21, 24, 28, 31, 34, 37, 41, 44, 47, 50, 53,
+        55, 58, 61, 64, 66, 69, 71, 74, 76, 78, 80, 83, 85, 87, 89, 91,
+        92, 94, 96, 98, 99, 101, 102, 104, 105, 106, 108, 109, 110, 111, 112, 113,
+        114, 115, 116, 117, 118, 119, 119, 120, 121, 121, 122, 123, 123, 124, 124, 125,
+        125, 125, 126, 126, 126, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127,
+        127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127,
+        127, 127, 127, 127, 126, 126, 126, 126, 125, 125, 125, 124, 124, 124, 123, 123,
+        123, 122, 122, 122, 121, 121, 121, 119, 117, 114, 109, 103, 95, 86, 86, 65,
+        53, 41, 29, 16, 2, -12, -24, -35, -44, -53, -62, -69, -76, -82, -87, -92,
+        -96, -100, -103, -106, -109, -111, -113, -115, -116, -118, -119, -120, -121, -122, -123, -123,
+        -124, -124, -125, -125, -126, -126, -126, -126, -127, -127, -127, -127, -127, -127, -127, -127,
+        -127, -127, -127, -127, -127, -127, -127, -127, -127, -126, -126, -126, -126, -125, -125, -125,
+        -124, -124, -123, -123, -122, -122, -121, -121, -120, -119, -119, -118, -117, -116, -116, -115,
+        -114, -113, -112, -111, -109, -108, -107, -106, -104, -103, -102, -100, -99, -97, -95, -94,
+        -92, -90, -88, -86, -84, -82, -80, -77, -75, -73, -70, -68, -65, -63, -60, -57,
+        -54, -51, -49, -46, -42, -39, -36, -33, -30, -26, -23, -19, -16, -12, -8, -4
+    },
+    {   // F (blended0006)
+        7, 37, 59, 74, 85, 94, 100, 105, 110, 113, 116, 118, 120, 121, 122, 123,
+        124, 125, 126, 126, 126, 127, 127, 127, 127, 127, 127, 127, 127, 127, 127, 124,
+        106, 94, 89, 86, 84, 84, 83, 83, 83, 83, 83, 83, 83, 83, 83, 83,
+        83, 83, 83, 83, 83, 83, 83, 83, 83, 83, 83, 83, 83, 84, 79, 64,
+        67, 68, 66, 64, 61, 59, 57, 56, 55, 55, 54, 54, 54, 54, 53, 53,
+        53, 53, 53, 53, 53, 53, 53, 53, 53, 53, 53, 53, 53, 53, 54, 51,
+        33, 20, 14, 10, 9, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+        8, 8, 8, 8, 8, 8, 8, 8, 7, 8, 7, 8, 2, -15, -15, -25,
+        -4, 10, 15, 17, 16, 14, 12, 10, 8, 6, 4, 3, 0, 0, -1, -2,
+        -2, -3, -4, -4, -4, -5, -5, -5, -5, -6, -6, -6, -6, -6, -6, -8,
+        -25, -39, -45, -49, -50, -51, -51, -52, -52, -52, -52, -52, -52, -52, -52, -52,
+        -52, -52, -52, -52, -52, -52, -52, -52, -52, -52, -52, -52, -52, -52, -54, -69,
+        -70, -66, -69, -71, -74, -75, -78, -78, -80, -80, -81, -81, -81, -82, -82, -82,
+        -82, -82, -82, -82, -82, -82, -82, -82, -82, -82, -82, -82, -82, -82, -82, -83,
+        -98, -114, -120, -124, -125, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127,
+        -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -127, -124, -109, -89, -59
+    },
+    {   // G (eguitar_0003)
+        10, 40, 63, 80, 91, 98, 101, 102, 102, 100, 97, 92, 89, 86, 86, 87,
+        90, 92, 95, 96, 96, 95, 93, 91, 89, 88, 89, 90, 91, 93, 94, 94,
+        94, 93, 91, 90, 89, 89, 89, 90, 91, 92, 93, 93, 92, 91, 90, 90,
+        89, 89, 89, 90, 91, 91, 91, 91, 91, 90, 90, 89, 89, 89, 90, 90,
+        90, 90, 91, 90, 90, 90, 89, 89, 89, 89, 89, 90, 90, 90, 90, 90,
+        89, 89, 89, 89, 89, 89, 89, 89, 89, 89, 89, 89, 89, 89, 89, 88,
+        88, 88, 88, 88, 88, 88, 89, 89, 89, 89, 89, 89, 89, 88, 88, 87,
+        87, 87, 88, 88, 89, 89, 89, 89, 88, 87, 86, 86, 86, 86, 88, 89,
+        90, 91, 91, 89, 86, 83, 81, 81, 83, 89, 96, 102, 105, 101, 90, 72,
+        48, 21, -6, -31, -53, -74, -92, -107, -119, -127, -127, -127, -127, -125, -121, -119,
+        -118, -118, -120, -121, -122, -123, -123, -122, -122, -121, -120, -120, -120, -121, -121, -121,
+        -121, -121, -121, -121, -121, -121, -121, -121, -121, -121, -121, -121, -121, -121, -121, -121,
+        -121, -121, -121, -121, -120, -120, -120, -120, -120, -120, -120, -121, -121, -121, -121, -120,
+        -120, -119, -119, -119, -119, -119, -120, -121, -121, -121, -121, -120, -119, -119, -118, -118,
+        -118, -119, -120, -121, -121, -121, -121, -120, -118, -117, -116, -117, -117, -119, -121, -122,
+        -123, -122, -120, -117, -114, -113, -113, -116, -123, -125, -125, -125, -122, -103, -74, -40
+    },
+    {   // H (1698)
+        1, 3, 4, 5, 7, 7, 8, 8, 9, 8, 20, 40, 48, 51, 49, 45,
+        40, 36, 32, 27, 27, 33, 41, 46, 47, 44, 41, 36, 32, 27, 25, 20,
+        27, 59, 76, 83, 83, 77, 70, 62, 73, 90, 94, 91, 84, 76, 67, 61,
+        87, 111, 116, 113, 104, 93, 80, 77, 82, 92, 95, 91, 85, 78, 69, 59,
+        50, 38, 26, 25, 27, 25, 23, 20, 17, 14, 12, 13, 14, 19, 49, 83,
+        94, 97, 89, 81, 69, 73, 103, 115, 113, 104, 91, 78, 66, 55, 46, 37,
+        30, 27, 42, 58, 61, 59, 53, 46, 38, 31, 24, 18, 14, 9, 6, 3,
+        1, 0, 8, 35, 52, 56, 55, 49, 42, 35, 28, 22, 16, 16, 31, 38,
+        39, 36, 31, 26, 20, 16, 13, 18, 24, 25, 23, 21, 16, 11, -6, -27,
+        -37, -40, -40, -38, -35, -31, -28, -24, -22, -19, -21, -50, -72, -78, -77, -71,
+        -67, -90, -113, -114, -109, -98, -87, -75, -65, -55, -47, -50, -74, -105, -124, -123,
+        -115, -102, -105, -116, -112, -104, -91, -79, -66, -71, -82, -80, -75, -66, -58, -53,
+        -54, -56, -60, -64, -71, -101, -124, -127, -120, -108, -93, -79, -65, -72, -86, -85,
+        -79, -70, -60, -50, -41, -43, -60, -68, -67, -61, -54, -46, -37, -32, -27, -28,
+        -34, -33, -27, -21, -16, -14, -25, -47, -56, -57, -53, -47, -40, -33, -27, -22,
+        -17, -13, -10, -8, -6, -8, -18, -23, -23, -21, -18, -14, -11, -7, -4, -2
+    },
+    {   // I (908)
+        1, 2, 2, 3, 4, 5, 6, 7, 8, 9, 9, 10, 11, 12, 13, 14,
+        15, 16, 17, 18, 19, 20, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29,
+        30, 31, 32, 33, 34, 34, 35, 37, 39, 41, 43, 44, 46, 47, 49, 50,
+        52, 53, 55, 56, 57, 59, 60, 62, 63, 65, 66, 67, 69, 70, 71, 73,
+        74, 75, 77, 78, 80, 81, 82, 83, 85, 86, 88, 89, 90, 91, 93, 94,
+        95, 96, 98, 99, 100, 101, 103, 104, 105, 107, 108, 109, 110, 112, 112, 114,
+        114, 117, 116, 120, 117, 127, 105, 58, 61, 57, 56, 53, 51, 48, 44, 41,
+        37, 34, 29, 26, 21, 18, 14, 10, 6, 2, -2, -6, -11, -14, -19, -23,
+        -27, -31, -35, -40, -44, -48, -52, -57, -61, -66, -70, -74, -78, -83, -87, -92,
+        -96, -102, -107, -101, -96, -92, -89, -87, -85, -84, -82, -81, -80, -79, -79, -78,
+        -77, -76, -76, -75, -74, -74, -73, -72, -72, -71, -71, -70, -69, -69, -68, -67,
+        -67, -66, -65, -64, -64, -63, -62, -62, -61, -60, -60, -59, -58, -57, -57, -56,
+        -55, -54, -54, -53, -52, -51, -51, -50, -49, -48, -48, -47, -46, -45, -45, -44,
+        -43, -42, -41, -41, -40, -39, -38, -37, -37, -36, -35, -34, -33, -32, -32, -31,
+        -30, -29, -28, -27, -27, -26, -25, -24, -23, -22, -21, -21, -20, -19, -18, -17,
+        -16, -16, -14, -14, -13, -12, -10, -5, -5, -5, -4, -3, -3, -2, -1, -1
+    }
+};
+
+#endif // MINTYSYNTH_ORIGINALWAVES_H
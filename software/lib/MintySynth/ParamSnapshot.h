@@ -0,0 +1,68 @@
+/*
+ * MintySynth Parameter Snapshot
+ *
+ * Wait-free triple buffer for handing a parameter set from the UI to the
+ * renderer. The writer edits a private staging copy and publishes it; the
+ * reader picks up the newest published copy with one atomic exchange and
+ * then reads it without any further synchronisation. Neither side ever
+ * waits or retries, and the reader never sees a half-written set.
+ *
+ * One writer task and one reader task.
+ */
+
+#ifndef MINTYSYNTH_PARAMSNAPSHOT_H
+#define MINTYSYNTH_PARAMSNAPSHOT_H
+
+#include <stdint.h>
+#include <atomic>
+
+template <typename T>
+class ParamSnapshot {
+public:
+    ParamSnapshot() : back(0), front(1), middle(2), published(0) {}
+
+    // Initialisation only, before both sides run
+    void reset(const T& value) {
+        staging = value;
+        for (int i = 0; i < 3; i++) buffers[i] = value;
+        back = 0;
+        front = 1;
+        middle.store(2);
+    }
+
+    // Writer side: edit the staging copy, then publish() it
+    T& edit() { return staging; }
+    const T& staged() const { return staging; }
+
+    void publish() {
+        buffers[back] = staging;
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+        published.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Reader side: switch to the newest published set. Returns true if
+    // there was one since the last call.
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T& read() const { return buffers[front]; }
+
+    // Number of publish() calls so far
+    uint32_t getPublishCount() const { return published.load(std::memory_order_relaxed); }
+
+private:
+    static const uint8_t INDEX = 0x03;
+    static const uint8_t FRESH = 0x04;      // Middle buffer not yet seen by the reader
+
+    T buffers[3];
+    T staging;
+    uint8_t back;                           // Writer owned
+    uint8_t front;                          // Reader owned
+    std::atomic<uint8_t> middle;            // Index of the handover buffer + FRESH
+    std::atomic<uint32_t> published;
+};
+
+#endif // MINTYSYNTH_PARAMSNAPSHOT_H
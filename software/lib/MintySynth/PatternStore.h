@@ -0,0 +1,235 @@
+/*
+ * MintySynth Pattern Store
+ *
+ * Step patterns kept as one bitset word per lane, with the notes and
+ * velocities beside it in packed byte arrays. Whether a lane plays a
+ * step is a single bit test, an empty step costs one bit, and a pattern
+ * can be anything from 1 to PATTERN_MAX_STEPS steps long.
+ *
+ *   StepPattern   one pattern at full size, the form the sequencer plays
+ *                 from (MintySynth keeps the playing one and the one cued
+ *                 after it)
+ *   PatternStore  the bank: PATTERN_SLOTS patterns sharing one pool of
+ *                 steps, each taking only its own length, so a 16-step
+ *                 pattern costs 128 bytes of pool plus its 40-byte slot
+ *   SongChain     the arrangement: slots with repeat counts, played in
+ *                 order and optionally looped
+ *
+ * The store and the chain belong to the UI side; the render side only
+ * ever sees the StepPatterns they are copied into.
+ *
+ * Header only, so the sketches can use it with their own audio loop.
+ */
+
+#ifndef MINTYSYNTH_PATTERNSTORE_H
+#define MINTYSYNTH_PATTERNSTORE_H
+
+#include <Arduino.h>
+#include <string.h>
+
+#ifndef PATTERN_LANES
+#define PATTERN_LANES         4                                 // Instrument lanes
+#endif
+#define PATTERN_MAX_STEPS     64                                // One uint64_t of gates per lane
+#define PATTERN_SLOTS         64
+#define PATTERN_POOL_STEPS    1024                              // Steps stored across all slots
+#define PATTERN_NONE          0xFF
+#define SONG_CHAIN_MAX        64
+
+struct StepPattern {
+    uint64_t gates[PATTERN_LANES];                          // Bit s set: the lane plays step s
+    uint8_t notes[PATTERN_LANES][PATTERN_MAX_STEPS];
+    uint8_t velocities[PATTERN_LANES][PATTERN_MAX_STEPS];
+    uint8_t length;                                         // Steps, 1 to PATTERN_MAX_STEPS
+
+    // Every step off, on `note` at full velocity
+    void clear(uint8_t steps, uint8_t note) {
+        memset(gates, 0, sizeof(gates));
+        memset(notes, note, sizeof(notes));
+        memset(velocities, 127, sizeof(velocities));
+        setLength(steps);
+    }
+
+    // Steps past the end keep their data, so lengthening brings them back
+    void setLength(uint8_t steps) {
+        length = constrain(steps, 1, PATTERN_MAX_STEPS);
+    }
+
+    bool isActive(uint8_t lane, uint8_t step) const {
+        return (gates[lane] >> step) & 1;
+    }
+
+    void setActive(uint8_t lane, uint8_t step, bool active) {
+        if (active) {
+            gates[lane] |= 1ULL << step;
+        } else {
+            gates[lane] &= ~(1ULL << step);
+        }
+    }
+
+    void setStep(uint8_t lane, uint8_t step, uint8_t note, uint8_t velocity, bool active) {
+        notes[lane][step] = note;
+        velocities[lane][step] = velocity;
+        setActive(lane, step, active);
+    }
+
+    // Same steps, notes and length, whatever the padding holds
+    bool sameAs(const StepPattern& other) const {
+        return length == other.length && !memcmp(gates, other.gates, sizeof(gates)) &&
+               !memcmp(notes, other.notes, sizeof(notes)) && !memcmp(velocities, other.velocities, sizeof(velocities));
+    }
+
+    // Active steps of the lane within the length
+    uint8_t countActive(uint8_t lane) const {
+        uint64_t mask = (length < 64) ? (1ULL << length) - 1 : ~0ULL;
+        return (uint8_t)__builtin_popcountll(gates[lane] & mask);
+    }
+};
+
+class PatternStore {
+public:
+    PatternStore() {
+        clear();
+    }
+
+    void clear() {
+        for (uint8_t s = 0; s < PATTERN_SLOTS; s++) {
+            memset(slots[s].gates, 0, sizeof(slots[s].gates));
+            slots[s].length = 0;
+        }
+        used = 0;
+    }
+
+    // Copies the pattern into the slot, replacing what was there. False if
+    // the pool has no room for the extra steps.
+    bool save(uint8_t slot, const StepPattern& pattern) {
+        if (slot >= PATTERN_SLOTS) return false;
+        if (!resize(slot, pattern.length)) return false;
+        Slot& entry = slots[slot];
+        memcpy(entry.gates, pattern.gates, sizeof(entry.gates));
+        uint16_t offset = offsetOf(slot);
+        for (uint8_t step = 0; step < pattern.length; step++) {
+            for (uint8_t lane = 0; lane < PATTERN_LANES; lane++) {
+                notes[offset + step][lane] = pattern.notes[lane][step];
+                velocities[offset + step][lane] = pattern.velocities[lane][step];
+            }
+        }
+        return true;
+    }
+
+    // Copies the slot out; false (pattern untouched) if it is empty
+    bool load(uint8_t slot, StepPattern& pattern) const {
+        if (!isUsed(slot)) return false;
+        const Slot& entry = slots[slot];
+        memcpy(pattern.gates, entry.gates, sizeof(pattern.gates));
+        uint16_t offset = offsetOf(slot);
+        for (uint8_t step = 0; step < entry.length; step++) {
+            for (uint8_t lane = 0; lane < PATTERN_LANES; lane++) {
+                pattern.notes[lane][step] = notes[offset + step][lane];
+                pattern.velocities[lane][step] = velocities[offset + step][lane];
+            }
+        }
+        pattern.length = entry.length;
+        return true;
+    }
+
+    void erase(uint8_t slot) {
+        if (!isUsed(slot)) return;
+        resize(slot, 0);
+        memset(slots[slot].gates, 0, sizeof(slots[slot].gates));
+    }
+
+    bool isUsed(uint8_t slot) const { return slot < PATTERN_SLOTS && slots[slot].length; }
+    uint8_t getLength(uint8_t slot) const { return slot < PATTERN_SLOTS ? slots[slot].length : 0; }
+    uint16_t getFreeSteps() const { return PATTERN_POOL_STEPS - used; }
+
+private:
+    // Slots lie in the pool in slot order, each right after the one before
+    struct Slot {
+        uint64_t gates[PATTERN_LANES];
+        uint8_t length;                     // 0: empty
+    };
+
+    Slot slots[PATTERN_SLOTS];
+    uint8_t notes[PATTERN_POOL_STEPS][PATTERN_LANES];
+    uint8_t velocities[PATTERN_POOL_STEPS][PATTERN_LANES];
+    uint16_t used;                          // Pool steps taken
+
+    uint16_t offsetOf(uint8_t slot) const {
+        uint16_t offset = 0;
+        for (uint8_t s = 0; s < slot; s++) offset += slots[s].length;
+        return offset;
+    }
+
+    // Moves the slots after this one to make (or give back) room
+    bool resize(uint8_t slot, uint8_t length) {
+        int16_t change = (int16_t)length - slots[slot].length;
+        if (change > (int16_t)(PATTERN_POOL_STEPS - used)) return false;
+        uint16_t end = offsetOf(slot) + slots[slot].length;
+        if (change && end < used) {
+            memmove(notes[end + change], notes[end], (used - end) * PATTERN_LANES);
+            memmove(velocities[end + change], velocities[end], (used - end) * PATTERN_LANES);
+        }
+        used += change;
+        slots[slot].length = length;
+        return true;
+    }
+};
+
+struct SongEntry {
+    uint8_t slot;
+    uint8_t repeats;
+};
+
+class SongChain {
+public:
+    SongChain() {
+        clear();
+    }
+
+    void clear() {
+        count = 0;
+        loop = true;
+    }
+
+    bool append(uint8_t slot, uint8_t repeats = 1) {
+        if (count >= SONG_CHAIN_MAX || slot >= PATTERN_SLOTS || !repeats) return false;
+        entries[count].slot = slot;
+        entries[count].repeats = repeats;
+        count++;
+        return true;
+    }
+
+    // Off: the song stops at its end (slotAt() returns PATTERN_NONE)
+    void setLoop(bool enabled) { loop = enabled; }
+    bool isLooping() const { return loop; }
+
+    uint8_t getLength() const { return count; }
+    const SongEntry& getEntry(uint8_t index) const { return entries[index]; }
+
+    // Patterns played in one pass, repeats counted
+    uint16_t getPatternCount() const {
+        uint16_t total = 0;
+        for (uint8_t i = 0; i < count; i++) total += entries[i].repeats;
+        return total;
+    }
+
+    // Slot of the position'th pattern played from the start of the song
+    uint8_t slotAt(uint32_t position) const {
+        uint16_t total = getPatternCount();
+        if (!total || (position >= total && !loop)) return PATTERN_NONE;
+        position %= total;
+        for (uint8_t i = 0; i < count; i++) {
+            if (position < entries[i].repeats) return entries[i].slot;
+            position -= entries[i].repeats;
+        }
+        return PATTERN_NONE;
+    }
+
+private:
+    SongEntry entries[SONG_CHAIN_MAX];
+    uint8_t count;
+    bool loop;
+};
+
+#endif // MINTYSYNTH_PATTERNSTORE_H
@@ -0,0 +1,280 @@
+/*
+ * MintySynth Preset Log Implementation
+ */
+
+#include "PresetLog.h"
+#include <string.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <LittleFS.h>
+#endif
+
+// Record header: magic "MP", version, slot, section, 0, payload length,
+// then the CRC-32 of the first 8 header bytes and the payload
+static const uint8_t PRESET_MAGIC0 = 'M';
+static const uint8_t PRESET_MAGIC1 = 'P';
+
+PresetLog::PresetLog() : file(), open(false), logSize(0), recordsWritten(0), writesSkipped(0),
+                         compactions(0), recovered(false) {
+    path[0] = '\0';
+    for (uint8_t slot = 0; slot < PRESET_SLOTS; slot++) {
+        for (uint8_t section = 0; section < PRESET_SECTIONS; section++) {
+            entries[slot][section].offset = PRESET_NO_RECORD;
+            entries[slot][section].length = 0;
+        }
+    }
+}
+
+PresetLog::~PresetLog() {
+    end();
+}
+
+bool PresetLog::begin(const char* logPath) {
+    end();
+    if (strlen(logPath) >= PRESET_PATH_MAX) return false;
+    strcpy(path, logPath);
+    if (!mount() || !openFile(file, path, false)) return false;
+    open = true;
+    recovered = false;
+
+    if (!scan()) {
+        recovered = true;
+        return compact();
+    }
+    return true;
+}
+
+void PresetLog::end() {
+    if (!open) return;
+    closeFile(file);
+    open = false;
+}
+
+// CRC-32 (IEEE, reflected), a nibble at a time from a 16-entry table
+uint32_t PresetLog::crc32(const void* data, size_t length, uint32_t crc) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = (crc >> 4) ^ table[(crc ^ p[i]) & 0x0F];
+        crc = (crc >> 4) ^ table[(crc ^ (p[i] >> 4)) & 0x0F];
+    }
+    return ~crc;
+}
+
+// Builds the index from the records in order. False at the first record
+// that is cut short or fails its CRC.
+bool PresetLog::scan() {
+    uint8_t header[PRESET_HEADER_SIZE];
+    uint8_t payload[PRESET_SECTION_MAX];
+    uint32_t size = fileSize(file);
+    uint32_t offset = 0;
+
+    while (offset < size) {
+        if (size - offset < PRESET_HEADER_SIZE || !readAt(file, offset, header, sizeof(header))) break;
+        uint16_t length = header[6] | ((uint16_t)header[7] << 8);
+        uint32_t stored = header[8] | ((uint32_t)header[9] << 8) | ((uint32_t)header[10] << 16) |
+                          ((uint32_t)header[11] << 24);
+        if (header[0] != PRESET_MAGIC0 || header[1] != PRESET_MAGIC1 || length > PRESET_SECTION_MAX) break;
+        if (size - offset - PRESET_HEADER_SIZE < length) break;
+        if (length && !readAt(file, offset + PRESET_HEADER_SIZE, payload, length)) break;
+        if (crc32(payload, length, crc32(header, 8)) != stored) break;
+
+        uint8_t version = header[2];
+        uint8_t slot = header[3];
+        uint8_t section = header[4];
+        if (version <= PRESET_FORMAT_VERSION && slot < PRESET_SLOTS && section < PRESET_SECTIONS) {
+            Entry& entry = entries[slot][section];
+            entry.offset = length ? offset : PRESET_NO_RECORD;     // Empty: erased
+            entry.length = length;
+            entry.version = version;
+            entry.crc = crc32(payload, length);
+        }
+        offset += PRESET_HEADER_SIZE + length;
+    }
+
+    logSize = offset;
+    return offset == size;
+}
+
+bool PresetLog::appendRecord(PresetFile& target, uint32_t& size, uint8_t slot, uint8_t section,
+                             const void* data, uint16_t length, uint8_t version, Entry& entry) {
+    uint8_t header[PRESET_HEADER_SIZE] = {
+        PRESET_MAGIC0, PRESET_MAGIC1, version, slot, section, 0, (uint8_t)length, (uint8_t)(length >> 8)
+    };
+    uint32_t crc = crc32(data, length, crc32(header, 8));
+    header[8] = (uint8_t)crc;
+    header[9] = (uint8_t)(crc >> 8);
+    header[10] = (uint8_t)(crc >> 16);
+    header[11] = (uint8_t)(crc >> 24);
+    if (!appendBytes(target, header, sizeof(header))) return false;
+    if (length && !appendBytes(target, data, length)) return false;
+
+    entry.offset = length ? size : PRESET_NO_RECORD;
+    entry.length = length;
+    entry.version = version;
+    entry.crc = crc32(data, length);
+    size += PRESET_HEADER_SIZE + length;
+    return true;
+}
+
+bool PresetLog::write(uint8_t slot, uint8_t section, const void* data, uint16_t length) {
+    if (!open || slot >= PRESET_SLOTS || section >= PRESET_SECTIONS || length > PRESET_SECTION_MAX) return false;
+
+    // Unchanged: the CRC and length say so cheaply, the bytes make sure
+    Entry& entry = entries[slot][section];
+    if (entry.offset != PRESET_NO_RECORD && entry.length == length && entry.version == PRESET_FORMAT_VERSION &&
+        entry.crc == crc32(data, length)) {
+        uint8_t stored[PRESET_SECTION_MAX];
+        if (readAt(file, entry.offset + PRESET_HEADER_SIZE, stored, length) && !memcmp(stored, data, length)) {
+            writesSkipped++;
+            return true;
+        }
+    }
+
+    if (logSize + PRESET_HEADER_SIZE + length > PRESET_LOG_LIMIT && !compact()) return false;
+    if (!appendRecord(file, logSize, slot, section, data, length, PRESET_FORMAT_VERSION, entry)) return false;
+    recordsWritten++;
+    return true;
+}
+
+int16_t PresetLog::read(uint8_t slot, uint8_t section, void* data, uint16_t size, uint8_t* version) {
+    if (!open || !has(slot, section)) return -1;
+    const Entry& entry = entries[slot][section];
+    if (entry.length > size) return -1;
+    if (!readAt(file, entry.offset + PRESET_HEADER_SIZE, data, entry.length)) return -1;
+    if (crc32(data, entry.length) != entry.crc) return -1;     // Changed under us on the flash
+    if (version) *version = entry.version;
+    return (int16_t)entry.length;
+}
+
+bool PresetLog::has(uint8_t slot, uint8_t section) {
+    return slot < PRESET_SLOTS && section < PRESET_SECTIONS && entries[slot][section].offset != PRESET_NO_RECORD;
+}
+
+void PresetLog::erase(uint8_t slot) {
+    if (!open || slot >= PRESET_SLOTS) return;
+    for (uint8_t section = 0; section < PRESET_SECTIONS; section++) {
+        Entry& entry = entries[slot][section];
+        if (entry.offset == PRESET_NO_RECORD) continue;
+        if (logSize + PRESET_HEADER_SIZE > PRESET_LOG_LIMIT && !compact()) return;
+        if (appendRecord(file, logSize, slot, section, NULL, 0, PRESET_FORMAT_VERSION, entry)) recordsWritten++;
+    }
+}
+
+// The newest record of every section goes into path.new, which then
+// replaces the log in one rename, so losing power here loses nothing.
+bool PresetLog::compact() {
+    if (!open) return false;
+    char newPath[PRESET_PATH_MAX + 4];
+    snprintf(newPath, sizeof(newPath), "%s.new", path);
+
+    PresetFile target;
+    if (!openFile(target, newPath, true)) return false;
+
+    Entry compacted[PRESET_SLOTS][PRESET_SECTIONS];
+    uint8_t payload[PRESET_SECTION_MAX];
+    uint32_t size = 0;
+    bool ok = true;
+    for (uint8_t slot = 0; slot < PRESET_SLOTS && ok; slot++) {
+        for (uint8_t section = 0; section < PRESET_SECTIONS && ok; section++) {
+            const Entry& entry = entries[slot][section];
+            compacted[slot][section].offset = PRESET_NO_RECORD;
+            compacted[slot][section].length = 0;
+            if (entry.offset == PRESET_NO_RECORD) continue;
+            ok = readAt(file, entry.offset + PRESET_HEADER_SIZE, payload, entry.length) &&
+                 appendRecord(target, size, slot, section, payload, entry.length, entry.version,
+                              compacted[slot][section]);
+        }
+    }
+    closeFile(target);
+    if (!ok) return false;
+
+    closeFile(file);
+    open = false;
+    if (!replaceFile(newPath, path) || !openFile(file, path, false)) return false;
+    open = true;
+    memcpy(entries, compacted, sizeof(entries));
+    logSize = size;
+    compactions++;
+    return true;
+}
+
+// -------------------------------------------------------------------------
+// Storage: LittleFS on the ESP32, stdio on the host
+// -------------------------------------------------------------------------
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+bool PresetLog::mount() {
+    return LittleFS.begin(true);    // Formats a partition that has never been used
+}
+
+// Append mode: reads seek anywhere, writes always go to the end
+bool PresetLog::openFile(PresetFile& target, const char* name, bool truncate) {
+    target = LittleFS.open(name, truncate ? "w+" : "a+");
+    return (bool)target;
+}
+
+void PresetLog::closeFile(PresetFile& target) {
+    target.close();
+}
+
+bool PresetLog::readAt(PresetFile& source, uint32_t offset, void* data, size_t length) {
+    return source.seek(offset) && source.read((uint8_t*)data, length) == length;
+}
+
+bool PresetLog::appendBytes(PresetFile& target, const void* data, size_t length) {
+    if (target.write((const uint8_t*)data, length) != length) return false;
+    target.flush();
+    return true;
+}
+
+uint32_t PresetLog::fileSize(PresetFile& source) {
+    return source.size();
+}
+
+// LittleFS renames over an existing file atomically
+bool PresetLog::replaceFile(const char* from, const char* to) {
+    return LittleFS.rename(from, to);
+}
+
+#else
+
+bool PresetLog::mount() {
+    return true;
+}
+
+bool PresetLog::openFile(PresetFile& target, const char* name, bool truncate) {
+    target = fopen(name, truncate ? "w+b" : "a+b");
+    return target != NULL;
+}
+
+void PresetLog::closeFile(PresetFile& target) {
+    if (target) fclose(target);
+    target = NULL;
+}
+
+bool PresetLog::readAt(PresetFile& source, uint32_t offset, void* data, size_t length) {
+    return fseek(source, offset, SEEK_SET) == 0 && fread(data, 1, length, source) == length;
+}
+
+// stdio wants a seek between a read and a write, even in append mode
+bool PresetLog::appendBytes(PresetFile& target, const void* data, size_t length) {
+    if (fseek(target, 0, SEEK_END) != 0 || fwrite(data, 1, length, target) != length) return false;
+    return fflush(target) == 0;
+}
+
+uint32_t PresetLog::fileSize(PresetFile& source) {
+    if (fseek(source, 0, SEEK_END) != 0) return 0;
+    return (uint32_t)ftell(source);
+}
+
+bool PresetLog::replaceFile(const char* from, const char* to) {
+    return rename(from, to) == 0;
+}
+
+#endif
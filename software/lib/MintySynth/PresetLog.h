@@ -0,0 +1,218 @@
+/*
+ * MintySynth Preset Log
+ *
+ * Presets and patterns kept in one append-only file on LittleFS (a plain
+ * file on the host). Every save appends a record: a 12-byte header with
+ * the format version, slot, section and a CRC-32, then the section in
+ * its compact encoding (PresetWriter/PresetReader below). A preset is
+ * split into sections (sounds, modulation, globals, pattern), and a save
+ * appends only the sections whose bytes changed, so tweaking one knob
+ * writes a few dozen bytes rather than the whole preset.
+ *
+ * begin() reads the log once and keeps the offset of the newest record
+ * of every slot and section in RAM, so a load is one seek and one read.
+ * A record that is torn (power lost mid-write) or fails its CRC ends the
+ * scan: everything before it is kept and the log is rewritten without
+ * the rest. Past PRESET_LOG_LIMIT the newest records are copied into a
+ * new file and the old one dropped. Appending and rare compaction spread
+ * the writes over the whole partition (LittleFS wear-levels its blocks),
+ * where rewriting a fixed NVS key wears the same pages each time.
+ *
+ * Records with a newer format version than PRESET_FORMAT_VERSION are
+ * skipped (and not carried over by compaction); the reader of each
+ * section gets the version and can still read older ones.
+ *
+ * One task only (the UI side).
+ */
+
+#ifndef MINTYSYNTH_PRESETLOG_H
+#define MINTYSYNTH_PRESETLOG_H
+
+#include <Arduino.h>
+#include "PatternStore.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <FS.h>
+typedef fs::File PresetFile;
+#else
+#include <stdio.h>
+typedef FILE* PresetFile;
+#endif
+
+#define PRESET_FORMAT_VERSION   1
+#define PRESET_SLOTS            16
+#define PRESET_SECTION_MAX      640                     // Bytes, a full 64-step pattern fits
+#define PRESET_LOG_LIMIT        (64 * 1024UL)           // Compacted past this
+#define PRESET_PATH_MAX         32
+#define PRESET_HEADER_SIZE      12
+#define PRESET_NO_RECORD        0xFFFFFFFFUL
+
+enum PresetSection {
+    PRESET_VOICES = 0,      // Sound of each lane
+    PRESET_ROUTES,          // Modulation matrix
+    PRESET_GLOBALS,         // Tempo, swing, scale and the like
+    PRESET_PATTERN,         // Steps, encoded by presetPutPattern()
+    PRESET_SECTIONS
+};
+
+// Little-endian byte packing for section payloads. Running past the end
+// sets the overflow flag instead of writing or reading out of bounds.
+class PresetWriter {
+public:
+    PresetWriter(uint8_t* buffer, uint16_t bufferSize) : data(buffer), size(bufferSize), used(0), overflow(false) {}
+
+    void put8(uint8_t value) {
+        if (used >= size) {
+            overflow = true;
+            return;
+        }
+        data[used++] = value;
+    }
+
+    void put16(uint16_t value) {
+        put8((uint8_t)value);
+        put8((uint8_t)(value >> 8));
+    }
+
+    uint16_t getLength() const { return used; }
+    bool isOverflow() const { return overflow; }
+
+private:
+    uint8_t* data;
+    uint16_t size;
+    uint16_t used;
+    bool overflow;
+};
+
+class PresetReader {
+public:
+    PresetReader(const uint8_t* buffer, uint16_t length) : data(buffer), size(length), used(0), overflow(false) {}
+
+    uint8_t get8() {
+        if (used >= size) {
+            overflow = true;
+            return 0;
+        }
+        return data[used++];
+    }
+
+    uint16_t get16() {
+        uint16_t low = get8();
+        return low | ((uint16_t)get8() << 8);
+    }
+
+    bool isOverflow() const { return overflow; }
+
+private:
+    const uint8_t* data;
+    uint16_t size;
+    uint16_t used;
+    bool overflow;
+};
+
+// Pattern section: the length, each lane's gates in (length + 7) / 8
+// bytes, then a note and a velocity for the active steps only. A 16-step
+// pattern with 16 hits takes 41 bytes.
+inline void presetPutPattern(PresetWriter& out, const StepPattern& pattern) {
+    out.put8(pattern.length);
+    for (uint8_t lane = 0; lane < PATTERN_LANES; lane++) {
+        for (uint8_t bit = 0; bit < pattern.length; bit += 8) {
+            out.put8((uint8_t)(pattern.gates[lane] >> bit));
+        }
+    }
+    for (uint8_t lane = 0; lane < PATTERN_LANES; lane++) {
+        for (uint8_t step = 0; step < pattern.length; step++) {
+            if (!pattern.isActive(lane, step)) continue;
+            out.put8(pattern.notes[lane][step]);
+            out.put8(pattern.velocities[lane][step]);
+        }
+    }
+}
+
+// Steps past the length and inactive steps come back on `note`
+inline bool presetGetPattern(PresetReader& in, StepPattern& pattern, uint8_t note) {
+    uint8_t length = in.get8();
+    if (!length || length > PATTERN_MAX_STEPS) return false;
+    pattern.clear(length, note);
+    for (uint8_t lane = 0; lane < PATTERN_LANES; lane++) {
+        for (uint8_t bit = 0; bit < length; bit += 8) {
+            pattern.gates[lane] |= (uint64_t)in.get8() << bit;
+        }
+        if (length < 64) pattern.gates[lane] &= (1ULL << length) - 1;
+    }
+    for (uint8_t lane = 0; lane < PATTERN_LANES; lane++) {
+        for (uint8_t step = 0; step < length; step++) {
+            if (!pattern.isActive(lane, step)) continue;
+            pattern.notes[lane][step] = in.get8();
+            pattern.velocities[lane][step] = in.get8();
+        }
+    }
+    return !in.isOverflow();
+}
+
+class PresetLog {
+public:
+    PresetLog();
+    ~PresetLog();
+
+    // Mounts LittleFS (on the ESP32) and reads the log at path, creating
+    // it if missing
+    bool begin(const char* path);
+    void end();
+
+    // Appends the section unless the newest copy already has these bytes.
+    // False if the log is not open or the write failed.
+    bool write(uint8_t slot, uint8_t section, const void* data, uint16_t length);
+
+    // Newest copy of the section: its length, or -1 if there is none (or
+    // it is longer than size, or it failed its CRC). version receives the
+    // format version it was written with.
+    int16_t read(uint8_t slot, uint8_t section, void* data, uint16_t size, uint8_t* version = NULL);
+
+    bool has(uint8_t slot, uint8_t section);
+    void erase(uint8_t slot);           // Every section of the slot
+
+    // Rewrites the log with the newest record of each section only
+    bool compact();
+
+    uint32_t getSize() { return logSize; }
+    uint32_t getRecordsWritten() { return recordsWritten; }
+    uint32_t getWritesSkipped() { return writesSkipped; }    // Unchanged sections
+    uint32_t getCompactions() { return compactions; }
+    bool isRecovered() { return recovered; }                // begin() dropped a torn tail
+
+    static uint32_t crc32(const void* data, size_t length, uint32_t crc = 0);
+
+private:
+    struct Entry {
+        uint32_t offset;        // Of the record header, PRESET_NO_RECORD if none
+        uint16_t length;
+        uint8_t version;
+        uint32_t crc;           // Of the payload
+    };
+
+    PresetFile file;
+    bool open;
+    char path[PRESET_PATH_MAX];
+    Entry entries[PRESET_SLOTS][PRESET_SECTIONS];
+    uint32_t logSize;
+    uint32_t recordsWritten;
+    uint32_t writesSkipped;
+    uint32_t compactions;
+    bool recovered;
+
+    bool scan();
+    bool appendRecord(PresetFile& target, uint32_t& size, uint8_t slot, uint8_t section,
+                      const void* data, uint16_t length, uint8_t version, Entry& entry);
+
+    // Storage: the only platform-specific part
+    static bool mount();
+    static bool openFile(PresetFile& target, const char* name, bool truncate);
+    static void closeFile(PresetFile& target);
+    static bool readAt(PresetFile& source, uint32_t offset, void* data, size_t length);
+    static bool appendBytes(PresetFile& target, const void* data, size_t length);
+    static uint32_t fileSize(PresetFile& source);
+    static bool replaceFile(const char* from, const char* to);
+};
+
+#endif // MINTYSYNTH_PRESETLOG_H
@@ -0,0 +1,143 @@
+/*
+ * MintySynth Sequencer Clock
+ *
+ * Step timing on the audio sample clock instead of millis(). Step
+ * positions are counted in samples with SEQ_FRACTION_BITS fraction bits,
+ * so a 16th at any tempo keeps its exact length (5512.5 samples at 120
+ * BPM) and nothing drifts. Swing delays the odd step of every pair
+ * without moving the pair, and each step is placed from the start of its
+ * pair, so the fractions never add up. Patterns of odd length end on an
+ * unswung step, so step 0 stays on the beat.
+ *
+ * The render loop owns the clock: before each block it asks how many
+ * frames are left until the next step, renders up to there, and calls
+ * advance() to play the step on its exact frame. Timing then depends only
+ * on the samples rendered, not on when the UI or the render task runs.
+ *
+ * Header only, so the sketches can use it with their own audio loop.
+ */
+
+#ifndef MINTYSYNTH_SEQUENCERCLOCK_H
+#define MINTYSYNTH_SEQUENCERCLOCK_H
+
+#include <Arduino.h>
+
+#define SEQ_FRACTION_BITS  16
+
+// One 16th-note step at bpm, in 1/2^SEQ_FRACTION_BITS samples
+inline uint64_t sequencerStepLength(uint16_t bpm, uint32_t sampleRate) {
+    return ((uint64_t)sampleRate * 15 << SEQ_FRACTION_BITS) / (bpm ? bpm : 1);
+}
+
+class SequencerClock {
+public:
+    SequencerClock() {
+        begin(44100, 16);
+    }
+
+    void begin(uint32_t rate, uint8_t steps) {
+        sampleRate = rate;
+        stepCount = steps ? steps : 1;
+        step = stepCount - 1;
+        running = false;
+        cued = false;
+        swing = 0;
+        swingScale = 1;
+        stepLength = sequencerStepLength(120, sampleRate);
+        swingDelay = 0;
+        pairStart = 0;
+        nextStepAt = 0;
+    }
+
+    // Both move the next step, counted from the start of the current pair
+    void setTempo(uint16_t bpm) {
+        stepLength = sequencerStepLength(bpm, sampleRate);
+        swingDelay = stepLength * swing / (2 * swingScale);
+        reschedule();
+    }
+
+    // Odd steps late by amount / fullScale of half a step
+    void setSwing(uint16_t amount, uint16_t fullScale) {
+        swing = amount;
+        swingScale = fullScale ? fullScale : 1;
+        swingDelay = stepLength * swing / (2 * swingScale);
+        reschedule();
+    }
+
+    // Steps per pattern, from the next step on; a step past the new end
+    // wraps to 0
+    void setLength(uint8_t steps) {
+        stepCount = steps ? steps : 1;
+        reschedule();
+    }
+
+    uint8_t getLength() const { return stepCount; }
+
+    // Step 0 plays at `frame` (frames rendered so far)
+    void start(uint64_t frame) {
+        running = true;
+        cued = true;
+        step = stepCount - 1;
+        nextStepAt = frame << SEQ_FRACTION_BITS;
+    }
+
+    void stop() {
+        running = false;
+    }
+
+    bool isRunning() const { return running; }
+
+    // Frames from `frame` to the next step: 0 if one is due, at most limit
+    uint32_t framesUntilStep(uint64_t frame, uint32_t limit) const {
+        if (!running) return limit;
+        uint64_t due = getNextStepFrame();
+        if (due <= frame) return 0;
+        return (due - frame < limit) ? (uint32_t)(due - frame) : limit;
+    }
+
+    // First frame at or after the next step
+    uint64_t getNextStepFrame() const {
+        return (nextStepAt + (1ULL << SEQ_FRACTION_BITS) - 1) >> SEQ_FRACTION_BITS;
+    }
+
+    // Moves on to the step that is due and returns it
+    uint8_t advance() {
+        step = (cued || step + 1 >= stepCount) ? 0 : step + 1;
+        if ((step & 1) == 0) pairStart = nextStepAt;
+        cued = false;
+        schedule();
+        return step;
+    }
+
+    uint8_t getStep() const { return step; }
+    uint64_t getStepLength() const { return stepLength; }     // In SEQ_FRACTION_BITS units
+
+private:
+    uint32_t sampleRate;
+    uint8_t stepCount;
+    uint8_t step;               // Last played
+    bool running;
+    bool cued;                  // Step 0 due after start(), not played yet
+    uint16_t swing;
+    uint16_t swingScale;
+    uint64_t stepLength;
+    uint64_t swingDelay;
+    uint64_t pairStart;         // The last even step
+    uint64_t nextStepAt;
+
+    void schedule() {
+        if (step & 1) {
+            nextStepAt = pairStart + 2 * stepLength;
+        } else if (step + 1 >= stepCount) {
+            nextStepAt = pairStart + stepLength;
+        } else {
+            nextStepAt = pairStart + stepLength + swingDelay;
+        }
+    }
+
+    void reschedule() {
+        if (running && !cued) schedule();
+    }
+};
+
+#endif // MINTYSYNTH_SEQUENCERCLOCK_H
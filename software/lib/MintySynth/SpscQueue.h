@@ -0,0 +1,57 @@
+/*
+ * MintySynth SPSC Queue
+ *
+ * Lock-free single-producer/single-consumer ring buffer for passing
+ * commands from the UI core to the audio core. Exactly one task may call
+ * push() and exactly one other task may call pop(); neither side ever
+ * blocks. Header only, so the sketches can use it as well.
+ */
+
+#ifndef MINTYSYNTH_SPSCQUEUE_H
+#define MINTYSYNTH_SPSCQUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+template <typename T, size_t CAPACITY>
+class SpscQueue {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    // Producer side. Returns false (and drops the item) when full.
+    bool push(const T& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= CAPACITY) return false;
+        items[h & (CAPACITY - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false when empty.
+    bool pop(T& item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        item = items[t & (CAPACITY - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Snapshot, exact only when called from one of the two sides
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return CAPACITY; }
+
+private:
+    T items[CAPACITY];
+    // Free-running counters; the producer owns head, the consumer owns tail
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+};
+
+#endif // MINTYSYNTH_SPSCQUEUE_H
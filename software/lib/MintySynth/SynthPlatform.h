@@ -0,0 +1,165 @@
+/*
+ * MintySynth Platform Layer
+ *
+ * Task creation and timing for the audio pipeline. On the ESP32 tasks
+ * are FreeRTOS tasks pinned to a core; on a host build they run on
+ * std::thread so the pipeline and its queues can be exercised natively.
+ *
+ * Periodic timers (input scanning) are esp_timer timers on the ESP32:
+ * a hardware timer whose callbacks run in the high-priority esp_timer
+ * task on core 0. On a host build a thread calls back on schedule.
+ */
+
+#ifndef MINTYSYNTH_SYNTHPLATFORM_H
+#define MINTYSYNTH_SYNTHPLATFORM_H
+
+#include <Arduino.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+#else
+#include <thread>
+#include <chrono>
+#include <atomic>
+#endif
+
+// Core layout: audio owns core 1, input and display run on core 0
+#define AUDIO_TASK_CORE       1
+#define AUDIO_TASK_PRIORITY   (configMAX_PRIORITIES - 2)
+#define AUDIO_TASK_STACK      4096
+#define UI_TASK_CORE          0
+#define UI_TASK_PRIORITY      1
+#define UI_TASK_STACK         8192
+
+#if !defined(ARDUINO_ARCH_ESP32)
+#ifndef configMAX_PRIORITIES
+#define configMAX_PRIORITIES  25
+#endif
+#endif
+
+typedef void (*SynthTaskFunction)(void* arg);
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+typedef TaskHandle_t SynthTask;
+
+static inline bool synthTaskStart(SynthTask* task, SynthTaskFunction entry, void* arg,
+                                  const char* name, uint32_t stack, uint8_t priority, int core) {
+    return xTaskCreatePinnedToCore(entry, name, stack, arg, priority, task, core) == pdPASS;
+}
+
+// Last call of a task entry function (FreeRTOS tasks must not return)
+static inline void synthTaskExit() {
+    vTaskDelete(NULL);
+}
+
+// Releases the handle of a task that has exited. FreeRTOS has no join, so
+// the caller waits for the task to signal completion first.
+static inline void synthTaskJoin(SynthTask* task) {
+    *task = NULL;
+}
+
+static inline void synthSleepMs(uint32_t ms) {
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+typedef esp_timer_handle_t SynthTimer;
+
+// Calls callback(arg) every periodUs until synthTimerStop(). The callback
+// must be short and must not block: it holds up every other esp_timer.
+static inline bool synthTimerStart(SynthTimer* timer, SynthTaskFunction callback, void* arg,
+                                   const char* name, uint32_t periodUs) {
+    esp_timer_create_args_t args = {};
+    args.callback = callback;
+    args.arg = arg;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = name;
+    if (esp_timer_create(&args, timer) != ESP_OK) return false;
+    if (esp_timer_start_periodic(*timer, periodUs) != ESP_OK) {
+        esp_timer_delete(*timer);
+        *timer = NULL;
+        return false;
+    }
+    return true;
+}
+
+// Stops the timer; a callback already under way still finishes
+static inline void synthTimerStop(SynthTimer* timer) {
+    if (*timer) {
+        esp_timer_stop(*timer);
+        esp_timer_delete(*timer);
+        *timer = NULL;
+    }
+}
+
+#else
+
+typedef std::thread* SynthTask;
+
+// Host threads ignore priority and core
+static inline bool synthTaskStart(SynthTask* task, SynthTaskFunction entry, void* arg,
+                                  const char* name, uint32_t stack, uint8_t priority, int core) {
+    (void)name; (void)stack; (void)priority; (void)core;
+    std::thread* thread = new std::thread(entry, arg);
+    if (task) {
+        *task = thread;
+    } else {
+        thread->detach();
+        delete thread;
+    }
+    return true;
+}
+
+static inline void synthTaskExit() {
+}
+
+static inline void synthTaskJoin(SynthTask* task) {
+    if (*task) {
+        (*task)->join();
+        delete *task;
+        *task = NULL;
+    }
+}
+
+static inline void synthSleepMs(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+struct SynthHostTimer {
+    std::thread thread;
+    std::atomic<bool> running;
+};
+
+typedef SynthHostTimer* SynthTimer;
+
+static inline bool synthTimerStart(SynthTimer* timer, SynthTaskFunction callback, void* arg,
+                                   const char* name, uint32_t periodUs) {
+    (void)name;
+    SynthHostTimer* host = new SynthHostTimer();
+    host->running = true;
+    host->thread = std::thread([host, callback, arg, periodUs]() {
+        std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+        while (host->running.load()) {
+            callback(arg);
+            next += std::chrono::microseconds(periodUs);
+            std::this_thread::sleep_until(next);
+        }
+    });
+    *timer = host;
+    return true;
+}
+
+static inline void synthTimerStop(SynthTimer* timer) {
+    if (*timer) {
+        (*timer)->running = false;
+        (*timer)->thread.join();
+        delete *timer;
+        *timer = NULL;
+    }
+}
+
+#endif
+
+#endif // MINTYSYNTH_SYNTHPLATFORM_H
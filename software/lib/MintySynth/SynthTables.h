@@ -0,0 +1,120 @@
+/*
+ * MintySynth Synthesis Tables
+ *
+ * constexpr math and table builders. Wave, pitch and envelope tables are
+ * evaluated by the compiler for the configured sample rate, so nothing
+ * transcendental runs at note-on and a sample rate change can never
+ * leave a table behind. Needs C++17 (see platformio.ini).
+ *
+ * Header only, and every name is prefixed, so sketches can include it
+ * next to their own definitions.
+ */
+
+#ifndef MINTYSYNTH_SYNTHTABLES_H
+#define MINTYSYNTH_SYNTHTABLES_H
+
+#include <Arduino.h>
+
+#define SYNTH_TABLE_NOTES  128     // MIDI notes 0-127
+
+// Tables read by the render path live in internal RAM on the ESP32, so
+// they stay fast while the flash cache is busy or disabled
+#if defined(ARDUINO_ARCH_ESP32)
+#define SYNTH_TABLE_ATTR DRAM_ATTR
+#else
+#define SYNTH_TABLE_ATTR
+#endif
+
+static constexpr double SYNTH_PI = 3.14159265358979323846;
+static constexpr double SYNTH_LN2 = 0.69314718055994530942;
+
+// Nearest integer, halves away from zero
+constexpr int64_t synthRound(double x) {
+    return (x >= 0) ? (int64_t)(x + 0.5) : -(int64_t)(-x + 0.5);
+}
+
+// sin(x): reduced to [-pi, pi], then a Taylor series good to ~1e-12
+constexpr double synthSin(double x) {
+    x -= 2.0 * SYNTH_PI * (double)synthRound(x / (2.0 * SYNTH_PI));
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 14; n++) {
+        term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+        sum += term;
+    }
+    return sum;
+}
+
+// e^x: x = k ln2 + r with |r| <= ln2 / 2, series for e^r, then scaled by 2^k
+constexpr double synthExp(double x) {
+    int64_t k = synthRound(x / SYNTH_LN2);
+    double r = x - (double)k * SYNTH_LN2;
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 18; n++) {
+        term *= r / n;
+        sum += term;
+    }
+    for (; k > 0; k--) sum *= 2.0;
+    for (; k < 0; k++) sum *= 0.5;
+    return sum;
+}
+
+constexpr double synthExp2(double x) {
+    return synthExp(x * SYNTH_LN2);
+}
+
+// 32-bit DDS tuning word for hz at sampleRate, clamped at Nyquist
+constexpr uint32_t synthTuningWord(double hz, uint32_t sampleRate) {
+    double ftw = hz * (4294967296.0 / sampleRate);
+    if (ftw <= 0.0) return 0;
+    if (ftw >= 2147483647.0) return 0x7FFFFFFF;
+    return (uint32_t)(ftw + 0.5);
+}
+
+// Tunings. The non-equal ones are C-based: C keeps its equal-tempered
+// pitch and the other pitch classes move by the cents below.
+enum SynthTuning {
+    TUNING_EQUAL = 0,           // 12-tone equal temperament, A4 = 440 Hz
+    TUNING_JUST,                // 5-limit just intonation
+    TUNING_PYTHAGOREAN,         // Pure fifths, wolf between F# and C#
+    TUNING_WERCKMEISTER,        // Werckmeister III well temperament
+    NUM_TUNINGS
+};
+
+// Cents away from equal temperament for pitch classes C to B
+static constexpr double synthTuningCents[NUM_TUNINGS][12] = {
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 0, 11.731, 3.910, 15.641, -13.686, -1.955, -9.776, 1.955, 13.686, -15.641, 17.596, -11.731 },
+    { 0, -9.775, 3.910, -5.865, 7.820, -1.955, 11.730, 1.955, -7.820, 5.865, -3.910, 9.775 },
+    { 0, -9.775, -7.820, -5.865, -9.775, -1.955, -11.730, -3.910, -7.820, -11.730, -3.910, -7.820 }
+};
+
+// Tuning words for every MIDI note
+struct SynthTuningTable {
+    uint32_t ftw[SYNTH_TABLE_NOTES];
+};
+
+constexpr SynthTuningTable synthMakeTuning(uint32_t sampleRate, uint8_t tuning) {
+    SynthTuningTable table = {};
+    for (int note = 0; note < SYNTH_TABLE_NOTES; note++) {
+        double semitones = (note - 69) + synthTuningCents[tuning][note % 12] / 100.0;
+        table.ftw[note] = synthTuningWord(440.0 * synthExp2(semitones / 12.0), sampleRate);
+    }
+    return table;
+}
+
+// All tunings at one sample rate, indexed by SynthTuning
+struct SynthTuningBank {
+    SynthTuningTable tuning[NUM_TUNINGS];
+};
+
+constexpr SynthTuningBank synthMakeTuningBank(uint32_t sampleRate) {
+    SynthTuningBank bank = {};
+    for (int tuning = 0; tuning < NUM_TUNINGS; tuning++) {
+        bank.tuning[tuning] = synthMakeTuning(sampleRate, tuning);
+    }
+    return bank;
+}
+
+#endif // MINTYSYNTH_SYNTHTABLES_H
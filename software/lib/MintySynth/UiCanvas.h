@@ -0,0 +1,104 @@
+/*
+ * MintySynth UI Canvas
+ *
+ * The drawing surface the UI widgets (UiWidgets.h) render to: filled
+ * rectangles and text in the built-in 6x8 font on an opaque background,
+ * which is all they need. Every call is counted as the ILI9341 would see
+ * it over SPI, one address window per rectangle or character cell, so
+ * the cost of a frame can be measured on the device and on a host fake.
+ *
+ * UiGfxCanvas adapts any display with the Adafruit_GFX / TFT_eSPI text
+ * and fillRect calls. Header only, so the sketches can use it.
+ */
+
+#ifndef MINTYSYNTH_UICANVAS_H
+#define MINTYSYNTH_UICANVAS_H
+
+#include <Arduino.h>
+
+#define UI_CHAR_WIDTH     6       // Built-in font cell at text size 1
+#define UI_CHAR_HEIGHT    8
+#define UI_WINDOW_BYTES   11      // CASET + 4, PASET + 4, RAMWR
+
+struct UiDrawStats {
+    uint32_t windows;       // Address windows set
+    uint32_t pixels;        // Pixels written
+    uint32_t bytes;         // SPI bytes: window setup plus 2 per pixel
+};
+
+class UiCanvas {
+public:
+    UiCanvas() {
+        resetStats();
+    }
+    virtual ~UiCanvas() {}
+
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+        if (w <= 0 || h <= 0) return;
+        count((uint32_t)w * h);
+        drawFill(x, y, w, h, color);
+    }
+
+    // Outline, as four fills
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+        fillRect(x, y, w, 1, color);
+        if (h < 2) return;
+        fillRect(x, y + h - 1, w, 1, color);
+        fillRect(x, y + 1, 1, h - 2, color);
+        if (w > 1) fillRect(x + w - 1, y + 1, 1, h - 2, color);
+    }
+
+    // The first `length` characters of text, background included
+    void drawText(int16_t x, int16_t y, const char* text, uint8_t length, uint8_t size,
+                  uint16_t color, uint16_t background) {
+        if (!length) return;
+        uint32_t cell = (uint32_t)UI_CHAR_WIDTH * UI_CHAR_HEIGHT * size * size;
+        for (uint8_t i = 0; i < length; i++) count(cell);
+        drawChars(x, y, text, length, size, color, background);
+    }
+
+    const UiDrawStats& getStats() const { return stats; }
+    void resetStats() {
+        stats.windows = 0;
+        stats.pixels = 0;
+        stats.bytes = 0;
+    }
+
+protected:
+    virtual void drawFill(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) = 0;
+    virtual void drawChars(int16_t x, int16_t y, const char* text, uint8_t length, uint8_t size,
+                           uint16_t color, uint16_t background) = 0;
+
+private:
+    UiDrawStats stats;
+
+    void count(uint32_t pixels) {
+        stats.windows++;
+        stats.pixels += pixels;
+        stats.bytes += UI_WINDOW_BYTES + pixels * 2;
+    }
+};
+
+template <class Display>
+class UiGfxCanvas : public UiCanvas {
+public:
+    explicit UiGfxCanvas(Display& target) : display(target) {}
+
+protected:
+    void drawFill(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override {
+        display.fillRect(x, y, w, h, color);
+    }
+
+    void drawChars(int16_t x, int16_t y, const char* text, uint8_t length, uint8_t size,
+                   uint16_t color, uint16_t background) override {
+        display.setTextSize(size);
+        display.setTextColor(color, background);
+        display.setCursor(x, y);
+        for (uint8_t i = 0; i < length; i++) display.print(text[i]);
+    }
+
+private:
+    Display& display;
+};
+
+#endif // MINTYSYNTH_UICANVAS_H
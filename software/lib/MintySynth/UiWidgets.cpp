@@ -0,0 +1,299 @@
+/*
+ * MintySynth UI Widgets Implementation
+ */
+
+#include "UiWidgets.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+#define VOICE_SELECTED    0x01
+#define VOICE_ACTIVE      0x02
+#define VOICE_BAR_HEIGHT  2
+
+// -------------------------------------------------------------------------
+// UiTextField
+// -------------------------------------------------------------------------
+
+UiTextField::UiTextField()
+    : x(0), y(0), columns(0), size(1), color(0xFFFF), background(0x0000) {
+    text[0] = '\0';
+    shown[0] = '\0';
+}
+
+void UiTextField::begin(int16_t fieldX, int16_t fieldY, uint8_t fieldColumns, uint8_t textSize,
+                        uint16_t textColor, uint16_t backgroundColor) {
+    x = fieldX;
+    y = fieldY;
+    columns = fieldColumns < UI_TEXT_MAX ? fieldColumns : UI_TEXT_MAX;
+    size = textSize ? textSize : 1;
+    color = textColor;
+    background = backgroundColor;
+    setText("");
+    invalidate();
+}
+
+void UiTextField::setText(const char* value) {
+    uint8_t i = 0;
+    while (i < columns && value[i]) {
+        text[i] = value[i];
+        i++;
+    }
+    while (i < columns) text[i++] = ' ';
+    text[columns] = '\0';
+}
+
+void UiTextField::printf(const char* format, ...) {
+    char line[UI_TEXT_MAX + 1];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    setText(line);
+}
+
+void UiTextField::setColor(uint16_t textColor) {
+    if (textColor == color) return;
+    color = textColor;
+    invalidate();
+}
+
+void UiTextField::render(UiCanvas& canvas) {
+    const int16_t cellWidth = UI_CHAR_WIDTH * size;
+
+    if (damaged) {
+        canvas.drawText(x, y, text, columns, size, color, background);
+        memcpy(shown, text, columns + 1);
+        damaged = false;
+        return;
+    }
+
+    uint8_t i = 0;
+    while (i < columns) {
+        if (text[i] == shown[i]) {
+            i++;
+            continue;
+        }
+        uint8_t start = i;
+        while (i < columns && text[i] != shown[i]) {
+            shown[i] = text[i];
+            i++;
+        }
+        canvas.drawText(x + start * cellWidth, y, text + start, i - start, size, color, background);
+    }
+}
+
+// -------------------------------------------------------------------------
+// UiGauge
+// -------------------------------------------------------------------------
+
+UiGauge::UiGauge()
+    : x(0), y(0), w(0), h(0), color(0xFFFF), frame(0xFFFF), background(0x0000),
+      minimum(0), maximum(1), value(0), shownLength(0) {
+}
+
+void UiGauge::begin(int16_t gaugeX, int16_t gaugeY, int16_t width, int16_t height,
+                    uint16_t barColor, uint16_t frameColor, uint16_t backgroundColor) {
+    x = gaugeX;
+    y = gaugeY;
+    w = width;
+    h = height;
+    color = barColor;
+    frame = frameColor;
+    background = backgroundColor;
+    invalidate();
+}
+
+void UiGauge::setRange(int32_t low, int32_t high) {
+    minimum = low;
+    maximum = high > low ? high : low + 1;
+}
+
+void UiGauge::setValue(int32_t newValue) {
+    value = constrain(newValue, minimum, maximum);
+}
+
+int16_t UiGauge::barLength() {
+    return (int16_t)((int64_t)(value - minimum) * (w - 2) / (maximum - minimum));
+}
+
+// The bar grows or shrinks by filling only the columns in between
+void UiGauge::render(UiCanvas& canvas) {
+    const int16_t inner = w - 2;
+    int16_t length = barLength();
+
+    if (damaged) {
+        canvas.drawRect(x, y, w, h, frame);
+        canvas.fillRect(x + 1, y + 1, length, h - 2, color);
+        canvas.fillRect(x + 1 + length, y + 1, inner - length, h - 2, background);
+        shownLength = length;
+        damaged = false;
+        return;
+    }
+
+    if (length > shownLength) {
+        canvas.fillRect(x + 1 + shownLength, y + 1, length - shownLength, h - 2, color);
+    } else if (length < shownLength) {
+        canvas.fillRect(x + 1 + length, y + 1, shownLength - length, h - 2, background);
+    }
+    shownLength = length;
+}
+
+// -------------------------------------------------------------------------
+// UiStepGrid
+// -------------------------------------------------------------------------
+
+UiStepGrid::UiStepGrid()
+    : pitch(15), onColor(0x07E0), offColor(0xFFFF), currentColor(0xF800), background(0x0000),
+      x(0), y(0), cells(0), columns(1) {
+    memset(flags, 0, sizeof(flags));
+    memset(shown, 0, sizeof(shown));
+}
+
+void UiStepGrid::begin(int16_t gridX, int16_t gridY, uint8_t cellCount, uint8_t rowCells, uint8_t cellPitch) {
+    x = gridX;
+    y = gridY;
+    cells = cellCount < UI_MAX_CELLS ? cellCount : UI_MAX_CELLS;
+    columns = rowCells ? rowCells : 1;
+    pitch = cellPitch;
+    memset(flags, 0, sizeof(flags));
+    invalidate();
+}
+
+void UiStepGrid::setColors(uint16_t on, uint16_t off, uint16_t current, uint16_t backgroundColor) {
+    onColor = on;
+    offColor = off;
+    currentColor = current;
+    background = backgroundColor;
+    invalidate();
+}
+
+void UiStepGrid::setStep(uint8_t cell, bool on) {
+    if (cell >= cells) return;
+    if (on) {
+        flags[cell] |= UI_STEP_ON;
+    } else {
+        flags[cell] &= ~UI_STEP_ON;
+    }
+}
+
+void UiStepGrid::setCurrent(int8_t cell) {
+    for (uint8_t i = 0; i < cells; i++) {
+        if (i == cell) {
+            flags[i] |= UI_STEP_CURRENT;
+        } else {
+            flags[i] &= ~UI_STEP_CURRENT;
+        }
+    }
+}
+
+void UiStepGrid::render(UiCanvas& canvas) {
+    for (uint8_t i = 0; i < cells; i++) {
+        if (!damaged && flags[i] == shown[i]) continue;
+        drawCell(canvas, i, x + (i % columns) * pitch, y + (i / columns) * pitch, flags[i]);
+        shown[i] = flags[i];
+    }
+    damaged = false;
+}
+
+// A pitch - 3 square at (x, y) inside a one pixel ring at (x - 1, y - 1)
+void UiStepGrid::drawCell(UiCanvas& canvas, uint8_t cell, int16_t cellX, int16_t cellY, uint8_t cellFlags) {
+    const int16_t side = pitch - 3;
+    (void)cell;
+
+    canvas.drawRect(cellX - 1, cellY - 1, side + 2, side + 2,
+                    (cellFlags & UI_STEP_CURRENT) ? currentColor : background);
+    if (cellFlags & UI_STEP_ON) {
+        canvas.fillRect(cellX, cellY, side, side, onColor);
+    } else {
+        canvas.drawRect(cellX, cellY, side, side, offColor);
+        canvas.fillRect(cellX + 1, cellY + 1, side - 2, side - 2, background);
+    }
+}
+
+// -------------------------------------------------------------------------
+// UiVoiceStrip
+// -------------------------------------------------------------------------
+
+UiVoiceStrip::UiVoiceStrip()
+    : x(0), y(0), w(0), h(0), spacing(0), voices(0), selected(0),
+      selectedColor(0xFFFF), idleColor(0x4208), activeColor(0x07E0), textColor(0x0000), background(0x0000) {
+    memset(labels, 0, sizeof(labels));
+    memset(flags, 0, sizeof(flags));
+    memset(shown, 0, sizeof(shown));
+}
+
+void UiVoiceStrip::begin(int16_t stripX, int16_t stripY, uint8_t voiceCount, int16_t width, int16_t height,
+                         int16_t boxSpacing) {
+    x = stripX;
+    y = stripY;
+    voices = voiceCount < UI_MAX_VOICES ? voiceCount : UI_MAX_VOICES;
+    w = width;
+    h = height;
+    spacing = boxSpacing;
+    memset(flags, 0, sizeof(flags));
+    setSelected(selected);
+    invalidate();
+}
+
+void UiVoiceStrip::setColors(uint16_t selectedBox, uint16_t idleBox, uint16_t activeBar, uint16_t text,
+                             uint16_t backgroundColor) {
+    selectedColor = selectedBox;
+    idleColor = idleBox;
+    activeColor = activeBar;
+    textColor = text;
+    background = backgroundColor;
+    invalidate();
+}
+
+void UiVoiceStrip::setLabel(uint8_t voice, const char* label) {
+    if (voice >= voices) return;
+    labels[voice] = label;
+    invalidate();
+}
+
+void UiVoiceStrip::setSelected(uint8_t voice) {
+    selected = voice;
+    for (uint8_t i = 0; i < voices; i++) {
+        if (i == voice) {
+            flags[i] |= VOICE_SELECTED;
+        } else {
+            flags[i] &= ~VOICE_SELECTED;
+        }
+    }
+}
+
+void UiVoiceStrip::setActive(uint8_t voice, bool active) {
+    if (voice >= voices) return;
+    if (active) {
+        flags[voice] |= VOICE_ACTIVE;
+    } else {
+        flags[voice] &= ~VOICE_ACTIVE;
+    }
+}
+
+// Box and label when the selection moves, only the bar when a voice
+// starts or stops sounding
+void UiVoiceStrip::render(UiCanvas& canvas) {
+    for (uint8_t v = 0; v < voices; v++) {
+        uint8_t changed = damaged ? 0xFF : (uint8_t)(flags[v] ^ shown[v]);
+        if (!changed) continue;
+
+        int16_t boxX = x + v * spacing;
+        if (changed & VOICE_SELECTED) {
+            uint16_t fill = (flags[v] & VOICE_SELECTED) ? selectedColor : idleColor;
+            canvas.fillRect(boxX, y, w, h, fill);
+            if (labels[v]) {
+                size_t length = strlen(labels[v]);
+                size_t fit = (w - 2) / UI_CHAR_WIDTH;
+                if (length > fit) length = fit;
+                canvas.drawText(boxX + 2, y + (h - UI_CHAR_HEIGHT) / 2, labels[v], length, 1, textColor, fill);
+            }
+        }
+        if (changed & VOICE_ACTIVE) {
+            canvas.fillRect(boxX, y + h + 1, w, VOICE_BAR_HEIGHT,
+                            (flags[v] & VOICE_ACTIVE) ? activeColor : background);
+        }
+        shown[v] = flags[v];
+    }
+    damaged = false;
+}
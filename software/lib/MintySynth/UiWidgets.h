@@ -0,0 +1,159 @@
+/*
+ * MintySynth UI Widgets
+ *
+ * Retained-mode display widgets. Each widget keeps the state it last
+ * drew next to the state it has been given, and render() draws only the
+ * parts where the two differ: the changed characters of a text field,
+ * the cells of a step grid whose flags changed, the sliver of a gauge
+ * between its old and new value. Nothing is cleared and redrawn, so a
+ * frame in which nothing changed draws nothing.
+ *
+ * Setters only record state and may be called any number of times per
+ * frame. invalidate() forces a full redraw, e.g. after the screen under
+ * the widget was cleared.
+ */
+
+#ifndef MINTYSYNTH_UIWIDGETS_H
+#define MINTYSYNTH_UIWIDGETS_H
+
+#include <Arduino.h>
+#include "UiCanvas.h"
+
+#define UI_TEXT_MAX       40      // Columns per text field
+#define UI_MAX_CELLS      32      // Step grid cells
+#define UI_MAX_VOICES     8       // Voice strip boxes
+#define UI_MAX_WIDGETS    24      // Per screen
+
+// Step grid cell flags
+#define UI_STEP_ON        0x01
+#define UI_STEP_CURRENT   0x02
+
+class UiWidget {
+public:
+    UiWidget() : damaged(true) {}
+    virtual ~UiWidget() {}
+
+    void invalidate() { damaged = true; }
+
+    // Draw what changed since the last render
+    virtual void render(UiCanvas& canvas) = 0;
+
+protected:
+    bool damaged;
+};
+
+// Fixed-width line of text, padded with spaces. Runs of changed
+// characters are redrawn, the rest of the line is left alone.
+class UiTextField : public UiWidget {
+public:
+    UiTextField();
+
+    void begin(int16_t x, int16_t y, uint8_t columns, uint8_t size, uint16_t color, uint16_t background);
+    void setText(const char* text);
+    void printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    void setColor(uint16_t color);
+
+    void render(UiCanvas& canvas) override;
+
+private:
+    int16_t x, y;
+    uint8_t columns, size;
+    uint16_t color, background;
+    char text[UI_TEXT_MAX + 1];
+    char shown[UI_TEXT_MAX + 1];
+};
+
+// Horizontal bar gauge with a one pixel frame, e.g. for an encoder
+class UiGauge : public UiWidget {
+public:
+    UiGauge();
+
+    void begin(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color, uint16_t frame, uint16_t background);
+    void setRange(int32_t minimum, int32_t maximum);
+    void setValue(int32_t value);
+
+    void render(UiCanvas& canvas) override;
+
+private:
+    int16_t x, y, w, h;
+    uint16_t color, frame, background;
+    int32_t minimum, maximum, value;
+    int16_t shownLength;
+
+    int16_t barLength();
+};
+
+// Grid of step cells, `columns` per row at `pitch` pixels. A cell is
+// redrawn when its flags change; drawCell() must stay inside its
+// pitch x pitch box, so a redraw never touches a neighbour.
+class UiStepGrid : public UiWidget {
+public:
+    UiStepGrid();
+
+    void begin(int16_t x, int16_t y, uint8_t cells, uint8_t columns, uint8_t pitch);
+    void setColors(uint16_t on, uint16_t off, uint16_t current, uint16_t background);
+    void setStep(uint8_t cell, bool on);
+    void setCurrent(int8_t cell);           // -1: none
+
+    void render(UiCanvas& canvas) override;
+
+protected:
+    uint8_t pitch;
+    uint16_t onColor, offColor, currentColor, background;
+
+    // Default look: filled when on, outlined when off, ringed when current
+    virtual void drawCell(UiCanvas& canvas, uint8_t cell, int16_t x, int16_t y, uint8_t flags);
+
+private:
+    int16_t x, y;
+    uint8_t cells, columns;
+    uint8_t flags[UI_MAX_CELLS];
+    uint8_t shown[UI_MAX_CELLS];
+};
+
+// Row of labelled voice boxes: the selected one highlighted, the ones
+// that are sounding marked with a bar under the label
+class UiVoiceStrip : public UiWidget {
+public:
+    UiVoiceStrip();
+
+    void begin(int16_t x, int16_t y, uint8_t voices, int16_t w, int16_t h, int16_t spacing);
+    void setColors(uint16_t selected, uint16_t idle, uint16_t active, uint16_t text, uint16_t background);
+    void setLabel(uint8_t voice, const char* label);
+    void setSelected(uint8_t voice);
+    void setActive(uint8_t voice, bool active);
+
+    void render(UiCanvas& canvas) override;
+
+private:
+    int16_t x, y, w, h, spacing;
+    uint8_t voices;
+    uint8_t selected;
+    uint16_t selectedColor, idleColor, activeColor, textColor, background;
+    const char* labels[UI_MAX_VOICES];
+    uint8_t flags[UI_MAX_VOICES];
+    uint8_t shown[UI_MAX_VOICES];
+};
+
+class UiScreen {
+public:
+    UiScreen() : count(0) {}
+
+    void add(UiWidget& widget) {
+        if (count < UI_MAX_WIDGETS) widgets[count++] = &widget;
+    }
+
+    void invalidate() {
+        for (uint8_t i = 0; i < count; i++) widgets[i]->invalidate();
+    }
+
+    void render(UiCanvas& canvas) {
+        for (uint8_t i = 0; i < count; i++) widgets[i]->render(canvas);
+    }
+
+private:
+    UiWidget* widgets[UI_MAX_WIDGETS];
+    uint8_t count;
+};
+
+#endif // MINTYSYNTH_UIWIDGETS_H
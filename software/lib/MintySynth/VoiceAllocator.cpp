@@ -0,0 +1,85 @@
+/*
+ * MintySynth Voice Allocator Implementation
+ */
+
+#include "VoiceAllocator.h"
+
+VoiceAllocator::VoiceAllocator() {
+    policy = STEAL_OLDEST;
+    sameNoteSteal = true;
+    polyphony = NUM_RENDER_VOICES;
+    nextStamp = 0;
+    
+    for (int i = 0; i < NUM_RENDER_VOICES; i++) {
+        voiceLane[i] = 0;
+        voiceNote[i] = 0;
+        voiceStamp[i] = 0;
+    }
+}
+
+void VoiceAllocator::setPolicy(StealPolicy newPolicy) {
+    policy = newPolicy;
+}
+
+StealPolicy VoiceAllocator::getPolicy() {
+    return policy;
+}
+
+void VoiceAllocator::setSameNoteSteal(bool enabled) {
+    sameNoteSteal = enabled;
+}
+
+void VoiceAllocator::setPolyphony(uint8_t voices) {
+    polyphony = constrain(voices, 1, NUM_RENDER_VOICES);
+}
+
+uint8_t VoiceAllocator::getPolyphony() {
+    return polyphony;
+}
+
+uint8_t VoiceAllocator::allocate(uint8_t lane, uint8_t note, const bool* active, const uint16_t* level) {
+    // Retrigger the voice already playing this note
+    if (sameNoteSteal) {
+        uint8_t voice = findVoice(lane, note, active);
+        if (voice != NO_VOICE) return assign(voice, lane, note);
+    }
+    
+    // Free voice
+    for (uint8_t i = 0; i < polyphony; i++) {
+        if (!active[i]) return assign(i, lane, note);
+    }
+    
+    // Pool is full: steal. Ties go to the older voice.
+    uint8_t victim = 0;
+    for (uint8_t i = 1; i < polyphony; i++) {
+        bool older = (int32_t)(voiceStamp[i] - voiceStamp[victim]) < 0;
+        if (policy == STEAL_QUIETEST) {
+            if (level[i] < level[victim] || (level[i] == level[victim] && older)) victim = i;
+        } else if (older) {
+            victim = i;
+        }
+    }
+    return assign(victim, lane, note);
+}
+
+uint8_t VoiceAllocator::findVoice(uint8_t lane, uint8_t note, const bool* active) {
+    for (uint8_t i = 0; i < polyphony; i++) {
+        if (active[i] && voiceLane[i] == lane && voiceNote[i] == note) return i;
+    }
+    return NO_VOICE;
+}
+
+uint8_t VoiceAllocator::getLane(uint8_t voice) {
+    return (voice < NUM_RENDER_VOICES) ? voiceLane[voice] : 0;
+}
+
+uint8_t VoiceAllocator::getNote(uint8_t voice) {
+    return (voice < NUM_RENDER_VOICES) ? voiceNote[voice] : 0;
+}
+
+uint8_t VoiceAllocator::assign(uint8_t voice, uint8_t lane, uint8_t note) {
+    voiceLane[voice] = lane;
+    voiceNote[voice] = note;
+    voiceStamp[voice] = nextStamp++;
+    return voice;
+}
@@ -0,0 +1,62 @@
+/*
+ * MintySynth Voice Allocator
+ *
+ * Assigns notes from the instrument lanes to a shared pool of render
+ * voices. When the pool is full a sounding voice is stolen: the oldest
+ * or the quietest one, or a voice already playing the same note on the
+ * same lane when same-note stealing is on.
+ */
+
+#ifndef MINTYSYNTH_VOICEALLOCATOR_H
+#define MINTYSYNTH_VOICEALLOCATOR_H
+
+#include <Arduino.h>
+
+// Render voice pool size (override with -DNUM_RENDER_VOICES=32)
+#ifndef NUM_RENDER_VOICES
+#define NUM_RENDER_VOICES 16
+#endif
+
+#define NO_VOICE 0xFF
+
+enum StealPolicy {
+    STEAL_OLDEST = 0,
+    STEAL_QUIETEST = 1
+};
+
+class VoiceAllocator {
+public:
+    VoiceAllocator();
+    
+    void setPolicy(StealPolicy policy);
+    StealPolicy getPolicy();
+    void setSameNoteSteal(bool enabled);
+    
+    // Number of pool voices in use, 1..NUM_RENDER_VOICES
+    void setPolyphony(uint8_t voices);
+    uint8_t getPolyphony();
+    
+    // Picks a render voice for a note-on. active[] and level[] describe the
+    // pool (level is any loudness measure, only compared between voices).
+    uint8_t allocate(uint8_t lane, uint8_t note, const bool* active, const uint16_t* level);
+    
+    // Render voice playing this lane/note, NO_VOICE if none
+    uint8_t findVoice(uint8_t lane, uint8_t note, const bool* active);
+    
+    uint8_t getLane(uint8_t voice);
+    uint8_t getNote(uint8_t voice);
+    
+private:
+    StealPolicy policy;
+    bool sameNoteSteal;
+    uint8_t polyphony;
+    
+    uint8_t voiceLane[NUM_RENDER_VOICES];
+    uint8_t voiceNote[NUM_RENDER_VOICES];
+    uint32_t voiceStamp[NUM_RENDER_VOICES];  // Allocation order, oldest is smallest
+    uint32_t nextStamp;
+    
+    uint8_t assign(uint8_t voice, uint8_t lane, uint8_t note);
+};
+
+#endif // MINTYSYNTH_VOICEALLOCATOR_H
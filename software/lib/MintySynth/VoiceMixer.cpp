@@ -0,0 +1,99 @@
+/*
+ * MintySynth Voice Mixer Implementation
+ *
+ * The vector paths keep the scalar semantics exactly: the running sum is
+ * saturated after every voice, lane by lane, in the same voice order.
+ */
+
+#include "VoiceMixer.h"
+#include <string.h>
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+#define MIXER_USE_PIE 1
+#elif defined(__SSE2__)
+#define MIXER_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+static inline int16_t saturate16(int32_t value) {
+    if (value > 32767) return 32767;
+    if (value < -32768) return -32768;
+    return (int16_t)value;
+}
+
+// acc[n] = sat16(acc[n] + src[n]) for n in [start, frames)
+static inline void addSaturateTail(int16_t* acc, const int16_t* src, size_t start, size_t frames) {
+    for (size_t n = start; n < frames; n++) {
+        acc[n] = saturate16((int32_t)acc[n] + src[n]);
+    }
+}
+
+void mixVoiceBlocksScalar(int16_t* out, const int16_t* const* blocks, uint8_t count, size_t frames) {
+    if (count == 0) {
+        memset(out, 0, frames * sizeof(int16_t));
+        return;
+    }
+
+    memcpy(out, blocks[0], frames * sizeof(int16_t));
+    for (uint8_t v = 1; v < count; v++) {
+        addSaturateTail(out, blocks[v], 0, frames);
+    }
+}
+
+#if defined(MIXER_USE_PIE)
+
+// EE.VADDS.S16 adds 8 lanes with signed saturation, same as saturate16()
+static void addSaturateBlock(int16_t* acc, const int16_t* src, size_t vectors) {
+    int16_t* accIn = acc;
+    int16_t* accOut = acc;
+    const int16_t* srcIn = src;
+
+    for (size_t i = 0; i < vectors; i++) {
+        asm volatile(
+            "ee.vld.128.ip q0, %0, 16\n"
+            "ee.vld.128.ip q1, %1, 16\n"
+            "ee.vadds.s16  q2, q0, q1\n"
+            "ee.vst.128.ip q2, %2, 16\n"
+            : "+r"(accIn), "+r"(srcIn), "+r"(accOut)
+            :
+            : "memory");
+    }
+}
+
+#elif defined(MIXER_USE_SSE2)
+
+static void addSaturateBlock(int16_t* acc, const int16_t* src, size_t vectors) {
+    __m128i* a = (__m128i*)acc;
+    const __m128i* s = (const __m128i*)src;
+
+    for (size_t i = 0; i < vectors; i++) {
+        _mm_store_si128(a + i, _mm_adds_epi16(_mm_load_si128(a + i), _mm_load_si128(s + i)));
+    }
+}
+
+#endif
+
+void mixVoiceBlocks(int16_t* out, const int16_t* const* blocks, uint8_t count, size_t frames) {
+#if defined(MIXER_USE_PIE) || defined(MIXER_USE_SSE2)
+    if (count == 0) {
+        memset(out, 0, frames * sizeof(int16_t));
+        return;
+    }
+
+    size_t vectors = frames / MIXER_LANES;
+    size_t vectorFrames = vectors * MIXER_LANES;
+
+    memcpy(out, blocks[0], frames * sizeof(int16_t));
+    for (uint8_t v = 1; v < count; v++) {
+        // Vector loads ignore the low address bits, so misaligned blocks take the scalar path
+        if (((uintptr_t)out | (uintptr_t)blocks[v]) & (MIXER_ALIGN - 1)) {
+            addSaturateTail(out, blocks[v], 0, frames);
+            continue;
+        }
+        addSaturateBlock(out, blocks[v], vectors);
+        addSaturateTail(out, blocks[v], vectorFrames, frames);
+    }
+#else
+    mixVoiceBlocksScalar(out, blocks, count, frames);
+#endif
+}
@@ -0,0 +1,27 @@
+/*
+ * MintySynth Voice Mixer
+ *
+ * Sums per-voice sample blocks into one output block with 16-bit
+ * saturation. On the ESP32-S3 the inner loop uses the PIE vector unit
+ * (8 samples per instruction), on x86 hosts SSE2, elsewhere plain C.
+ * All paths produce identical output to mixVoiceBlocksScalar(); the
+ * voices/mixer benchmark checks that on random and saturating blocks.
+ */
+
+#ifndef MINTYSYNTH_VOICEMIXER_H
+#define MINTYSYNTH_VOICEMIXER_H
+
+#include <Arduino.h>
+
+// Voice blocks and the output must be 16-byte aligned
+#define MIXER_ALIGN     16
+#define MIXER_LANES     8       // int16 samples per vector
+
+// out[n] = sat16(blocks[0][n] + blocks[1][n] + ...), added in block order.
+// count == 0 clears the output.
+void mixVoiceBlocks(int16_t* out, const int16_t* const* blocks, uint8_t count, size_t frames);
+
+// Portable reference implementation
+void mixVoiceBlocksScalar(int16_t* out, const int16_t* const* blocks, uint8_t count, size_t frames);
+
+#endif // MINTYSYNTH_VOICEMIXER_H
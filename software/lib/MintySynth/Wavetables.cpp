@@ -0,0 +1,164 @@
+/*
+ * MintySynth Wavetables Implementation
+ *
+ * All 15 waveforms and the band-limited bank are computed by the compiler,
+ * so the audio path is a phase accumulator plus a table read, like the
+ * original AVR synth, and there is nothing to build at boot.
+ */
+
+#include "Wavetables.h"
+#include "MintySynth.h"
+#include "SynthTables.h"
+#include "OriginalWaves.h"
+
+// Band-limited bank for the discontinuous waveforms (12 KB)
+enum BandLimitedWave {
+    BL_SAW = 0,
+    BL_RAMP,
+    BL_SQUARE,
+    NUM_BL_WAVES
+};
+
+// WaveformType -> BandLimitedWave, -1 for waveforms played from the plain table
+static const int8_t bandLimitedIndex[NUM_WAVEFORMS] = {
+    -1,             // WAVE_SINE
+    BL_RAMP,        // WAVE_RAMP
+    -1,             // WAVE_TRIANGLE
+    BL_SQUARE,      // WAVE_SQUARE
+    -1,             // WAVE_NOISE
+    BL_SAW,         // WAVE_SAW
+    -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+struct WavetableSet {
+    int16_t wave[NUM_WAVEFORMS][WAVETABLE_SIZE];
+};
+
+struct BandLimitedSet {
+    int16_t wave[NUM_BL_WAVES][WAVETABLE_MIP_LEVELS][WAVETABLE_SIZE];
+};
+
+constexpr int16_t clampSample(int64_t value) {
+    return (int16_t)((value > 32767) ? 32767 : (value < -32767) ? -32767 : value);
+}
+
+constexpr int mipHarmonics(int level) {
+    int harmonics = 128 >> level;
+    return (harmonics < WAVETABLE_SIZE / 2) ? harmonics : WAVETABLE_SIZE / 2 - 1;
+}
+
+constexpr WavetableSet buildWavetables() {
+    WavetableSet set = {};
+    int16_t* sine = set.wave[WAVE_SINE];
+    
+    for (int i = 0; i < WAVETABLE_SIZE; i++) {
+        sine[i] = (int16_t)synthRound(32767.0 * synthSin(2.0 * SYNTH_PI * i / WAVETABLE_SIZE));
+    }
+    
+    // Pitched noise like the original NoiseTable: 16-bit Galois LFSR
+    uint16_t lfsr = 0xACE1;
+    
+    for (int i = 0; i < WAVETABLE_SIZE; i++) {
+        int32_t ramp = i * (65534 / (WAVETABLE_SIZE - 1)) - 32767;   // -32767 .. 32767
+        
+        set.wave[WAVE_RAMP][i] = clampSample(-ramp);
+        set.wave[WAVE_SAW][i] = clampSample(ramp);
+        set.wave[WAVE_TRIANGLE][i] = (i < WAVETABLE_SIZE / 2)
+            ? clampSample(i * 512 - 32767)
+            : clampSample(32767 - (i - WAVETABLE_SIZE / 2) * 512);
+        set.wave[WAVE_SQUARE][i] = (i < WAVETABLE_SIZE / 2) ? 32767 : -32767;
+        
+        lfsr = (lfsr >> 1) ^ (-(lfsr & 1u) & 0xB400u);
+        set.wave[WAVE_NOISE][i] = clampSample((int16_t)lfsr);
+        
+        // A-I are the original tables.h waves, 8-bit full scale -> Q15
+        for (int w = 0; w < ORIGINAL_WAVES; w++) {
+            set.wave[WAVE_A + w][i] = clampSample(synthRound(originalWaves[w][i] * (32767.0 / 127.0)));
+        }
+    }
+    
+    return set;
+}
+
+// Fourier series of a naive shape up to `harmonics`, into accum (unit scale).
+// sin of an integer harmonic is an exact read of the sine table.
+constexpr void sumHarmonics(int wave, int harmonics, const double* sine, double* accum) {
+    for (int i = 0; i < WAVETABLE_SIZE; i++) accum[i] = 0.0;
+    
+    for (int k = 1; k <= harmonics; k++) {
+        // Saw and ramp are sums of sines; the square only has odd harmonics
+        double b = 0.0;
+        if (wave == BL_SAW) b = -2.0 / (SYNTH_PI * k);
+        else if (wave == BL_RAMP) b = 2.0 / (SYNTH_PI * k);
+        else if (k & 1) b = 4.0 / (SYNTH_PI * k);
+        if (b == 0.0) continue;
+        
+        for (int i = 0; i < WAVETABLE_SIZE; i++) {
+            accum[i] += b * sine[(k * i) & (WAVETABLE_SIZE - 1)];
+        }
+    }
+}
+
+constexpr BandLimitedSet buildBandLimitedBank() {
+    BandLimitedSet set = {};
+    double sine[WAVETABLE_SIZE] = {};
+    double accum[WAVETABLE_MIP_LEVELS][WAVETABLE_SIZE] = {};
+    
+    for (int i = 0; i < WAVETABLE_SIZE; i++) {
+        sine[i] = synthSin(2.0 * SYNTH_PI * i / WAVETABLE_SIZE);
+    }
+    
+    for (int wave = 0; wave < NUM_BL_WAVES; wave++) {
+        // Every level shares the scale of the overall peak (Gibbs overshoot
+        // at the top, the bare fundamental at the bottom), so the timbre
+        // changes across octaves without a level jump
+        double peak = 0.0;
+        for (int level = 0; level < WAVETABLE_MIP_LEVELS; level++) {
+            sumHarmonics(wave, mipHarmonics(level), sine, accum[level]);
+            for (int i = 0; i < WAVETABLE_SIZE; i++) {
+                double magnitude = (accum[level][i] < 0) ? -accum[level][i] : accum[level][i];
+                if (magnitude > peak) peak = magnitude;
+            }
+        }
+        
+        double scale = 32767.0 / peak;
+        for (int level = 0; level < WAVETABLE_MIP_LEVELS; level++) {
+            for (int i = 0; i < WAVETABLE_SIZE; i++) {
+                set.wave[wave][level][i] = clampSample(synthRound(accum[level][i] * scale));
+            }
+        }
+    }
+    
+    return set;
+}
+
+static constexpr WavetableSet wavetables SYNTH_TABLE_ATTR = buildWavetables();
+static constexpr BandLimitedSet bandLimited SYNTH_TABLE_ATTR = buildBandLimitedBank();
+
+const int16_t* getWavetable(uint8_t waveform) {
+    if (waveform >= NUM_WAVEFORMS) waveform = WAVE_SINE;
+    return wavetables.wave[waveform];
+}
+
+const int16_t* getWavetable(uint8_t waveform, uint32_t ftw) {
+    if (waveform >= NUM_WAVEFORMS || bandLimitedIndex[waveform] < 0) {
+        return getWavetable(waveform);
+    }
+    return bandLimited.wave[bandLimitedIndex[waveform]][wavetableMipLevel(ftw)];
+}
+
+uint8_t wavetableMipLevel(uint32_t ftw) {
+    // Harmonic h aliases once h * ftw >= 2^31. Level L keeps 128 >> L
+    // harmonics, which is safe while ftw <= 2^(24 + L).
+    if (ftw <= (1UL << 24)) return 0;
+    uint8_t level = (32 - __builtin_clz(ftw - 1)) - 24;
+    return (level < WAVETABLE_MIP_LEVELS) ? level : WAVETABLE_MIP_LEVELS - 1;
+}
+
+uint32_t frequencyToTuningWord(float hz) {
+    // 2^32 / SAMPLE_RATE phase increments per Hz
+    float ftw = hz * (4294967296.0f / SAMPLE_RATE);
+    if (ftw <= 0.0f) return 0;
+    if (ftw >= 2147483648.0f) return 0x7FFFFFFF;   // Clamp at Nyquist
+    return (uint32_t)ftw;
+}
@@ -0,0 +1,37 @@
+/*
+ * MintySynth Wavetables
+ *
+ * Single-cycle wavetables and DDS helpers for the oscillator bank.
+ * The tables are constexpr (see SynthTables.h), nothing to initialise.
+ * Based on original MintySynth by Andrew Mowry
+ */
+
+#ifndef MINTYSYNTH_WAVETABLES_H
+#define MINTYSYNTH_WAVETABLES_H
+
+#include <Arduino.h>
+
+// Wavetable configuration
+#define WAVETABLE_BITS  8
+#define WAVETABLE_SIZE  (1 << WAVETABLE_BITS)
+#define WAVETABLE_SHIFT (32 - WAVETABLE_BITS)   // Phase accumulator -> table index
+
+// Band-limited mip levels: level L holds harmonics 1..(128 >> L), one octave apart
+#define WAVETABLE_MIP_LEVELS 8
+
+// Table for a WaveformType (0-14), WAVETABLE_SIZE signed Q15 samples
+const int16_t* getWavetable(uint8_t waveform);
+
+// Alias-free table for a waveform played at tuning word ftw. Saw, ramp
+// and square come from the band-limited bank, other waveforms return
+// the same table as getWavetable(waveform).
+const int16_t* getWavetable(uint8_t waveform, uint32_t ftw);
+
+// Mip level whose highest harmonic stays below Nyquist at tuning word ftw
+uint8_t wavetableMipLevel(uint32_t ftw);
+
+// 32-bit DDS frequency tuning word for a frequency in Hz, for run-time
+// values; note pitches come from the tuning tables
+uint32_t frequencyToTuningWord(float hz);
+
+#endif // MINTYSYNTH_WAVETABLES_H
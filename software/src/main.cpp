@@ -9,6 +9,7 @@
  * - 5x Rotary Encoders
  * - 4x4 Matrix Keyboard + 4 direct buttons
  * - PCM5102A I2S DAC
+ * - MIDI In (DIN on a UART, or the USB serial port)
  * 
  * Based on original MintySynth by Andrew Mowry
  * http://mintysynth.com
@@ -19,15 +20,51 @@
 #include <Arduino.h>
 #include <SPI.h>
 #include <TFT_eSPI.h>
-#include <ESP32Encoder.h>
-#include <driver/i2s.h>
 #include "MintySynth.h"
+#include "AudioPipeline.h"
+#include "AudioOutput.h"
+#include "AudioAnalysis.h"
+#include "InputScanner.h"
+#include "EncoderInput.h"
+#include "MidiInput.h"
+#include "UiWidgets.h"
+
+// Synthesis engine, rendered by its own task on core 1 straight into the I2S DMA buffers
+MintySynth engine;
+AudioPipeline audio(engine);
+AudioOutput i2sOutput;
+
+// Copy of the rendered output, analysed at display rate for the tuner
+AudioTap audioTap;
+AudioAnalyzer analyzer;
+
+// Key press to DAC timing of the notes the keys play, printed on request
+LatencyProbe latencyProbe;
+
+// Presets on LittleFS, appended to a log ('s' saves, 'o' loads)
+PresetLog presetLog;
 
 // Display
 TFT_eSPI tft = TFT_eSPI();
 
-// Rotary Encoders
-ESP32Encoder encoders[5];
+// Retained-mode screen: each widget redraws only what changed since the last frame
+UiGfxCanvas<TFT_eSPI> canvas(tft);
+UiScreen screen;
+UiTextField paramFields[5];
+UiGauge paramGauges[5];
+UiTextField stepsLabel;
+UiStepGrid stepGrid;
+UiVoiceStrip voiceStrip;
+UiTextField stepField;
+UiTextField statusLine;
+UiTextField tunerField;
+
+const char* const PARAM_NAMES[5] = {"TEMPO", "PITCH", "LENGTH", "ENVELOPE", "SWING"};
+const int16_t PARAM_RANGES[5][2] = {{60, 200}, {24, 96}, {10, 100}, {0, 4}, {0, 50}};
+const char* const VOICE_LABELS[4] = {"1", "2", "3", "4"};
+
+// Rotary Encoders: PCNT units for the first four, interrupts for the fifth
+EncoderInput encoders;
 
 // Pin Definitions - OPTIMIZED SAFE ALLOCATION for ESP32-S3-WROOM-1
 // Using all 34 available pins with improved boot reliability
@@ -57,13 +94,23 @@ const uint8_t MATRIX_COLS[4] = {48, 47, 21, 46};  // Corrected pin allocation
 const uint8_t DIRECT_BUTTONS[3] = {20, 3, 19};
 // Button 0: PLAY/STOP, Button 1: VOICE SELECT, Button 2: CLEAR/SHIFT
 
+// Matrix and buttons, scanned from a timer; keys 0-15 matrix, 16-18 buttons
+InputScanner keyScanner;
+
 // I2S Audio Pins (3 pins) - Relocated DOUT to avoid GPIO46 conflict
 const uint8_t I2S_BCLK = 12;
 const uint8_t I2S_LRCLK = 45;
 const uint8_t I2S_DOUT = 0;
 
-// Synthesis Parameters
-struct SynthParams {
+// MIDI In (1 pin) - optocoupler on U0RXD, free while the console is on USB CDC
+const uint8_t MIDI_RX = 44;
+
+// DIN MIDI on Serial1, read from a timer; 'm' hands it the USB serial port too
+MidiInput midiInput;
+bool serialMidi = false;
+
+// UI copy of the synthesis parameters (the engine owns the real ones)
+struct UiParams {
     uint16_t tempo = 120;
     uint8_t pitch = 60;
     uint8_t length = 50;
@@ -71,19 +118,24 @@ struct SynthParams {
     uint8_t swing = 0;
     uint8_t currentStep = 0;
     uint8_t currentVoice = 0;
+    bool playing = false;
     bool stepActive[16] = {false};
     uint8_t stepNotes[16] = {60};
 } synth;
 
 // Function Prototypes
 void initDisplay();
+void initScreen();
 void initEncoders();
 void initMatrix();
 void initAudio();
 void updateDisplay();
 void scanEncoders();
-void scanMatrix();
-void processAudio();
+void processKeys();
+void handleSerial(int command);
+void printLatency();
+void printVoiceCost();
+void uiTask(void* arg);
 
 void setup() {
     Serial.begin(115200);
@@ -98,21 +150,51 @@ void setup() {
     // Initial display update
     updateDisplay();
     
+    // Input and display run on core 0, away from the audio task
+    synthTaskStart(NULL, uiTask, NULL, "ui", UI_TASK_STACK, UI_TASK_PRIORITY, UI_TASK_CORE);
+    
     Serial.println("MintySynth ESP32-S3 Ready!");
 }
 
 void loop() {
-    scanEncoders();
-    scanMatrix();
-    processAudio();
+    // Everything runs in the audio and UI tasks
+    vTaskDelete(NULL);
+}
+
+void uiTask(void* arg) {
+    unsigned long lastDisplayUpdate = 0;
+    uint32_t lastLatencyUs = 0;
     
-    static unsigned long lastDisplayUpdate = 0;
-    if (millis() - lastDisplayUpdate > 50) {  // 20fps display updates
-        updateDisplay();
-        lastDisplayUpdate = millis();
+    for (;;) {
+        scanEncoders();
+        processKeys();
+        audio.updatePatterns();
+        
+        // 'l' prints the key-to-DAC latency breakdown, 'r' starts it over,
+        // 's' and 'o' save and load the preset, 'v' measures the render
+        // cost per voice, 'm' turns the port into MIDI in
+        if (!serialMidi && Serial.available()) {
+            handleSerial(Serial.read());
+        }
+        
+        // Report the latency the tuner settled on, with the render cost
+        // behind it in CPU cycles per frame. Not once the port carries MIDI:
+        // text there would go to the MIDI host as stray bytes.
+        uint32_t latencyUs = audio.getLatencyUs();
+        if (!serialMidi && latencyUs != lastLatencyUs) {
+            Serial.printf("Audio latency: %lu us (render %lu us per buffer, %lu cycles per frame)\n",
+                          (unsigned long)latencyUs, (unsigned long)audio.getRenderUs(),
+                          (unsigned long)engine.getCyclesPerSample());
+            lastLatencyUs = latencyUs;
+        }
+        
+        if (millis() - lastDisplayUpdate > 50) {  // 20fps display updates
+            updateDisplay();
+            lastDisplayUpdate = millis();
+        }
+        
+        delay(1);
     }
-    
-    delay(1);
 }
 
 void initDisplay() {
@@ -124,184 +206,272 @@ void initDisplay() {
     tft.drawString("MintySynth ESP32-S3", 10, 10);
     tft.setTextSize(1);
     tft.drawString("Initializing...", 10, 40);
+    initScreen();
+}
+
+void initScreen() {
+    for (int i = 0; i < 5; i++) {
+        paramFields[i].begin(10, 60 + i * 20, 13, 1, TFT_WHITE, TFT_BLACK);
+        paramGauges[i].begin(100, 60 + i * 20, 120, 8, TFT_CYAN, TFT_DARKGREY, TFT_BLACK);
+        paramGauges[i].setRange(PARAM_RANGES[i][0], PARAM_RANGES[i][1]);
+        screen.add(paramFields[i]);
+        screen.add(paramGauges[i]);
+    }
+    
+    stepsLabel.begin(10, 170, 6, 1, TFT_WHITE, TFT_BLACK);
+    stepsLabel.setText("STEPS:");
+    stepGrid.begin(60, 170, 16, 16, 15);
+    stepGrid.setColors(TFT_GREEN, TFT_WHITE, TFT_RED, TFT_BLACK);
+    screen.add(stepsLabel);
+    screen.add(stepGrid);
+    
+    voiceStrip.begin(10, 196, 4, 20, 12, 24);
+    voiceStrip.setColors(TFT_WHITE, TFT_DARKGREY, TFT_GREEN, TFT_BLACK, TFT_BLACK);
+    for (int v = 0; v < 4; v++) voiceStrip.setLabel(v, VOICE_LABELS[v]);
+    stepField.begin(110, 200, 8, 1, TFT_WHITE, TFT_BLACK);
+    statusLine.begin(10, 220, 30, 1, TFT_WHITE, TFT_BLACK);
+    tunerField.begin(170, 200, 11, 1, TFT_CYAN, TFT_BLACK);
+    screen.add(voiceStrip);
+    screen.add(stepField);
+    screen.add(statusLine);
+    screen.add(tunerField);
 }
 
 void initEncoders() {
     for (int i = 0; i < 5; i++) {
-        encoders[i].attachFullQuad(ENCODER_PINS[i][0], ENCODER_PINS[i][1]);
-        encoders[i].clearCount();
+        encoders.attach(i, ENCODER_PINS[i][0], ENCODER_PINS[i][1]);
+        encoders.setRange(i, PARAM_RANGES[i][1] - PARAM_RANGES[i][0]);  // A flick sweeps the range
         pinMode(ENCODER_PINS[i][2], INPUT_PULLUP);  // Switch pin
     }
 }
 
 void initMatrix() {
-    // Set up matrix keyboard
-    for (int i = 0; i < 4; i++) {
-        pinMode(MATRIX_ROWS[i], INPUT_PULLUP);
-        pinMode(MATRIX_COLS[i], OUTPUT);
-        digitalWrite(MATRIX_COLS[i], HIGH);
-    }
-    
-    // Set up direct buttons
-    for (int i = 0; i < 4; i++) {
-        pinMode(DIRECT_BUTTONS[i], INPUT_PULLUP);
+    // Columns are pulled low one at a time, rows read with pull-ups
+    keyScanner.setMatrix(MATRIX_ROWS, 4, MATRIX_COLS, 4);
+    keyScanner.setButtons(DIRECT_BUTTONS, 3);
+    if (!keyScanner.begin()) {
+        Serial.println("Key scanner failed to start");
     }
 }
 
 void initAudio() {
-    // Configure I2S for audio output
-    i2s_config_t i2s_config = {
-        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
-        .sample_rate = 44100,
-        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
-        .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
-        .communication_format = I2S_COMM_FORMAT_STAND_I2S,
-        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 8,
-        .dma_buf_len = 64,
-        .use_apll = false,
-        .tx_desc_auto_clear = true,
-        .fixed_mclk = 0
-    };
+    // I2S to the PCM5102: 8 DMA buffers of 64 frames. The render task works
+    // 1-7 buffers (1.5-10 ms) ahead of the DAC, tuned to the render load.
+    AudioOutputConfig config;
+    audioOutputDefaults(config, SAMPLE_RATE);
+    config.bufferCount = 8;
+    config.bufferFrames = 64;
+    config.bckPin = I2S_BCLK;
+    config.wsPin = I2S_LRCLK;
+    config.dataPin = I2S_DOUT;
     
-    i2s_pin_config_t pin_config = {
-        .bck_io_num = I2S_BCLK,
-        .ws_io_num = I2S_LRCLK,
-        .data_out_num = I2S_DOUT,
-        .data_in_num = I2S_PIN_NO_CHANGE
-    };
+    if (!i2sOutput.begin(config)) {
+        Serial.println("I2S output failed to start");
+        return;
+    }
+    
+    // Render task on core 1, woken by each TX-done interrupt
+    engine.begin();
+    if (presetLog.begin("/mintysynth.log")) {
+        engine.setPresetLog(&presetLog);
+        if (presetLog.isRecovered()) Serial.println("Preset log: dropped a damaged tail");
+    }
+    audio.setAdaptiveLatency(true);
+    analyzer.begin(SAMPLE_RATE);
+    audio.setTap(&audioTap);
+    audio.setProbe(&latencyProbe);
     
-    i2s_driver_install(I2S_NUM_0, &i2s_config, 0, NULL);
-    i2s_set_pin(I2S_NUM_0, &pin_config);
+    // MIDI plays on the render task, one DMA buffer after it arrives
+    midiInput.attachUart(Serial1, MIDI_RX);
+    audio.setMidi(&midiInput);
+    audio.begin(i2sOutput);
+    if (!midiInput.begin()) {
+        Serial.println("MIDI input failed to start");
+    }
 }
 
 void updateDisplay() {
-    // Clear display area
-    tft.fillRect(0, 50, 320, 190, TFT_BLACK);
-    
-    // Display current parameters
-    tft.setTextSize(1);
-    tft.drawString("TEMPO: " + String(synth.tempo), 10, 60);
-    tft.drawString("PITCH: " + String(synth.pitch), 10, 80);
-    tft.drawString("LENGTH: " + String(synth.length), 10, 100);
-    tft.drawString("ENVELOPE: " + String(synth.envelope), 10, 120);
-    tft.drawString("SWING: " + String(synth.swing), 10, 140);
+    // Hand the widgets the current state, then draw only the differences
+    const uint16_t values[5] = {synth.tempo, synth.pitch, synth.length, synth.envelope, synth.swing};
+    for (int i = 0; i < 5; i++) {
+        paramFields[i].printf("%s: %u", PARAM_NAMES[i], values[i]);
+        paramGauges[i].setValue(values[i]);
+    }
     
-    // Display step grid
-    tft.drawString("STEPS:", 10, 170);
     for (int i = 0; i < 16; i++) {
-        int x = 60 + (i * 15);
-        int y = 170;
-        
-        if (synth.stepActive[i]) {
-            tft.fillRect(x, y, 12, 12, TFT_GREEN);
+        stepGrid.setStep(i, synth.stepActive[i]);
+    }
+    stepGrid.setCurrent(synth.currentStep);
+    
+    // The bar under the selected voice shows the sequencer running
+    for (int v = 0; v < 4; v++) {
+        voiceStrip.setActive(v, synth.playing && v == synth.currentVoice);
+    }
+    voiceStrip.setSelected(synth.currentVoice);
+    stepField.printf("Step: %u", synth.currentStep + 1);
+    
+    uint32_t latencyUs = audio.getLatencyUs();
+    statusLine.printf("%s  Latency: %lu.%lu ms", synth.playing ? "PLAY" : "STOP",
+                      (unsigned long)(latencyUs / 1000), (unsigned long)(latencyUs / 100 % 10));
+    
+    // Tuner keeps its last reading if the render task lapped the copy
+    if (analyzer.update(audioTap)) {
+        const TunerReading& tuning = analyzer.getTuner();
+        if (tuning.valid) {
+            tunerField.printf("%s%d %+dc", audioNoteName(tuning.note), tuning.note / 12 - 1, tuning.cents);
         } else {
-            tft.drawRect(x, y, 12, 12, TFT_WHITE);
-        }
-        
-        // Highlight current step
-        if (i == synth.currentStep) {
-            tft.drawRect(x-1, y-1, 14, 14, TFT_RED);
+            tunerField.setText("--");
         }
     }
     
-    // Display current voice and step
-    tft.drawString("Voice: " + String(synth.currentVoice + 1), 10, 200);
-    tft.drawString("Step: " + String(synth.currentStep + 1), 100, 200);
+    screen.render(canvas);
 }
 
 void scanEncoders() {
-    // Read encoder changes
+    // Detents turned since the last scan, faster turns moving further
     int32_t changes[5];
     for (int i = 0; i < 5; i++) {
-        changes[i] = encoders[i].getCount();
-        encoders[i].clearCount();
+        changes[i] = encoders.getChange(i);
     }
     
     // Update parameters based on encoder changes
     if (changes[0] != 0) {  // Tempo
         synth.tempo = constrain(synth.tempo + changes[0], 60, 200);
+        audio.setGlobalParam(GLOBAL_TEMPO, synth.tempo);
     }
     if (changes[1] != 0) {  // Pitch
         synth.pitch = constrain(synth.pitch + changes[1], 24, 96);
         synth.stepNotes[synth.currentStep] = synth.pitch;
+        audio.setStep(synth.currentVoice, synth.currentStep, synth.pitch, synth.stepActive[synth.currentStep]);
     }
     if (changes[2] != 0) {  // Length
         synth.length = constrain(synth.length + changes[2], 10, 100);
+        audio.setVoiceParam(synth.currentVoice, PARAM_LENGTH, synth.length);
     }
     if (changes[3] != 0) {  // Envelope
         synth.envelope = constrain(synth.envelope + changes[3], 0, 4);
+        audio.setVoiceParam(synth.currentVoice, PARAM_ENVELOPE, synth.envelope);
     }
     if (changes[4] != 0) {  // Swing
         synth.swing = constrain(synth.swing + changes[4], 0, 50);
+        audio.setGlobalParam(GLOBAL_SWING, synth.swing);
     }
 }
 
-void scanMatrix() {
-    static bool lastButtonState[20] = {false};
-    bool currentButtonState[20] = {false};
-    
-    // Scan 4x4 matrix
-    for (int col = 0; col < 4; col++) {
-        digitalWrite(MATRIX_COLS[col], LOW);
-        delayMicroseconds(10);
-        
-        for (int row = 0; row < 4; row++) {
-            int buttonIndex = row * 4 + col;
-            currentButtonState[buttonIndex] = !digitalRead(MATRIX_ROWS[row]);
+void processKeys() {
+    // Debounced presses from the scanner (releases do nothing here)
+    InputEvent event;
+    while (keyScanner.pop(event)) {
+        if (!event.down) continue;
+        uint8_t i = event.key;
+        if (i < 16) {
+            // Step button pressed
+            synth.currentStep = i;
+            synth.stepActive[i] = !synth.stepActive[i];  // Toggle step
+            audio.setStep(synth.currentVoice, i, synth.stepNotes[i], synth.stepActive[i]);
+            if (synth.stepActive[i]) {
+                // Preview, stamped with the press for the latency probe
+                audio.noteOn(synth.currentVoice, synth.stepNotes[i], 127, event.us);
+            }
+        } else {
+            // Direct button pressed
+            switch (i - 16) {
+                case 0:  // PLAY/STOP
+                    synth.playing = !synth.playing;
+                    if (synth.playing) {
+                        audio.start();
+                    } else {
+                        audio.stop();
+                    }
+                    break;
+                case 1:  // VOICE SELECT
+                    synth.currentVoice = (synth.currentVoice + 1) % 4;
+                    break;
+                case 2:  // CLEAR/SHIFT (combined function)
+                    synth.stepActive[synth.currentStep] = false;
+                    audio.setStep(synth.currentVoice, synth.currentStep, synth.stepNotes[synth.currentStep], false);
+                    break;
+            }
         }
-        
-        digitalWrite(MATRIX_COLS[col], HIGH);
-    }
-    
-    // Scan direct buttons (only 3 buttons now)
-    for (int i = 0; i < 3; i++) {
-        currentButtonState[16 + i] = !digitalRead(DIRECT_BUTTONS[i]);
     }
-    
-    // Process button presses (just pressed, not held)
-    for (int i = 0; i < 19; i++) {  // 16 matrix + 3 direct = 19 total
-        if (currentButtonState[i] && !lastButtonState[i]) {
-            if (i < 16) {
-                // Step button pressed
-                synth.currentStep = i;
-                synth.stepActive[i] = !synth.stepActive[i];  // Toggle step
-            } else {
-                // Direct button pressed
-                switch (i - 16) {
-                    case 0:  // PLAY/STOP
-                        // TODO: Implement play/stop
-                        break;
-                    case 1:  // VOICE SELECT
-                        synth.currentVoice = (synth.currentVoice + 1) % 4;
-                        break;
-                    case 2:  // CLEAR/SHIFT (combined function)
-                        synth.stepActive[synth.currentStep] = false;
-                        break;
-                }
+}
+
+void handleSerial(int command) {
+    switch (command) {
+        case 'l':
+            printLatency();
+            break;
+        case 'r':
+            latencyProbe.reset();
+            Serial.println("Latency histograms cleared");
+            break;
+        case 's':
+            Serial.println(audio.savePreset(0) ? "Preset saved" : "Preset save failed");
+            break;
+        case 'o':
+            if (!audio.loadPreset(0)) {
+                Serial.println("No preset saved");
+                break;
             }
-        }
-        lastButtonState[i] = currentButtonState[i];
+            // Bring the UI copy in line with what was loaded
+            synth.tempo = engine.getGlobalParam(GLOBAL_TEMPO);
+            synth.swing = engine.getGlobalParam(GLOBAL_SWING);
+            synth.length = engine.getVoiceParam(synth.currentVoice, PARAM_LENGTH);
+            synth.envelope = engine.getVoiceParam(synth.currentVoice, PARAM_ENVELOPE);
+            for (uint8_t i = 0; i < 16; i++) {
+                synth.stepActive[i] = engine.isStepActive(synth.currentVoice, i);
+            }
+            Serial.println("Preset loaded");
+            break;
+        case 'v':
+            printVoiceCost();
+            break;
+        case 'm':
+            // No more commands or reports from here on: the port belongs to the MIDI timer
+            Serial.println("USB serial is MIDI in now");
+            Serial.flush();
+            serialMidi = true;
+            midiInput.attach(Serial);
+            break;
     }
 }
 
-void processAudio() {
-    // TODO: Implement audio synthesis and I2S output
-    // This is a placeholder for the synthesis engine
-    static int16_t audioBuffer[64];
-    size_t bytesWritten;
+void printLatency() {
+    char line[96];
+    Serial.printf("Key to DAC latency (DMA %u x %u frames, lead %u):\n", i2sOutput.getBufferCount(),
+                  i2sOutput.getBufferFrames(), i2sOutput.getLead());
+    for (uint8_t stage = 0; stage < LATENCY_STAGES; stage++) {
+        latencyProbe.format(stage, line, sizeof(line));
+        Serial.println(line);
+    }
+    Serial.printf("MIDI: %lu messages, %lu late, %lu errors, %lu dropped\n",
+                  (unsigned long)midiInput.getMessages(), (unsigned long)audio.getMidiLate(),
+                  (unsigned long)midiInput.getErrors(), (unsigned long)midiInput.getDropped());
+    Serial.printf("Render: %lu cycles per frame, %lu us per buffer\n",
+                  (unsigned long)engine.getCyclesPerSample(), (unsigned long)audio.getRenderUs());
+}
+
+// Render cycles per frame against the number of sounding voices, the
+// polyphony ceiling of this chip. The engine is measured on this task, so
+// the render task stops meanwhile and the audio drops out for a moment.
+void printVoiceCost() {
+    uint32_t cycles[NUM_RENDER_VOICES + 1];
+    uint32_t cyclesPerSecond = getCpuFrequencyMhz() * 1000000UL;
     
-    // Generate simple test tone for now
-    static float phase = 0;
-    float frequency = 440.0 * pow(2.0, (synth.pitch - 69) / 12.0);
+    Serial.println("Measuring render cost per voice, audio paused");
+    Serial.flush();
+    audio.end();
+    bool wasPlaying = engine.isPlaying();
+    if (wasPlaying) engine.stop();
+    engine.measureVoiceCost(cycles, NUM_RENDER_VOICES);
+    if (wasPlaying) engine.start();
+    audio.begin(i2sOutput);
     
-    for (int i = 0; i < 64; i += 2) {
-        int16_t sample = (int16_t)(sin(phase) * 8000);
-        audioBuffer[i] = sample;      // Left channel
-        audioBuffer[i + 1] = sample;  // Right channel
-        phase += 2.0 * PI * frequency / 44100.0;
-        if (phase > 2.0 * PI) phase -= 2.0 * PI;
+    for (uint8_t voices = 0; voices <= NUM_RENDER_VOICES; voices++) {
+        uint32_t perVoice = (voices && cycles[voices] > cycles[0]) ? (cycles[voices] - cycles[0]) / voices : 0;
+        uint32_t load = (uint32_t)((uint64_t)cycles[voices] * SAMPLE_RATE * 1000 / cyclesPerSecond);
+        Serial.printf("%2u voices: %5lu cycles/frame (%lu per voice), core %lu.%lu%%\n", voices,
+                      (unsigned long)cycles[voices], (unsigned long)perVoice,
+                      (unsigned long)(load / 10), (unsigned long)(load % 10));
     }
-    
-    i2s_write(I2S_NUM_0, audioBuffer, sizeof(audioBuffer), &bytesWritten, 0);
-}
\ No newline at end of file
+}
@@ -0,0 +1,70 @@
+/*
+ * MintySynth Benchmark Golden Hashes
+ *
+ * Output hashes of every benchmark in main.cpp on a host build. A change
+ * that is meant to alter the output regenerates this list with
+ * minty-bench -p and says why in its commit.
+ */
+
+#ifndef MINTYSYNTH_BENCH_GOLDEN_H
+#define MINTYSYNTH_BENCH_GOLDEN_H
+
+#include <stdint.h>
+
+struct GoldenHash {
+    const char* name;
+    uint64_t hash;
+};
+
+static const GoldenHash goldenHashes[] = {
+    { "voices/1", 0xe087388b5c2bd541ULL },
+    { "voices/4", 0xbe9beb3b0d487329ULL },
+    { "voices/8", 0x373f998145f94addULL },
+    { "voices/16", 0x3f8df8df4ebbc509ULL },
+    { "voices/mixer", 0x1dd4dcee7fc9540bULL },
+    { "steal/oldest", 0xf81cfbbbc634e752ULL },
+    { "steal/quietest", 0xff017c8638a1043bULL },
+    { "steal/note", 0x5c82cd1154cefb88ULL },
+    { "wave/sine", 0xe14d72f86838d805ULL },
+    { "wave/ramp", 0x8ce432aa01caae85ULL },
+    { "wave/triangle", 0xb27ff259f8af3791ULL },
+    { "wave/square", 0x96856c243e1805b1ULL },
+    { "wave/noise", 0x4b621d0360b1e589ULL },
+    { "wave/saw", 0xbe9beb3b0d487329ULL },
+    { "wave/a", 0xfaba61587c9144f1ULL },
+    { "wave/b", 0xc8b9de774d7ab689ULL },
+    { "wave/c", 0x103e5f26b834f089ULL },
+    { "wave/d", 0x1ffd26193b85a319ULL },
+    { "wave/e", 0x0d7aeb91d2c5e575ULL },
+    { "wave/f", 0x2652b5d8411f6e49ULL },
+    { "wave/g", 0x1d982d4f445dcce9ULL },
+    { "wave/h", 0x3ddd6c79320a1315ULL },
+    { "wave/i", 0xee7cfcec69f243f9ULL },
+    { "envelope/attack", 0x0853d035fd7c3979ULL },
+    { "envelope/decay", 0xbd4db76efd710229ULL },
+    { "envelope/pluck", 0xdbb928565d494a85ULL },
+    { "envelope/long", 0x354975d91e570861ULL },
+    { "envelope/reverse", 0xbd4db76efd710229ULL },
+    { "sequencer", 0x32e04e43518028d5ULL },
+    { "sequencer/velocity", 0x55341c6bd34db99dULL },
+    { "sequencer/clock", 0xba26065375d3844aULL },
+    { "sequencer/song", 0x86fabdccaad7fb98ULL },
+    { "pattern/store", 0x002efe7328097435ULL },
+    { "preset/log", 0x0b8f824043ec19bdULL },
+    { "scheduler/wheel", 0x8d5db88a65ac6c99ULL },
+    { "scheduler/linear", 0x8d5db88a65ac6c99ULL },
+    { "input/keys", 0xa3a78bb8b9074abdULL },
+    { "input/scan", 0x574149d08aea4b4cULL },
+    { "input/encoder", 0x2ce4f8f366ddd6dcULL },
+    { "input/midi", 0x09397680bd534446ULL },
+    { "latency/tuner", 0xd20877defae06dd8ULL },
+    { "latency/probe", 0x5c4ed1712beffb25ULL },
+    { "ui/redraw", 0xfd436c93147a7e52ULL },
+    { "ui/retained", 0x653987cb97c72ebeULL },
+    { "analysis/tap", 0x694879bb6ffbb13cULL },
+    { "analysis/frame", 0x9976f33b19a951f8ULL },
+    { "threads/queue", 0x692bc31f5afa7a75ULL },
+    { "threads/snapshot", 0x7d22d633bb6aaf29ULL },
+};
+
+#endif // MINTYSYNTH_BENCH_GOLDEN_H
@@ -0,0 +1,2084 @@
+/*
+ * MintySynth Benchmarks
+ *
+ * Host benchmarks for the render, sequencer, input, latency tuning and
+ * display paths. Each one reports the best time per item (a stereo
+ * frame, a key scan, a tuner decision or a UI frame) over a few repeats
+ * and hashes everything it produced. The hash is compared with golden.h,
+ * so a change that alters the sound, the step timing, the decoded keys,
+ * the tuner's choices or what the UI draws fails the run instead of only
+ * moving the numbers. The UI benchmarks also print the pixels and SPI
+ * bytes drawn per frame, the analysis one how often the tuner found the
+ * note being played, the sequencer clock how far any step lands from its
+ * exact time, the song how many patterns it started against the count
+ * expected, the velocity one whether each note's peak follows its step
+ * velocity, the pattern store how full its pool got and whether any load
+ * came back wrong, the preset log how many sections it wrote and skipped
+ * and whether any load (or the recovery from a torn write) came back
+ * wrong, the event schedulers how many events they held and
+ * whether any played late, the scanner one how many key edges came out
+ * right, the encoder one whether any steps were lost and how far a flick
+ * goes, the MIDI one how far its notes move against their arrival (and
+ * how far they would by whole blocks) and the latency probe how far its
+ * percentiles are from the exact ones. The mixer one also compares the
+ * vector mixer with the scalar one on every block and fails on any
+ * difference, golden hash or not, and the steal ones check every voice
+ * the allocator picks against a model of its policy. The threads ones hand data between two
+ * threads through the lock-free types and fail on anything torn or out
+ * of order; build with -fsanitize=thread to have the races checked too.
+ *
+ *   minty-bench [options] [filter]
+ *
+ *   -r <n>     Repeats per benchmark, best time wins (default 5)
+ *   -p         Print the current hashes in golden.h format and exit 0
+ *   filter     Only run benchmarks whose name contains this
+ *
+ * Exits 1 if any hash differs from golden.h or between repeats, or a
+ * benchmark's own check failed.
+ */
+
+#include "MintySynth.h"
+#include "VoiceMixer.h"
+#include "SequencerClock.h"
+#include "EventScheduler.h"
+#include "PatternStore.h"
+#include "PresetLog.h"
+#include "InputDecoder.h"
+#include "InputScanner.h"
+#include "EncoderDecoder.h"
+#include "MidiInput.h"
+#include "AudioOutput.h"
+#include "AudioPipeline.h"
+#include "LatencyTuner.h"
+#include "LatencyProbe.h"
+#include "UiWidgets.h"
+#include "AudioAnalysis.h"
+#include "ParamSnapshot.h"
+#include "SynthPlatform.h"
+#include "golden.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+#define BENCH_BLOCK_FRAMES   AUDIO_BUFFER_SIZE
+#define BENCH_BLOCKS         (SAMPLE_RATE * 5 / BENCH_BLOCK_FRAMES)  // 5 s of audio per render benchmark
+#define BENCH_SCANS          1000000UL
+#define BENCH_MIXES          200000UL     // Random blocks through both mixers
+#define BENCH_STEALS         1000000UL    // Note-ons into a full pool, mostly
+#define BENCH_STEAL_POOL     8            // Polyphony for the steal benchmarks
+#define BENCH_TUNER_BUFFERS  1000000UL
+#define BENCH_SCAN_SECONDS   60
+#define BENCH_SCAN_KEYS      19           // 4x4 matrix and three buttons
+#define BENCH_SCAN_EDGES     1024         // Presses and releases per key, at most
+#define BENCH_SCAN_BOUNCES   7            // Contact changes per edge, at most
+#define BENCH_SCAN_LATE_US   4000         // Bounces (under 3 ms) plus one full scan
+#define BENCH_ENCODER_TURNS  1000         // Turn scripts per run, 2.5 s each
+#define BENCH_ENCODER_EDGES  (BENCH_ENCODER_TURNS * 640)
+#define BENCH_ENCODER_RANGE  260          // Tempo, 40-300 BPM
+#define BENCH_MIDI_SECONDS   60
+#define BENCH_MIDI_BYTES     (BENCH_MIDI_SECONDS * 3125)   // A DIN cable flat out
+#define BENCH_MIDI_BYTE_US   320          // 10 bits at 31250 baud
+#define BENCH_MIDI_CLOCK_US  20833        // 24 clocks a beat at 120 BPM
+#define BENCH_MIDI_JITTER_US 300          // Render task waking late, at most
+#define BENCH_PROBE_SAMPLES  200000       // Latencies recorded per run
+#define BENCH_CLOCK_SECONDS  60           // Played at every tempo and swing
+#define BENCH_SCHED_SECONDS  120
+#define BENCH_SCHED_LANES    16           // Every lane plays every step
+#define BENCH_SCHED_BPM      160
+#define BENCH_STORE_OPS      200000       // Pattern saves, each followed by a load
+#define BENCH_SONG_SECONDS   120
+#define BENCH_PRESET_OPS     20000        // Preset saves, each followed by a load
+#define BENCH_PRESET_PATH    "minty-bench-presets.log"
+#define BENCH_UI_FRAMES      100000UL     // At 20 fps, 83 minutes of UI
+#define BENCH_TAP_BLOCKS     1000000UL
+#define BENCH_ANALYSIS_BLOCKS (SAMPLE_RATE * 30 / BENCH_BLOCK_FRAMES)  // 30 s of audio, analysed at 20 fps
+#define BENCH_SNAPSHOT_SETS  1000000UL    // Published by one thread, picked up by another
+#define BENCH_SNAPSHOT_WORDS 32
+#define BENCH_QUEUE_ITEMS    1000000UL    // Pushed by one thread, popped by another
+
+// One repeat of a benchmark: time spent in the measured calls, items
+// processed and a running FNV-1a hash of the output
+class BenchRun {
+public:
+    BenchRun() : nanoseconds(0), items(0), hash(0xcbf29ce484222325ULL), failed(false) {
+        note[0] = '\0';
+    }
+
+    void begin() { started = std::chrono::steady_clock::now(); }
+    void end(uint64_t count) {
+        nanoseconds += std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - started).count();
+        items += count;
+    }
+
+    // Printed after the status, e.g. a per-item count
+    void setNote(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        vsnprintf(note, sizeof(note), format, args);
+        va_end(args);
+    }
+
+    void add(const void* data, size_t bytes) {
+        const uint8_t* p = (const uint8_t*)data;
+        for (size_t i = 0; i < bytes; i++) {
+            hash = (hash ^ p[i]) * 0x100000001b3ULL;
+        }
+    }
+
+    // The benchmark's own check went wrong; the note says how
+    void fail() { failed = true; }
+
+    double nanoseconds;
+    uint64_t items;
+    uint64_t hash;
+    bool failed;
+    char note[48];
+
+private:
+    std::chrono::steady_clock::time_point started;
+};
+
+struct BenchCase;
+typedef void (*BenchFunction)(const BenchCase& bench, BenchRun& run);
+
+struct BenchCase {
+    char name[32];
+    const char* unit;
+    BenchFunction function;
+    int arg;
+};
+
+static const char* waveNames[NUM_WAVEFORMS] = {
+    "sine", "ramp", "triangle", "square", "noise", "saw",
+    "a", "b", "c", "d", "e", "f", "g", "h", "i"
+};
+
+static const char* envelopeNames[NUM_ENVELOPES] = {
+    "attack", "decay", "pluck", "long", "reverse"
+};
+
+static std::unique_ptr<MintySynth> newSynth() {
+    std::unique_ptr<MintySynth> synth(new MintySynth());
+    synth->begin();
+    return synth;
+}
+
+static void setLanes(MintySynth& synth, uint8_t waveform, uint8_t envelope, uint8_t length) {
+    for (int lane = 0; lane < NUM_VOICES; lane++) {
+        synth.setVoiceParam(lane, PARAM_WAVEFORM, waveform);
+        synth.setVoiceParam(lane, PARAM_ENVELOPE, envelope);
+        synth.setVoiceParam(lane, PARAM_LENGTH, length);
+    }
+    synth.refreshParams();      // Block boundary: the first notes already play these
+}
+
+static uint32_t benchRandom(uint32_t& state, uint32_t low, uint32_t high) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return low + state % (high - low);
+}
+
+// Renders `blocks` blocks, retriggering `voices` notes spread over the
+// lanes every `retrigger` blocks
+static void renderNotes(MintySynth& synth, BenchRun& run, int voices, int blocks, int retrigger) {
+    static int16_t buffer[BENCH_BLOCK_FRAMES * 2];
+
+    for (int b = 0; b < blocks; b++) {
+        if (b % retrigger == 0) {
+            for (int v = 0; v < voices; v++) {
+                synth.triggerVoice(v % NUM_VOICES, 36 + ((v * 7 + b / retrigger) % 48));
+            }
+        }
+        run.begin();
+        synth.processAudio(buffer, BENCH_BLOCK_FRAMES * 2);
+        run.end(BENCH_BLOCK_FRAMES);
+        run.add(buffer, sizeof(buffer));
+    }
+}
+
+// Render cost against the number of sounding voices (saw, long envelope)
+static void benchVoices(const BenchCase& bench, BenchRun& run) {
+    std::unique_ptr<MintySynth> synth = newSynth();
+    synth->setPolyphony(bench.arg);
+    setLanes(*synth, WAVE_SAW, ENV_LONG, 127);
+    renderNotes(*synth, run, bench.arg, BENCH_BLOCKS, 86);
+}
+
+// One waveform on four voices
+// mixVoiceBlocks() (PIE on the ESP32-S3, SSE2 on x86) against
+// mixVoiceBlocksScalar() on random blocks: 0-4 voices, any length up to
+// a full block, quiet, full-range and loud enough to saturate, with one
+// block or the output moved off the vector alignment one time in four.
+// Only the vector mixer is timed; any difference fails the run.
+static void benchMixer(const BenchCase& bench, BenchRun& run) {
+    const size_t span = AUDIO_BUFFER_SIZE + MIXER_LANES;
+    alignas(MIXER_ALIGN) static int16_t voices[4][span];
+    alignas(MIXER_ALIGN) static int16_t vectorOut[span];
+    alignas(MIXER_ALIGN) static int16_t scalarOut[span];
+    uint32_t seed = 0x510E527Fu;
+    uint32_t clipped = 0;
+    uint32_t differ = 0;
+    (void)bench;
+
+    for (uint32_t m = 0; m < BENCH_MIXES; m++) {
+        uint8_t count = (uint8_t)benchRandom(seed, 0, 5);
+        size_t frames = benchRandom(seed, 1, AUDIO_BUFFER_SIZE + 1);
+        uint32_t level = benchRandom(seed, 0, 3);
+        uint32_t moved = benchRandom(seed, 0, 4) ? 5 : benchRandom(seed, 0, 5);    // 4 is the output
+        size_t offset = benchRandom(seed, 1, MIXER_LANES);
+
+        const int16_t* blocks[4];
+        for (uint8_t v = 0; v < count; v++) {
+            int16_t* block = voices[v] + (moved == v ? offset : 0);
+            for (size_t n = 0; n < frames; n++) {
+                int32_t sample;
+                if (level == 0) {
+                    sample = (int32_t)benchRandom(seed, 0, 8192) - 4096;
+                } else if (level == 1) {
+                    sample = (int32_t)benchRandom(seed, 0, 65536) - 32768;
+                } else {
+                    sample = (int32_t)benchRandom(seed, 16000, 32768) * ((n & 16) ? -1 : 1);
+                }
+                block[n] = (int16_t)sample;
+            }
+            blocks[v] = block;
+        }
+        int16_t* out = vectorOut + (moved == 4 ? offset : 0);
+
+        run.begin();
+        mixVoiceBlocks(out, blocks, count, frames);
+        run.end(frames);
+        mixVoiceBlocksScalar(scalarOut, blocks, count, frames);
+
+        differ += memcmp(out, scalarOut, frames * sizeof(int16_t)) != 0;
+        for (size_t n = 0; n < frames; n++) clipped += (out[n] == 32767 || out[n] == -32768);
+        run.add(out, frames * sizeof(int16_t));
+    }
+    if (differ) run.fail();
+    run.setNote("%lu mixes, %lu clipped, %lu differ", (unsigned long)BENCH_MIXES,
+                (unsigned long)clipped, (unsigned long)differ);
+}
+
+// Voice stealing: note-ons from six notes on four lanes into a pool of
+// BENCH_STEAL_POOL voices, with random levels and releases so it is full
+// most of the time. Each render voice VoiceAllocator picks is checked
+// against a plain model of the policy (arg 0 oldest, 1 quietest, 2
+// oldest with same-note stealing). The same settings then play 5 s of
+// random notes through the synth, which must never sound more voices
+// than the pool. Times a note-on with the model's bookkeeping.
+static void benchSteal(const BenchCase& bench, BenchRun& run) {
+    static const StealPolicy policies[3] = { STEAL_OLDEST, STEAL_QUIETEST, STEAL_OLDEST };
+    StealPolicy policy = policies[bench.arg];
+    bool sameNote = bench.arg == 2;
+    std::unique_ptr<VoiceAllocator> allocator(new VoiceAllocator());
+    bool active[NUM_RENDER_VOICES] = {};
+    uint16_t level[NUM_RENDER_VOICES] = {};
+    uint8_t voiceLane[NUM_RENDER_VOICES] = {};
+    uint8_t voiceNote[NUM_RENDER_VOICES] = {};
+    uint32_t voiceAge[NUM_RENDER_VOICES] = {};
+    uint32_t seed = 0x9B05688Cu;
+    uint32_t steals = 0;
+    uint32_t retriggers = 0;
+    uint32_t wrong = 0;
+
+    allocator->setPolyphony(BENCH_STEAL_POOL);
+    allocator->setPolicy(policy);
+    allocator->setSameNoteSteal(sameNote);
+
+    run.begin();
+    for (uint32_t n = 0; n < BENCH_STEALS; n++) {
+        // Notes end and fade between note-ons
+        if (benchRandom(seed, 0, 4) == 0) active[benchRandom(seed, 0, BENCH_STEAL_POOL)] = false;
+        level[benchRandom(seed, 0, BENCH_STEAL_POOL)] = (uint16_t)benchRandom(seed, 0, 64);
+
+        uint8_t lane = (uint8_t)benchRandom(seed, 0, NUM_VOICES);
+        uint8_t note = (uint8_t)benchRandom(seed, 60, 66);
+        uint8_t expected = NO_VOICE;
+        if (sameNote) {
+            for (uint8_t v = 0; v < BENCH_STEAL_POOL && expected == NO_VOICE; v++) {
+                if (active[v] && voiceLane[v] == lane && voiceNote[v] == note) expected = v;
+            }
+            retriggers += expected != NO_VOICE;
+        }
+        for (uint8_t v = 0; v < BENCH_STEAL_POOL && expected == NO_VOICE; v++) {
+            if (!active[v]) expected = v;
+        }
+        if (expected == NO_VOICE) {
+            expected = 0;
+            for (uint8_t v = 1; v < BENCH_STEAL_POOL; v++) {
+                bool quieter = level[v] < level[expected] ||
+                               (level[v] == level[expected] && voiceAge[v] < voiceAge[expected]);
+                bool older = voiceAge[v] < voiceAge[expected];
+                if (policy == STEAL_QUIETEST ? quieter : older) expected = v;
+            }
+            steals++;
+        }
+
+        uint8_t voice = allocator->allocate(lane, note, active, level);
+        wrong += voice != expected;
+        if (voice >= BENCH_STEAL_POOL) break;
+        active[voice] = true;
+        level[voice] = (uint16_t)benchRandom(seed, 32, 96);   // Fresh notes are mostly louder
+        voiceLane[voice] = lane;
+        voiceNote[voice] = note;
+        voiceAge[voice] = n;
+        run.add(&voice, sizeof(voice));
+    }
+    run.end(BENCH_STEALS);
+
+    // The same settings on the synth, lanes at four volumes
+    static int16_t buffer[BENCH_BLOCK_FRAMES * 2];
+    std::unique_ptr<MintySynth> synth = newSynth();
+    uint32_t over = 0;
+    synth->setPolyphony(BENCH_STEAL_POOL);
+    synth->setStealPolicy(policy);
+    synth->setSameNoteSteal(sameNote);
+    for (int lane = 0; lane < NUM_VOICES; lane++) {
+        synth->setVoiceParam(lane, PARAM_VOLUME, 40 + lane * 29);
+    }
+    setLanes(*synth, WAVE_SAW, ENV_LONG, 127);
+    for (int b = 0; b < BENCH_BLOCKS; b++) {
+        uint32_t notes = benchRandom(seed, 0, 4);
+        for (uint32_t i = 0; i < notes; i++) {
+            synth->triggerVoice((uint8_t)benchRandom(seed, 0, NUM_VOICES), (uint8_t)benchRandom(seed, 48, 54));
+        }
+        synth->processAudio(buffer, BENCH_BLOCK_FRAMES * 2);
+        over += synth->getActiveVoiceCount() > BENCH_STEAL_POOL;
+        run.add(buffer, sizeof(buffer));
+    }
+
+    if (wrong || over) run.fail();
+    run.setNote("%lu steals, %lu retriggers, %lu wrong", (unsigned long)steals,
+                (unsigned long)retriggers, (unsigned long)(wrong + over));
+}
+
+static void benchWaveform(const BenchCase& bench, BenchRun& run) {
+    std::unique_ptr<MintySynth> synth = newSynth();
+    setLanes(*synth, bench.arg, ENV_LONG, 127);
+    renderNotes(*synth, run, 4, BENCH_BLOCKS, 86);
+}
+
+// One envelope on four voices, retriggered often enough to pass every stage
+static void benchEnvelope(const BenchCase& bench, BenchRun& run) {
+    std::unique_ptr<MintySynth> synth = newSynth();
+    setLanes(*synth, WAVE_SINE, bench.arg, 40);
+    renderNotes(*synth, run, 4, BENCH_BLOCKS, 34);
+}
+
+// Four busy lanes played by the sequencer on the sample clock
+static void benchSequencer(const BenchCase& bench, BenchRun& run) {
+    static int16_t buffer[BENCH_BLOCK_FRAMES * 2];
+    std::unique_ptr<MintySynth> synth = newSynth();
+    (void)bench;
+
+    for (int lane = 0; lane < NUM_VOICES; lane++) {
+        synth->setVoiceParam(lane, PARAM_WAVEFORM, WAVE_A + lane * 2);
+        synth->setVoiceParam(lane, PARAM_ENVELOPE, ENV_PLUCK);
+        for (int s = 0; s < NUM_STEPS; s++) {
+            if ((s + lane) % (lane + 1) == 0) synth->setStep(lane, s, 40 + lane * 12 + s);
+        }
+    }
+    synth->setTempo(200);
+
+    synth->start();
+    for (int b = 0; b < BENCH_BLOCKS; b++) {
+        run.begin();
+        synth->processAudio(buffer, BENCH_BLOCK_FRAMES * 2);
+        run.end(BENCH_BLOCK_FRAMES);
+        run.add(buffer, sizeof(buffer));
+    }
+    synth->stop();
+}
+
+// Step velocities: one lane plays a pattern whose 16 steps fall from
+// velocity 127 to 7, each note ending before the next step. The peak of
+// every note, found between the silences, must follow its velocity.
+static void benchVelocity(const BenchCase& bench, BenchRun& run) {
+    static int16_t buffer[BENCH_BLOCK_FRAMES * 2];
+    const int blocks = SAMPLE_RATE * 4 / BENCH_BLOCK_FRAMES;     // Two passes at 120 BPM
+    std::unique_ptr<MintySynth> synth = newSynth();
+    StepPattern pattern;
+    (void)bench;
+
+    synth->setVoiceParam(0, PARAM_WAVEFORM, WAVE_SINE);
+    synth->setVoiceParam(0, PARAM_ENVELOPE, ENV_ATTACK);
+    synth->setVoiceParam(0, PARAM_LENGTH, 100);
+    synth->setVoiceParam(0, PARAM_VOLUME, 127);
+    pattern.clear(NUM_STEPS, 60);
+    for (uint8_t step = 0; step < NUM_STEPS; step++) {
+        pattern.setStep(0, step, 60, 127 - step * 8, true);
+    }
+    synth->getPatternStore().save(0, pattern);
+    synth->loadPattern(0);
+    synth->setTempo(120);
+
+    int16_t peaks[NUM_STEPS * 2];
+    uint32_t notes = 0;
+    int16_t peak = 0;
+    uint32_t quiet = 0;
+    synth->start();
+    for (int b = 0; b < blocks; b++) {
+        run.begin();
+        synth->processAudio(buffer, BENCH_BLOCK_FRAMES * 2);
+        run.end(BENCH_BLOCK_FRAMES);
+        run.add(buffer, sizeof(buffer));
+
+        for (int i = 0; i < BENCH_BLOCK_FRAMES; i++) {
+            int16_t sample = (int16_t)abs(buffer[i * 2]);
+            if (sample) {
+                peak = std::max(peak, sample);
+                quiet = 0;
+            } else if (++quiet == 64 && peak) {     // A note is over
+                if (notes < NUM_STEPS * 2) peaks[notes] = peak;
+                notes++;
+                peak = 0;
+            }
+        }
+    }
+    synth->stop();
+
+    // Within 2% of full scale of the first note scaled by velocity
+    uint32_t off = 0;
+    for (uint32_t n = 0; n < notes && n < NUM_STEPS * 2; n++) {
+        int32_t expected = (int32_t)peaks[0] * pattern.velocities[0][n % NUM_STEPS] / 127;
+        off += abs(peaks[n] - expected) > peaks[0] / 50;
+        off += n % NUM_STEPS && peaks[n] >= peaks[n - 1];
+    }
+    if (notes != NUM_STEPS * 2 || off) run.fail();
+    run.setNote("%lu notes, peak %d to %d, %lu off", (unsigned long)notes, peaks[0],
+                notes >= NUM_STEPS ? peaks[NUM_STEPS - 1] : 0, (unsigned long)off);
+}
+
+// SequencerClock at every tempo from 60 to 200 BPM, straight and fully
+// swung, driven the way processAudio() does in blocks cut at each step.
+// Every step's frame is checked against its exact time.
+static void benchClock(const BenchCase& bench, BenchRun& run) {
+    const uint64_t endFrame = (uint64_t)SAMPLE_RATE * BENCH_CLOCK_SECONDS;
+    SequencerClock clock;
+    uint32_t steps = 0;
+    double worst = 0;
+    (void)bench;
+
+    run.begin();
+    for (uint16_t bpm = 60; bpm <= 200; bpm++) {
+        for (uint8_t swing = 0; swing <= 127; swing += 127) {
+            double step = SAMPLE_RATE * 15.0 / bpm;
+            uint64_t frame = 0;
+            uint32_t played = 0;
+            clock.begin(SAMPLE_RATE, NUM_STEPS);
+            clock.setTempo(bpm);
+            clock.setSwing(swing, 127);
+            clock.start(0);
+            while (frame < endFrame) {
+                uint32_t frames = clock.framesUntilStep(frame, BENCH_BLOCK_FRAMES);
+                if (frames) {
+                    frame += frames;
+                    continue;
+                }
+                clock.advance();
+                double exact = (played / 2) * 2 * step + ((played & 1) ? step * (1 + swing / 254.0) : 0);
+                double error = frame - exact;
+                if (error > worst) worst = error;
+                if (-error > worst) worst = -error;
+                run.add(&frame, sizeof(frame));
+                played++;
+            }
+            steps += played;
+        }
+    }
+    run.end(steps);
+    run.setNote("%lu steps, worst %.2f frames off", (unsigned long)steps, worst);
+}
+
+// Key scans with a few keys changing at a time, decoded into presses
+static void benchInput(const BenchCase& bench, BenchRun& run) {
+    static uint32_t scans[BENCH_SCANS];
+    KeyDecoder keys;
+    uint32_t lfsr = 0xACE1u;
+    uint32_t scan = 0;
+    (void)bench;
+
+    for (unsigned long i = 0; i < BENCH_SCANS; i++) {
+        lfsr = (lfsr >> 1) ^ (-(lfsr & 1u) & 0xB400u);
+        if ((lfsr & 7) == 0) scan ^= 1UL << (lfsr % 19);
+        scans[i] = scan;
+    }
+
+    uint32_t counts[INPUT_MAX_KEYS] = {0};
+    run.begin();
+    for (unsigned long i = 0; i < BENCH_SCANS; i++) {
+        uint32_t pressed = keys.update(scans[i]);
+        while (pressed) counts[KeyDecoder::nextKey(pressed)]++;
+    }
+    run.end(BENCH_SCANS);
+    run.add(counts, sizeof(counts));
+}
+
+// Simulated switch contacts for the scanner: each press and release is a
+// true edge followed by a burst of bounces that settles within 3 ms
+struct BenchKeyTrace {
+    uint32_t edges[BENCH_SCAN_EDGES];                           // Press first
+    uint32_t toggles[BENCH_SCAN_EDGES * BENCH_SCAN_BOUNCES];    // Every contact change
+    uint32_t edgeCount;
+    uint32_t toggleCount;
+    uint32_t cursor;                                            // Toggles up to now
+};
+
+static void buildKeyTrace(BenchKeyTrace& trace, uint32_t seed) {
+    const uint32_t endUs = (BENCH_SCAN_SECONDS - 1) * 1000000UL;
+    uint32_t t = benchRandom(seed, 10000, 500000);
+
+    trace.edgeCount = 0;
+    trace.toggleCount = 0;
+    trace.cursor = 0;
+    while (t < endUs && trace.edgeCount + 2 <= BENCH_SCAN_EDGES) {
+        for (int edge = 0; edge < 2; edge++) {
+            trace.edges[trace.edgeCount++] = t;
+            trace.toggles[trace.toggleCount++] = t;
+            uint32_t bounce = t;
+            for (uint32_t b = benchRandom(seed, 0, BENCH_SCAN_BOUNCES / 2 + 1); b > 0; b--) {
+                bounce += benchRandom(seed, 50, 450);
+                trace.toggles[trace.toggleCount++] = bounce;
+                bounce += benchRandom(seed, 50, 450);
+                trace.toggles[trace.toggleCount++] = bounce;
+            }
+            t += edge ? benchRandom(seed, 30000, 500000) : benchRandom(seed, 20000, 300000);
+        }
+    }
+}
+
+// Plays the traces into the scanner's pins: rows 0-3 read, columns 4-7
+// driven, buttons 8-10
+class BenchScanner : public InputScanner {
+public:
+    BenchScanner(BenchKeyTrace* keyTraces) : nowUs(0), traces(keyTraces), column(0) {}
+
+    uint32_t nowUs;
+
+protected:
+    uint64_t readPins() override {
+        uint64_t pins = ~0ULL;
+        for (int row = 0; row < 4; row++) {
+            if (closed(row * 4 + column)) pins &= ~(1ULL << row);
+        }
+        for (int b = 0; b < 3; b++) {
+            if (closed(16 + b)) pins &= ~(1ULL << (8 + b));
+        }
+        return pins;
+    }
+
+    void driveLine(uint8_t line) override {
+        column = line;
+    }
+
+private:
+    BenchKeyTrace* traces;
+    uint8_t column;
+
+    bool closed(int key) {
+        BenchKeyTrace& trace = traces[key];
+        while (trace.cursor < trace.toggleCount && trace.toggles[trace.cursor] <= nowUs) trace.cursor++;
+        return trace.cursor & 1;
+    }
+};
+
+// A minute of bouncing keys scanned every INPUT_SCAN_PERIOD_US on the
+// simulated clock. Every true edge must come out once, as the right press
+// or release, stamped no later than one full scan after the contact
+// first reads as changed.
+static void benchScan(const BenchCase& bench, BenchRun& run) {
+    static const uint8_t rows[4] = { 0, 1, 2, 3 };
+    static const uint8_t cols[4] = { 4, 5, 6, 7 };
+    static const uint8_t buttons[3] = { 8, 9, 10 };
+    const uint32_t ticks = BENCH_SCAN_SECONDS * 1000000UL / INPUT_SCAN_PERIOD_US;
+    std::unique_ptr<BenchKeyTrace[]> traces(new BenchKeyTrace[BENCH_SCAN_KEYS]);
+    (void)bench;
+
+    uint32_t edges = 0;
+    for (int k = 0; k < BENCH_SCAN_KEYS; k++) {
+        buildKeyTrace(traces[k], 0x9E3779B9u * (k + 1));
+        edges += traces[k].edgeCount;
+    }
+
+    std::unique_ptr<BenchScanner> scanner(new BenchScanner(traces.get()));
+    scanner->setMatrix(rows, 4, cols, 4);
+    scanner->setButtons(buttons, 3);
+
+    uint32_t seen[BENCH_SCAN_KEYS] = {0};
+    uint32_t right = 0;
+    uint32_t worstUs = 0;
+    run.begin();
+    for (uint32_t i = 0; i < ticks; i++) {
+        scanner->nowUs = i * INPUT_SCAN_PERIOD_US;
+        scanner->tick(scanner->nowUs);
+
+        InputEvent event;
+        while (scanner->pop(event)) {
+            run.add(&event.us, sizeof(event.us));
+            run.add(&event.key, sizeof(event.key));
+            run.add(&event.down, sizeof(event.down));
+            if (event.key >= BENCH_SCAN_KEYS) continue;
+
+            uint32_t n = seen[event.key]++;
+            const BenchKeyTrace& trace = traces[event.key];
+            if (n >= trace.edgeCount || event.down != !(n & 1) || event.us < trace.edges[n]) continue;
+            uint32_t lateUs = event.us - trace.edges[n];
+            if (lateUs <= BENCH_SCAN_LATE_US) right++;
+            if (lateUs > worstUs) worstUs = lateUs;
+        }
+    }
+    run.end(ticks);
+    run.setNote("%lu/%lu edges, stamped +%lu us worst", (unsigned long)right, (unsigned long)edges,
+                (unsigned long)worstUs);
+}
+
+// Encoder pin edges: levels (clk << 1 | dt) from `us` on
+struct BenchEdge {
+    uint32_t us;
+    uint8_t levels;
+};
+
+// Turns `detents` (negative for anticlockwise) at one per detentUs. One
+// edge in four bounces: back to the old level and forward again.
+static void buildTurn(BenchEdge* edges, uint32_t& count, uint32_t& t, int32_t& position, int detents,
+                      uint32_t detentUs, uint32_t& seed) {
+    static const uint8_t clockwise[4] = { 0, 2, 3, 1 };
+    int8_t step = detents > 0 ? 1 : -1;
+
+    for (int q = 0; q < (detents > 0 ? detents : -detents) * ENCODER_STEPS_PER_DETENT; q++) {
+        uint8_t from = clockwise[position & 3];
+        position += step;
+        uint8_t to = clockwise[position & 3];
+        t += detentUs / ENCODER_STEPS_PER_DETENT;
+        edges[count++] = { t, to };
+        if (benchRandom(seed, 0, 4) == 0) {
+            uint32_t bounce = t + benchRandom(seed, 20, 120);
+            edges[count++] = { bounce, from };
+            edges[count++] = { bounce + benchRandom(seed, 20, 120), to };
+        }
+    }
+}
+
+// Scripted turns (slow, reversing, a 12 detent flick each way) through the
+// interrupt path: every edge raises an interrupt serviced 2-15 us later,
+// now and then 50-250 us later under load, which reads the pins as they
+// are by then. The UI reads the counts every 5 ms through EncoderAccel.
+static void benchEncoder(const BenchCase& bench, BenchRun& run) {
+    static const int32_t turns[][2] = {           // Detents, us per detent (a pause for 0)
+        { 5, 120000 }, { -3, 80000 }, { 12, 4000 }, { 0, 300000 }, { -12, 5000 },
+        { 0, 300000 }, { 20, 20000 }, { -20, 9000 }, { 1, 200000 }, { -1, 200000 },
+    };
+    std::unique_ptr<BenchEdge[]> edges(new BenchEdge[BENCH_ENCODER_EDGES]);
+    uint32_t seed = 0x2545F491u;
+    uint32_t count = 0;
+    uint32_t t = 1000;
+    int32_t position = 2;                         // Resting at 11
+    uint32_t flickUs = 0;                         // The first clockwise flick
+    (void)bench;
+
+    for (int g = 0; g < BENCH_ENCODER_TURNS; g++) {
+        for (size_t i = 0; i < sizeof(turns) / sizeof(turns[0]); i++) {
+            if (turns[i][0] == 0) {
+                t += turns[i][1];
+            } else {
+                if (!flickUs && turns[i][1] < ENCODER_FAST_US) flickUs = t;
+                buildTurn(edges.get(), count, t, position, turns[i][0], turns[i][1], seed);
+            }
+        }
+    }
+    const int32_t truth = position - 2;
+
+    QuadratureDecoder decoder;
+    EncoderAccel accel;
+    decoder.begin(3);
+    accel.begin(0, BENCH_ENCODER_RANGE);
+
+    uint32_t serviced = 0;                        // Edges the pins have reached
+    uint32_t freeUs = 0;                          // Interrupt busy until
+    uint32_t pollUs = 5000;
+    int32_t value = 0;
+    int32_t flick = 0;
+    run.begin();
+    for (uint32_t e = 0; e < count; e++) {
+        uint32_t latency = benchRandom(seed, 0, 100) == 0 ? benchRandom(seed, 50, 250) : benchRandom(seed, 2, 15);
+        uint32_t at = edges[e].us + latency;
+        if (at < freeUs) at = freeUs;
+        freeUs = at + 2;
+
+        while (pollUs <= at) {
+            int32_t change = accel.update(decoder.getCount(), pollUs);
+            value += change;
+            if (pollUs > flickUs && pollUs - flickUs < 200000) flick += change;
+            run.add(&change, sizeof(change));
+            pollUs += 5000;
+        }
+
+        while (serviced + 1 < count && edges[serviced + 1].us <= at) serviced++;
+        decoder.update(edges[serviced].levels);
+    }
+    run.end(count);
+
+    int32_t decoded = decoder.getCount();
+    run.add(&decoded, sizeof(decoded));
+    run.setNote("%ld steps lost, flick moves %ld", (long)(truth - decoded), (long)flick);
+}
+
+// Latency tuner decisions for a render load that steps between light
+// and heavy, with an underrun whenever a buffer overruns its lead
+static void benchLatency(const BenchCase& bench, BenchRun& run) {
+    static const uint32_t loads[] = { 100, 400, 900, 1500, 200, 2500 };
+    static uint32_t renderUs[BENCH_TUNER_BUFFERS];
+    const uint32_t periodUs = 64 * 1000000UL / SAMPLE_RATE;
+    LatencyTuner tuner;
+    uint32_t lfsr = 0xACE1u;
+    (void)bench;
+
+    for (unsigned long i = 0; i < BENCH_TUNER_BUFFERS; i++) {
+        lfsr = (lfsr >> 1) ^ (-(lfsr & 1u) & 0xB400u);
+        renderUs[i] = loads[(i / 20000) % 6] + (lfsr & 127);
+    }
+
+    uint32_t leadCounts[8] = {0};      // Buffers rendered at each lead
+    uint32_t changes = 0;
+    uint8_t lead = 7;
+    tuner.begin(7, periodUs, 250000UL / periodUs);
+    run.begin();
+    for (unsigned long i = 0; i < BENCH_TUNER_BUFFERS; i++) {
+        bool underrun = renderUs[i] + LATENCY_SLACK_US > (uint32_t)lead * periodUs;
+        uint8_t next = tuner.update(renderUs[i], underrun);
+        changes += (next != lead);
+        lead = next;
+        leadCounts[lead]++;
+    }
+    run.end(BENCH_TUNER_BUFFERS);
+    run.add(leadCounts, sizeof(leadCounts));
+    run.add(&changes, sizeof(changes));
+}
+
+// Key-to-DAC latencies into a LatencyHistogram: mostly 5-20 ms, one in
+// fifty up to 60 ms behind a slow UI frame. Its percentiles are checked
+// against the sorted samples.
+static void benchProbe(const BenchCase& bench, BenchRun& run) {
+    std::unique_ptr<uint32_t[]> samples(new uint32_t[BENCH_PROBE_SAMPLES]);
+    std::unique_ptr<LatencyHistogram> histogram(new LatencyHistogram());
+    uint32_t seed = 0x9E3779B9u;
+    (void)bench;
+
+    for (uint32_t i = 0; i < BENCH_PROBE_SAMPLES; i++) {
+        samples[i] = benchRandom(seed, 5000, 20000);
+        if (benchRandom(seed, 0, 50) == 0) samples[i] += benchRandom(seed, 0, 40000);
+    }
+
+    run.begin();
+    for (uint32_t i = 0; i < BENCH_PROBE_SAMPLES; i++) {
+        histogram->record(samples[i]);
+    }
+    run.end(BENCH_PROBE_SAMPLES);
+
+    LatencyStats stats;
+    histogram->getStats(stats);
+    run.add(&stats, sizeof(stats));
+
+    std::sort(samples.get(), samples.get() + BENCH_PROBE_SAMPLES);
+    uint32_t p50 = samples[BENCH_PROBE_SAMPLES / 2 - 1];
+    uint32_t p99 = samples[BENCH_PROBE_SAMPLES / 100 * 99 - 1];
+    run.setNote("p50 %lu us vs %lu, p99 %lu vs %lu", (unsigned long)stats.p50Us,
+                (unsigned long)p50, (unsigned long)stats.p99Us, (unsigned long)p99);
+}
+
+// The linear scan the sketches used before EventScheduler, as big as
+// the wheel: every pop and every look ahead walks all the slots. Ties go
+// to the event scheduled first, like the wheel.
+class BenchLinearScheduler {
+public:
+    BenchLinearScheduler() : sequence(0), count(0), peak(0), dropped(0) {
+        for (int i = 0; i < SCHED_CAPACITY; i++) used[i] = false;
+    }
+
+    bool schedule(const SynthEvent& event) {
+        for (int i = 0; i < SCHED_CAPACITY; i++) {
+            if (used[i]) continue;
+            used[i] = true;
+            events[i] = event;
+            order[i] = sequence++;
+            if (++count > peak) peak = count;
+            return true;
+        }
+        dropped++;
+        return false;
+    }
+
+    bool pop(uint64_t frame, SynthEvent& event) {
+        int best = -1;
+        for (int i = 0; i < SCHED_CAPACITY; i++) {
+            if (!used[i] || events[i].frame > frame) continue;
+            if (best < 0 || events[i].frame < events[best].frame ||
+                (events[i].frame == events[best].frame && order[i] < order[best])) {
+                best = i;
+            }
+        }
+        if (best < 0) return false;
+        event = events[best];
+        used[best] = false;
+        count--;
+        return true;
+    }
+
+    uint32_t framesUntilNext(uint64_t frame, uint32_t limit) const {
+        uint64_t next = frame + limit;
+        for (int i = 0; i < SCHED_CAPACITY; i++) {
+            if (used[i] && events[i].frame < next) next = events[i].frame;
+        }
+        return next > frame ? (uint32_t)(next - frame) : 0;
+    }
+
+    uint16_t getPeak() const { return peak; }
+    uint32_t getDropped() const { return dropped; }
+
+private:
+    SynthEvent events[SCHED_CAPACITY];
+    uint32_t order[SCHED_CAPACITY];
+    bool used[SCHED_CAPACITY];
+    uint32_t sequence;
+    uint16_t count;
+    uint16_t peak;
+    uint32_t dropped;
+};
+
+// One step of a dense pattern: every lane ratchets 1-4 times, swung on
+// the odd steps by its own amount, each hit a note-on, a parameter
+// change and a note-off. One note in eight rings for up to two seconds,
+// past the wheel's reach.
+template <class Scheduler>
+static uint32_t scheduleBenchStep(Scheduler& scheduler, uint64_t frame, uint8_t step,
+                                  uint32_t stepFrames, uint32_t& seed) {
+    uint32_t events = 0;
+    for (uint8_t lane = 0; lane < BENCH_SCHED_LANES; lane++) {
+        uint32_t ratchets = benchRandom(seed, 1, 5);
+        uint32_t swing = (step & 1) ? stepFrames * (lane % 4) / 8 : 0;
+        uint32_t spacing = (stepFrames - swing) / ratchets;
+        for (uint32_t r = 0; r < ratchets; r++) {
+            SynthEvent event;
+            event.frame = frame + swing + r * spacing;
+            event.voice = lane;
+            event.data = (uint8_t)(36 + (step * 7 + lane * 5 + r) % 48);
+            event.velocity = (uint8_t)(127 - r * 20);
+            event.value = 0;
+
+            event.type = EVENT_NOTE_ON;
+            events += scheduler.schedule(event);
+            event.type = EVENT_PARAM;
+            event.value = (uint16_t)benchRandom(seed, 0, 128);
+            events += scheduler.schedule(event);
+
+            uint32_t gate = spacing / 2 + 1;
+            if (benchRandom(seed, 0, 8) == 0) gate = benchRandom(seed, spacing, SAMPLE_RATE * 2);
+            event.type = EVENT_NOTE_OFF;
+            event.frame += gate;
+            event.value = event.data;
+            events += scheduler.schedule(event);
+        }
+    }
+    return events;
+}
+
+// A 160 BPM pattern scheduled a step at a time and played the way a
+// render loop does: everything due at the frame, then on to the next
+// event or step. Every event is checked against the frame it asked for.
+template <class Scheduler>
+static void benchScheduler(BenchRun& run, Scheduler& scheduler) {
+    const uint64_t endFrame = (uint64_t)SAMPLE_RATE * BENCH_SCHED_SECONDS;
+    SequencerClock clock;
+    uint32_t seed = 0x2545F491u;
+    uint32_t scheduled = 0;
+    uint32_t played = 0;
+    uint32_t late = 0;
+    uint64_t frame = 0;
+    uint64_t last = 0;
+
+    clock.begin(SAMPLE_RATE, NUM_STEPS);
+    clock.setTempo(BENCH_SCHED_BPM);
+    clock.start(0);
+    run.begin();
+    while (frame < endFrame) {
+        if (clock.framesUntilStep(frame, 1) == 0) {
+            uint8_t step = clock.advance();
+            uint32_t stepFrames = (uint32_t)(clock.getStepLength() >> SEQ_FRACTION_BITS);
+            scheduled += scheduleBenchStep(scheduler, frame, step, stepFrames, seed);
+        }
+
+        SynthEvent event;
+        while (scheduler.pop(frame, event)) {
+            late += (event.frame != frame || event.frame < last);
+            last = event.frame;
+            uint8_t fields[4] = { event.type, event.voice, event.data, (uint8_t)event.value };
+            run.add(&event.frame, sizeof(event.frame));
+            run.add(fields, sizeof(fields));
+            played++;
+        }
+
+        uint32_t frames = clock.framesUntilStep(frame, BENCH_BLOCK_FRAMES);
+        frame += scheduler.framesUntilNext(frame, frames);
+    }
+    run.end(played);
+    run.add(&scheduled, sizeof(scheduled));
+    run.setNote("%lu events, peak %u, %lu late, %lu dropped", (unsigned long)played,
+                (unsigned)scheduler.getPeak(), (unsigned long)late, (unsigned long)scheduler.getDropped());
+}
+
+static void benchWheel(const BenchCase& bench, BenchRun& run) {
+    std::unique_ptr<EventScheduler> scheduler(new EventScheduler());
+    (void)bench;
+    benchScheduler(run, *scheduler);
+}
+
+static void benchLinear(const BenchCase& bench, BenchRun& run) {
+    std::unique_ptr<BenchLinearScheduler> scheduler(new BenchLinearScheduler());
+    (void)bench;
+    benchScheduler(run, *scheduler);
+}
+
+// Random pattern of random length, a third of the steps on
+static void buildBenchPattern(StepPattern& pattern, uint32_t& seed) {
+    pattern.clear((uint8_t)benchRandom(seed, 1, PATTERN_MAX_STEPS + 1), 60);
+    for (uint8_t lane = 0; lane < PATTERN_LANES; lane++) {
+        for (uint8_t step = 0; step < pattern.length; step++) {
+            pattern.setStep(lane, step, (uint8_t)benchRandom(seed, 24, 97), (uint8_t)benchRandom(seed, 1, 128),
+                            benchRandom(seed, 0, 3) == 0);
+        }
+    }
+}
+
+// PatternStore churn: patterns of every length saved over each other,
+// slots erased when the pool is full, and every save followed by loading
+// some slot and scanning it a bit at a time. Loads are checked against a
+// full-size copy of each slot.
+static void benchStore(const BenchCase& bench, BenchRun& run) {
+    std::unique_ptr<PatternStore> store(new PatternStore());
+    std::unique_ptr<StepPattern[]> copies(new StepPattern[PATTERN_SLOTS]);
+    StepPattern pattern;
+    uint32_t seed = 0x6C8E9CF5u;
+    uint32_t bad = 0;
+    uint32_t active = 0;
+    (void)bench;
+
+    for (uint32_t op = 0; op < BENCH_STORE_OPS; op++) {
+        buildBenchPattern(pattern, seed);
+        uint8_t slot = (uint8_t)benchRandom(seed, 0, PATTERN_SLOTS);
+        run.begin();
+        while (!store->save(slot, pattern)) {
+            store->erase((uint8_t)benchRandom(seed, 0, PATTERN_SLOTS));
+        }
+        run.end(0);
+        copies[slot] = pattern;
+
+        uint8_t check = (uint8_t)benchRandom(seed, 0, PATTERN_SLOTS);
+        run.begin();
+        bool used = store->load(check, pattern);
+        if (used) {
+            for (uint8_t step = 0; step < pattern.length; step++) {
+                for (uint8_t lane = 0; lane < PATTERN_LANES; lane++) {
+                    active += pattern.isActive(lane, step);
+                }
+            }
+        }
+        run.end(1);
+        if (!used) continue;
+
+        const StepPattern& copy = copies[check];
+        bool same = pattern.length == copy.length;
+        for (uint8_t lane = 0; same && lane < PATTERN_LANES; lane++) {
+            same = pattern.gates[lane] == copy.gates[lane] &&
+                   !memcmp(pattern.notes[lane], copy.notes[lane], pattern.length) &&
+                   !memcmp(pattern.velocities[lane], copy.velocities[lane], pattern.length);
+        }
+        bad += !same;
+        run.add(pattern.gates, sizeof(pattern.gates));
+        run.add(&pattern.length, sizeof(pattern.length));
+    }
+    run.add(&active, sizeof(active));
+    run.setNote("%u of %u steps used, %lu bad", (unsigned)(PATTERN_POOL_STEPS - store->getFreeSteps()),
+                (unsigned)PATTERN_POOL_STEPS, (unsigned long)bad);
+}
+
+// A song of patterns from 3 to 64 steps, swung, played by the sequencer
+// with the UI side following it after every block. The patterns started
+// are checked against a SequencerClock stepping through the same lengths.
+static void benchSong(const BenchCase& bench, BenchRun& run) {
+    static const uint8_t lengths[] = { 16, 12, 7, 32, 64, 5, 48, 3 };
+    static int16_t buffer[BENCH_BLOCK_FRAMES * 2];
+    const uint32_t blocks = SAMPLE_RATE * BENCH_SONG_SECONDS / BENCH_BLOCK_FRAMES;
+    std::unique_ptr<MintySynth> synth = newSynth();
+    SongChain song;
+    StepPattern pattern;
+    uint32_t seed = 0x1F123BB5u;
+    (void)bench;
+
+    for (int lane = 0; lane < NUM_VOICES; lane++) {
+        synth->setVoiceParam(lane, PARAM_WAVEFORM, WAVE_B + lane);
+        synth->setVoiceParam(lane, PARAM_ENVELOPE, ENV_PLUCK);
+    }
+    for (uint8_t slot = 0; slot < sizeof(lengths); slot++) {
+        buildBenchPattern(pattern, seed);
+        pattern.setLength(lengths[slot]);
+        synth->getPatternStore().save(slot, pattern);
+        song.append(slot, 1 + slot % 3);
+    }
+    synth->setSong(song);
+    synth->setTempo(180);
+    synth->setGlobalParam(GLOBAL_SWING, 64);
+
+    synth->start();
+    for (uint32_t b = 0; b < blocks; b++) {
+        run.begin();
+        synth->processAudio(buffer, BENCH_BLOCK_FRAMES * 2);
+        synth->updatePatterns();
+        run.end(BENCH_BLOCK_FRAMES);
+        run.add(buffer, sizeof(buffer));
+    }
+    synth->stop();
+
+    // The same song on a bare clock: patterns started within the frames rendered
+    SequencerClock clock;
+    uint64_t frame = 0;
+    uint32_t expected = 0;
+    clock.begin(SAMPLE_RATE, NUM_STEPS);
+    clock.setTempo(180);
+    clock.setSwing(64, 127);
+    clock.start(0);
+    for (;;) {
+        uint32_t frames = clock.framesUntilStep(frame, UINT32_MAX);
+        frame += frames;
+        if (frame >= (uint64_t)blocks * BENCH_BLOCK_FRAMES) break;
+        if (frames == 0) {
+            if (clock.advance() == 0) expected++;
+            clock.setLength(lengths[song.slotAt(expected - 1)]);
+        }
+    }
+    uint32_t started = synth->getPatternPosition();
+    run.add(&started, sizeof(started));
+    run.setNote("%lu patterns, %lu expected", (unsigned long)started, (unsigned long)expected);
+}
+
+// What a preset load must bring back, read through the synth's getters
+struct BenchPreset {
+    uint8_t voices[NUM_VOICES][PARAM_LFO_SHAPE + 1];
+    uint16_t globals[GLOBAL_TUNING + 1];
+    ModRoute routes[NUM_VOICES][MOD_ROUTES];
+    uint8_t length;
+    uint64_t gates[NUM_VOICES];
+
+    void capture(MintySynth& synth) {
+        memset(this, 0, sizeof(*this));
+        for (uint8_t v = 0; v < NUM_VOICES; v++) {
+            for (uint8_t p = 0; p <= PARAM_LFO_SHAPE; p++) voices[v][p] = synth.getVoiceParam(v, p);
+            for (uint8_t r = 0; r < MOD_ROUTES; r++) routes[v][r] = synth.getModRoute(v, r);
+        }
+        for (uint8_t g = 0; g <= GLOBAL_TUNING; g++) globals[g] = synth.getGlobalParam(g);
+        length = synth.getPatternLength();
+        for (uint8_t v = 0; v < NUM_VOICES; v++) {
+            for (uint8_t step = 0; step < length; step++) {
+                if (synth.isStepActive(v, step)) gates[v] |= 1ULL << step;
+            }
+        }
+    }
+};
+
+// PresetLog on a host file: the synth is tweaked a little (one knob, a
+// step, the modulation, or nothing) and saved to a random slot, then a
+// random slot is loaded and checked against what was saved. At the end
+// a torn record is left at the tail of the log, which is opened again
+// and every slot checked once more.
+static void benchPresetLog(const BenchCase& bench, BenchRun& run) {
+    std::unique_ptr<MintySynth> synth = newSynth();
+    std::unique_ptr<PresetLog> log(new PresetLog());
+    std::unique_ptr<BenchPreset[]> saved(new BenchPreset[PRESET_SLOTS]);
+    bool used[PRESET_SLOTS] = { false };
+    BenchPreset loaded;
+    uint32_t seed = 0x2B7E1516u;
+    uint32_t bad = 0;
+    (void)bench;
+
+    remove(BENCH_PRESET_PATH);
+    if (!log->begin(BENCH_PRESET_PATH)) {
+        run.setNote("cannot open %s", BENCH_PRESET_PATH);
+        return;
+    }
+    synth->setPresetLog(log.get());
+
+    for (uint32_t op = 0; op < BENCH_PRESET_OPS; op++) {
+        uint32_t tweak = benchRandom(seed, 0, 8);
+        uint8_t lane = (uint8_t)benchRandom(seed, 0, NUM_VOICES);
+        if (tweak < 3) {
+            synth->setVoiceParam(lane, (uint8_t)benchRandom(seed, 0, PARAM_LFO_SHAPE + 1),
+                                 (uint8_t)benchRandom(seed, 0, 128));
+        } else if (tweak < 5) {
+            uint8_t step = (uint8_t)benchRandom(seed, 0, synth->getPatternLength());
+            synth->setStep(lane, step, (uint8_t)benchRandom(seed, 24, 97), benchRandom(seed, 0, 2));
+        } else if (tweak == 5) {
+            synth->setModRoute(lane, (uint8_t)benchRandom(seed, 0, MOD_ROUTES),
+                               (uint8_t)benchRandom(seed, 0, NUM_MOD_SOURCES),
+                               (uint8_t)benchRandom(seed, 0, NUM_MOD_DESTINATIONS),
+                               (int8_t)(benchRandom(seed, 0, 255) - 127));
+        } else if (tweak == 6) {
+            synth->setGlobalParam((uint8_t)benchRandom(seed, 0, GLOBAL_TUNING + 1),
+                                  (uint16_t)benchRandom(seed, 0, 201));
+        }
+
+        uint8_t slot = (uint8_t)benchRandom(seed, 0, PRESET_SLOTS);
+        run.begin();
+        bool ok = synth->savePreset(slot);
+        run.end(0);
+        bad += !ok;
+        saved[slot].capture(*synth);
+        used[slot] = true;
+
+        uint8_t check = (uint8_t)benchRandom(seed, 0, PRESET_SLOTS);
+        run.begin();
+        ok = synth->loadPreset(check);
+        run.end(1);
+        if (ok != used[check]) bad++;
+        if (!ok) continue;
+        loaded.capture(*synth);
+        bad += memcmp(&loaded, &saved[check], sizeof(loaded)) != 0;
+        run.add(&loaded, sizeof(loaded));
+    }
+
+    // Power lost halfway through a record: the header and a few bytes
+    uint32_t records = log->getRecordsWritten();
+    uint32_t skipped = log->getWritesSkipped();
+    uint32_t compactions = log->getCompactions();
+    log->end();
+    FILE* torn = fopen(BENCH_PRESET_PATH, "ab");
+    if (torn) {
+        static const uint8_t partial[] = { 'M', 'P', PRESET_FORMAT_VERSION, 0, PRESET_VOICES, 0, 32, 0, 1, 2, 3 };
+        fwrite(partial, 1, sizeof(partial), torn);
+        fclose(torn);
+    }
+    bad += !log->begin(BENCH_PRESET_PATH) || !log->isRecovered();
+    for (uint8_t slot = 0; slot < PRESET_SLOTS; slot++) {
+        if (!used[slot]) continue;
+        if (!synth->loadPreset(slot)) {
+            bad++;
+            continue;
+        }
+        loaded.capture(*synth);
+        bad += memcmp(&loaded, &saved[slot], sizeof(loaded)) != 0;
+        run.add(&loaded, sizeof(loaded));
+    }
+    uint32_t size = log->getSize();
+    log->end();
+    remove(BENCH_PRESET_PATH);
+
+    run.add(&records, sizeof(records));
+    run.add(&skipped, sizeof(skipped));
+    run.add(&size, sizeof(size));
+    run.setNote("%lu written, %lu same, %lu compacts, %lu bad", (unsigned long)records, (unsigned long)skipped,
+                (unsigned long)compactions, (unsigned long)bad);
+}
+
+// A recorded DIN cable: each byte and when it finished arriving, and the
+// note-ons the synth must play, stamped with their last byte
+struct BenchMidiTrace {
+    uint32_t us[BENCH_MIDI_BYTES];
+    uint8_t bytes[BENCH_MIDI_BYTES];
+    uint32_t byteCount;
+    uint32_t cursor;                    // Bytes read so far
+    uint32_t noteUs[BENCH_MIDI_BYTES / 2];
+    uint16_t notes[BENCH_MIDI_BYTES / 2];   // Lane << 7 | note
+    uint32_t noteCount;
+    uint32_t lineUs;                    // Cable free from here
+    uint32_t clockUs;                   // Next clock byte
+};
+
+// One byte on the cable from `us`, in when its ten bits are
+static void putMidiRaw(BenchMidiTrace& trace, uint32_t us, uint8_t byte) {
+    trace.lineUs = us + BENCH_MIDI_BYTE_US;
+    if (trace.byteCount >= BENCH_MIDI_BYTES) return;
+    trace.us[trace.byteCount] = trace.lineUs;
+    trace.bytes[trace.byteCount++] = byte;
+}
+
+// Sends a byte as soon as the cable is free, a clock byte first if one is
+// due, even in the middle of a message. Returns when the byte is in.
+static uint32_t putMidiByte(BenchMidiTrace& trace, uint32_t us, uint8_t byte) {
+    while (trace.clockUs <= std::max(us, trace.lineUs)) {
+        putMidiRaw(trace, std::max(trace.clockUs, trace.lineUs), MIDI_CLOCK);
+        trace.clockUs += BENCH_MIDI_CLOCK_US;
+    }
+    putMidiRaw(trace, std::max(us, trace.lineUs), byte);
+    return trace.lineUs;
+}
+
+// A minute of playing on channels 1-6 (5 and 6 have no lane) with
+// chords, running status, both kinds of note-off, pitch bend, program
+// and controller changes, sysex and song position in between, under a
+// steady MIDI clock with a start, a stop and a continue.
+static void buildMidiTrace(BenchMidiTrace& trace, uint32_t seed) {
+    const uint32_t endUs = (BENCH_MIDI_SECONDS - 1) * 1000000UL;
+    uint8_t held[6][8];
+    uint8_t heldCount[6] = { 0 };
+    uint8_t running = 0;
+    uint32_t us = 1000;
+
+    trace.byteCount = 0;
+    trace.cursor = 0;
+    trace.noteCount = 0;
+    trace.lineUs = 0;
+    trace.clockUs = BENCH_MIDI_CLOCK_US;
+    putMidiByte(trace, us, MIDI_START);
+
+    while (us < endUs) {
+        us += benchRandom(seed, 0, 4) ? benchRandom(seed, 500, 12000) : 0;
+        if (us > endUs / 2 && trace.clockUs < endUs / 2 + 2 * BENCH_MIDI_CLOCK_US) {
+            putMidiByte(trace, us, MIDI_STOP);
+            us += 500000;
+            putMidiByte(trace, us, MIDI_CONTINUE);
+        }
+
+        uint8_t channel = (uint8_t)benchRandom(seed, 0, 6);
+        uint32_t kind = benchRandom(seed, 0, 32);
+        uint8_t status;
+        uint8_t data[2];
+        uint8_t length = 2;
+        bool noteOn = false;
+
+        if (kind < 20) {
+            if (heldCount[channel] && (heldCount[channel] == 8 || benchRandom(seed, 0, 2))) {
+                data[0] = held[channel][0];
+                heldCount[channel]--;
+                memmove(held[channel], held[channel] + 1, heldCount[channel]);
+                bool zero = benchRandom(seed, 0, 2);
+                status = (zero ? MIDI_NOTE_ON : MIDI_NOTE_OFF) | channel;
+                data[1] = zero ? 0 : 64;
+            } else {
+                data[0] = (uint8_t)benchRandom(seed, 36, 97);
+                data[1] = (uint8_t)benchRandom(seed, 1, 128);
+                held[channel][heldCount[channel]++] = data[0];
+                status = MIDI_NOTE_ON | channel;
+                noteOn = channel < NUM_VOICES;
+            }
+        } else if (kind < 24) {
+            status = MIDI_PITCH_BEND | channel;
+            data[0] = (uint8_t)benchRandom(seed, 0, 128);
+            data[1] = (uint8_t)benchRandom(seed, 0, 128);
+        } else if (kind < 26) {
+            status = MIDI_PROGRAM_CHANGE | channel;
+            data[0] = (uint8_t)benchRandom(seed, 0, 128);
+            length = 1;
+        } else if (kind == 26) {
+            status = MIDI_CONTROL_CHANGE | channel;
+            data[0] = MIDI_CC_ALL_NOTES_OFF;
+            data[1] = 0;
+            heldCount[channel] = 0;
+        } else if (kind == 27) {
+            status = MIDI_CONTROL_CHANGE | channel;
+            data[0] = 7;
+            data[1] = (uint8_t)benchRandom(seed, 0, 128);
+        } else if (kind == 28) {
+            status = MIDI_CHANNEL_PRESSURE | channel;
+            data[0] = (uint8_t)benchRandom(seed, 0, 128);
+            length = 1;
+        } else if (kind < 31) {
+            uint32_t sysexBytes = benchRandom(seed, 4, 25);
+            putMidiByte(trace, us, MIDI_SYSEX);
+            for (uint32_t i = 0; i < sysexBytes; i++) putMidiByte(trace, us, (uint8_t)benchRandom(seed, 0, 128));
+            putMidiByte(trace, us, MIDI_SYSEX_END);
+            running = 0;
+            continue;
+        } else {
+            status = 0xF2;      // Song position: system common, ends running status
+            data[0] = (uint8_t)benchRandom(seed, 0, 128);
+            data[1] = (uint8_t)benchRandom(seed, 0, 128);
+        }
+
+        if (status != running) putMidiByte(trace, us, status);
+        running = (status < 0xF0) ? status : 0;
+        uint32_t inUs = 0;
+        for (uint8_t i = 0; i < length; i++) inUs = putMidiByte(trace, us, data[i]);
+        if (noteOn && trace.noteCount < BENCH_MIDI_BYTES / 2) {
+            trace.noteUs[trace.noteCount] = inUs;
+            trace.notes[trace.noteCount++] = (uint16_t)(channel << 7 | data[0]);
+        }
+    }
+    putMidiByte(trace, us, MIDI_STOP);
+}
+
+// Plays the recording into port 0
+class BenchMidiInput : public MidiInput {
+public:
+    BenchMidiInput(BenchMidiTrace* midiTrace) : nowUs(0), trace(midiTrace) {
+        portCount.store(1);
+    }
+
+    uint32_t nowUs;
+
+protected:
+    int readPort(uint8_t port) override {
+        if (port || trace->cursor >= trace->byteCount || trace->us[trace->cursor] > nowUs) return -1;
+        return trace->bytes[trace->cursor++];
+    }
+
+private:
+    BenchMidiTrace* trace;
+};
+
+// The recording read by MidiInput every MIDI_POLL_PERIOD_US and played
+// the way AudioPipeline does: before each DMA buffer (whose task wakes
+// up to BENCH_MIDI_JITTER_US late) the messages go onto their frames
+// through a MidiTimeline and an EventScheduler, and the buffer is
+// rendered in pieces between them. Every note-on must come out once, in
+// order, with nothing late; how far it moves against its arrival is
+// compared with playing it at the start of the buffer.
+static void benchMidi(const BenchCase& bench, BenchRun& run) {
+    const uint32_t buffers = (uint32_t)((uint64_t)BENCH_MIDI_SECONDS * SAMPLE_RATE / AUDIO_OUTPUT_FRAMES);
+    std::unique_ptr<BenchMidiTrace> trace(new BenchMidiTrace());
+    std::unique_ptr<MintySynth> synth = newSynth();
+    std::unique_ptr<EventScheduler> events(new EventScheduler());
+    MidiTimeline timeline;
+    int16_t out[AUDIO_OUTPUT_FRAMES * 2];
+    uint32_t seed = 0x6A09E667u;
+    (void)bench;
+
+    buildMidiTrace(*trace, 0xBB67AE85u);
+    std::unique_ptr<BenchMidiInput> input(new BenchMidiInput(trace.get()));
+    timeline.begin(SAMPLE_RATE, 0);
+    events->clear(synth->getSampleClock());
+
+    uint32_t tickUs = 0;
+    uint32_t scheduled = 0;
+    uint32_t played = 0;
+    uint32_t bad = 0;
+    int64_t minTimed = INT64_MAX, maxTimed = INT64_MIN;
+    int64_t minBlock = INT64_MAX, maxBlock = INT64_MIN;
+    for (uint32_t k = 0; k < buffers; k++) {
+        uint32_t startUs = (uint32_t)((uint64_t)k * AUDIO_OUTPUT_FRAMES * 1000000ULL / SAMPLE_RATE) +
+                           benchRandom(seed, 0, BENCH_MIDI_JITTER_US);
+        uint64_t frame = synth->getSampleClock();
+        uint32_t messages = 0;
+
+        run.begin();
+        for (; (int32_t)(startUs - tickUs) >= 0; tickUs += MIDI_POLL_PERIOD_US) {
+            input->nowUs = tickUs;
+            input->tick(tickUs);
+        }
+        timeline.startBuffer(frame, startUs);
+        MidiMessage message;
+        SynthEvent event;
+        while (input->pop(message)) {
+            messages++;
+            if (!midiToEvent(message, timeline.frameOf(message.us), NUM_VOICES, event)) continue;
+            bad += timeline.isLate(message.us);
+            bad += !events->schedule(event);
+            if (event.type != EVENT_NOTE_ON) continue;
+
+            // Against the arrival, so only the movement counts
+            uint32_t n = scheduled++;
+            if (n >= trace->noteCount || trace->notes[n] != (uint16_t)(event.voice << 7 | event.data)) {
+                bad++;
+                continue;
+            }
+            int64_t arrival = (int64_t)trace->noteUs[n] * SAMPLE_RATE / 1000000;
+            int64_t timed = (int64_t)event.frame - arrival;
+            int64_t block = (int64_t)frame - arrival;
+            minTimed = std::min(minTimed, timed);
+            maxTimed = std::max(maxTimed, timed);
+            minBlock = std::min(minBlock, block);
+            maxBlock = std::max(maxBlock, block);
+        }
+        run.end(messages);
+
+        for (uint32_t done = 0; done < AUDIO_OUTPUT_FRAMES;) {
+            uint64_t now = synth->getSampleClock();
+            while (events->pop(now, event)) {
+                bad += event.frame != now;
+                uint8_t fields[4] = { event.type, event.voice, event.data, event.velocity };
+                run.add(&event.frame, sizeof(event.frame));
+                run.add(fields, sizeof(fields));
+                if (event.type == EVENT_NOTE_ON) {
+                    synth->triggerVoice(event.voice, event.data, event.velocity);
+                    played++;
+                } else if (event.type == EVENT_NOTE_OFF) {
+                    synth->releaseNote(event.voice, event.data);
+                } else if (event.data == MIDI_START || event.data == MIDI_CONTINUE) {
+                    synth->start();
+                } else if (event.data == MIDI_STOP) {
+                    synth->stop();
+                } else {
+                    synth->releaseVoice(event.voice);
+                }
+            }
+            uint32_t count = events->framesUntilNext(now, AUDIO_OUTPUT_FRAMES - done);
+            synth->processAudio(out + done * 2, count * 2);
+            done += count;
+        }
+        run.add(out, sizeof(out));
+    }
+    bad += played != trace->noteCount || input->getErrors() || input->getDropped();
+
+    run.add(&played, sizeof(played));
+    run.setNote("%lu notes, jitter %lu frames (%lu), %lu bad", (unsigned long)played,
+                (unsigned long)(maxTimed - minTimed), (unsigned long)(maxBlock - minBlock), (unsigned long)bad);
+}
+
+// Fake ILI9341: draws nothing, UiCanvas counts what would go over SPI
+class BenchCanvas : public UiCanvas {
+protected:
+    void drawFill(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override {
+        (void)x; (void)y; (void)w; (void)h; (void)color;
+    }
+    void drawChars(int16_t x, int16_t y, const char* text, uint8_t length, uint8_t size,
+                   uint16_t color, uint16_t background) override {
+        (void)x; (void)y; (void)text; (void)length; (void)size; (void)color; (void)background;
+    }
+};
+
+static const char* const uiParamNames[5] = { "TEMPO", "PITCH", "LENGTH", "ENVELOPE", "SWING" };
+static const int16_t uiParamRanges[5][2] = { {60, 200}, {24, 96}, {10, 100}, {0, 4}, {0, 50} };
+
+// What the firmware's screen shows, stepped one 50 ms UI frame at a time:
+// the sequencer at 120 BPM, now and then an encoder turn or a step toggle
+struct BenchUiState {
+    uint16_t values[5];
+    bool steps[16];
+    uint8_t step;
+    uint8_t voice;
+    bool playing;
+    uint32_t latencyUs;
+    uint32_t lfsr;
+    uint32_t frame;
+
+    BenchUiState() : step(0), voice(0), playing(true), latencyUs(2902), lfsr(0xACE1u), frame(0) {
+        static const uint16_t initial[5] = { 120, 60, 50, 2, 0 };
+        memcpy(values, initial, sizeof(values));
+        for (int i = 0; i < 16; i++) steps[i] = (i % 4 == 0);
+    }
+
+    void advance() {
+        frame++;
+        step = (frame * 50 / 125) % 16;
+        lfsr = (lfsr >> 1) ^ (-(lfsr & 1u) & 0xB400u);
+        if ((lfsr & 15) == 0) {
+            int i = (lfsr >> 4) % 5;
+            int delta = (lfsr & 0x100) ? 1 : -1;
+            values[i] = constrain(values[i] + delta, uiParamRanges[i][0], uiParamRanges[i][1]);
+        }
+        if ((lfsr & 63) == 1) steps[(lfsr >> 6) % 16] ^= true;
+        if ((lfsr & 255) == 2) voice = (voice + 1) % 4;
+        if ((lfsr & 511) == 3) latencyUs = 1451 * (1 + (lfsr >> 9) % 7);
+    }
+};
+
+typedef void (*BenchUiDraw)(UiCanvas& canvas, const BenchUiState& state);
+
+// Times each frame's draw calls and hashes what they would have sent
+static void benchUiFrames(BenchRun& run, BenchUiDraw draw) {
+    BenchCanvas canvas;
+    BenchUiState state;
+    uint64_t pixels = 0;
+    uint64_t bytes = 0;
+
+    for (unsigned long f = 0; f < BENCH_UI_FRAMES; f++) {
+        state.advance();
+        canvas.resetStats();
+        run.begin();
+        draw(canvas, state);
+        run.end(1);
+
+        const UiDrawStats& stats = canvas.getStats();
+        run.add(&stats, sizeof(stats));
+        pixels += stats.pixels;
+        bytes += stats.bytes;
+    }
+    run.setNote("%llu px %llu B/frame", (unsigned long long)(pixels / BENCH_UI_FRAMES),
+                (unsigned long long)(bytes / BENCH_UI_FRAMES));
+}
+
+// The clear-and-redraw display update the firmware had before the widgets
+static void drawUiRedraw(UiCanvas& canvas, const BenchUiState& state) {
+    char line[32];
+    int length;
+
+    canvas.fillRect(0, 50, 320, 190, 0x0000);
+    for (int i = 0; i < 5; i++) {
+        length = snprintf(line, sizeof(line), "%s: %u", uiParamNames[i], state.values[i]);
+        canvas.drawText(10, 60 + i * 20, line, length, 1, 0xFFFF, 0x0000);
+    }
+    canvas.drawText(10, 170, "STEPS:", 6, 1, 0xFFFF, 0x0000);
+    for (int i = 0; i < 16; i++) {
+        int x = 60 + i * 15;
+        if (state.steps[i]) {
+            canvas.fillRect(x, 170, 12, 12, 0x07E0);
+        } else {
+            canvas.drawRect(x, 170, 12, 12, 0xFFFF);
+        }
+        if (i == state.step) canvas.drawRect(x - 1, 169, 14, 14, 0xF800);
+    }
+    length = snprintf(line, sizeof(line), "Voice: %u", state.voice + 1);
+    canvas.drawText(10, 200, line, length, 1, 0xFFFF, 0x0000);
+    length = snprintf(line, sizeof(line), "Step: %u", state.step + 1);
+    canvas.drawText(100, 200, line, length, 1, 0xFFFF, 0x0000);
+    length = snprintf(line, sizeof(line), "Latency: %.1f ms", state.latencyUs / 1000.0f);
+    canvas.drawText(10, 220, line, length, 1, 0xFFFF, 0x0000);
+}
+
+static void benchUiRedraw(const BenchCase& bench, BenchRun& run) {
+    (void)bench;
+    benchUiFrames(run, drawUiRedraw);
+}
+
+// The same screen as retained widgets, laid out like main.cpp's
+struct BenchUi {
+    UiScreen screen;
+    UiTextField fields[5];
+    UiGauge gauges[5];
+    UiTextField stepsLabel;
+    UiStepGrid grid;
+    UiVoiceStrip voices;
+    UiTextField stepField;
+    UiTextField status;
+
+    BenchUi() {
+        static const char* const labels[4] = { "1", "2", "3", "4" };
+        for (int i = 0; i < 5; i++) {
+            fields[i].begin(10, 60 + i * 20, 13, 1, 0xFFFF, 0x0000);
+            gauges[i].begin(100, 60 + i * 20, 120, 8, 0x07FF, 0x7BEF, 0x0000);
+            gauges[i].setRange(uiParamRanges[i][0], uiParamRanges[i][1]);
+            screen.add(fields[i]);
+            screen.add(gauges[i]);
+        }
+        stepsLabel.begin(10, 170, 6, 1, 0xFFFF, 0x0000);
+        stepsLabel.setText("STEPS:");
+        grid.begin(60, 170, 16, 16, 15);
+        voices.begin(10, 196, 4, 20, 12, 24);
+        voices.setColors(0xFFFF, 0x7BEF, 0x07E0, 0x0000, 0x0000);
+        for (int v = 0; v < 4; v++) voices.setLabel(v, labels[v]);
+        stepField.begin(110, 200, 8, 1, 0xFFFF, 0x0000);
+        status.begin(10, 220, 30, 1, 0xFFFF, 0x0000);
+        screen.add(stepsLabel);
+        screen.add(grid);
+        screen.add(voices);
+        screen.add(stepField);
+        screen.add(status);
+    }
+};
+
+static BenchUi* benchUi;
+
+static void drawUiRetained(UiCanvas& canvas, const BenchUiState& state) {
+    BenchUi& ui = *benchUi;
+    for (int i = 0; i < 5; i++) {
+        ui.fields[i].printf("%s: %u", uiParamNames[i], state.values[i]);
+        ui.gauges[i].setValue(state.values[i]);
+    }
+    for (int i = 0; i < 16; i++) ui.grid.setStep(i, state.steps[i]);
+    ui.grid.setCurrent(state.step);
+    for (int v = 0; v < 4; v++) ui.voices.setActive(v, state.playing && v == state.voice);
+    ui.voices.setSelected(state.voice);
+    ui.stepField.printf("Step: %u", state.step + 1);
+    ui.status.printf("%s  Latency: %lu.%lu ms", state.playing ? "PLAY" : "STOP",
+                     (unsigned long)(state.latencyUs / 1000), (unsigned long)(state.latencyUs / 100 % 10));
+    ui.screen.render(canvas);
+}
+
+static void benchUiRetained(const BenchCase& bench, BenchRun& run) {
+    std::unique_ptr<BenchUi> ui(new BenchUi());
+    (void)bench;
+    benchUi = ui.get();
+    benchUiFrames(run, drawUiRetained);
+    benchUi = NULL;
+}
+
+// The render task's side of the audio tap: one block copied in
+static void benchTap(const BenchCase& bench, BenchRun& run) {
+    static int16_t block[BENCH_BLOCK_FRAMES * 2];
+    static int16_t mono[AUDIO_TAP_FRAMES];
+    std::unique_ptr<AudioTap> tap(new AudioTap());
+    (void)bench;
+
+    for (int i = 0; i < BENCH_BLOCK_FRAMES * 2; i++) block[i] = (int16_t)(i * 257);
+
+    run.begin();
+    for (unsigned long b = 0; b < BENCH_TAP_BLOCKS; b++) {
+        block[0] = (int16_t)b;
+        tap->write(block, BENCH_BLOCK_FRAMES);
+    }
+    run.end(BENCH_TAP_BLOCKS);
+
+    bool clean = tap->read(mono, AUDIO_TAP_FRAMES);
+    run.add(&clean, sizeof(clean));
+    run.add(mono, sizeof(mono));
+}
+
+// The UI's side: plucked sine notes stepping through three octaves, a new
+// one every other 50 ms UI frame, rendered into the tap and analysed each
+// frame. The tuner is scored on the first frame of each note.
+static void benchAnalysis(const BenchCase& bench, BenchRun& run) {
+    static int16_t buffer[BENCH_BLOCK_FRAMES * 2];
+    static int16_t low[128];
+    static int16_t high[128];
+    std::unique_ptr<MintySynth> synth = newSynth();
+    std::unique_ptr<AudioTap> tap(new AudioTap());
+    std::unique_ptr<AudioAnalyzer> analyzer(new AudioAnalyzer());
+    const int blocksPerFrame = SAMPLE_RATE / 20 / BENCH_BLOCK_FRAMES;
+    const int blocksPerNote = blocksPerFrame * 2;
+    (void)bench;
+
+    setLanes(*synth, WAVE_SINE, ENV_LONG, 127);
+    analyzer->begin(SAMPLE_RATE);
+
+    uint8_t note = 0;
+    uint32_t readings = 0;
+    uint32_t onNote = 0;
+    for (int b = 0; b < (int)BENCH_ANALYSIS_BLOCKS; b++) {
+        if (b % blocksPerNote == 0) {
+            note = 40 + (b / blocksPerNote) % 36;
+            synth->triggerVoice(0, note);
+        }
+        synth->processAudio(buffer, BENCH_BLOCK_FRAMES * 2);
+        tap->write(buffer, BENCH_BLOCK_FRAMES);
+        if (b % blocksPerFrame != blocksPerFrame - 1) continue;
+
+        run.begin();
+        bool fresh = analyzer->update(*tap);
+        analyzer->getScope(low, high, 128);
+        run.end(1);
+
+        const TunerReading& tuning = analyzer->getTuner();
+        if (fresh && b % blocksPerNote < blocksPerFrame) {
+            readings++;
+            onNote += tuning.valid && tuning.note == note;
+        }
+        run.add(analyzer->getBands(), AUDIO_SPECTRUM_BANDS);
+        run.add(&tuning.note, sizeof(tuning.note));
+        run.add(&tuning.cents, sizeof(tuning.cents));
+        run.add(low, sizeof(low));
+        run.add(high, sizeof(high));
+    }
+    run.setNote("tuner %lu/%lu on the note", (unsigned long)onNote, (unsigned long)readings);
+}
+
+// ParamSnapshot across two threads: every word of a set holds the number
+// of the publish that wrote it, so a set mixing two publishes, or one
+// older than the set read before it, shows up in the reader.
+struct BenchParamSet {
+    uint32_t words[BENCH_SNAPSHOT_WORDS];
+};
+
+struct BenchSnapshotShared {
+    ParamSnapshot<BenchParamSet> snapshot;
+    std::atomic<bool> done;
+    uint32_t seen;              // Reader owned until joined
+    uint32_t torn;
+    uint32_t backwards;
+    uint32_t last;
+};
+
+static void snapshotWriter(void* arg) {
+    BenchSnapshotShared* shared = (BenchSnapshotShared*)arg;
+    for (uint32_t n = 1; n <= BENCH_SNAPSHOT_SETS; n++) {
+        BenchParamSet& set = shared->snapshot.edit();
+        for (int w = 0; w < BENCH_SNAPSHOT_WORDS; w++) set.words[w] = n;
+        shared->snapshot.publish();
+        if (n % 16 == 0) std::this_thread::yield();     // Lets the reader in on one core too
+    }
+    shared->done.store(true, std::memory_order_release);
+    synthTaskExit();
+}
+
+static void snapshotReader(void* arg) {
+    BenchSnapshotShared* shared = (BenchSnapshotShared*)arg;
+    for (;;) {
+        // Checked before update(), so the last publish is still picked up
+        bool finished = shared->done.load(std::memory_order_acquire);
+        if (shared->snapshot.update()) {
+            const BenchParamSet& set = shared->snapshot.read();
+            uint32_t n = set.words[0];
+            for (int w = 1; w < BENCH_SNAPSHOT_WORDS; w++) {
+                if (set.words[w] != n) {
+                    shared->torn++;
+                    break;
+                }
+            }
+            if (n < shared->last) shared->backwards++;
+            shared->last = n;
+            shared->seen++;
+        } else if (finished) {
+            break;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    synthTaskExit();
+}
+
+static void benchSnapshot(const BenchCase& bench, BenchRun& run) {
+    std::unique_ptr<BenchSnapshotShared> shared(new BenchSnapshotShared());
+    BenchParamSet initial;
+    (void)bench;
+
+    memset(&initial, 0, sizeof(initial));
+    shared->snapshot.reset(initial);
+    shared->done.store(false);
+    shared->seen = shared->torn = shared->backwards = shared->last = 0;
+
+    SynthTask reader = NULL;
+    SynthTask writer = NULL;
+    run.begin();
+    synthTaskStart(&reader, snapshotReader, shared.get(), "reader", AUDIO_TASK_STACK,
+                   AUDIO_TASK_PRIORITY, AUDIO_TASK_CORE);
+    synthTaskStart(&writer, snapshotWriter, shared.get(), "writer", UI_TASK_STACK,
+                   UI_TASK_PRIORITY, UI_TASK_CORE);
+    synthTaskJoin(&writer);
+    synthTaskJoin(&reader);
+    run.end(BENCH_SNAPSHOT_SETS);
+
+    // How many sets the reader caught depends on scheduling; what it
+    // ends on and whether any were bad does not
+    if (shared->torn || shared->backwards || shared->last != BENCH_SNAPSHOT_SETS) run.fail();
+    uint32_t published = shared->snapshot.getPublishCount();
+    run.add(&published, sizeof(published));
+    run.add(&shared->last, sizeof(shared->last));
+    run.add(&shared->torn, sizeof(shared->torn));
+    run.add(&shared->backwards, sizeof(shared->backwards));
+    run.setNote("%lu seen, %lu torn, %lu backwards", (unsigned long)shared->seen,
+                (unsigned long)shared->torn, (unsigned long)shared->backwards);
+}
+
+// SpscQueue across two threads, sized and typed like the pipeline's
+// command queue. Every field of a command follows from its sequence
+// number, so the consumer can tell a lost, repeated, reordered or torn
+// command from the next expected one.
+struct BenchQueueShared {
+    SpscQueue<AudioCommand, AUDIO_COMMAND_QUEUE_SIZE> queue;
+    uint32_t full;              // Producer owned until joined
+    uint32_t received;          // Consumer owned until joined
+    uint32_t wrong;
+    BenchRun* run;
+};
+
+static void fillBenchCommand(AudioCommand& command, uint32_t n) {
+    command.type = (uint8_t)(n % 5);
+    command.voice = (uint8_t)(n & 3);
+    command.note = (uint8_t)(n & 127);
+    command.velocity = (uint8_t)((n >> 7) & 127);
+    command.keyUs = n;
+    command.sentUs = n ^ 0x9E3779B9u;
+}
+
+static void queueProducer(void* arg) {
+    BenchQueueShared* shared = (BenchQueueShared*)arg;
+    AudioCommand command;
+    for (uint32_t n = 0; n < BENCH_QUEUE_ITEMS; n++) {
+        fillBenchCommand(command, n);
+        while (!shared->queue.push(command)) {
+            shared->full++;
+            std::this_thread::yield();
+        }
+    }
+    synthTaskExit();
+}
+
+static void queueConsumer(void* arg) {
+    BenchQueueShared* shared = (BenchQueueShared*)arg;
+    AudioCommand command;
+    AudioCommand expected;
+    while (shared->received < BENCH_QUEUE_ITEMS) {
+        if (!shared->queue.pop(command)) {
+            std::this_thread::yield();
+            continue;
+        }
+        fillBenchCommand(expected, shared->received++);
+        if (command.type != expected.type || command.voice != expected.voice ||
+            command.note != expected.note || command.velocity != expected.velocity ||
+            command.keyUs != expected.keyUs || command.sentUs != expected.sentUs) {
+            shared->wrong++;
+        }
+        shared->run->add(&command.keyUs, sizeof(command.keyUs));
+    }
+    synthTaskExit();
+}
+
+static void benchQueue(const BenchCase& bench, BenchRun& run) {
+    std::unique_ptr<BenchQueueShared> shared(new BenchQueueShared());
+    (void)bench;
+
+    shared->full = shared->received = shared->wrong = 0;
+    shared->run = &run;
+
+    SynthTask consumer = NULL;
+    SynthTask producer = NULL;
+    run.begin();
+    synthTaskStart(&consumer, queueConsumer, shared.get(), "consumer", AUDIO_TASK_STACK,
+                   AUDIO_TASK_PRIORITY, AUDIO_TASK_CORE);
+    synthTaskStart(&producer, queueProducer, shared.get(), "producer", UI_TASK_STACK,
+                   UI_TASK_PRIORITY, UI_TASK_CORE);
+    synthTaskJoin(&producer);
+    synthTaskJoin(&consumer);
+    run.end(BENCH_QUEUE_ITEMS);
+
+    if (shared->wrong || !shared->queue.empty()) run.fail();
+    run.add(&shared->wrong, sizeof(shared->wrong));
+    run.setNote("%lu items, %lu wrong, %lu waits on full", (unsigned long)shared->received,
+                (unsigned long)shared->wrong, (unsigned long)shared->full);
+}
+
+static int buildCases(BenchCase* cases) {
+    int count = 0;
+    static const int voiceCounts[] = { 1, 4, 8, NUM_RENDER_VOICES };
+
+    for (size_t i = 0; i < sizeof(voiceCounts) / sizeof(voiceCounts[0]); i++) {
+        BenchCase& c = cases[count++];
+        snprintf(c.name, sizeof(c.name), "voices/%d", voiceCounts[i]);
+        c.unit = "frame";
+        c.function = benchVoices;
+        c.arg = voiceCounts[i];
+    }
+    BenchCase& mixer = cases[count++];
+    snprintf(mixer.name, sizeof(mixer.name), "voices/mixer");
+    mixer.unit = "frame";
+    mixer.function = benchMixer;
+    mixer.arg = 0;
+
+    static const char* const stealNames[3] = { "oldest", "quietest", "note" };
+    for (int p = 0; p < 3; p++) {
+        BenchCase& c = cases[count++];
+        snprintf(c.name, sizeof(c.name), "steal/%s", stealNames[p]);
+        c.unit = "note";
+        c.function = benchSteal;
+        c.arg = p;
+    }
+
+    for (int w = 0; w < NUM_WAVEFORMS; w++) {
+        BenchCase& c = cases[count++];
+        snprintf(c.name, sizeof(c.name), "wave/%s", waveNames[w]);
+        c.unit = "frame";
+        c.function = benchWaveform;
+        c.arg = w;
+    }
+    for (int e = 0; e < NUM_ENVELOPES; e++) {
+        BenchCase& c = cases[count++];
+        snprintf(c.name, sizeof(c.name), "envelope/%s", envelopeNames[e]);
+        c.unit = "frame";
+        c.function = benchEnvelope;
+        c.arg = e;
+    }
+
+    BenchCase& sequencer = cases[count++];
+    snprintf(sequencer.name, sizeof(sequencer.name), "sequencer");
+    sequencer.unit = "frame";
+    sequencer.function = benchSequencer;
+    sequencer.arg = 0;
+
+    BenchCase& velocity = cases[count++];
+    snprintf(velocity.name, sizeof(velocity.name), "sequencer/velocity");
+    velocity.unit = "frame";
+    velocity.function = benchVelocity;
+    velocity.arg = 0;
+
+    BenchCase& clock = cases[count++];
+    snprintf(clock.name, sizeof(clock.name), "sequencer/clock");
+    clock.unit = "step";
+    clock.function = benchClock;
+    clock.arg = 0;
+
+    BenchCase& song = cases[count++];
+    snprintf(song.name, sizeof(song.name), "sequencer/song");
+    song.unit = "frame";
+    song.function = benchSong;
+    song.arg = 0;
+
+    BenchCase& store = cases[count++];
+    snprintf(store.name, sizeof(store.name), "pattern/store");
+    store.unit = "load";
+    store.function = benchStore;
+    store.arg = 0;
+
+    BenchCase& presets = cases[count++];
+    snprintf(presets.name, sizeof(presets.name), "preset/log");
+    presets.unit = "load";
+    presets.function = benchPresetLog;
+    presets.arg = 0;
+
+    BenchCase& wheel = cases[count++];
+    snprintf(wheel.name, sizeof(wheel.name), "scheduler/wheel");
+    wheel.unit = "event";
+    wheel.function = benchWheel;
+    wheel.arg = 0;
+
+    BenchCase& linear = cases[count++];
+    snprintf(linear.name, sizeof(linear.name), "scheduler/linear");
+    linear.unit = "event";
+    linear.function = benchLinear;
+    linear.arg = 0;
+
+    BenchCase& input = cases[count++];
+    snprintf(input.name, sizeof(input.name), "input/keys");
+    input.unit = "scan";
+    input.function = benchInput;
+    input.arg = 0;
+
+    BenchCase& scan = cases[count++];
+    snprintf(scan.name, sizeof(scan.name), "input/scan");
+    scan.unit = "tick";
+    scan.function = benchScan;
+    scan.arg = 0;
+
+    BenchCase& encoder = cases[count++];
+    snprintf(encoder.name, sizeof(encoder.name), "input/encoder");
+    encoder.unit = "edge";
+    encoder.function = benchEncoder;
+    encoder.arg = 0;
+
+    BenchCase& midi = cases[count++];
+    snprintf(midi.name, sizeof(midi.name), "input/midi");
+    midi.unit = "message";
+    midi.function = benchMidi;
+    midi.arg = 0;
+
+    BenchCase& latency = cases[count++];
+    snprintf(latency.name, sizeof(latency.name), "latency/tuner");
+    latency.unit = "buffer";
+    latency.function = benchLatency;
+    latency.arg = 0;
+
+    BenchCase& probe = cases[count++];
+    snprintf(probe.name, sizeof(probe.name), "latency/probe");
+    probe.unit = "sample";
+    probe.function = benchProbe;
+    probe.arg = 0;
+
+    BenchCase& redraw = cases[count++];
+    snprintf(redraw.name, sizeof(redraw.name), "ui/redraw");
+    redraw.unit = "frame";
+    redraw.function = benchUiRedraw;
+    redraw.arg = 0;
+
+    BenchCase& retained = cases[count++];
+    snprintf(retained.name, sizeof(retained.name), "ui/retained");
+    retained.unit = "frame";
+    retained.function = benchUiRetained;
+    retained.arg = 0;
+
+    BenchCase& tap = cases[count++];
+    snprintf(tap.name, sizeof(tap.name), "analysis/tap");
+    tap.unit = "block";
+    tap.function = benchTap;
+    tap.arg = 0;
+
+    BenchCase& analysis = cases[count++];
+    snprintf(analysis.name, sizeof(analysis.name), "analysis/frame");
+    analysis.unit = "frame";
+    analysis.function = benchAnalysis;
+    analysis.arg = 0;
+
+    BenchCase& queue = cases[count++];
+    snprintf(queue.name, sizeof(queue.name), "threads/queue");
+    queue.unit = "item";
+    queue.function = benchQueue;
+    queue.arg = 0;
+
+    BenchCase& snapshot = cases[count++];
+    snprintf(snapshot.name, sizeof(snapshot.name), "threads/snapshot");
+    snapshot.unit = "set";
+    snapshot.function = benchSnapshot;
+    snapshot.arg = 0;
+
+    return count;
+}
+
+static const GoldenHash* findGolden(const char* name) {
+    for (size_t i = 0; i < sizeof(goldenHashes) / sizeof(goldenHashes[0]); i++) {
+        if (strcmp(goldenHashes[i].name, name) == 0) return &goldenHashes[i];
+    }
+    return NULL;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: minty-bench [-r repeats] [-p] [filter]\n");
+}
+
+int main(int argc, char** argv) {
+    int repeats = 5;
+    bool printGolden = false;
+    const char* filter = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            repeats = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0) {
+            printGolden = true;
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 1;
+        } else {
+            filter = argv[i];
+        }
+    }
+    if (repeats < 1) {
+        usage();
+        return 1;
+    }
+
+    BenchCase cases[64];
+    int caseCount = buildCases(cases);
+    int failures = 0;
+
+    if (!printGolden) printf("%-20s %12s  %-16s %s\n", "benchmark", "ns/item", "hash", "");
+
+    for (int i = 0; i < caseCount; i++) {
+        const BenchCase& bench = cases[i];
+        if (filter && !strstr(bench.name, filter)) continue;
+
+        double best = 0;
+        uint64_t hash = 0;
+        bool stable = true;
+        bool failed = false;
+        char note[sizeof(BenchRun::note)] = "";
+        for (int r = 0; r < repeats; r++) {
+            BenchRun run;
+            bench.function(bench, run);
+            memcpy(note, run.note, sizeof(note));
+            double perItem = run.items ? run.nanoseconds / run.items : 0;
+            if (r == 0 || perItem < best) best = perItem;
+            if (r > 0 && run.hash != hash) stable = false;
+            failed |= run.failed;
+            hash = run.hash;
+        }
+
+        if (printGolden) {
+            printf("    { \"%s\", 0x%016llxULL },\n", bench.name, (unsigned long long)hash);
+            continue;
+        }
+
+        const GoldenHash* golden = findGolden(bench.name);
+        const char* status = "ok";
+        if (failed) {
+            status = "FAILED";
+            failures++;
+        } else if (!stable) {
+            status = "UNSTABLE (differs between repeats)";
+            failures++;
+        } else if (!golden) {
+            status = "new (no golden hash)";
+        } else if (golden->hash != hash) {
+            status = "CHANGED";
+            failures++;
+        }
+        printf("%-20s %9.2f/%-5s %016llx %s%s%s\n", bench.name, best, bench.unit,
+               (unsigned long long)hash, status, note[0] ? "  " : "", note);
+    }
+
+    if (failures) {
+        printf("%d benchmark(s) failed or changed their output; if a change is intended, update "
+               "tools/bench/golden.h from minty-bench -p\n", failures);
+        return 1;
+    }
+    return 0;
+}
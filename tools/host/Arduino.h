@@ -0,0 +1,54 @@
+/*
+ * MintySynth Host Arduino Layer
+ *
+ * The part of the Arduino core that lib/MintySynth uses, for native
+ * (host) builds of the tools. millis() and micros() follow the wall
+ * clock until a tool calls hostClockAdvance(); from then on they only
+ * move when the tool advances them, so audio can be rendered on a
+ * simulated sample clock faster than realtime.
+ */
+
+#ifndef MINTYSYNTH_HOST_ARDUINO_H
+#define MINTYSYNTH_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+#define PI          3.1415926535897932384626433832795
+#define HALF_PI     1.5707963267948966192313216916398
+#define TWO_PI      6.283185307179586476925286766559
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+
+// Host clock
+inline bool hostClockSimulated = false;
+inline uint64_t hostClockMicros = 0;
+
+inline uint64_t hostClockNow() {
+    if (hostClockSimulated) return hostClockMicros;
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// Switches to the simulated clock and moves it forward
+inline void hostClockAdvance(uint64_t us) {
+    hostClockSimulated = true;
+    hostClockMicros += us;
+}
+
+inline unsigned long millis() { return (unsigned long)(hostClockNow() / 1000); }
+inline unsigned long micros() { return (unsigned long)hostClockNow(); }
+
+inline long random(long howbig) { return howbig > 0 ? rand() % howbig : 0; }
+inline long random(long howsmall, long howbig) {
+    return (howbig > howsmall) ? howsmall + random(howbig - howsmall) : howsmall;
+}
+
+#endif // MINTYSYNTH_HOST_ARDUINO_H
@@ -0,0 +1,72 @@
+/*
+ * MintySynth WAV Writer Implementation
+ */
+
+#include "WavWriter.h"
+#include <string.h>
+
+static void put16(uint8_t* p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t value) {
+    put16(p, value & 0xFFFF);
+    put16(p + 2, value >> 16);
+}
+
+WavWriter::WavWriter() : file(NULL), sampleRate(0), channels(0), dataBytes(0) {
+}
+
+WavWriter::~WavWriter() {
+    close();
+}
+
+bool WavWriter::open(const char* path, uint32_t rate, uint16_t channelCount) {
+    close();
+
+    file = fopen(path, "wb");
+    if (!file) return false;
+
+    sampleRate = rate;
+    channels = channelCount;
+    dataBytes = 0;
+    return writeHeader();
+}
+
+bool WavWriter::write(const int16_t* samples, size_t count) {
+    if (!file) return false;
+
+    // RIFF is little-endian, like every host this runs on
+    size_t written = fwrite(samples, sizeof(int16_t), count, file);
+    dataBytes += written * sizeof(int16_t);
+    return written == count;
+}
+
+bool WavWriter::close() {
+    if (!file) return true;
+
+    bool ok = (fseek(file, 0, SEEK_SET) == 0) && writeHeader();
+    ok = (fclose(file) == 0) && ok;
+    file = NULL;
+    return ok;
+}
+
+bool WavWriter::writeHeader() {
+    uint8_t header[44];
+
+    memcpy(header, "RIFF", 4);
+    put32(header + 4, 36 + dataBytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put32(header + 16, 16);                         // fmt chunk size
+    put16(header + 20, 1);                          // PCM
+    put16(header + 22, channels);
+    put32(header + 24, sampleRate);
+    put32(header + 28, sampleRate * channels * 2);  // Byte rate
+    put16(header + 32, channels * 2);               // Block align
+    put16(header + 34, 16);                         // Bits per sample
+    memcpy(header + 36, "data", 4);
+    put32(header + 40, dataBytes);
+
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
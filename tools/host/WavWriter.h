@@ -0,0 +1,36 @@
+/*
+ * MintySynth WAV Writer
+ *
+ * Streams 16-bit PCM into a RIFF/WAVE file for the host tools. The
+ * header sizes are patched in close().
+ */
+
+#ifndef MINTYSYNTH_WAVWRITER_H
+#define MINTYSYNTH_WAVWRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+class WavWriter {
+public:
+    WavWriter();
+    ~WavWriter();
+
+    bool open(const char* path, uint32_t sampleRate, uint16_t channels);
+    bool write(const int16_t* samples, size_t count);     // Interleaved samples
+    bool close();
+    bool isOpen() const { return file != NULL; }
+
+    uint32_t getFrames() const { return dataBytes / (2 * channels); }
+
+private:
+    FILE* file;
+    uint32_t sampleRate;
+    uint16_t channels;
+    uint32_t dataBytes;
+
+    bool writeHeader();
+};
+
+#endif // MINTYSYNTH_WAVWRITER_H
@@ -0,0 +1,275 @@
+/*
+ * MintySynth Pattern Files Implementation
+ */
+
+#include "PatternFile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string.h>
+#include <sstream>
+
+// Nested C initializer, e.g. {{1,2},{3}}
+struct InitNode {
+    bool leaf;
+    long value;
+    std::vector<InitNode> items;
+};
+
+static bool readFile(const char* path, std::string& text) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+
+    char chunk[4096];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0) text.append(chunk, count);
+    fclose(file);
+    return true;
+}
+
+static std::string stripComments(const std::string& text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text.compare(i, 2, "//") == 0) {
+            while (i < text.size() && text[i] != '\n') i++;
+        } else if (text.compare(i, 2, "/*") == 0) {
+            size_t end = text.find("*/", i + 2);
+            i = (end == std::string::npos) ? text.size() : end + 1;
+            continue;
+        }
+        if (i < text.size()) out += text[i];
+    }
+    return out;
+}
+
+static void skipSpace(const std::string& text, size_t& pos) {
+    while (pos < text.size() && isspace((unsigned char)text[pos])) pos++;
+}
+
+static bool parseInitializer(const std::string& text, size_t& pos, InitNode& node) {
+    skipSpace(text, pos);
+    if (pos >= text.size()) return false;
+
+    if (text[pos] != '{') {
+        char* end;
+        node.leaf = true;
+        node.value = strtol(text.c_str() + pos, &end, 0);
+        if (end == text.c_str() + pos) return false;
+        pos = end - text.c_str();
+        return true;
+    }
+
+    node.leaf = false;
+    pos++;
+    for (;;) {
+        skipSpace(text, pos);
+        if (pos >= text.size()) return false;
+        if (text[pos] == '}') {
+            pos++;
+            return true;
+        }
+        InitNode item;
+        if (!parseInitializer(text, pos, item)) return false;
+        node.items.push_back(item);
+        skipSpace(text, pos);
+        if (pos < text.size() && text[pos] == ',') pos++;
+    }
+}
+
+// Initializer of `name[...] = {...}`
+static bool findArray(const std::string& text, const char* name, InitNode& node) {
+    size_t pos = 0;
+    size_t length = strlen(name);
+    while ((pos = text.find(name, pos)) != std::string::npos) {
+        bool wordStart = (pos == 0) || !(isalnum((unsigned char)text[pos - 1]) || text[pos - 1] == '_');
+        pos += length;
+        if (!wordStart || pos >= text.size() || text[pos] != '[') continue;
+
+        size_t equals = text.find('=', pos);
+        if (equals == std::string::npos) return false;
+        pos = equals + 1;
+        return parseInitializer(text, pos, node);
+    }
+    return false;
+}
+
+// Element of a partially initialized aggregate, 0 where it was left out
+static long initValue(const InitNode& node, int i, int j, int k) {
+    if (node.leaf || i >= (int)node.items.size()) return 0;
+    const InitNode& a = node.items[i];
+    if (a.leaf || j >= (int)a.items.size()) return 0;
+    const InitNode& b = a.items[j];
+    if (b.leaf || k >= (int)b.items.size()) return 0;
+    return b.items[k].leaf ? b.items[k].value : 0;
+}
+
+void patternDefaults(Pattern& pattern) {
+    for (int v = 0; v < NUM_VOICES; v++) {
+        VoiceParams& voice = pattern.voices[v];
+        voice.waveform = WAVE_SINE;
+        voice.pitch = 60;
+        voice.envelope = ENV_PLUCK;
+        voice.length = 50;
+        voice.modulation = 64;
+        voice.volume = 100;
+        voice.lfoRate = 64;
+        voice.lfoShape = LFO_SINE;
+        voice.active = false;
+        for (int s = 0; s < NUM_STEPS; s++) pattern.notes[v][s] = 0;
+    }
+    pattern.tempo = 120;
+    pattern.swing = 0;
+}
+
+static bool loadOriginalSong(const std::string& text, const std::vector<int>& songs,
+                             PatternChain& chain, std::string& error) {
+    InitNode prefs, notes;
+    if (!findArray(text, "voicePrefs", prefs) || !findArray(text, "song", notes)) {
+        error = "no voicePrefs[][][] and song[][][] initializers";
+        return false;
+    }
+
+    for (size_t i = 0; i < songs.size(); i++) {
+        int song = songs[i];
+        if (song < 0 || song >= ORIGINAL_SONGS) {
+            error = "song index out of range 0-5";
+            return false;
+        }
+
+        Pattern pattern;
+        patternDefaults(pattern);
+        pattern.tempo = ORIGINAL_DEMO_TEMPO;
+        for (int v = 0; v < NUM_VOICES; v++) {
+            // wave, pitch, envelope, length, mod, MIDI channel, MIDI instrument
+            VoiceParams& voice = pattern.voices[v];
+            voice.waveform = constrain(initValue(prefs, song, v, 0), 0, NUM_WAVEFORMS - 1);
+            voice.pitch = constrain(initValue(prefs, song, v, 1), 0, 127);
+            voice.envelope = constrain(initValue(prefs, song, v, 2), 0, NUM_ENVELOPES - 1);
+            voice.length = constrain(initValue(prefs, song, v, 3), 0, 127);
+            voice.modulation = constrain(initValue(prefs, song, v, 4), 0, 127);
+            for (int s = 0; s < NUM_STEPS; s++) {
+                pattern.notes[v][s] = constrain(initValue(notes, song, v, s), 0, 127);
+            }
+        }
+        chain.push_back(pattern);
+    }
+    return true;
+}
+
+static bool setVoiceField(VoiceParams& voice, const std::string& key, int value) {
+    if (key == "waveform") voice.waveform = constrain(value, 0, NUM_WAVEFORMS - 1);
+    else if (key == "pitch") voice.pitch = constrain(value, 0, 127);
+    else if (key == "envelope") voice.envelope = constrain(value, 0, NUM_ENVELOPES - 1);
+    else if (key == "length") voice.length = constrain(value, 0, 127);
+    else if (key == "modulation") voice.modulation = constrain(value, 0, 127);
+    else if (key == "volume") voice.volume = constrain(value, 0, 127);
+    else if (key == "lforate") voice.lfoRate = constrain(value, 0, 127);
+    else if (key == "lfoshape") voice.lfoShape = constrain(value, 0, NUM_LFO_SHAPES - 1);
+    else return false;
+    return true;
+}
+
+static bool loadTextPattern(const std::string& text, PatternChain& chain, std::string& error) {
+    Pattern pattern;
+    patternDefaults(pattern);
+    bool started = false;
+
+    std::istringstream lines(text);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+
+        std::istringstream words(line);
+        std::string command;
+        if (!(words >> command)) continue;
+
+        bool ok = true;
+        if (command == "pattern") {
+            if (started) chain.push_back(pattern);
+            started = false;
+            // Lane settings and tempo carry over, the steps start empty
+            for (int v = 0; v < NUM_VOICES; v++) {
+                for (int s = 0; s < NUM_STEPS; s++) pattern.notes[v][s] = 0;
+            }
+        } else if (command == "tempo") {
+            int bpm = 0;
+            ok = (words >> bpm) && bpm > 0;
+            pattern.tempo = constrain(bpm, 60, 200);
+        } else if (command == "swing") {
+            int swing = 0;
+            ok = (bool)(words >> swing);
+            pattern.swing = constrain(swing, 0, 127);
+        } else if (command == "voice") {
+            int lane = -1;
+            ok = (words >> lane) && lane >= 0 && lane < NUM_VOICES;
+            std::string key;
+            int value;
+            while (ok && (words >> key)) {
+                ok = (words >> value) && setVoiceField(pattern.voices[lane], key, value);
+            }
+        } else if (command == "steps") {
+            int lane = -1;
+            ok = (words >> lane) && lane >= 0 && lane < NUM_VOICES;
+            std::string note;
+            int step = 0;
+            while (ok && step < NUM_STEPS && (words >> note)) {
+                pattern.notes[lane][step++] = (note == ".") ? 0 : constrain(atoi(note.c_str()), 0, 127);
+            }
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            error = "line " + std::to_string(lineNumber) + ": cannot parse \"" + line + "\"";
+            return false;
+        }
+        if (command == "voice" || command == "steps") started = true;
+    }
+
+    if (started) chain.push_back(pattern);
+    if (chain.empty()) {
+        error = "no patterns";
+        return false;
+    }
+    return true;
+}
+
+bool loadPatternFile(const char* path, const std::vector<int>& songs,
+                     PatternChain& chain, std::string& error) {
+    std::string text;
+    if (!readFile(path, text)) {
+        error = "cannot read file";
+        return false;
+    }
+
+    chain.clear();
+    text = stripComments(text);
+    if (text.find("voicePrefs") != std::string::npos) {
+        return loadOriginalSong(text, songs, chain, error);
+    }
+    return loadTextPattern(text, chain, error);
+}
+
+void applyPattern(MintySynth& synth, const Pattern& pattern) {
+    for (int v = 0; v < NUM_VOICES; v++) {
+        const VoiceParams& voice = pattern.voices[v];
+        synth.setVoiceParam(v, PARAM_WAVEFORM, voice.waveform);
+        synth.setVoiceParam(v, PARAM_PITCH, voice.pitch);
+        synth.setVoiceParam(v, PARAM_ENVELOPE, voice.envelope);
+        synth.setVoiceParam(v, PARAM_LENGTH, voice.length);
+        synth.setVoiceParam(v, PARAM_MODULATION, voice.modulation);
+        synth.setVoiceParam(v, PARAM_VOLUME, voice.volume);
+        synth.setVoiceParam(v, PARAM_LFO_RATE, voice.lfoRate);
+        synth.setVoiceParam(v, PARAM_LFO_SHAPE, voice.lfoShape);
+
+        for (int s = 0; s < NUM_STEPS; s++) {
+            if (pattern.notes[v][s]) synth.setStep(v, s, pattern.notes[v][s], true);
+            else synth.clearStep(v, s);
+        }
+    }
+    synth.setGlobalParam(GLOBAL_TEMPO, pattern.tempo);
+    synth.setGlobalParam(GLOBAL_SWING, pattern.swing);
+}
@@ -0,0 +1,54 @@
+/*
+ * MintySynth Pattern Files
+ *
+ * Loads patterns for the offline renderer from either
+ *
+ * - the original song.h layout (voicePrefs[6][4][7] and song[6][4][16]),
+ *   picking one or more of its six songs, or
+ * - a plain-text pattern file:
+ *
+ *     # comment
+ *     tempo 120
+ *     swing 0
+ *     pattern                       (starts the next pattern of a chain)
+ *     voice 0 waveform 3 envelope 2 length 50 modulation 64 volume 100
+ *     steps 0 60 . 62 . 64 . . . 67 . . . 72 . . .
+ *
+ *   voice takes any of: waveform pitch envelope length modulation volume
+ *   lforate lfoshape. steps takes a lane and 16 notes, "." or 0 = rest.
+ *   tempo and swing apply to the pattern they appear in and the ones
+ *   after it.
+ */
+
+#ifndef MINTYSYNTH_PATTERNFILE_H
+#define MINTYSYNTH_PATTERNFILE_H
+
+#include "MintySynth.h"
+#include <string>
+#include <vector>
+
+#define ORIGINAL_SONGS        6
+#define ORIGINAL_DEMO_TEMPO   89      // stepLength 168 ms in the original demo mode
+
+struct Pattern {
+    VoiceParams voices[NUM_VOICES];
+    uint8_t notes[NUM_VOICES][NUM_STEPS];   // 0 = rest
+    uint16_t tempo;
+    uint8_t swing;
+};
+
+// Patterns played one after the other
+typedef std::vector<Pattern> PatternChain;
+
+// Lane defaults of the engine (sine, pluck, length 50, no sweep, volume 100)
+void patternDefaults(Pattern& pattern);
+
+// Loads path. For song.h, `songs` lists the song indices to chain (the
+// original demo is 0 then 1). Returns false with a message in error.
+bool loadPatternFile(const char* path, const std::vector<int>& songs,
+                     PatternChain& chain, std::string& error);
+
+// Writes the pattern into the engine: lane parameters and steps
+void applyPattern(MintySynth& synth, const Pattern& pattern);
+
+#endif // MINTYSYNTH_PATTERNFILE_H
@@ -0,0 +1,386 @@
+/*
+ * MintySynth Offline Renderer
+ *
+ * Renders patterns to WAV on the host, faster than realtime, using the
+ * same MintySynth engine as the firmware. The sequencer runs on the
+ * engine's sample clock, so the output does not depend on how fast the
+ * host is.
+ *
+ *   minty-render [options] <pattern>...
+ *
+ *   -o <file>      Output WAV (one input only; default <pattern>.wav)
+ *   -s <list>      song.h songs to chain, e.g. 0,1 (default: the demo, 0,1)
+ *   -n <loops>     Times to play the chain (default 1)
+ *   -t <bpm>       Tempo override
+ *   -T <tuning>    SynthTuning 0-3
+ *   -l <ms>        Release tail after the last step (default 500)
+ *   -x             Throughput only, no WAV
+ *   -R             Play in realtime through AudioPipeline and the host
+ *                  stand-in of the I2S DMA output (AudioOutput); the WAV
+ *                  gets what the DMA played
+ *   -B <buffers>   DMA buffer count for -R (default 4)
+ *   -F <frames>    Frames per DMA buffer for -R (default 256)
+ *   -A             Adaptive latency for -R (LatencyTuner)
+ *   -k <ms>        With -R, press a key every <ms> (with contact bounce)
+ *                  through InputScanner; each press plays a note the way
+ *                  the firmware UI does, timed by a LatencyProbe
+ *
+ * Prints the rendered length and the realtime factor for every pattern,
+ * and the DMA underruns and the final latency with -R. With -k it prints
+ * the key-to-DAC breakdown in the format of the firmware's 'l' command.
+ */
+
+#include "MintySynth.h"
+#include "AudioPipeline.h"
+#include "AudioOutput.h"
+#include "InputScanner.h"
+#include "LatencyProbe.h"
+#include "PatternFile.h"
+#include "WavWriter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct RenderOptions {
+    std::vector<int> songs;
+    const char* output;
+    int loops;
+    int tempo;              // 0 = from the pattern
+    int tuning;
+    int tailMs;
+    bool writeWav;
+    bool realtime;
+    int dmaBuffers;
+    int dmaFrames;
+    bool adaptive;
+    int keyMs;              // 0 = no key presses
+};
+
+struct RenderResult {
+    uint64_t frames;
+    double seconds;         // Wall time spent rendering
+    uint32_t underruns;     // DMA buffers played before they were rendered (-R)
+    uint32_t latencyUs;     // Render to DAC at the end (-R)
+    uint32_t renderUs;      // Worst render time per DMA buffer (-R)
+    std::string latency;    // Key-to-DAC report (-k)
+};
+
+static void usage() {
+    fprintf(stderr,
+            "usage: minty-render [-o out.wav] [-s 0,1] [-n loops] [-t bpm] [-T tuning]\n"
+            "                    [-l tail_ms] [-x] [-R [-A] [-B buffers] [-F frames] [-k ms]] <pattern>...\n");
+}
+
+static std::vector<int> parseList(const char* text) {
+    std::vector<int> list;
+    while (*text) {
+        char* end;
+        long value = strtol(text, &end, 10);
+        if (end == text) break;
+        list.push_back((int)value);
+        text = (*end == ',') ? end + 1 : end;
+    }
+    return list;
+}
+
+// Renders up to `end` on the sample clock (SEQ_FRACTION_BITS), the last
+// block cut short, so a pattern applied next is in place for a step at end
+static void renderUntil(MintySynth& synth, uint64_t end, WavWriter* wav) {
+    static int16_t buffer[AUDIO_BUFFER_SIZE * 2];
+    uint64_t endFrame = (end + (1 << SEQ_FRACTION_BITS) - 1) >> SEQ_FRACTION_BITS;
+
+    while (synth.getSampleClock() < endFrame) {
+        uint64_t left = endFrame - synth.getSampleClock();
+        size_t frames = (left < AUDIO_BUFFER_SIZE) ? (size_t)left : AUDIO_BUFFER_SIZE;
+        synth.processAudio(buffer, frames * 2);
+        if (wav) wav->write(buffer, frames * 2);
+    }
+}
+
+static uint64_t toMicros(uint64_t clock) {
+    return (clock >> SEQ_FRACTION_BITS) * 1000000ULL / SAMPLE_RATE;
+}
+
+// Release tail in sample clock units
+static uint64_t tailLength(int tailMs) {
+    return ((uint64_t)tailMs * SAMPLE_RATE / 1000) << SEQ_FRACTION_BITS;
+}
+
+static bool renderChain(const PatternChain& chain, const RenderOptions& options,
+                        const char* path, RenderResult& result) {
+    std::unique_ptr<MintySynth> engine(new MintySynth());
+    MintySynth& synth = *engine;
+    WavWriter wav;
+
+    if (options.writeWav && !wav.open(path, SAMPLE_RATE, 2)) {
+        fprintf(stderr, "%s: cannot write\n", path);
+        return false;
+    }
+
+    synth.begin();
+    synth.setGlobalParam(GLOBAL_TUNING, options.tuning);
+    result.frames = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t end = 0;           // Pattern boundaries on the sample clock
+    bool started = false;
+
+    for (int loop = 0; loop < options.loops; loop++) {
+        for (size_t p = 0; p < chain.size(); p++) {
+            Pattern pattern = chain[p];
+            if (options.tempo) pattern.tempo = constrain(options.tempo, 60, 200);
+            applyPattern(synth, pattern);
+            if (!started) {
+                synth.start();
+                started = true;
+            }
+
+            // Sixteen steps at this pattern's tempo, then switch
+            end += NUM_STEPS * sequencerStepLength(pattern.tempo, SAMPLE_RATE);
+            renderUntil(synth, end, options.writeWav ? &wav : NULL);
+        }
+    }
+
+    // Let the last notes ring out with nothing new triggered
+    for (int lane = 0; lane < NUM_VOICES; lane++) {
+        for (int s = 0; s < NUM_STEPS; s++) synth.clearStep(lane, s);
+    }
+    end += tailLength(options.tailMs);
+    renderUntil(synth, end, options.writeWav ? &wav : NULL);
+    synth.stop();
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.frames = synth.getSampleClock();
+    result.underruns = 0;
+    result.latencyUs = 0;
+    result.renderUs = 0;
+    return wav.close();
+}
+
+// Sink of the simulated DMA in realtime mode, runs on the DMA thread
+static WavWriter* playedWav = NULL;
+
+static void writePlayed(const int16_t* buffer, size_t samples) {
+    if (playedWav) playedWav->write(buffer, samples);
+}
+
+// One key (button 0 on GPIO 0) pressed for half of every period. The
+// first 1.5 ms after each edge bounce every 300 us.
+class ReplayScanner : public InputScanner {
+public:
+    explicit ReplayScanner(uint32_t periodUs) : periodUs(periodUs) {}
+
+protected:
+    uint64_t readPins() override {
+        uint32_t phase = micros() % periodUs;
+        bool down = phase < periodUs / 2;
+        uint32_t since = down ? phase : phase - periodUs / 2;
+        if (since < 1500 && (since / 300) & 1) down = !down;
+        return down ? ~1ULL : ~0ULL;
+    }
+
+private:
+    uint32_t periodUs;
+};
+
+// The firmware's UI loop for the keys: every press becomes a stamped
+// note-on on lane 0, polled once a millisecond
+static void playKeys(AudioPipeline& audio, InputScanner& scanner, std::atomic<bool>& running) {
+    while (running.load()) {
+        InputEvent event;
+        while (scanner.pop(event)) {
+            if (event.down) audio.noteOn(0, 72, 127, event.us);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// The firmware's audio path on the wall clock: the render task fills the
+// DMA buffers in place as the simulated I2S plays them, while this thread
+// acts as the UI, switching patterns on time
+static bool playChain(const PatternChain& chain, const RenderOptions& options,
+                      const char* path, RenderResult& result) {
+    std::unique_ptr<MintySynth> engine(new MintySynth());
+    MintySynth& synth = *engine;
+    AudioPipeline audio(synth);
+    AudioOutput output;
+    std::unique_ptr<LatencyProbe> probe(new LatencyProbe());
+    ReplayScanner scanner(options.keyMs * 1000);
+    std::atomic<bool> pressing(true);
+    std::thread keys;
+    WavWriter wav;
+
+    if (options.writeWav && !wav.open(path, SAMPLE_RATE, 2)) {
+        fprintf(stderr, "%s: cannot write\n", path);
+        return false;
+    }
+    playedWav = options.writeWav ? &wav : NULL;
+
+    AudioOutputConfig config;
+    audioOutputDefaults(config, SAMPLE_RATE);
+    config.bufferCount = options.dmaBuffers;
+    config.bufferFrames = options.dmaFrames;
+    config.sink = writePlayed;
+
+    synth.begin();
+    synth.setGlobalParam(GLOBAL_TUNING, options.tuning);
+
+    auto start = std::chrono::steady_clock::now();
+    output.begin(config);
+    audio.setAdaptiveLatency(options.adaptive);
+    if (options.keyMs) {
+        static const uint8_t button = 0;
+        audio.setProbe(probe.get());
+        scanner.setButtons(&button, 1);
+        scanner.begin();
+    }
+    audio.begin(output);
+    if (options.keyMs) keys = std::thread(playKeys, std::ref(audio), std::ref(scanner), std::ref(pressing));
+
+    // Pattern boundaries on the sample clock, switched on the wall clock
+    uint64_t end = 0;
+    for (int loop = 0; loop < options.loops; loop++) {
+        for (size_t p = 0; p < chain.size(); p++) {
+            Pattern pattern = chain[p];
+            if (options.tempo) pattern.tempo = constrain(options.tempo, 60, 200);
+            applyPattern(synth, pattern);
+            if (loop == 0 && p == 0) audio.start();
+
+            end += NUM_STEPS * sequencerStepLength(pattern.tempo, SAMPLE_RATE);
+            std::this_thread::sleep_until(start + std::chrono::microseconds(toMicros(end)));
+        }
+    }
+
+    for (int lane = 0; lane < NUM_VOICES; lane++) {
+        for (int s = 0; s < NUM_STEPS; s++) synth.clearStep(lane, s);
+    }
+    end += tailLength(options.tailMs);
+    std::this_thread::sleep_until(start + std::chrono::microseconds(toMicros(end)));
+    if (keys.joinable()) {
+        pressing.store(false);
+        keys.join();
+        scanner.end();
+    }
+    audio.stop();
+    result.latencyUs = audio.getLatencyUs();
+    result.renderUs = audio.getRenderUs();
+
+    audio.end();
+    output.end();
+    playedWav = NULL;
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.frames = (uint64_t)output.getBuffersPlayed() * output.getBufferFrames();
+    result.underruns = output.getUnderruns();
+
+    if (options.keyMs) {
+        char line[96];
+        snprintf(line, sizeof(line), "  Key to DAC latency (DMA %d x %d frames, lead %u):\n", options.dmaBuffers,
+                 options.dmaFrames, output.getLead());
+        result.latency = line;
+        for (uint8_t stage = 0; stage < LATENCY_STAGES; stage++) {
+            probe->format(stage, line, sizeof(line));
+            result.latency += std::string("  ") + line + "\n";
+        }
+    }
+    return wav.close();
+}
+
+int main(int argc, char** argv) {
+    RenderOptions options;
+    options.songs.push_back(0);
+    options.songs.push_back(1);
+    options.output = NULL;
+    options.loops = 1;
+    options.tempo = 0;
+    options.tuning = TUNING_EQUAL;
+    options.tailMs = 500;
+    options.writeWav = true;
+    options.realtime = false;
+    options.dmaBuffers = AUDIO_OUTPUT_BUFFERS;
+    options.dmaFrames = AUDIO_OUTPUT_FRAMES;
+    options.adaptive = false;
+    options.keyMs = 0;
+
+    std::vector<const char*> inputs;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (!strcmp(arg, "-o") && hasValue) options.output = argv[++i];
+        else if (!strcmp(arg, "-s") && hasValue) options.songs = parseList(argv[++i]);
+        else if (!strcmp(arg, "-n") && hasValue) options.loops = atoi(argv[++i]);
+        else if (!strcmp(arg, "-t") && hasValue) options.tempo = atoi(argv[++i]);
+        else if (!strcmp(arg, "-T") && hasValue) options.tuning = atoi(argv[++i]);
+        else if (!strcmp(arg, "-l") && hasValue) options.tailMs = atoi(argv[++i]);
+        else if (!strcmp(arg, "-x")) options.writeWav = false;
+        else if (!strcmp(arg, "-R")) options.realtime = true;
+        else if (!strcmp(arg, "-A")) options.adaptive = true;
+        else if (!strcmp(arg, "-B") && hasValue) options.dmaBuffers = atoi(argv[++i]);
+        else if (!strcmp(arg, "-F") && hasValue) options.dmaFrames = atoi(argv[++i]);
+        else if (!strcmp(arg, "-k") && hasValue) options.keyMs = atoi(argv[++i]);
+        else if (arg[0] == '-') {
+            usage();
+            return 2;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (inputs.empty() || (options.output && inputs.size() > 1) || options.loops < 1 ||
+        options.tuning < 0 || options.tuning >= NUM_TUNINGS ||
+        options.dmaBuffers < 2 || options.dmaBuffers > AUDIO_OUTPUT_MAX_BUFFERS ||
+        options.dmaFrames < 1 || options.dmaFrames > AUDIO_OUTPUT_MAX_FRAMES ||
+        options.keyMs < 0 || (options.keyMs && (!options.realtime || options.keyMs < 20))) {
+        usage();
+        return 2;
+    }
+
+    int failures = 0;
+    double totalAudio = 0, totalWall = 0;
+
+    for (size_t i = 0; i < inputs.size(); i++) {
+        PatternChain chain;
+        std::string error;
+        if (!loadPatternFile(inputs[i], options.songs, chain, error)) {
+            fprintf(stderr, "%s: %s\n", inputs[i], error.c_str());
+            failures++;
+            continue;
+        }
+
+        std::string path = options.output ? options.output : std::string(inputs[i]) + ".wav";
+        RenderResult result;
+        bool ok = options.realtime ? playChain(chain, options, path.c_str(), result)
+                                   : renderChain(chain, options, path.c_str(), result);
+        if (!ok) {
+            failures++;
+            continue;
+        }
+
+        double audio = (double)result.frames / SAMPLE_RATE;
+        printf("%s: %u pattern(s), %.2f s audio in %.3f s, %.1fx realtime%s%s\n",
+               inputs[i], (unsigned)chain.size(), audio, result.seconds,
+               result.seconds > 0 ? audio / result.seconds : 0.0,
+               options.writeWav ? " -> " : "", options.writeWav ? path.c_str() : "");
+        if (options.realtime) {
+            printf("  DMA %d x %d frames, %u underrun(s), latency %.1f ms%s, render %u us/buffer\n",
+                   options.dmaBuffers, options.dmaFrames, (unsigned)result.underruns,
+                   result.latencyUs / 1000.0, options.adaptive ? " (adaptive)" : "",
+                   (unsigned)result.renderUs);
+            fputs(result.latency.c_str(), stdout);
+            if (result.underruns) failures++;
+        }
+        totalAudio += audio;
+        totalWall += result.seconds;
+    }
+
+    if (inputs.size() > 1 && totalWall > 0) {
+        printf("total: %.2f s audio in %.3f s, %.1fx realtime\n", totalAudio, totalWall, totalAudio / totalWall);
+    }
+    return failures ? 1 : 0;
+}